@@ -0,0 +1,343 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ComponentExecutor"
+#include <log/log.h>
+
+#include <cutils/properties.h>
+#include <utils/AndroidThreads.h>
+#include <utils/ThreadDefs.h>
+
+#include <inttypes.h>
+
+#include <algorithm>
+#include <sstream>
+
+#include <ComponentExecutor.h>
+
+namespace android {
+
+namespace {
+
+constexpr char kExecutorThreadsProperty[] = "debug.c2.sw.executor_threads";
+constexpr int32_t kMaxExecutorThreads = 32;
+constexpr size_t kMaxSpareThreads = 32;
+
+// The executor and worker index of the current thread, if it is a worker thread
+thread_local ComponentExecutor *tExecutor = nullptr;
+thread_local size_t tWorker = 0;
+
+}  // namespace
+
+ComponentStrand::ComponentStrand(
+        const std::string &name, const std::weak_ptr<ComponentExecutor> &executor)
+    : mName(name), mExecutor(executor), mScheduled(false), mClosed(false) {}
+
+void ComponentStrand::post(std::function<void()> task) {
+    std::shared_ptr<ComponentExecutor> executor = mExecutor.lock();
+    if (!executor) {
+        ALOGW("%s: executor is gone, dropping task", mName.c_str());
+        return;
+    }
+    bool schedule = false;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        if (mClosed) {
+            return;
+        }
+        mTasks.push_back({std::move(task), systemTime()});
+        mStats.queueDepth = mTasks.size();
+        mStats.maxQueueDepth = std::max(mStats.maxQueueDepth, mStats.queueDepth);
+        if (!mScheduled) {
+            mScheduled = true;
+            schedule = true;
+        }
+    }
+    if (schedule) {
+        executor->schedule(shared_from_this());
+    }
+}
+
+void ComponentStrand::close() {
+    std::deque<Task> tasks;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mClosed = true;
+        tasks.swap(mTasks);
+        mStats.queueDepth = 0;
+    }
+    // the tasks are destroyed outside of the lock, as they may hold the last reference to
+    // the owner of the strand
+}
+
+ComponentStrand::Stats ComponentStrand::stats() const {
+    std::lock_guard<std::mutex> lock(mLock);
+    return mStats;
+}
+
+bool ComponentStrand::runNext() {
+    Task task;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        if (mTasks.empty()) {
+            mScheduled = false;
+            return false;
+        }
+        task = std::move(mTasks.front());
+        mTasks.pop_front();
+        mStats.queueDepth = mTasks.size();
+    }
+    const nsecs_t startTimeNs = systemTime();
+    task.run();
+    const nsecs_t endTimeNs = systemTime();
+
+    std::lock_guard<std::mutex> lock(mLock);
+    const nsecs_t waitNs = startTimeNs - task.postTimeNs;
+    ++mStats.taskCount;
+    mStats.totalWaitNs += waitNs;
+    mStats.maxWaitNs = std::max(mStats.maxWaitNs, waitNs);
+    mStats.totalRunNs += endTimeNs - startTimeNs;
+    if (mTasks.empty()) {
+        mScheduled = false;
+        return false;
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// static
+std::shared_ptr<ComponentExecutor> ComponentExecutor::Shared() {
+    // The executor is never destroyed, as components may run until the process exits
+    static std::shared_ptr<ComponentExecutor> *const executor = [] {
+        const int32_t threadCount = std::clamp<int32_t>(
+                property_get_int32(kExecutorThreadsProperty, 0), 0, kMaxExecutorThreads);
+        return new std::shared_ptr<ComponentExecutor>(
+                threadCount > 0 ? std::make_shared<ComponentExecutor>(threadCount) : nullptr);
+    }();
+    return *executor;
+}
+
+ComponentExecutor::ComponentExecutor(size_t threadCount)
+    : mQueuedCount(0), mStopping(false), mNextWorker(0) {
+    for (size_t i = 0; i < threadCount; ++i) {
+        mWorkers.emplace_back(new Worker);
+    }
+    for (size_t i = 0; i < threadCount; ++i) {
+        mWorkers[i]->thread = std::thread([this, i] { threadLoop(i, nullptr); });
+    }
+}
+
+ComponentExecutor::~ComponentExecutor() {
+    {
+        std::lock_guard<std::mutex> lock(mIdleLock);
+        mStopping = true;
+    }
+    mIdleCondition.notify_all();
+    for (const std::unique_ptr<Worker> &worker : mWorkers) {
+        worker->thread.join();
+    }
+    // no spare threads are started once stopping
+    std::list<std::unique_ptr<Spare>> spares;
+    {
+        std::lock_guard<std::mutex> lock(mIdleLock);
+        spares.swap(mSpares);
+    }
+    // join in the order started, as a spare thread blocked in a task retires the spare
+    // thread it started
+    while (!spares.empty()) {
+        spares.pop_front();
+    }
+}
+
+ComponentExecutor::Spare::~Spare() {
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+std::shared_ptr<ComponentStrand> ComponentExecutor::createStrand(const std::string &name) {
+    std::shared_ptr<ComponentStrand> strand(new ComponentStrand(name, weak_from_this()));
+    std::lock_guard<std::mutex> lock(mStrandsLock);
+    mStrands.remove_if([](const std::weak_ptr<ComponentStrand> &strand) {
+        return strand.expired();
+    });
+    mStrands.push_back(strand);
+    return strand;
+}
+
+std::string ComponentExecutor::dump() const {
+    size_t spareCount = 0;
+    {
+        std::lock_guard<std::mutex> lock(mIdleLock);
+        spareCount = std::count_if(
+                mSpares.begin(), mSpares.end(),
+                [](const std::unique_ptr<Spare> &spare) { return !spare->retired; });
+    }
+    std::ostringstream out;
+    out << "ComponentExecutor: " << mWorkers.size() << " threads, " << spareCount
+        << " standing in for blocked tasks" << std::endl;
+    std::lock_guard<std::mutex> lock(mStrandsLock);
+    for (const std::weak_ptr<ComponentStrand> &weakStrand : mStrands) {
+        std::shared_ptr<ComponentStrand> strand = weakStrand.lock();
+        if (!strand) {
+            continue;
+        }
+        const ComponentStrand::Stats stats = strand->stats();
+        const nsecs_t count = std::max<nsecs_t>(stats.taskCount, 1);
+        out << "  " << strand->name() << ": queue depth " << stats.queueDepth
+            << " (max " << stats.maxQueueDepth << "), " << stats.taskCount << " tasks, wait "
+            << stats.totalWaitNs / count / 1000 << " us avg "
+            << stats.maxWaitNs / 1000 << " us max, run "
+            << stats.totalRunNs / count / 1000 << " us avg" << std::endl;
+    }
+    return out.str();
+}
+
+void ComponentExecutor::schedule(const std::shared_ptr<ComponentStrand> &strand) {
+    size_t worker;
+    if (tExecutor == this) {
+        // keep the strands posted to by a task on the worker running it, where their data is
+        // likely to be in cache; idle workers steal them if needed
+        worker = tWorker;
+    } else {
+        std::lock_guard<std::mutex> lock(mIdleLock);
+        worker = mNextWorker;
+        mNextWorker = (mNextWorker + 1) % mWorkers.size();
+    }
+    enqueue(worker, strand);
+}
+
+void ComponentExecutor::enqueue(size_t worker, const std::shared_ptr<ComponentStrand> &strand) {
+    {
+        std::lock_guard<std::mutex> lock(mWorkers[worker]->lock);
+        mWorkers[worker]->strands.push_back(strand);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mIdleLock);
+        ++mQueuedCount;
+    }
+    mIdleCondition.notify_one();
+}
+
+std::shared_ptr<ComponentStrand> ComponentExecutor::dequeue(size_t worker) {
+    // The caller claimed one of the queued strands, so one of the queues has a strand not
+    // claimed by other workers, or will have once its enqueue() completes.
+    for (;;) {
+        {
+            Worker &own = *mWorkers[worker];
+            std::lock_guard<std::mutex> lock(own.lock);
+            if (!own.strands.empty()) {
+                std::shared_ptr<ComponentStrand> strand = std::move(own.strands.front());
+                own.strands.pop_front();
+                return strand;
+            }
+        }
+        // steal from the back of the other queues, away from where their owners dequeue
+        for (size_t i = 1; i < mWorkers.size(); ++i) {
+            Worker &victim = *mWorkers[(worker + i) % mWorkers.size()];
+            std::lock_guard<std::mutex> lock(victim.lock);
+            if (!victim.strands.empty()) {
+                std::shared_ptr<ComponentStrand> strand = std::move(victim.strands.back());
+                victim.strands.pop_back();
+                ALOGV("worker %zu stole %s", worker, strand->name().c_str());
+                return strand;
+            }
+        }
+        std::this_thread::yield();
+    }
+}
+
+void ComponentExecutor::threadLoop(size_t worker, Spare *spare) {
+    tExecutor = this;
+    tWorker = worker;
+    androidSetThreadPriority(0, ANDROID_PRIORITY_VIDEO);
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mIdleLock);
+            mIdleCondition.wait(lock, [this, spare] {
+                return mQueuedCount > 0 || mStopping || (spare && spare->retired);
+            });
+            if (spare && spare->retired) {
+                spare->exited = true;
+                if (mQueuedCount > 0) {
+                    // pass on the wakeup this thread may have taken from a worker
+                    mIdleCondition.notify_one();
+                }
+                return;
+            }
+            if (mQueuedCount == 0) {
+                if (spare) {
+                    spare->exited = true;
+                }
+                return;
+            }
+            --mQueuedCount;
+        }
+        std::shared_ptr<ComponentStrand> strand = dequeue(worker);
+        if (strand->runNext()) {
+            enqueue(worker, strand);
+        }
+    }
+}
+
+ComponentExecutor::Spare *ComponentExecutor::startSpare(size_t worker) {
+    // the exited spare threads are joined after unlocking
+    std::list<std::unique_ptr<Spare>> exited;
+    std::lock_guard<std::mutex> lock(mIdleLock);
+    if (mStopping) {
+        return nullptr;
+    }
+    for (auto it = mSpares.begin(); it != mSpares.end(); ) {
+        auto next = std::next(it);
+        if ((*it)->exited) {
+            exited.splice(exited.end(), mSpares, it);
+        }
+        it = next;
+    }
+    if (mSpares.size() >= kMaxSpareThreads) {
+        ALOGW("too many blocked tasks, worker %zu waits without a spare thread", worker);
+        return nullptr;
+    }
+    mSpares.emplace_back(new Spare);
+    Spare *spare = mSpares.back().get();
+    spare->thread = std::thread([this, worker, spare] { threadLoop(worker, spare); });
+    return spare;
+}
+
+void ComponentExecutor::retireSpare(Spare *spare) {
+    {
+        std::lock_guard<std::mutex> lock(mIdleLock);
+        spare->retired = true;
+    }
+    // the spare thread finishes the task it may be running, and returns
+    mIdleCondition.notify_all();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+ComponentExecutor::BlockingScope::BlockingScope()
+    : mExecutor(tExecutor),
+      mSpare(mExecutor ? mExecutor->startSpare(tWorker) : nullptr) {}
+
+ComponentExecutor::BlockingScope::~BlockingScope() {
+    if (mSpare) {
+        mExecutor->retireSpare(mSpare);
+    }
+}
+
+}  // namespace android
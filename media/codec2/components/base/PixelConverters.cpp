@@ -0,0 +1,581 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "PixelConverters"
+#include <log/log.h>
+
+#include <cutils/properties.h>
+
+#include <string.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "PixelConverters.h"
+
+namespace android {
+
+namespace {
+
+#if defined(__i386__) || defined(__x86_64__)
+#define HAVE_AVX2_DISPATCH 1
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define HAVE_AVX2_DISPATCH 0
+#endif
+
+// The kernels are instantiated for each vector width, and inlined into the entry point of
+// their SIMD level so that they are compiled for its target.
+#define KERNEL inline __attribute__((always_inline))
+
+constexpr char kConvertThreadsProperty[] = "debug.c2.sw.convert_threads";
+constexpr size_t kMaxConvertThreads = 8;
+// frames smaller than 1080p are not worth waking up other threads for
+constexpr size_t kMinBandedPixelCount = 1920 * 1080;
+
+PixelSimdLevel detectPixelSimdLevel() {
+#if HAVE_AVX2_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return PIXEL_SIMD_AVX2;
+    }
+#endif
+    return PIXEL_SIMD_128;
+}
+
+/*
+ * Runs the bands of the frames converted by several threads. The pool is shared by all the
+ * components of the process, and the thread submitting a frame converts one of its bands.
+ *
+ * The pool has a fixed size: one thread per core, up to kMaxConvertThreads, counting the
+ * submitting thread, which is not part of the pool. It is created on first use, and its
+ * threads are joined when it is destroyed at exit, after converting the bands already queued.
+ */
+class RowBandPool {
+public:
+    static RowBandPool& getInstance() {
+        static RowBandPool pool;
+        return pool;
+    }
+
+    // Returns the number of bands that run in parallel, including the submitting thread.
+    size_t concurrency() const {
+        return mThreads.size() + 1;
+    }
+
+    void run(size_t bandCount, const std::function<void(size_t band)>& task) {
+        std::mutex doneLock;
+        std::condition_variable doneCondition;
+        size_t pending = bandCount - 1;
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            for (size_t band = 1; band < bandCount; ++band) {
+                mTasks.emplace_back([&, band] {
+                    task(band);
+                    std::lock_guard<std::mutex> lock(doneLock);
+                    if (--pending == 0) {
+                        doneCondition.notify_one();
+                    }
+                });
+            }
+        }
+        mCondition.notify_all();
+        task(0);
+        std::unique_lock<std::mutex> lock(doneLock);
+        doneCondition.wait(lock, [&pending] { return pending == 0; });
+    }
+
+private:
+    RowBandPool() {
+        const size_t coreCount = std::max(std::thread::hardware_concurrency(), 1u);
+        const size_t threadCount = std::min(coreCount, kMaxConvertThreads) - 1;
+        for (size_t i = 0; i < threadCount; ++i) {
+            mThreads.emplace_back([this] { threadLoop(); });
+        }
+    }
+
+    ~RowBandPool() {
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            mExiting = true;
+        }
+        mCondition.notify_all();
+        for (std::thread& thread : mThreads) {
+            thread.join();
+        }
+    }
+
+    void threadLoop() {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mLock);
+                mCondition.wait(lock, [this] { return mExiting || !mTasks.empty(); });
+                if (mTasks.empty()) {
+                    return;
+                }
+                task = std::move(mTasks.front());
+                mTasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::mutex mLock;
+    std::condition_variable mCondition;
+    std::deque<std::function<void()>> mTasks;
+    bool mExiting = false;
+    std::vector<std::thread> mThreads;
+
+    RowBandPool(const RowBandPool&) = delete;
+    RowBandPool& operator=(const RowBandPool&) = delete;
+};
+
+template <typename T, size_t N>
+struct Vector {
+    typedef T type __attribute__((vector_size(N * sizeof(T))));
+};
+
+template <typename T, size_t N>
+using vec = typename Vector<T, N>::type;
+
+// Lines are not aligned on a vector boundary
+template <typename V, typename T>
+KERNEL V load(const T* p) {
+    V v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+template <typename V, typename T>
+KERNEL void store(T* p, const V& v) {
+    memcpy(p, &v, sizeof(v));
+}
+
+template <typename V>
+constexpr size_t lanes() {
+    return sizeof(V) / sizeof(V{}[0]);
+}
+
+// Interleaves the low, or high, halves of the lanes of a and b
+template <bool HIGH, typename V, size_t... I>
+KERNEL V zip(const V& a, const V& b, std::index_sequence<I...>) {
+    constexpr size_t N = lanes<V>();
+    return __builtin_shufflevector(a, b, ((I % 2 ? N : 0) + (HIGH ? N / 2 : 0) + I / 2)...);
+}
+
+template <bool HIGH, typename V>
+KERNEL V zip(const V& a, const V& b) {
+    return zip<HIGH>(a, b, std::make_index_sequence<lanes<V>()>());
+}
+
+// Returns the even lanes of a, followed by the even lanes of b
+template <typename V, size_t... I>
+KERNEL V evens(const V& a, const V& b, std::index_sequence<I...>) {
+    return __builtin_shufflevector(a, b, (2 * I)...);
+}
+
+template <typename V>
+KERNEL V evens(const V& a, const V& b) {
+    return evens(a, b, std::make_index_sequence<lanes<V>()>());
+}
+
+template <typename V>
+KERNEL V clamp(const V& v, const V& lo, const V& hi) {
+    const V low = v < lo;
+    const V high = v > hi;
+    return (lo & low) | (hi & high) | (v & ~(low | high));
+}
+
+template <size_t W>
+KERNEL size_t yuv420Planar16ToY410(uint32_t *dst, const uint16_t *srcY, const uint16_t *srcU,
+                                   const uint16_t *srcV, size_t srcYStride, size_t srcUStride,
+                                   size_t srcVStride, size_t dstStride, size_t width,
+                                   size_t height) {
+    using u32 = vec<uint32_t, W>;
+    using u16 = vec<uint16_t, W>;
+    // Each 32-bit lane holds two luma samples, sharing one chroma sample
+    constexpr size_t kColumns = 2 * W;
+    size_t columns = width / kColumns * kColumns;
+    // The scalar loop converts 4 columns at a time and cannot be left with fewer
+    if (width - columns > 0 && width - columns < 4) {
+        columns = columns >= kColumns ? columns - kColumns : 0;
+    }
+
+    // The scalar converter only masks the first of every two samples it reads at once
+    u32 chromaMask;
+    for (size_t i = 0; i < W; ++i) {
+        chromaMask[i] = i % 2 ? 0xFFFF : 0x3FF;
+    }
+    for (size_t y = 0; y < height; y += 2) {
+        for (size_t x = 0; x < columns; x += kColumns) {
+            const u32 u = __builtin_convertvector(load<u16>(srcU + x / 2), u32) & chromaMask;
+            const u32 v = __builtin_convertvector(load<u16>(srcV + x / 2), u32) & chromaMask;
+            const u32 uv = u | (v << 20);
+            for (size_t row = 0; row < 2; ++row) {
+                const u32 luma = load<u32>(srcY + row * srcYStride + x);
+                const u32 even = 3u << 30 | ((luma & 0x3FF) << 10) | uv;
+                const u32 odd = 3u << 30 | ((luma >> 16) << 10) | uv;
+                uint32_t *out = dst + row * dstStride + x;
+                store(out, zip<false>(even, odd));
+                store(out + W, zip<true>(even, odd));
+            }
+        }
+        srcY += srcYStride * 2;
+        srcU += srcUStride;
+        srcV += srcVStride;
+        dst += dstStride * 2;
+    }
+    return columns;
+}
+
+template <typename U32, typename I32>
+KERNEL U32 packRGBA1010102(const I32& yMult, const I32& u_b, const I32& uv_g, const I32& v_r) {
+    const I32 zero = {};
+    const I32 max = zero + 1023;
+    const I32 b = clamp((yMult + u_b) / 1024, zero, max);
+    const I32 g = clamp((yMult + uv_g) / 1024, zero, max);
+    const I32 r = clamp((yMult + v_r) / 1024, zero, max);
+    return 3u << 30 | reinterpret_cast<U32>(b << 20 | g << 10 | r);
+}
+
+template <size_t W>
+KERNEL size_t yuv420Planar16ToRGBA1010102(uint32_t *dst, const uint16_t *srcY,
+                                          const uint16_t *srcU, const uint16_t *srcV,
+                                          size_t srcYStride, size_t srcUStride,
+                                          size_t srcVStride, size_t dstStride, size_t width,
+                                          size_t height, const YuvToRgbCoeffs &coeffs) {
+    using i32 = vec<int32_t, W>;
+    using u32 = vec<uint32_t, W>;
+    using u16 = vec<uint16_t, W>;
+    constexpr size_t kColumns = 2 * W;
+    const size_t columns = width / kColumns * kColumns;
+
+    for (size_t y = 0; y < height; y += 2) {
+        for (size_t x = 0; x < columns; x += kColumns) {
+            const i32 u = __builtin_convertvector(load<u16>(srcU + x / 2), i32) - 512;
+            const i32 v = __builtin_convertvector(load<u16>(srcV + x / 2), i32) - 512;
+            const i32 u_b = u * coeffs._b_u;
+            const i32 uv_g = v * -coeffs._g_v + u * -coeffs._g_u;
+            const i32 v_r = v * coeffs._r_v;
+            for (size_t row = 0; row < 2; ++row) {
+                // Each 32-bit lane holds two luma samples, sharing one chroma sample
+                const u32 luma = load<u32>(srcY + row * srcYStride + x);
+                const i32 y0 = reinterpret_cast<i32>(luma & 0xFFFF) - coeffs._c16;
+                const i32 y1 = reinterpret_cast<i32>(luma >> 16) - coeffs._c16;
+                const u32 even = packRGBA1010102<u32>(y0 * coeffs._y + 512, u_b, uv_g, v_r);
+                const u32 odd = packRGBA1010102<u32>(y1 * coeffs._y + 512, u_b, uv_g, v_r);
+                uint32_t *out = dst + row * dstStride + x;
+                store(out, zip<false>(even, odd));
+                store(out + W, zip<true>(even, odd));
+            }
+        }
+        srcY += srcYStride * 2;
+        srcU += srcUStride;
+        srcV += srcVStride;
+        dst += dstStride * 2;
+    }
+    return columns;
+}
+
+template <size_t W>
+KERNEL size_t yuv420Planar16ToYV12(uint8_t *dstY, uint8_t *dstU, uint8_t *dstV,
+                                   const uint16_t *srcY, const uint16_t *srcU,
+                                   const uint16_t *srcV, size_t srcYStride, size_t srcUStride,
+                                   size_t srcVStride, size_t dstYStride, size_t dstUVStride,
+                                   size_t width, size_t height, bool isMonochrome) {
+    using u16 = vec<uint16_t, 2 * W>;
+    using u8 = vec<uint8_t, 2 * W>;
+    // A whole vector of chroma samples for every two vectors of luma samples
+    constexpr size_t kColumns = 4 * W;
+    const size_t columns = width / kColumns * kColumns;
+
+    for (size_t y = 0; y < height; ++y) {
+        for (size_t x = 0; x < columns; x += lanes<u16>()) {
+            store(dstY + x, __builtin_convertvector(load<u16>(srcY + x) >> 2, u8));
+        }
+        srcY += srcYStride;
+        dstY += dstYStride;
+    }
+
+    for (size_t y = 0; y < (height + 1) / 2; ++y) {
+        if (isMonochrome) {
+            memset(dstU, 128, columns / 2);
+            memset(dstV, 128, columns / 2);
+        } else {
+            for (size_t x = 0; x < columns / 2; x += lanes<u16>()) {
+                store(dstU + x, __builtin_convertvector(load<u16>(srcU + x) >> 2, u8));
+                store(dstV + x, __builtin_convertvector(load<u16>(srcV + x) >> 2, u8));
+            }
+        }
+        srcU += srcUStride;
+        srcV += srcVStride;
+        dstU += dstUVStride;
+        dstV += dstUVStride;
+    }
+    return columns;
+}
+
+template <size_t W>
+KERNEL size_t yuv420Planar16ToP010(uint16_t *dstY, uint16_t *dstUV, const uint16_t *srcY,
+                                   const uint16_t *srcU, const uint16_t *srcV, size_t srcYStride,
+                                   size_t srcUStride, size_t srcVStride, size_t dstYStride,
+                                   size_t dstUVStride, size_t width, size_t height,
+                                   bool isMonochrome) {
+    using u16 = vec<uint16_t, 2 * W>;
+    constexpr size_t kLanes = lanes<u16>();
+    constexpr size_t kColumns = 2 * kLanes;
+    const size_t columns = width / kColumns * kColumns;
+
+    for (size_t y = 0; y < height; ++y) {
+        for (size_t x = 0; x < columns; x += kLanes) {
+            store(dstY + x, load<u16>(srcY + x) << 6);
+        }
+        srcY += srcYStride;
+        dstY += dstYStride;
+    }
+
+    const u16 neutral = u16{} + (512 << 6);
+    for (size_t y = 0; y < (height + 1) / 2; ++y) {
+        for (size_t x = 0; x < columns / 2; x += kLanes) {
+            const u16 u = isMonochrome ? neutral : load<u16>(srcU + x) << 6;
+            const u16 v = isMonochrome ? neutral : load<u16>(srcV + x) << 6;
+            store(dstUV + 2 * x, zip<false>(u, v));
+            store(dstUV + 2 * x + kLanes, zip<true>(u, v));
+        }
+        srcU += srcUStride;
+        srcV += srcVStride;
+        dstUV += dstUVStride;
+    }
+    return columns;
+}
+
+// Returns one of the Y, U or V components of RGBA1010102 pixels
+template <typename U16, typename U32, typename I32>
+KERNEL U16 rgbaToYuv(const U32& rgba, const int16_t* weights, const I32& offset, const I32& lo,
+                     const I32& hi) {
+    const I32 b = reinterpret_cast<I32>((rgba >> 20) & 0x3FF);
+    const I32 g = reinterpret_cast<I32>((rgba >> 10) & 0x3FF);
+    const I32 r = reinterpret_cast<I32>(rgba & 0x3FF);
+    const I32 value = ((r * weights[0] + g * weights[1] + b * weights[2] + 512) >> 10) + offset;
+    return __builtin_convertvector(clamp(value, lo, hi), U16);
+}
+
+KERNEL uint16_t rgbaToYuv(uint32_t rgba, const int16_t* weights, int32_t offset, int32_t lo,
+                          int32_t hi) {
+    const int32_t b = (rgba >> 20) & 0x3FF;
+    const int32_t g = (rgba >> 10) & 0x3FF;
+    const int32_t r = rgba & 0x3FF;
+    const int32_t value = ((r * weights[0] + g * weights[1] + b * weights[2] + 512) >> 10) + offset;
+    return std::clamp(value, lo, hi);
+}
+
+template <size_t W>
+KERNEL void rgba1010102ToYUV420Planar16(uint16_t *dstY, uint16_t *dstU, uint16_t *dstV,
+                                        const uint32_t *srcRGBA, size_t srcRGBStride,
+                                        size_t width, size_t height,
+                                        const int16_t (*weights)[3], uint16_t zeroLvl,
+                                        uint16_t maxLvlLuma, uint16_t maxLvlChroma) {
+    using i32 = vec<int32_t, W>;
+    using u32 = vec<uint32_t, W>;
+    using u16 = vec<uint16_t, W>;
+    constexpr size_t kColumns = 2 * W;
+    const size_t columns = width / kColumns * kColumns;
+
+    const i32 zero = i32{} + zeroLvl;
+    const i32 maxLuma = i32{} + maxLvlLuma;
+    const i32 maxChroma = i32{} + maxLvlChroma;
+    const i32 chromaOffset = i32{} + 512;
+
+    for (size_t y = 0; y < height; ++y) {
+        const bool hasChroma = y % 2 == 0;
+        size_t x = 0;
+        for (; x < columns; x += kColumns) {
+            const u32 rgba0 = load<u32>(srcRGBA + x);
+            const u32 rgba1 = load<u32>(srcRGBA + x + W);
+            store(dstY + x, rgbaToYuv<u16>(rgba0, weights[0], zero, zero, maxLuma));
+            store(dstY + x + W, rgbaToYuv<u16>(rgba1, weights[0], zero, zero, maxLuma));
+            if (hasChroma) {
+                // chroma is taken from the top left pixel of every 2x2 block
+                const u32 rgba = evens(rgba0, rgba1);
+                store(dstU + x / 2,
+                      rgbaToYuv<u16>(rgba, weights[1], chromaOffset, zero, maxChroma));
+                store(dstV + x / 2,
+                      rgbaToYuv<u16>(rgba, weights[2], chromaOffset, zero, maxChroma));
+            }
+        }
+        for (; x < width; ++x) {
+            dstY[x] = rgbaToYuv(srcRGBA[x], weights[0], zeroLvl, zeroLvl, maxLvlLuma);
+            if (hasChroma && x % 2 == 0) {
+                dstU[x >> 1] = rgbaToYuv(srcRGBA[x], weights[1], 512, zeroLvl, maxLvlChroma);
+                dstV[x >> 1] = rgbaToYuv(srcRGBA[x], weights[2], 512, zeroLvl, maxLvlChroma);
+            }
+        }
+        srcRGBA += srcRGBStride;
+        dstY += width;
+        if (hasChroma) {
+            dstU += width / 2;
+            dstV += width / 2;
+        }
+    }
+}
+
+// The entry points of each SIMD level, with the vector width of the level
+
+#define DEFINE_SIMD_LEVEL(NAME, ATTRIBUTES, W)                                                 \
+    struct NAME {                                                                              \
+        template <typename... Args>                                                            \
+        ATTRIBUTES static size_t y410(Args... args) {                                          \
+            return yuv420Planar16ToY410<W>(args...);                                           \
+        }                                                                                      \
+        template <typename... Args>                                                            \
+        ATTRIBUTES static size_t rgba1010102(Args... args) {                                   \
+            return yuv420Planar16ToRGBA1010102<W>(args...);                                    \
+        }                                                                                      \
+        template <typename... Args>                                                            \
+        ATTRIBUTES static size_t yv12(Args... args) {                                          \
+            return yuv420Planar16ToYV12<W>(args...);                                           \
+        }                                                                                      \
+        template <typename... Args>                                                            \
+        ATTRIBUTES static size_t p010(Args... args) {                                          \
+            return yuv420Planar16ToP010<W>(args...);                                           \
+        }                                                                                      \
+        template <typename... Args>                                                            \
+        ATTRIBUTES static void yuv420Planar16(Args... args) {                                  \
+            rgba1010102ToYUV420Planar16<W>(args...);                                           \
+        }                                                                                      \
+    };
+
+DEFINE_SIMD_LEVEL(Simd128, __attribute__((noinline)), 4)
+#if HAVE_AVX2_DISPATCH
+DEFINE_SIMD_LEVEL(SimdAvx2, __attribute__((noinline)) TARGET_AVX2, 8)
+#endif
+
+#undef DEFINE_SIMD_LEVEL
+
+// Calls kernel with the entry points of the current SIMD level, or returns none
+template <typename T, typename Kernel>
+T dispatch(T none, const Kernel& kernel) {
+    switch (pixelSimdLevel()) {
+#if HAVE_AVX2_DISPATCH
+        case PIXEL_SIMD_AVX2:
+            return kernel(SimdAvx2{});
+#else
+        case PIXEL_SIMD_AVX2:
+#endif
+        case PIXEL_SIMD_128:
+            return kernel(Simd128{});
+        default:
+            return none;
+    }
+}
+
+}  // namespace
+
+PixelSimdLevel& pixelSimdLevel() {
+    static PixelSimdLevel level = detectPixelSimdLevel();
+    return level;
+}
+
+size_t& pixelConverterThreadCount() {
+    static size_t count = std::clamp<int32_t>(
+            property_get_int32(kConvertThreadsProperty, 1), 1, kMaxConvertThreads);
+    return count;
+}
+
+void runInRowBands(size_t width, size_t height,
+                   const std::function<void(size_t rowBegin, size_t rowEnd)>& convert) {
+    if (pixelConverterThreadCount() <= 1 || width * height < kMinBandedPixelCount) {
+        convert(0, height);
+        return;
+    }
+    RowBandPool& pool = RowBandPool::getInstance();
+    // no more bands than can run in parallel
+    const size_t threadCount = std::min(pixelConverterThreadCount(), pool.concurrency());
+    // bands of an even number of rows
+    const size_t bandHeight = ((height + threadCount - 1) / threadCount + 1) & ~size_t(1);
+    const size_t bandCount = (height + bandHeight - 1) / bandHeight;
+    pool.run(bandCount, [&](size_t band) {
+        const size_t rowBegin = band * bandHeight;
+        convert(rowBegin, std::min(rowBegin + bandHeight, height));
+    });
+}
+
+size_t convertYUV420Planar16ToY410Simd(uint32_t *dst, const uint16_t *srcY,
+                                       const uint16_t *srcU, const uint16_t *srcV,
+                                       size_t srcYStride, size_t srcUStride, size_t srcVStride,
+                                       size_t dstStride, size_t width, size_t height) {
+    return dispatch(size_t(0), [&](auto simd) {
+        return decltype(simd)::y410(dst, srcY, srcU, srcV, srcYStride, srcUStride, srcVStride,
+                                    dstStride, width, height);
+    });
+}
+
+size_t convertYUV420Planar16ToRGBA1010102Simd(uint32_t *dst, const uint16_t *srcY,
+                                              const uint16_t *srcU, const uint16_t *srcV,
+                                              size_t srcYStride, size_t srcUStride,
+                                              size_t srcVStride, size_t dstStride, size_t width,
+                                              size_t height, const YuvToRgbCoeffs &coeffs) {
+    return dispatch(size_t(0), [&](auto simd) {
+        return decltype(simd)::rgba1010102(dst, srcY, srcU, srcV, srcYStride, srcUStride,
+                                           srcVStride, dstStride, width, height, coeffs);
+    });
+}
+
+size_t convertYUV420Planar16ToYV12Simd(uint8_t *dstY, uint8_t *dstU, uint8_t *dstV,
+                                       const uint16_t *srcY, const uint16_t *srcU,
+                                       const uint16_t *srcV, size_t srcYStride,
+                                       size_t srcUStride, size_t srcVStride, size_t dstYStride,
+                                       size_t dstUVStride, size_t width, size_t height,
+                                       bool isMonochrome) {
+    return dispatch(size_t(0), [&](auto simd) {
+        return decltype(simd)::yv12(dstY, dstU, dstV, srcY, srcU, srcV, srcYStride, srcUStride,
+                                    srcVStride, dstYStride, dstUVStride, width, height,
+                                    isMonochrome);
+    });
+}
+
+size_t convertYUV420Planar16ToP010Simd(uint16_t *dstY, uint16_t *dstUV, const uint16_t *srcY,
+                                       const uint16_t *srcU, const uint16_t *srcV,
+                                       size_t srcYStride, size_t srcUStride, size_t srcVStride,
+                                       size_t dstYStride, size_t dstUVStride, size_t width,
+                                       size_t height, bool isMonochrome) {
+    return dispatch(size_t(0), [&](auto simd) {
+        return decltype(simd)::p010(dstY, dstUV, srcY, srcU, srcV, srcYStride, srcUStride,
+                                    srcVStride, dstYStride, dstUVStride, width, height,
+                                    isMonochrome);
+    });
+}
+
+void convertRGBA1010102ToYUV420Planar16Simd(uint16_t *dstY, uint16_t *dstU, uint16_t *dstV,
+                                            const uint32_t *srcRGBA, size_t srcRGBStride,
+                                            size_t width, size_t height,
+                                            const int16_t (*weights)[3], uint16_t zeroLvl,
+                                            uint16_t maxLvlLuma, uint16_t maxLvlChroma) {
+    dispatch(false, [&](auto simd) {
+        decltype(simd)::yuv420Planar16(dstY, dstU, dstV, srcRGBA, srcRGBStride, width, height,
+                                       weights, zeroLvl, maxLvlLuma, maxLvlChroma);
+        return true;
+    });
+}
+
+}  // namespace android
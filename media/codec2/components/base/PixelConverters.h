@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PIXEL_CONVERTERS_H_
+#define PIXEL_CONVERTERS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+
+namespace android {
+
+/*
+ * Vector kernels of the pixel format converters of SimpleC2Component.
+ *
+ * The kernels are written with compiler vector extensions, which map onto NEON on ARM and SSE
+ * on x86. On x86, they are also compiled for AVX2 with twice the vector width, and the variant
+ * is selected at runtime from the CPU features. They give the same output as the scalar
+ * converters, bit for bit.
+ *
+ * Each kernel converts the leftmost columns of the frame that fill whole vectors, and returns
+ * the number of columns converted. The caller converts the remaining columns with the scalar
+ * code. All kernels return 0 with PIXEL_SIMD_NONE.
+ */
+
+enum PixelSimdLevel {
+    PIXEL_SIMD_NONE,
+    PIXEL_SIMD_128,   // NEON or SSE
+    PIXEL_SIMD_AVX2,
+};
+
+// Returns the SIMD level used by the kernels, detected once.
+// Tests may assign a lower level to compare the kernels with the scalar converters.
+PixelSimdLevel& pixelSimdLevel();
+
+// Returns the number of threads a large frame is converted with, from the
+// debug.c2.sw.convert_threads property (default 1). Tests may assign it.
+size_t& pixelConverterThreadCount();
+
+// Calls convert(rowBegin, rowEnd) on bands of rows covering [0, height). Frames of at least
+// 1080p are split in pixelConverterThreadCount() bands, at most one per core, run in parallel
+// on a shared pool; smaller frames are converted in a single band on the calling thread. Bands
+// start on an even row, so that they map onto whole rows of 4:2:0 chroma.
+void runInRowBands(size_t width, size_t height,
+                   const std::function<void(size_t rowBegin, size_t rowEnd)>& convert);
+
+// matrix conversion coefficients for YUV to RGB
+// (see media/libstagefright/colorconverter/ColorConverter.cpp for more details)
+struct YuvToRgbCoeffs {
+    int32_t _y, _r_v, _g_u, _g_v, _b_u, _c16;
+};
+
+size_t convertYUV420Planar16ToY410Simd(uint32_t *dst, const uint16_t *srcY,
+                                       const uint16_t *srcU, const uint16_t *srcV,
+                                       size_t srcYStride, size_t srcUStride, size_t srcVStride,
+                                       size_t dstStride, size_t width, size_t height);
+
+size_t convertYUV420Planar16ToRGBA1010102Simd(uint32_t *dst, const uint16_t *srcY,
+                                              const uint16_t *srcU, const uint16_t *srcV,
+                                              size_t srcYStride, size_t srcUStride,
+                                              size_t srcVStride, size_t dstStride, size_t width,
+                                              size_t height, const YuvToRgbCoeffs &coeffs);
+
+size_t convertYUV420Planar16ToYV12Simd(uint8_t *dstY, uint8_t *dstU, uint8_t *dstV,
+                                       const uint16_t *srcY, const uint16_t *srcU,
+                                       const uint16_t *srcV, size_t srcYStride,
+                                       size_t srcUStride, size_t srcVStride, size_t dstYStride,
+                                       size_t dstUVStride, size_t width, size_t height,
+                                       bool isMonochrome);
+
+size_t convertYUV420Planar16ToP010Simd(uint16_t *dstY, uint16_t *dstUV, const uint16_t *srcY,
+                                       const uint16_t *srcU, const uint16_t *srcV,
+                                       size_t srcYStride, size_t srcUStride, size_t srcVStride,
+                                       size_t dstYStride, size_t dstUVStride, size_t width,
+                                       size_t height, bool isMonochrome);
+
+// The RGBA to YUV kernel converts whole rows, as the scalar converter does not take a
+// destination stride. It does nothing with PIXEL_SIMD_NONE.
+void convertRGBA1010102ToYUV420Planar16Simd(uint16_t *dstY, uint16_t *dstU, uint16_t *dstV,
+                                            const uint32_t *srcRGBA, size_t srcRGBStride,
+                                            size_t width, size_t height,
+                                            const int16_t (*weights)[3], uint16_t zeroLvl,
+                                            uint16_t maxLvlLuma, uint16_t maxLvlChroma);
+
+}  // namespace android
+
+#endif  // PIXEL_CONVERTERS_H_
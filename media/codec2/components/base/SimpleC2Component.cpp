@@ -24,6 +24,7 @@
 #include <media/stagefright/foundation/AUtils.h>
 
 #include <inttypes.h>
+#include <future>
 #include <libyuv.h>
 
 #include <C2Config.h>
@@ -31,8 +32,11 @@
 #include <C2PlatformSupport.h>
 #include <Codec2BufferUtils.h>
 #include <Codec2CommonUtils.h>
+#include <ComponentExecutor.h>
 #include <SimpleC2Component.h>
 
+#include "PixelConverters.h"
+
 namespace android {
 
 // libyuv version required for I410ToAB30Matrix and I210ToAB30Matrix.
@@ -81,9 +85,11 @@ void convertYUV420Planar8ToYV12(uint8_t *dstY, uint8_t *dstU, uint8_t *dstV, con
     }
 }
 
-void convertYUV420Planar16ToY410(uint32_t *dst, const uint16_t *srcY, const uint16_t *srcU,
-                                 const uint16_t *srcV, size_t srcYStride, size_t srcUStride,
-                                 size_t srcVStride, size_t dstStride, size_t width, size_t height) {
+static void convertYUV420Planar16ToY410Scalar(uint32_t *dst, const uint16_t *srcY,
+                                              const uint16_t *srcU, const uint16_t *srcV,
+                                              size_t srcYStride, size_t srcUStride,
+                                              size_t srcVStride, size_t dstStride, size_t width,
+                                              size_t height) {
     // Converting two lines at a time, slightly faster
     for (size_t y = 0; y < height; y += 2) {
         uint32_t *dstTop = (uint32_t *)dst;
@@ -145,6 +151,26 @@ void convertYUV420Planar16ToY410(uint32_t *dst, const uint16_t *srcY, const uint
     }
 }
 
+void convertYUV420Planar16ToY410(uint32_t *dst, const uint16_t *srcY, const uint16_t *srcU,
+                                 const uint16_t *srcV, size_t srcYStride, size_t srcUStride,
+                                 size_t srcVStride, size_t dstStride, size_t width, size_t height) {
+    runInRowBands(width, height, [&](size_t rowBegin, size_t rowEnd) {
+        uint32_t *bandDst = dst + rowBegin * dstStride;
+        const uint16_t *bandY = srcY + rowBegin * srcYStride;
+        const uint16_t *bandU = srcU + rowBegin / 2 * srcUStride;
+        const uint16_t *bandV = srcV + rowBegin / 2 * srcVStride;
+        const size_t bandHeight = rowEnd - rowBegin;
+        const size_t x = convertYUV420Planar16ToY410Simd(
+                bandDst, bandY, bandU, bandV, srcYStride, srcUStride, srcVStride, dstStride,
+                width, bandHeight);
+        if (x < width) {
+            convertYUV420Planar16ToY410Scalar(bandDst + x, bandY + x, bandU + x / 2,
+                                              bandV + x / 2, srcYStride, srcUStride, srcVStride,
+                                              dstStride, width - x, bandHeight);
+        }
+    });
+}
+
 namespace {
 
 static C2ColorAspectsStruct FillMissingColorAspects(
@@ -198,13 +224,9 @@ static C2ColorAspectsStruct FillMissingColorAspects(
     return _aspects;
 }
 
-// matrix conversion coefficients
-// (see media/libstagefright/colorconverter/ColorConverter.cpp for more details)
-struct Coeffs {
-    int32_t _y, _r_v, _g_u, _g_v, _b_u, _c16;
-};
+using Coeffs = YuvToRgbCoeffs;
 
-static const struct Coeffs GetCoeffsForAspects(const C2ColorAspectsStruct &aspects) {
+static const Coeffs GetCoeffsForAspects(const C2ColorAspectsStruct &aspects) {
     bool isFullRange = aspects.range == C2Color::RANGE_FULL;
 
     switch (aspects.matrix) {
@@ -246,17 +268,11 @@ static const struct Coeffs GetCoeffsForAspects(const C2ColorAspectsStruct &aspec
 }
 
 #define CLIP3(min, v, max) (((v) < (min)) ? (min) : (((max) > (v)) ? (v) : (max)))
-void convertYUV420Planar16ToRGBA1010102(
+static void convertYUV420Planar16ToRGBA1010102Scalar(
         uint32_t *dst, const uint16_t *srcY, const uint16_t *srcU,
         const uint16_t *srcV, size_t srcYStride, size_t srcUStride,
         size_t srcVStride, size_t dstStride, size_t width,
-        size_t height,
-        std::shared_ptr<const C2ColorAspectsStruct> aspects) {
-
-    C2ColorAspectsStruct _aspects = FillMissingColorAspects(aspects, width, height);
-
-    struct Coeffs coeffs = GetCoeffsForAspects(_aspects);
-
+        size_t height, const Coeffs &coeffs) {
     int32_t _y = coeffs._y;
     int32_t _b_u = coeffs._b_u;
     int32_t _neg_g_u = -coeffs._g_u;
@@ -339,6 +355,34 @@ void convertYUV420Planar16ToRGBA1010102(
     }
 }
 
+void convertYUV420Planar16ToRGBA1010102(
+        uint32_t *dst, const uint16_t *srcY, const uint16_t *srcU,
+        const uint16_t *srcV, size_t srcYStride, size_t srcUStride,
+        size_t srcVStride, size_t dstStride, size_t width,
+        size_t height,
+        std::shared_ptr<const C2ColorAspectsStruct> aspects) {
+
+    C2ColorAspectsStruct _aspects = FillMissingColorAspects(aspects, width, height);
+
+    Coeffs coeffs = GetCoeffsForAspects(_aspects);
+
+    runInRowBands(width, height, [&](size_t rowBegin, size_t rowEnd) {
+        uint32_t *bandDst = dst + rowBegin * dstStride;
+        const uint16_t *bandY = srcY + rowBegin * srcYStride;
+        const uint16_t *bandU = srcU + rowBegin / 2 * srcUStride;
+        const uint16_t *bandV = srcV + rowBegin / 2 * srcVStride;
+        const size_t bandHeight = rowEnd - rowBegin;
+        const size_t x = convertYUV420Planar16ToRGBA1010102Simd(
+                bandDst, bandY, bandU, bandV, srcYStride, srcUStride, srcVStride, dstStride,
+                width, bandHeight, coeffs);
+        if (x < width) {
+            convertYUV420Planar16ToRGBA1010102Scalar(
+                    bandDst + x, bandY + x, bandU + x / 2, bandV + x / 2, srcYStride,
+                    srcUStride, srcVStride, dstStride, width - x, bandHeight, coeffs);
+        }
+    });
+}
+
 void convertYUV420Planar16ToY410OrRGBA1010102(
         uint32_t *dst, const uint16_t *srcY,
         const uint16_t *srcU, const uint16_t *srcV,
@@ -354,11 +398,12 @@ void convertYUV420Planar16ToY410OrRGBA1010102(
     }
 }
 
-void convertYUV420Planar16ToYV12(uint8_t *dstY, uint8_t *dstU, uint8_t *dstV, const uint16_t *srcY,
-                                 const uint16_t *srcU, const uint16_t *srcV, size_t srcYStride,
-                                 size_t srcUStride, size_t srcVStride, size_t dstYStride,
-                                 size_t dstUVStride, size_t width, size_t height,
-                                 bool isMonochrome) {
+static void convertYUV420Planar16ToYV12Scalar(uint8_t *dstY, uint8_t *dstU, uint8_t *dstV,
+                                              const uint16_t *srcY, const uint16_t *srcU,
+                                              const uint16_t *srcV, size_t srcYStride,
+                                              size_t srcUStride, size_t srcVStride,
+                                              size_t dstYStride, size_t dstUVStride, size_t width,
+                                              size_t height, bool isMonochrome) {
     for (size_t y = 0; y < height; ++y) {
         for (size_t x = 0; x < width; ++x) {
             dstY[x] = (uint8_t)(srcY[x] >> 2);
@@ -390,11 +435,37 @@ void convertYUV420Planar16ToYV12(uint8_t *dstY, uint8_t *dstU, uint8_t *dstV, co
     }
 }
 
-void convertYUV420Planar16ToP010(uint16_t *dstY, uint16_t *dstUV, const uint16_t *srcY,
+void convertYUV420Planar16ToYV12(uint8_t *dstY, uint8_t *dstU, uint8_t *dstV, const uint16_t *srcY,
                                  const uint16_t *srcU, const uint16_t *srcV, size_t srcYStride,
                                  size_t srcUStride, size_t srcVStride, size_t dstYStride,
                                  size_t dstUVStride, size_t width, size_t height,
                                  bool isMonochrome) {
+    runInRowBands(width, height, [&](size_t rowBegin, size_t rowEnd) {
+        uint8_t *bandDstY = dstY + rowBegin * dstYStride;
+        uint8_t *bandDstU = dstU + rowBegin / 2 * dstUVStride;
+        uint8_t *bandDstV = dstV + rowBegin / 2 * dstUVStride;
+        const uint16_t *bandY = srcY + rowBegin * srcYStride;
+        const uint16_t *bandU = srcU + rowBegin / 2 * srcUStride;
+        const uint16_t *bandV = srcV + rowBegin / 2 * srcVStride;
+        const size_t bandHeight = rowEnd - rowBegin;
+        const size_t x = convertYUV420Planar16ToYV12Simd(
+                bandDstY, bandDstU, bandDstV, bandY, bandU, bandV, srcYStride, srcUStride,
+                srcVStride, dstYStride, dstUVStride, width, bandHeight, isMonochrome);
+        if (x < width) {
+            convertYUV420Planar16ToYV12Scalar(
+                    bandDstY + x, bandDstU + x / 2, bandDstV + x / 2, bandY + x, bandU + x / 2,
+                    bandV + x / 2, srcYStride, srcUStride, srcVStride, dstYStride, dstUVStride,
+                    width - x, bandHeight, isMonochrome);
+        }
+    });
+}
+
+static void convertYUV420Planar16ToP010Scalar(uint16_t *dstY, uint16_t *dstUV,
+                                              const uint16_t *srcY, const uint16_t *srcU,
+                                              const uint16_t *srcV, size_t srcYStride,
+                                              size_t srcUStride, size_t srcVStride,
+                                              size_t dstYStride, size_t dstUVStride, size_t width,
+                                              size_t height, bool isMonochrome) {
     for (size_t y = 0; y < height; ++y) {
         for (size_t x = 0; x < width; ++x) {
             dstY[x] = srcY[x] << 6;
@@ -426,6 +497,30 @@ void convertYUV420Planar16ToP010(uint16_t *dstY, uint16_t *dstUV, const uint16_t
     }
 }
 
+void convertYUV420Planar16ToP010(uint16_t *dstY, uint16_t *dstUV, const uint16_t *srcY,
+                                 const uint16_t *srcU, const uint16_t *srcV, size_t srcYStride,
+                                 size_t srcUStride, size_t srcVStride, size_t dstYStride,
+                                 size_t dstUVStride, size_t width, size_t height,
+                                 bool isMonochrome) {
+    runInRowBands(width, height, [&](size_t rowBegin, size_t rowEnd) {
+        uint16_t *bandDstY = dstY + rowBegin * dstYStride;
+        uint16_t *bandDstUV = dstUV + rowBegin / 2 * dstUVStride;
+        const uint16_t *bandY = srcY + rowBegin * srcYStride;
+        const uint16_t *bandU = srcU + rowBegin / 2 * srcUStride;
+        const uint16_t *bandV = srcV + rowBegin / 2 * srcVStride;
+        const size_t bandHeight = rowEnd - rowBegin;
+        const size_t x = convertYUV420Planar16ToP010Simd(
+                bandDstY, bandDstUV, bandY, bandU, bandV, srcYStride, srcUStride, srcVStride,
+                dstYStride, dstUVStride, width, bandHeight, isMonochrome);
+        if (x < width) {
+            convertYUV420Planar16ToP010Scalar(
+                    bandDstY + x, bandDstUV + x, bandY + x, bandU + x / 2, bandV + x / 2,
+                    srcYStride, srcUStride, srcVStride, dstYStride, dstUVStride, width - x,
+                    bandHeight, isMonochrome);
+        }
+    });
+}
+
 void convertP010ToYUV420Planar16(uint16_t *dstY, uint16_t *dstU, uint16_t *dstV,
                                  const uint16_t *srcY, const uint16_t *srcUV,
                                  size_t srcYStride, size_t srcUVStride, size_t dstYStride,
@@ -490,6 +585,17 @@ void convertRGBA1010102ToYUV420Planar16(uint16_t* dstY, uint16_t* dstU, uint16_t
                                          ? bt709Matrix_10bit[colorRange - 1]
                                          : bt2020Matrix_10bit[colorRange - 1];
 
+    if (pixelSimdLevel() != PIXEL_SIMD_NONE) {
+        runInRowBands(width, height, [&](size_t rowBegin, size_t rowEnd) {
+            convertRGBA1010102ToYUV420Planar16Simd(
+                    dstY + rowBegin * width, dstU + rowBegin / 2 * (width / 2),
+                    dstV + rowBegin / 2 * (width / 2), srcRGBA + rowBegin * srcRGBStride,
+                    srcRGBStride, width, rowEnd - rowBegin, weights, zeroLvl, maxLvlLuma,
+                    maxLvlChroma);
+        });
+        return;
+    }
+
     for (size_t y = 0; y < height; ++y) {
         for (size_t x = 0; x < width; ++x) {
             b = (srcRGBA[x]  >> 20) & 0x3FF;
@@ -666,34 +772,29 @@ void SimpleC2Component::WorkHandler::setComponent(
     mThiz = thiz;
 }
 
-static void Reply(const sp<AMessage> &msg, int32_t *err = nullptr) {
+void SimpleC2Component::WorkHandler::onMessageReceived(const sp<AMessage> &msg) {
+    int32_t err = handle(msg->what());
     sp<AReplyToken> replyId;
-    CHECK(msg->senderAwaitsResponse(&replyId));
-    sp<AMessage> reply = new AMessage;
-    if (err) {
-        reply->setInt32("err", *err);
+    if (msg->senderAwaitsResponse(&replyId)) {
+        sp<AMessage> reply = new AMessage;
+        reply->setInt32("err", err);
+        reply->postReply(replyId);
     }
-    reply->postReply(replyId);
 }
 
-void SimpleC2Component::WorkHandler::onMessageReceived(const sp<AMessage> &msg) {
+int32_t SimpleC2Component::WorkHandler::handle(uint32_t what) {
     std::shared_ptr<SimpleC2Component> thiz = mThiz.lock();
     if (!thiz) {
-        ALOGD("component not yet set; msg = %s", msg->debugString().c_str());
-        sp<AReplyToken> replyId;
-        if (msg->senderAwaitsResponse(&replyId)) {
-            sp<AMessage> reply = new AMessage;
-            reply->setInt32("err", C2_CORRUPTED);
-            reply->postReply(replyId);
-        }
-        return;
+        ALOGD("component not yet set; msg = %u", what);
+        return C2_CORRUPTED;
     }
 
-    switch (msg->what()) {
+    int32_t err = C2_OK;
+    switch (what) {
         case kWhatProcess: {
             if (mRunning) {
                 if (thiz->processQueue()) {
-                    (new AMessage(kWhatProcess, this))->post();
+                    thiz->post(kWhatProcess);
                 }
             } else {
                 ALOGV("Ignore process message as we're not running");
@@ -701,8 +802,7 @@ void SimpleC2Component::WorkHandler::onMessageReceived(const sp<AMessage> &msg)
             break;
         }
         case kWhatInit: {
-            int32_t err = thiz->onInit();
-            Reply(msg, &err);
+            err = thiz->onInit();
             [[fallthrough]];
         }
         case kWhatStart: {
@@ -710,30 +810,28 @@ void SimpleC2Component::WorkHandler::onMessageReceived(const sp<AMessage> &msg)
             break;
         }
         case kWhatStop: {
-            int32_t err = thiz->onStop();
+            err = thiz->onStop();
             thiz->mOutputBlockPool.reset();
-            Reply(msg, &err);
             break;
         }
         case kWhatReset: {
             thiz->onReset();
             thiz->mOutputBlockPool.reset();
             mRunning = false;
-            Reply(msg);
             break;
         }
         case kWhatRelease: {
             thiz->onRelease();
             thiz->mOutputBlockPool.reset();
             mRunning = false;
-            Reply(msg);
             break;
         }
         default: {
-            ALOGD("Unrecognized msg: %d", msg->what());
+            ALOGD("Unrecognized msg: %u", what);
             break;
         }
     }
+    return err;
 }
 
 class SimpleC2Component::BlockingBlockPool : public C2BlockPool {
@@ -752,37 +850,40 @@ public:
             uint32_t capacity,
             C2MemoryUsage usage,
             std::shared_ptr<C2LinearBlock>* block) {
-        c2_status_t status;
-        do {
-            status = mBase->fetchLinearBlock(capacity, usage, block);
-        } while (status == C2_BLOCKING);
-        return status;
+        return fetch([&] { return mBase->fetchLinearBlock(capacity, usage, block); });
     }
 
     virtual c2_status_t fetchCircularBlock(
             uint32_t capacity,
             C2MemoryUsage usage,
             std::shared_ptr<C2CircularBlock>* block) {
-        c2_status_t status;
-        do {
-            status = mBase->fetchCircularBlock(capacity, usage, block);
-        } while (status == C2_BLOCKING);
-        return status;
+        return fetch([&] { return mBase->fetchCircularBlock(capacity, usage, block); });
     }
 
     virtual c2_status_t fetchGraphicBlock(
             uint32_t width, uint32_t height, uint32_t format,
             C2MemoryUsage usage,
             std::shared_ptr<C2GraphicBlock>* block) {
-        c2_status_t status;
+        return fetch([&] {
+            return mBase->fetchGraphicBlock(width, height, format, usage, block);
+        });
+    }
+
+private:
+    // Retries |fetchBlock| until it does not return C2_BLOCKING. The wait is marked as such
+    // for the shared executor, so that the other components keep running on it.
+    static c2_status_t fetch(const std::function<c2_status_t()> &fetchBlock) {
+        c2_status_t status = fetchBlock();
+        if (status != C2_BLOCKING) {
+            return status;
+        }
+        ComponentExecutor::BlockingScope blocking;
         do {
-            status = mBase->fetchGraphicBlock(width, height, format, usage,
-                                              block);
+            status = fetchBlock();
         } while (status == C2_BLOCKING);
         return status;
     }
 
-private:
     std::shared_ptr<C2BlockPool> mBase;
 };
 
@@ -800,18 +901,50 @@ SimpleC2Component::SimpleC2Component(
         const std::shared_ptr<C2ComponentInterface> &intf)
     : mDummyReadView(DummyReadView()),
       mIntf(intf),
-      mLooper(new ALooper),
       mHandler(new WorkHandler) {
+    if (std::shared_ptr<ComponentExecutor> executor = ComponentExecutor::Shared()) {
+        mStrand = executor->createStrand(intf->getName());
+        return;
+    }
+    mLooper = new ALooper;
     mLooper->setName(intf->getName().c_str());
     (void)mLooper->registerHandler(mHandler);
     mLooper->start(false, false, ANDROID_PRIORITY_VIDEO);
 }
 
 SimpleC2Component::~SimpleC2Component() {
+    if (mStrand) {
+        mStrand->close();
+        return;
+    }
     mLooper->unregisterHandler(mHandler->id());
     (void)mLooper->stop();
 }
 
+void SimpleC2Component::post(uint32_t what) {
+    if (mStrand) {
+        mStrand->post([handler = mHandler, what] { (void)handler->handle(what); });
+        return;
+    }
+    (new AMessage(what, mHandler))->post();
+}
+
+int32_t SimpleC2Component::postAndAwaitResponse(uint32_t what) {
+    if (mStrand) {
+        std::promise<int32_t> reply;
+        std::future<int32_t> err = reply.get_future();
+        mStrand->post([handler = mHandler, what, &reply] {
+            reply.set_value(handler->handle(what));
+        });
+        return err.get();
+    }
+    sp<AMessage> reply;
+    (new AMessage(what, mHandler))->postAndAwaitResponse(&reply);
+    int32_t err;
+    CHECK(reply->findInt32("err", &err));
+    return err;
+}
+
 c2_status_t SimpleC2Component::setListener_vb(
         const std::shared_ptr<C2Component::Listener> &listener, c2_blocking_t mayBlock) {
     mHandler->setComponent(shared_from_this());
@@ -847,7 +980,7 @@ c2_status_t SimpleC2Component::queue_nb(std::list<std::unique_ptr<C2Work>> * con
         }
     }
     if (queueWasEmpty) {
-        (new AMessage(WorkHandler::kWhatProcess, mHandler))->post();
+        post(WorkHandler::kWhatProcess);
     }
     return C2_OK;
 }
@@ -902,7 +1035,7 @@ c2_status_t SimpleC2Component::drain_nb(drain_mode_t drainMode) {
         queue->markDrain(drainMode);
     }
     if (queueWasEmpty) {
-        (new AMessage(WorkHandler::kWhatProcess, mHandler))->post();
+        post(WorkHandler::kWhatProcess);
     }
 
     return C2_OK;
@@ -916,15 +1049,12 @@ c2_status_t SimpleC2Component::start() {
     bool needsInit = (state->mState == UNINITIALIZED);
     state.unlock();
     if (needsInit) {
-        sp<AMessage> reply;
-        (new AMessage(WorkHandler::kWhatInit, mHandler))->postAndAwaitResponse(&reply);
-        int32_t err;
-        CHECK(reply->findInt32("err", &err));
+        int32_t err = postAndAwaitResponse(WorkHandler::kWhatInit);
         if (err != C2_OK) {
             return (c2_status_t)err;
         }
     } else {
-        (new AMessage(WorkHandler::kWhatStart, mHandler))->post();
+        post(WorkHandler::kWhatStart);
     }
     state.lock();
     state->mState = RUNNING;
@@ -945,10 +1075,7 @@ c2_status_t SimpleC2Component::stop() {
         queue->clear();
         queue->pending().clear();
     }
-    sp<AMessage> reply;
-    (new AMessage(WorkHandler::kWhatStop, mHandler))->postAndAwaitResponse(&reply);
-    int32_t err;
-    CHECK(reply->findInt32("err", &err));
+    int32_t err = postAndAwaitResponse(WorkHandler::kWhatStop);
     if (err != C2_OK) {
         return (c2_status_t)err;
     }
@@ -966,15 +1093,13 @@ c2_status_t SimpleC2Component::reset() {
         queue->clear();
         queue->pending().clear();
     }
-    sp<AMessage> reply;
-    (new AMessage(WorkHandler::kWhatReset, mHandler))->postAndAwaitResponse(&reply);
+    (void)postAndAwaitResponse(WorkHandler::kWhatReset);
     return C2_OK;
 }
 
 c2_status_t SimpleC2Component::release() {
     ALOGV("release");
-    sp<AMessage> reply;
-    (new AMessage(WorkHandler::kWhatRelease, mHandler))->postAndAwaitResponse(&reply);
+    (void)postAndAwaitResponse(WorkHandler::kWhatRelease);
     return C2_OK;
 }
 
@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENT_EXECUTOR_H_
+#define COMPONENT_EXECUTOR_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <utils/Timers.h>
+
+namespace android {
+
+class ComponentExecutor;
+
+/**
+ * A serial queue of tasks run on a ComponentExecutor.
+ *
+ * Tasks posted to a strand run one at a time, in the order they were posted, but not
+ * necessarily on the same thread.
+ */
+class ComponentStrand : public std::enable_shared_from_this<ComponentStrand> {
+public:
+    struct Stats {
+        size_t queueDepth = 0;      // tasks waiting to run
+        size_t maxQueueDepth = 0;
+        uint64_t taskCount = 0;     // tasks run
+        nsecs_t totalWaitNs = 0;    // from posting to running the tasks
+        nsecs_t maxWaitNs = 0;
+        nsecs_t totalRunNs = 0;
+    };
+
+    ~ComponentStrand() = default;
+
+    /**
+     * Posts a task to run after the tasks already posted. Tasks posted after close() are
+     * dropped.
+     */
+    void post(std::function<void()> task);
+
+    /**
+     * Drops the tasks not yet run. Does not wait for a running task, so that a strand may
+     * be closed from one of its tasks.
+     */
+    void close();
+
+    const std::string &name() const { return mName; }
+    Stats stats() const;
+
+private:
+    friend class ComponentExecutor;
+
+    ComponentStrand(const std::string &name, const std::weak_ptr<ComponentExecutor> &executor);
+
+    // Runs the next task, and returns whether the strand has more tasks to run.
+    bool runNext();
+
+    struct Task {
+        std::function<void()> run;
+        nsecs_t postTimeNs;
+    };
+
+    const std::string mName;
+    const std::weak_ptr<ComponentExecutor> mExecutor;
+    mutable std::mutex mLock;
+    std::deque<Task> mTasks;
+    bool mScheduled;    // queued on a worker or running
+    bool mClosed;
+    Stats mStats;
+};
+
+/**
+ * Runs the tasks of many strands, one per component, on a fixed pool of threads.
+ *
+ * Each worker thread has its own queue of strands ready to run. A strand posted to from a
+ * worker is queued on that worker; other strands are spread over the workers. An idle worker
+ * steals strands from the queues of the other workers. A strand runs one task per turn and
+ * then goes back at the end of the queue, so that busy components do not starve others.
+ *
+ * A task that waits for a resource, such as an output buffer, marks itself with a
+ * BlockingScope, so that a spare thread serves the queue of its worker in the meantime.
+ */
+class ComponentExecutor : public std::enable_shared_from_this<ComponentExecutor> {
+public:
+    /**
+     * Returns the executor shared by the software components of the process, with the number
+     * of threads of the debug.c2.sw.executor_threads property. Returns nullptr if the property
+     * is 0 (default), in which case each component runs on its own looper thread.
+     */
+    static std::shared_ptr<ComponentExecutor> Shared();
+
+    explicit ComponentExecutor(size_t threadCount);
+
+    // Runs the queued strands to completion, and joins the worker threads.
+    ~ComponentExecutor();
+
+    std::shared_ptr<ComponentStrand> createStrand(const std::string &name);
+
+    size_t threadCount() const { return mWorkers.size(); }
+
+    // Returns the stats of the live strands, one line per strand.
+    std::string dump() const;
+
+    class BlockingScope;
+
+private:
+    friend class ComponentStrand;
+
+    struct Worker {
+        std::mutex lock;
+        std::deque<std::shared_ptr<ComponentStrand>> strands;
+        std::thread thread;
+    };
+
+    // A thread standing in for a blocked worker. The flags are guarded by mIdleLock.
+    struct Spare {
+        ~Spare();
+
+        std::thread thread;
+        bool retired = false;   // the blocked task resumed
+        bool exited = false;    // the thread is about to return, and may be joined
+    };
+
+    void schedule(const std::shared_ptr<ComponentStrand> &strand);
+    void enqueue(size_t worker, const std::shared_ptr<ComponentStrand> &strand);
+    std::shared_ptr<ComponentStrand> dequeue(size_t worker);
+    void threadLoop(size_t worker, Spare *spare);
+
+    // Starts a spare thread serving the queue of |worker|. Returns nullptr if there are too
+    // many spare threads, or if the executor is stopping.
+    Spare *startSpare(size_t worker);
+    void retireSpare(Spare *spare);
+
+    std::vector<std::unique_ptr<Worker>> mWorkers;
+
+    mutable std::mutex mIdleLock;
+    std::condition_variable mIdleCondition;
+    size_t mQueuedCount;    // strands queued on all workers, guarded by mIdleLock
+    bool mStopping;
+    size_t mNextWorker;     // for strands posted to from other threads
+    std::list<std::unique_ptr<Spare>> mSpares;  // guarded by mIdleLock
+
+    mutable std::mutex mStrandsLock;
+    std::list<std::weak_ptr<ComponentStrand>> mStrands;
+};
+
+/**
+ * Marks the task running on the current thread as blocked until the scope ends. If the thread
+ * is a worker, a spare thread runs the strands queued on the worker meanwhile, so that a
+ * component waiting for its output buffers does not hold back the others. Has no effect on
+ * other threads.
+ */
+class ComponentExecutor::BlockingScope {
+public:
+    BlockingScope();
+    ~BlockingScope();
+
+private:
+    ComponentExecutor *const mExecutor;
+    Spare *mSpare;  // nullptr if no spare thread was started
+};
+
+}  // namespace android
+
+#endif  // COMPONENT_EXECUTOR_H_
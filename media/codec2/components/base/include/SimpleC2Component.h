@@ -31,6 +31,8 @@ struct C2ColorAspectsStruct;
 
 namespace android {
 
+class ComponentStrand;
+
 typedef enum {
     CONV_FORMAT_I420,
     CONV_FORMAT_I422,
@@ -239,6 +241,9 @@ private:
 
         void setComponent(const std::shared_ptr<SimpleC2Component> &thiz);
 
+        // Handles a message, and returns the error to reply with.
+        int32_t handle(uint32_t what);
+
     protected:
         void onMessageReceived(const sp<AMessage> &msg) override;
 
@@ -261,8 +266,14 @@ private:
     };
     Mutexed<ExecState> mExecState;
 
+    // The messages of the handler run on the looper thread of the component, or on the
+    // strand of the component in the shared executor if there is one.
     sp<ALooper> mLooper;
     sp<WorkHandler> mHandler;
+    std::shared_ptr<ComponentStrand> mStrand;
+
+    void post(uint32_t what);
+    int32_t postAndAwaitResponse(uint32_t what);
 
     class WorkQueue {
     public:
@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <ComponentExecutor.h>
+#include <gtest/gtest.h>
+
+namespace android {
+namespace {
+
+using namespace std::chrono_literals;
+
+// Waits for the tasks posted so far to the strands to run, and for their stats to be
+// updated. The stats of the task waited for may not be yet.
+void waitForStrands(const std::vector<std::shared_ptr<ComponentStrand>> &strands) {
+    for (const std::shared_ptr<ComponentStrand> &strand : strands) {
+        std::promise<void> done;
+        strand->post([&done] { done.set_value(); });
+        done.get_future().wait();
+    }
+}
+
+TEST(ComponentExecutorTest, RunsTasksOfAStrandInOrder) {
+    auto executor = std::make_shared<ComponentExecutor>(4);
+    std::vector<std::shared_ptr<ComponentStrand>> strands;
+    std::vector<std::vector<int>> results(8);
+    for (size_t i = 0; i < results.size(); ++i) {
+        strands.push_back(executor->createStrand("strand" + std::to_string(i)));
+    }
+    constexpr int kTaskCount = 1000;
+    for (int task = 0; task < kTaskCount; ++task) {
+        for (size_t i = 0; i < strands.size(); ++i) {
+            // the vector of a strand is not locked, as its tasks never run concurrently
+            strands[i]->post([&result = results[i], task] { result.push_back(task); });
+        }
+    }
+    waitForStrands(strands);
+    for (const std::vector<int> &result : results) {
+        ASSERT_EQ(result.size(), size_t(kTaskCount));
+        for (int task = 0; task < kTaskCount; ++task) {
+            EXPECT_EQ(result[task], task);
+        }
+    }
+}
+
+TEST(ComponentExecutorTest, NeverRunsTasksOfAStrandConcurrently) {
+    auto executor = std::make_shared<ComponentExecutor>(4);
+    std::shared_ptr<ComponentStrand> strand = executor->createStrand("strand");
+    std::atomic<int> running{0};
+    std::atomic<bool> overlapped{false};
+    std::vector<std::thread> posters;
+    for (int i = 0; i < 4; ++i) {
+        posters.emplace_back([&] {
+            for (int task = 0; task < 200; ++task) {
+                strand->post([&] {
+                    if (running.fetch_add(1) != 0) {
+                        overlapped = true;
+                    }
+                    std::this_thread::yield();
+                    running.fetch_sub(1);
+                });
+            }
+        });
+    }
+    for (std::thread &poster : posters) {
+        poster.join();
+    }
+    waitForStrands({strand});
+    EXPECT_FALSE(overlapped);
+    EXPECT_GE(strand->stats().taskCount, 800u);
+}
+
+// Strands posted to from a task are queued on the worker running it, and run in parallel
+// by the other workers stealing them.
+TEST(ComponentExecutorTest, IdleWorkersStealStrands) {
+    auto executor = std::make_shared<ComponentExecutor>(4);
+    std::vector<std::shared_ptr<ComponentStrand>> strands;
+    for (int i = 0; i < 8; ++i) {
+        strands.push_back(executor->createStrand("strand" + std::to_string(i)));
+    }
+    std::mutex lock;
+    std::set<std::thread::id> threads;
+    std::promise<void> posted;
+    executor->createStrand("poster")->post([&] {
+        for (const std::shared_ptr<ComponentStrand> &strand : strands) {
+            strand->post([&] {
+                std::this_thread::sleep_for(20ms);
+                std::lock_guard<std::mutex> guard(lock);
+                threads.insert(std::this_thread::get_id());
+            });
+        }
+        posted.set_value();
+    });
+    posted.get_future().wait();
+    waitForStrands(strands);
+    EXPECT_GT(threads.size(), 1u);
+}
+
+TEST(ComponentExecutorTest, Stats) {
+    auto executor = std::make_shared<ComponentExecutor>(1);
+    std::shared_ptr<ComponentStrand> strand = executor->createStrand("c2.test.strand");
+    std::promise<void> blocked;
+    std::shared_future<void> unblock = blocked.get_future().share();
+    strand->post([unblock] { unblock.wait(); });
+    for (int i = 0; i < 3; ++i) {
+        strand->post([] { std::this_thread::sleep_for(1ms); });
+    }
+    // the first task may not have started yet
+    EXPECT_GE(strand->stats().queueDepth, 3u);
+    std::this_thread::sleep_for(10ms);
+    blocked.set_value();
+    waitForStrands({strand});
+
+    const ComponentStrand::Stats stats = strand->stats();
+    EXPECT_EQ(stats.queueDepth, 0u);
+    EXPECT_GE(stats.maxQueueDepth, 3u);
+    EXPECT_GE(stats.taskCount, 4u);
+    EXPECT_GE(stats.maxWaitNs, nsecs_t(10000000));
+    EXPECT_GE(stats.totalRunNs, nsecs_t(13000000));
+    EXPECT_NE(executor->dump().find("c2.test.strand: queue depth 0"), std::string::npos);
+}
+
+TEST(ComponentExecutorTest, DropsTasksOfClosedStrands) {
+    auto executor = std::make_shared<ComponentExecutor>(1);
+    std::shared_ptr<ComponentStrand> blocker = executor->createStrand("blocker");
+    std::shared_ptr<ComponentStrand> strand = executor->createStrand("strand");
+    std::promise<void> blocked;
+    std::shared_future<void> unblock = blocked.get_future().share();
+    blocker->post([unblock] { unblock.wait(); });
+    bool ran = false;
+    strand->post([&ran] { ran = true; });
+    strand->close();
+    strand->post([&ran] { ran = true; });
+    blocked.set_value();
+    waitForStrands({blocker});
+    executor.reset();
+    EXPECT_FALSE(ran);
+}
+
+// A task waiting for another strand to run, like a decoder waiting for an output buffer
+// released by the client, does not hold back the strands queued behind it.
+TEST(ComponentExecutorTest, SpareThreadsStandInForBlockedTasks) {
+    auto executor = std::make_shared<ComponentExecutor>(1);
+    std::vector<std::shared_ptr<ComponentStrand>> blocked;
+    std::vector<std::promise<void>> released(3);
+    std::vector<std::future<void>> resumed;
+    for (size_t i = 0; i < released.size(); ++i) {
+        blocked.push_back(executor->createStrand("blocked" + std::to_string(i)));
+        std::shared_future<void> release = released[i].get_future().share();
+        std::shared_ptr<std::promise<void>> resume = std::make_shared<std::promise<void>>();
+        resumed.push_back(resume->get_future());
+        blocked[i]->post([release, resume] {
+            ComponentExecutor::BlockingScope blocking;
+            release.wait();
+            resume->set_value();
+        });
+    }
+    std::shared_ptr<ComponentStrand> releaser = executor->createStrand("releaser");
+    for (std::promise<void> &release : released) {
+        releaser->post([&release] { release.set_value(); });
+    }
+    for (std::future<void> &resume : resumed) {
+        ASSERT_EQ(std::future_status::ready, resume.wait_for(5s));
+    }
+    waitForStrands(blocked);
+    EXPECT_NE(executor->dump().find("1 threads, 0 standing in"), std::string::npos);
+}
+
+// A blocking scope outside of the executor has no effect.
+TEST(ComponentExecutorTest, BlockingScopeOutsideOfExecutor) {
+    auto executor = std::make_shared<ComponentExecutor>(1);
+    {
+        ComponentExecutor::BlockingScope blocking;
+    }
+    EXPECT_NE(executor->dump().find("1 threads, 0 standing in"), std::string::npos);
+}
+
+}  // namespace
+}  // namespace android
@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <random>
+#include <vector>
+
+#include <C2Config.h>
+#include <SimpleC2Component.h>
+#include <benchmark/benchmark.h>
+
+#include "PixelConverters.h"
+
+using namespace android;
+
+/*******************************************************************
+ * The first parameter is the frame height, 1080 or 2160 for 16:9 frames.
+ * The second parameter is the SIMD level: 0 for the scalar converters.
+ * The third parameter is the thread count.
+ *******************************************************************/
+
+struct ConverterBenchmark {
+    explicit ConverterBenchmark(benchmark::State& state)
+        : height(state.range(0)), width(height * 16 / 9) {
+        savedLevel = pixelSimdLevel();
+        savedThreadCount = pixelConverterThreadCount();
+        const PixelSimdLevel level = static_cast<PixelSimdLevel>(state.range(1));
+        if (level > savedLevel) {
+            state.SkipWithError("SIMD level not supported");
+        } else {
+            pixelSimdLevel() = level;
+        }
+        pixelConverterThreadCount() = state.range(2);
+
+        std::minstd_rand gen(height);
+        y.resize(width * height);
+        u.resize(width / 2 * height / 2);
+        v.resize(width / 2 * height / 2);
+        for (auto* plane : {&y, &u, &v}) {
+            for (auto& sample : *plane) {
+                sample = gen() & 0x3FF;
+            }
+        }
+    }
+
+    ~ConverterBenchmark() {
+        pixelSimdLevel() = savedLevel;
+        pixelConverterThreadCount() = savedThreadCount;
+    }
+
+    const size_t height;
+    const size_t width;
+    std::vector<uint16_t> y;
+    std::vector<uint16_t> u;
+    std::vector<uint16_t> v;
+    PixelSimdLevel savedLevel;
+    size_t savedThreadCount;
+};
+
+static void BM_YUV420Planar16ToRGBA1010102(benchmark::State& state) {
+    ConverterBenchmark frame(state);
+    std::vector<uint32_t> dst(frame.width * frame.height);
+    for (auto _ : state) {
+        convertYUV420Planar16ToY410OrRGBA1010102(
+                dst.data(), frame.y.data(), frame.u.data(), frame.v.data(), frame.width,
+                frame.width / 2, frame.width / 2, frame.width, frame.width, frame.height);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * frame.width * frame.height);
+}
+
+static void BM_YUV420Planar16ToP010(benchmark::State& state) {
+    ConverterBenchmark frame(state);
+    std::vector<uint16_t> dst(frame.width * frame.height * 3 / 2);
+    for (auto _ : state) {
+        convertYUV420Planar16ToP010(dst.data(), dst.data() + frame.width * frame.height,
+                                    frame.y.data(), frame.u.data(), frame.v.data(), frame.width,
+                                    frame.width / 2, frame.width / 2, frame.width, frame.width,
+                                    frame.width, frame.height);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * frame.width * frame.height);
+}
+
+static void BM_Planar16ToYV12(benchmark::State& state) {
+    ConverterBenchmark frame(state);
+    const size_t lumaSize = frame.width * frame.height;
+    std::vector<uint8_t> dst(lumaSize * 3 / 2);
+    for (auto _ : state) {
+        convertPlanar16ToYV12(dst.data(), dst.data() + lumaSize * 5 / 4, dst.data() + lumaSize,
+                              frame.y.data(), frame.u.data(), frame.v.data(), frame.width,
+                              frame.width / 2, frame.width / 2, frame.width, frame.width / 2,
+                              frame.width / 2, frame.width, frame.height, false,
+                              CONV_FORMAT_I420, nullptr, 0);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * frame.width * frame.height);
+}
+
+static void BM_RGBA1010102ToYUV420Planar16(benchmark::State& state) {
+    ConverterBenchmark frame(state);
+    const size_t lumaSize = frame.width * frame.height;
+    std::vector<uint32_t> src(lumaSize);
+    std::minstd_rand gen(frame.height);
+    for (auto& pixel : src) {
+        pixel = gen();
+    }
+    std::vector<uint16_t> dst(lumaSize * 3 / 2);
+    for (auto _ : state) {
+        convertRGBA1010102ToYUV420Planar16(dst.data(), dst.data() + lumaSize,
+                                           dst.data() + lumaSize * 5 / 4, src.data(),
+                                           frame.width, frame.width, frame.height,
+                                           C2Color::MATRIX_BT2020, C2Color::RANGE_LIMITED);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * lumaSize);
+}
+
+static void ConverterArgs(benchmark::internal::Benchmark* b) {
+    for (int height : {1080, 2160}) {
+        for (int level : {PIXEL_SIMD_NONE, PIXEL_SIMD_128, PIXEL_SIMD_AVX2}) {
+            for (int threadCount : {1, 4}) {
+                b->Args({height, level, threadCount});
+            }
+        }
+    }
+}
+
+BENCHMARK(BM_YUV420Planar16ToRGBA1010102)->Apply(ConverterArgs);
+BENCHMARK(BM_YUV420Planar16ToP010)->Apply(ConverterArgs);
+BENCHMARK(BM_Planar16ToYV12)->Apply(ConverterArgs);
+BENCHMARK(BM_RGBA1010102ToYUV420Planar16)->Apply(ConverterArgs);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include <C2Config.h>
+#include <SimpleC2Component.h>
+#include <gtest/gtest.h>
+
+#include "PixelConverters.h"
+
+namespace android {
+namespace {
+
+// A 4:2:0 10-bit frame, with strides larger than the width
+struct Yuv420Planar16 {
+    Yuv420Planar16(size_t width, size_t height, uint32_t seed)
+        : yStride(width + 6),
+          uvStride((width + 1) / 2 + 3),
+          // the converters read the second row of the last row pair of odd heights
+          y(yStride * (height + 1)),
+          u(uvStride * ((height + 1) / 2)),
+          v(uvStride * ((height + 1) / 2)) {
+        std::minstd_rand gen(seed);
+        for (auto* plane : {&y, &u, &v}) {
+            for (auto& sample : *plane) {
+                sample = gen() & 0x3FF;
+            }
+        }
+        // out of range samples are converted as by the scalar code too
+        y[1] = 0xFFFF;
+        u[1] = 0x8001;
+        v[3] = 0x4321;
+    }
+
+    size_t yStride;
+    size_t uvStride;
+    std::vector<uint16_t> y;
+    std::vector<uint16_t> u;
+    std::vector<uint16_t> v;
+};
+
+// Restores the SIMD level and thread count detected for the device
+class PixelConvertersTest
+        : public ::testing::TestWithParam<std::tuple<std::pair<size_t, size_t>, size_t>> {
+public:
+    void SetUp() override {
+        std::tie(mWidth, mHeight) = std::get<0>(GetParam());
+        mThreadCount = std::get<1>(GetParam());
+        mSimdLevel = pixelSimdLevel();
+        mDefaultThreadCount = pixelConverterThreadCount();
+    }
+
+    void TearDown() override {
+        pixelSimdLevel() = mSimdLevel;
+        pixelConverterThreadCount() = mDefaultThreadCount;
+    }
+
+    // Runs convert with the scalar code and with each SIMD level supported by the device, and
+    // expects the same output from all.
+    template <typename Output, typename Convert>
+    void expectSameAsScalar(Convert convert) {
+        pixelSimdLevel() = PIXEL_SIMD_NONE;
+        pixelConverterThreadCount() = 1;
+        const Output expected = convert();
+        pixelConverterThreadCount() = mThreadCount;
+        for (int level = PIXEL_SIMD_128; level <= mSimdLevel; ++level) {
+            SCOPED_TRACE(testing::Message() << "SIMD level " << level);
+            pixelSimdLevel() = static_cast<PixelSimdLevel>(level);
+            EXPECT_TRUE(convert() == expected);
+        }
+    }
+
+protected:
+    size_t mWidth;
+    size_t mHeight;
+    size_t mThreadCount;
+    PixelSimdLevel mSimdLevel;
+    size_t mDefaultThreadCount;
+};
+
+TEST_P(PixelConvertersTest, YUV420Planar16ToY410OrRGBA1010102) {
+    const Yuv420Planar16 src(mWidth, mHeight, 1);
+    const size_t dstStride = mWidth + 8;
+    expectSameAsScalar<std::vector<uint32_t>>([&] {
+        std::vector<uint32_t> dst(dstStride * (mHeight + 1));
+        convertYUV420Planar16ToY410OrRGBA1010102(dst.data(), src.y.data(), src.u.data(),
+                                                 src.v.data(), src.yStride, src.uvStride,
+                                                 src.uvStride, dstStride, mWidth, mHeight);
+        return dst;
+    });
+}
+
+TEST_P(PixelConvertersTest, YUV420Planar16ToP010) {
+    const Yuv420Planar16 src(mWidth, mHeight, 2);
+    const size_t dstYStride = mWidth + 10;
+    const size_t dstUVStride = mWidth + 12;
+    for (bool isMonochrome : {false, true}) {
+        SCOPED_TRACE(testing::Message() << "monochrome " << isMonochrome);
+        expectSameAsScalar<std::vector<uint16_t>>([&] {
+            std::vector<uint16_t> dst(dstYStride * mHeight + dstUVStride * ((mHeight + 1) / 2));
+            convertYUV420Planar16ToP010(dst.data(), dst.data() + dstYStride * mHeight,
+                                        src.y.data(), src.u.data(), src.v.data(), src.yStride,
+                                        src.uvStride, src.uvStride, dstYStride, dstUVStride,
+                                        mWidth, mHeight, isMonochrome);
+            return dst;
+        });
+    }
+}
+
+TEST_P(PixelConvertersTest, Planar16ToYV12) {
+    const Yuv420Planar16 src(mWidth, mHeight, 3);
+    const size_t dstYStride = mWidth + 10;
+    const size_t dstUVStride = (mWidth + 1) / 2 + 5;
+    const size_t chromaSize = dstUVStride * ((mHeight + 1) / 2);
+    for (bool isMonochrome : {false, true}) {
+        SCOPED_TRACE(testing::Message() << "monochrome " << isMonochrome);
+        expectSameAsScalar<std::vector<uint8_t>>([&] {
+            std::vector<uint8_t> dst(dstYStride * mHeight + 2 * chromaSize);
+            uint8_t* dstV = dst.data() + dstYStride * mHeight;
+            convertPlanar16ToYV12(dst.data(), dstV + chromaSize, dstV, src.y.data(),
+                                  src.u.data(), src.v.data(), src.yStride, src.uvStride,
+                                  src.uvStride, dstYStride, dstUVStride, dstUVStride, mWidth,
+                                  mHeight, isMonochrome, CONV_FORMAT_I420, nullptr, 0);
+            return dst;
+        });
+    }
+}
+
+TEST_P(PixelConvertersTest, RGBA1010102ToYUV420Planar16) {
+    const size_t srcStride = mWidth + 4;
+    std::vector<uint32_t> src(srcStride * mHeight);
+    std::minstd_rand gen(4);
+    for (auto& pixel : src) {
+        pixel = gen();
+    }
+    for (C2Color::matrix_t matrix : {C2Color::MATRIX_BT709, C2Color::MATRIX_BT2020}) {
+        for (C2Color::range_t range : {C2Color::RANGE_FULL, C2Color::RANGE_LIMITED}) {
+            SCOPED_TRACE(testing::Message() << "matrix " << matrix << " range " << range);
+            expectSameAsScalar<std::vector<uint16_t>>([&] {
+                // the chroma planes are packed with a stride of width / 2
+                const size_t chromaSize = mWidth / 2 * ((mHeight + 1) / 2) + 1;
+                std::vector<uint16_t> dst(mWidth * mHeight + 2 * chromaSize);
+                uint16_t* dstU = dst.data() + mWidth * mHeight;
+                convertRGBA1010102ToYUV420Planar16(dst.data(), dstU, dstU + chromaSize,
+                                                   src.data(), srcStride, mWidth, mHeight,
+                                                   matrix, range);
+                return dst;
+            });
+        }
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+        PixelConverters, PixelConvertersTest,
+        ::testing::Combine(::testing::Values(std::make_pair(1920, 1080),
+                                             std::make_pair(3840, 2160),
+                                             std::make_pair(1282, 720),
+                                             std::make_pair(174, 99),
+                                             std::make_pair(22, 10),
+                                             std::make_pair(18, 8)),
+                           ::testing::Values(1, 4)));
+
+}  // namespace
+}  // namespace android
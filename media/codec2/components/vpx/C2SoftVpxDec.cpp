@@ -19,9 +19,11 @@
 #include <log/log.h>
 
 #include <algorithm>
+#include <cutils/properties.h>
 #include <media/stagefright/foundation/AUtils.h>
 #include <media/stagefright/foundation/MediaDefs.h>
 
+#include <C2BlockInternal.h>
 #include <C2Debug.h>
 #include <C2PlatformSupport.h>
 #include <Codec2BufferUtils.h>
@@ -32,6 +34,7 @@
 
 namespace android {
 constexpr size_t kMinInputBufferSize = 2 * 1024 * 1024;
+constexpr char ZERO_COPY_PROPERTY[] = "debug.vp9dec.zerocopy";
 #ifdef VP9
 constexpr char COMPONENT_NAME[] = "c2.android.vp9.decoder";
 #else
@@ -369,7 +372,11 @@ C2SoftVpxDec::C2SoftVpxDec(
       mIntf(intfImpl),
       mCodecCtx(nullptr),
       mCoreCount(1),
-      mQueue(new Mutexed<ConversionQueue>) {
+      mQueue(new Mutexed<ConversionQueue>),
+      mZeroCopy(false),
+      mZeroCopyLayoutMismatch(false),
+      mFrameBufferWidth(0),
+      mFrameBufferHeight(0) {
 }
 
 C2SoftVpxDec::~C2SoftVpxDec() {
@@ -478,6 +485,17 @@ status_t C2SoftVpxDec::initDecoder() {
         return UNKNOWN_ERROR;
     }
 
+    // libvpx only supports external frame buffers for VP9.
+    mZeroCopy = mMode == MODE_VP9 && property_get_bool(ZERO_COPY_PROPERTY, false);
+    mZeroCopyLayoutMismatch = false;
+    mFrameBufferWidth = 0;
+    mFrameBufferHeight = 0;
+    if (mZeroCopy && (vpx_err = vpx_codec_set_frame_buffer_functions(
+                              mCodecCtx, GetFrameBuffer, ReleaseFrameBuffer, this))) {
+        ALOGW("failed to set frame buffer functions (%d), copying output", vpx_err);
+        mZeroCopy = false;
+    }
+
     if (mMode == MODE_VP9) {
         using namespace std::string_literals;
         for (int i = 0; i < mCoreCount; ++i) {
@@ -499,6 +517,10 @@ status_t C2SoftVpxDec::destroyDecoder() {
         delete mCodecCtx;
         mCodecCtx = nullptr;
     }
+    mFrameBuffers.clear();
+    mFreeFrameBuffers.clear();
+    mParkedBlocks.clear();
+    mFrameBufferPool.reset();
     bool running = true;
     for (const sp<ConverterThread> &thread : mConverterThreads) {
         thread->requestExit();
@@ -531,9 +553,8 @@ void fillEmptyWork(const std::unique_ptr<C2Work> &work) {
 }
 
 void C2SoftVpxDec::finishWork(uint64_t index, const std::unique_ptr<C2Work> &work,
-                           const std::shared_ptr<C2GraphicBlock> &block) {
-    std::shared_ptr<C2Buffer> buffer = createGraphicBuffer(block,
-                                                           C2Rect(mWidth, mHeight));
+                           const std::shared_ptr<C2GraphicBlock> &block, const C2Rect &crop) {
+    std::shared_ptr<C2Buffer> buffer = createGraphicBuffer(block, crop);
     auto fillWork = [buffer, index, intf = this->mIntf](
             const std::unique_ptr<C2Work> &work) {
         uint32_t flags = 0;
@@ -628,6 +649,21 @@ void C2SoftVpxDec::process(
 
     if (inSize) {
         uint8_t *bitstream = const_cast<uint8_t *>(rView.data() + inOffset);
+        if (mZeroCopy) {
+            // The frame buffers are requested during the decode, before the frame size is
+            // known from the output image. It is known here for key frames, which all size
+            // changes of common streams come with.
+            vpx_codec_stream_info_t si;
+            memset(&si, 0, sizeof(si));
+            si.sz = sizeof(si);
+            if (vpx_codec_peek_stream_info(&vpx_codec_vp9_dx_algo, bitstream, inSize, &si) ==
+                        VPX_CODEC_OK &&
+                si.w && si.h) {
+                mFrameBufferWidth = si.w;
+                mFrameBufferHeight = si.h;
+            }
+            mFrameBufferPool = pool;
+        }
         vpx_codec_err_t err = vpx_codec_decode(
                 mCodecCtx, bitstream, inSize, &work->input.ordinal.frameIndex, 0);
         if (err != VPX_CODEC_OK) {
@@ -700,6 +736,7 @@ status_t C2SoftVpxDec::outputBuffer(
         return false;
     }
 
+    const uint64_t index = ((c2_cntr64_t *)img->user_priv)->peekull();
     std::shared_ptr<C2GraphicBlock> block;
     uint32_t format = HAL_PIXEL_FORMAT_YV12;
     std::shared_ptr<C2StreamColorAspectsTuning::output> defaultColorAspects;
@@ -733,13 +770,18 @@ status_t C2SoftVpxDec::outputBuffer(
         mHalPixelFormat = format;
     }
 
+    C2Rect crop;
+    if (mZeroCopy && format == HAL_PIXEL_FORMAT_YV12 && getZeroCopyCrop(img, &crop)) {
+        finishWork(index, work, static_cast<const FrameBuffer *>(img->fb_priv)->block, crop);
+        return OK;
+    }
+
     C2MemoryUsage usage = { C2MemoryUsage::CPU_READ, C2MemoryUsage::CPU_WRITE };
     // We always create a graphic block that is width aligned to 16 and height
     // aligned to 2. We set the correct "crop" value of the image in the call to
     // createGraphicBuffer() by setting the correct image dimensions.
-    c2_status_t err = pool->fetchGraphicBlock(align(mWidth, 16),
-                                              align(mHeight, 2), format, usage,
-                                              &block);
+    c2_status_t err = fetchBlock(pool, align(mWidth, 16), align(mHeight, 2), format, usage,
+                                 &block);
     if (err != C2_OK) {
         ALOGE("fetchGraphicBlock for Output failed with status %d", err);
         work->result = err;
@@ -819,10 +861,234 @@ status_t C2SoftVpxDec::outputBuffer(
         convertYUV420Planar8ToYV12(dstY, dstU, dstV, srcY, srcU, srcV, srcYStride, srcUStride,
                                    srcVStride, dstYStride, dstVStride, dstVStride, mWidth, mHeight);
     }
-    finishWork(((c2_cntr64_t *)img->user_priv)->peekull(), work, std::move(block));
+    finishWork(index, work, std::move(block), C2Rect(mWidth, mHeight));
     return OK;
 }
 
+namespace {
+
+// The maximum number of blocks dequeued from a buffer queue in a row because libvpx still
+// references their buffer
+constexpr size_t kMaxParkedBlocks = 4;
+
+struct BufferQueueSlot {
+    uint32_t generation;
+    uint64_t bqId;
+    int32_t bqSlot;
+
+    bool operator==(const BufferQueueSlot &other) const {
+        return generation == other.generation && bqId == other.bqId && bqSlot == other.bqSlot;
+    }
+};
+
+// Returns the buffer queue slot of a block, if it comes from a buffer queue.
+std::optional<BufferQueueSlot> getBufferQueueSlot(const std::shared_ptr<C2GraphicBlock> &block) {
+    BufferQueueSlot slot;
+    if (!block || !_C2BlockFactory::GetBufferQueueData(
+                          _C2BlockFactory::GetGraphicBlockPoolData(*block), &slot.generation,
+                          &slot.bqId, &slot.bqSlot)) {
+        return std::nullopt;
+    }
+    return slot;
+}
+
+// The layout of the frame buffers of the VP9 decoder, as allocated by
+// vpx_realloc_frame_buffer(): 4:2:0 planes with a border of VP9_DEC_BORDER_IN_PIXELS,
+// the chroma planes following the luma plane with half its stride.
+struct Vp9FrameLayout {
+    static constexpr uint32_t kBorder = 32;
+    // libvpx aligns the start of the frame buffer to 32 bytes, and asks for the extra size.
+    static constexpr size_t kAlignment = 32;
+
+    Vp9FrameLayout(uint32_t width, uint32_t height)
+        : yStride(align(align(width, 8) + 2 * kBorder, 32)),
+          rows(align(height, 8) + 2 * kBorder),
+          ySize(size_t(yStride) * rows),
+          uvSize(size_t(yStride / 2) * (rows / 2)) {}
+
+    size_t minSize() const {
+        return ySize + 2 * uvSize + kAlignment - 1;
+    }
+
+    // Returns whether the mapped block holds a frame buffer with this layout.
+    bool matches(const C2GraphicView &view) const {
+        const C2PlanarLayout layout = view.layout();
+        if (layout.type != C2PlanarLayout::TYPE_YUV || layout.numPlanes != 3) {
+            return false;
+        }
+        for (uint32_t i = 0; i < layout.numPlanes; ++i) {
+            const C2PlaneInfo &plane = layout.planes[i];
+            const uint32_t stride = i == C2PlanarLayout::PLANE_Y ? yStride : yStride / 2;
+            if (plane.colInc != 1 || plane.rowInc != int32_t(stride) ||
+                plane.allocatedDepth != 8) {
+                return false;
+            }
+        }
+        const uint8_t *dataY = view.data()[C2PlanarLayout::PLANE_Y];
+        const uint8_t *dataU = view.data()[C2PlanarLayout::PLANE_U];
+        const uint8_t *dataV = view.data()[C2PlanarLayout::PLANE_V];
+        return uintptr_t(dataY) % kAlignment == 0 && dataU == dataY + ySize &&
+               dataV == dataU + uvSize;
+    }
+
+    const uint32_t yStride;
+    const uint32_t rows;
+    const size_t ySize;
+    const size_t uvSize;
+};
+
+}  // namespace
+
+bool C2SoftVpxDec::isReferenced(const std::shared_ptr<C2GraphicBlock> &block) const {
+    const std::optional<BufferQueueSlot> slot = getBufferQueueSlot(block);
+    if (!slot) {
+        return false;
+    }
+    return std::any_of(mFrameBuffers.begin(), mFrameBuffers.end(),
+                       [&slot](const FrameBuffer &buffer) {
+                           return getBufferQueueSlot(buffer.block) == slot;
+                       });
+}
+
+c2_status_t C2SoftVpxDec::fetchBlock(const std::shared_ptr<C2BlockPool> &pool, uint32_t width,
+                                     uint32_t height, uint32_t format, C2MemoryUsage usage,
+                                     std::shared_ptr<C2GraphicBlock> *block) {
+    // Gralloc blocks are only reused when no longer referenced, but a buffer queue may hand
+    // out a buffer again once it was displayed or discarded, while libvpx still references
+    // it: such a block is kept out of the queue and another one is dequeued.
+    for (size_t parked = 0; ; ++parked) {
+        c2_status_t err = pool->fetchGraphicBlock(width, height, format, usage, block);
+        if (err != C2_OK || !mZeroCopy || !isReferenced(*block)) {
+            return err;
+        }
+        if (parked == kMaxParkedBlocks) {
+            ALOGD("no buffer of the queue is free of libvpx references");
+            block->reset();
+            return C2_TIMED_OUT;
+        }
+        mParkedBlocks.push_back(std::move(*block));
+    }
+}
+
+bool C2SoftVpxDec::fetchFrameBlock(size_t minSize, FrameBuffer *frameBuffer) {
+    if (mZeroCopyLayoutMismatch || !mFrameBufferPool) {
+        return false;
+    }
+    const C2Allocator::id_t allocatorId = mFrameBufferPool->getAllocatorId();
+    if (allocatorId != C2PlatformAllocatorStore::GRALLOC &&
+        allocatorId != C2PlatformAllocatorStore::BUFFERQUEUE) {
+        return false;
+    }
+    // The size differs for high bit depth frames, and for frames of a size that was not
+    // peeked, which are decoded into heap buffers.
+    const Vp9FrameLayout frameLayout(mFrameBufferWidth, mFrameBufferHeight);
+    if (minSize != frameLayout.minSize()) {
+        return false;
+    }
+
+    C2MemoryUsage usage = { C2MemoryUsage::CPU_READ, C2MemoryUsage::CPU_WRITE };
+    c2_status_t err = fetchBlock(mFrameBufferPool, frameLayout.yStride, frameLayout.rows,
+                                 HAL_PIXEL_FORMAT_YCBCR_420_888, usage, &frameBuffer->block);
+    if (err != C2_OK) {
+        ALOGD("fetchGraphicBlock for frame buffer failed with status %d", err);
+        return false;
+    }
+    frameBuffer->view.emplace(frameBuffer->block->map().get());
+    if (frameBuffer->view->error() != C2_OK || !frameLayout.matches(*frameBuffer->view)) {
+        if (frameBuffer->view->error() == C2_OK) {
+            ALOGI("output blocks do not have the frame buffer layout, copying output");
+            mZeroCopyLayoutMismatch = true;
+        }
+        frameBuffer->view.reset();
+        frameBuffer->block.reset();
+        return false;
+    }
+    return true;
+}
+
+// static
+int C2SoftVpxDec::GetFrameBuffer(void *priv, size_t minSize, vpx_codec_frame_buffer_t *fb) {
+    C2SoftVpxDec *self = static_cast<C2SoftVpxDec *>(priv);
+    std::list<FrameBuffer> &inUse = self->mFrameBuffers;
+    inUse.emplace_front();
+    if (self->fetchFrameBlock(minSize, &inUse.front())) {
+        // libvpx only uses the first minSize - 31 bytes of a buffer aligned to 32 bytes,
+        // which the block spans. Unlike heap buffers, blocks are not zeroed: new ones are
+        // zeroed by the allocator, and libvpx reuses its own buffers without clearing them.
+        fb->data = const_cast<uint8_t *>(inUse.front().view->data()[C2PlanarLayout::PLANE_Y]);
+    } else {
+        inUse.pop_front();
+        std::list<FrameBuffer> &free = self->mFreeFrameBuffers;
+        free.remove_if([minSize](const FrameBuffer &buffer) {
+            return buffer.data.size() < minSize;
+        });
+        if (free.empty()) {
+            inUse.emplace_front();
+            // libvpx requires new frame buffers to be zeroed
+            inUse.front().data.resize(minSize);
+        } else {
+            inUse.splice(inUse.begin(), free, free.begin());
+        }
+        fb->data = inUse.front().data.data();
+    }
+    fb->size = minSize;
+    fb->priv = &inUse.front();
+    return 0;
+}
+
+// static
+int C2SoftVpxDec::ReleaseFrameBuffer(void *priv, vpx_codec_frame_buffer_t *fb) {
+    C2SoftVpxDec *self = static_cast<C2SoftVpxDec *>(priv);
+    std::list<FrameBuffer> &inUse = self->mFrameBuffers;
+    auto it = std::find_if(inUse.begin(), inUse.end(), [fb](const FrameBuffer &buffer) {
+        return &buffer == fb->priv;
+    });
+    if (it == inUse.end()) {
+        ALOGE("released unknown frame buffer %p", fb->priv);
+        return -1;
+    }
+    if (it->block) {
+        // the block is reused by the pool once the output buffer is released too
+        inUse.erase(it);
+        self->mParkedBlocks.remove_if([self](const std::shared_ptr<C2GraphicBlock> &block) {
+            return !self->isReferenced(block);
+        });
+    } else {
+        self->mFreeFrameBuffers.splice(self->mFreeFrameBuffers.begin(), inUse, it);
+    }
+    return 0;
+}
+
+bool C2SoftVpxDec::getZeroCopyCrop(const vpx_image_t *img, C2Rect *crop) {
+    const FrameBuffer *frameBuffer = static_cast<const FrameBuffer *>(img->fb_priv);
+    if (!frameBuffer || !frameBuffer->block || img->fmt != VPX_IMG_FMT_I420) {
+        return false;
+    }
+    // The image is a crop of the block if its planes are at the same offset in each plane
+    // of the block, accounting for chroma subsampling.
+    const C2GraphicView &view = *frameBuffer->view;
+    const C2PlanarLayout layout = view.layout();
+    const int32_t yStride = layout.planes[C2PlanarLayout::PLANE_Y].rowInc;
+    const int32_t uvStride = layout.planes[C2PlanarLayout::PLANE_U].rowInc;
+    const ptrdiff_t offset = img->planes[VPX_PLANE_Y] - view.data()[C2PlanarLayout::PLANE_Y];
+    if (offset < 0 || img->stride[VPX_PLANE_Y] != yStride ||
+        img->stride[VPX_PLANE_U] != uvStride || img->stride[VPX_PLANE_V] != uvStride) {
+        return false;
+    }
+    const uint32_t left = offset % yStride;
+    const uint32_t top = offset / yStride;
+    const ptrdiff_t uvOffset = (top / 2) * uvStride + left / 2;
+    if (left % 2 || top % 2 ||
+        img->planes[VPX_PLANE_U] != view.data()[C2PlanarLayout::PLANE_U] + uvOffset ||
+        img->planes[VPX_PLANE_V] != view.data()[C2PlanarLayout::PLANE_V] + uvOffset ||
+        left + mWidth > frameBuffer->block->width() ||
+        top + mHeight > frameBuffer->block->height()) {
+        return false;
+    }
+    *crop = C2Rect(mWidth, mHeight).at(left, top);
+    return true;
+}
+
 c2_status_t C2SoftVpxDec::drainInternal(
         uint32_t drainMode,
         const std::shared_ptr<C2BlockPool> &pool,
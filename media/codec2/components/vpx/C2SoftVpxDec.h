@@ -17,11 +17,13 @@
 #ifndef ANDROID_C2_SOFT_VPX_DEC_H_
 #define ANDROID_C2_SOFT_VPX_DEC_H_
 
-#include <SimpleC2Component.h>
+#include <optional>
 
+#include <SimpleC2Component.h>
 
 #include "vpx/vpx_decoder.h"
 #include "vpx/vp8dx.h"
+#include "vpx/vpx_frame_buffer.h"
 
 namespace android {
 
@@ -86,10 +88,40 @@ struct C2SoftVpxDec : public SimpleC2Component {
     std::shared_ptr<Mutexed<ConversionQueue>> mQueue;
     std::vector<sp<ConverterThread>> mConverterThreads;
 
+    // Zero-copy output (VP9 only): libvpx decodes into frame buffers backed by graphic
+    // blocks of the output pool, and those blocks are output without a copy.
+    struct FrameBuffer {
+        std::shared_ptr<C2GraphicBlock> block;  // set if backed by a graphic block
+        std::optional<C2GraphicView> view;
+        std::vector<uint8_t> data;              // otherwise
+    };
+    bool mZeroCopy;
+    // Set once a block from the pool is found not to have the layout of a libvpx frame
+    // buffer, after which frame buffers are allocated on the heap only.
+    bool mZeroCopyLayoutMismatch;
+    std::shared_ptr<C2BlockPool> mFrameBufferPool;
+    uint32_t mFrameBufferWidth;
+    uint32_t mFrameBufferHeight;
+    std::list<FrameBuffer> mFrameBuffers;   // in use by libvpx
+    std::list<FrameBuffer> mFreeFrameBuffers;  // heap buffers released by libvpx
+    // Blocks of a buffer queue pool dequeued again while libvpx still references their buffer,
+    // e.g. after they were displayed. They are kept dequeued, so that the buffer queue hands
+    // out other buffers, until libvpx releases the frame buffer they alias.
+    std::list<std::shared_ptr<C2GraphicBlock>> mParkedBlocks;
+
+    static int GetFrameBuffer(void *priv, size_t minSize, vpx_codec_frame_buffer_t *fb);
+    static int ReleaseFrameBuffer(void *priv, vpx_codec_frame_buffer_t *fb);
+    bool fetchFrameBlock(size_t minSize, FrameBuffer *frameBuffer);
+    c2_status_t fetchBlock(const std::shared_ptr<C2BlockPool> &pool, uint32_t width,
+                           uint32_t height, uint32_t format, C2MemoryUsage usage,
+                           std::shared_ptr<C2GraphicBlock> *block);
+    bool isReferenced(const std::shared_ptr<C2GraphicBlock> &block) const;
+    bool getZeroCopyCrop(const vpx_image_t *img, C2Rect *crop);
+
     status_t initDecoder();
     status_t destroyDecoder();
     void finishWork(uint64_t index, const std::unique_ptr<C2Work> &work,
-                    const std::shared_ptr<C2GraphicBlock> &block);
+                    const std::shared_ptr<C2GraphicBlock> &block, const C2Rect &crop);
     status_t outputBuffer(
             const std::shared_ptr<C2BlockPool> &pool,
             const std::unique_ptr<C2Work> &work);
@@ -2266,6 +2266,12 @@ void CCodec::signalSetParameters(const sp<AMessage> &msg) {
     std::vector<std::unique_ptr<C2Param>> configUpdate;
     (void)config->getConfigUpdateFromSdkParams(
             comp, params, Config::IS_PARAM, C2_MAY_BLOCK, &configUpdate);
+    for (const std::unique_ptr<C2Param> &param : configUpdate) {
+        if (C2GlobalLowLatencyModeTuning *lowLatency =
+                C2GlobalLowLatencyModeTuning::From(param.get())) {
+            mChannel->setLowLatencyMode(lowLatency->value);
+        }
+    }
     // Prefer to pass parameters to the buffer channel, so they can be synchronized with the frames.
     // Parameter synchronization is not defined when using input surface. For now, route
     // these directly to the component.
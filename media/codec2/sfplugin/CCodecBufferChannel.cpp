@@ -47,7 +47,9 @@
 #include <hidlmemory/FrameworkUtils.h>
 #include <media/openmax/OMX_Core.h>
 #include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/AHandler.h>
 #include <media/stagefright/foundation/ALookup.h>
+#include <media/stagefright/foundation/ALooper.h>
 #include <media/stagefright/foundation/AMessage.h>
 #include <media/stagefright/foundation/AUtils.h>
 #include <media/stagefright/foundation/hexdump.h>
@@ -90,6 +92,11 @@ const static size_t kDequeueTimeoutNs = 0;
 // after app resume to foreground to notify HAL something
 const static uint64_t kPipelinePausedTimeoutMs = 1000;
 
+// Input work batching is off unless the batch count is more than 1.
+constexpr char kInputBatchCountProperty[] = "debug.stagefright.ccodec_input_batch_count";
+constexpr char kInputBatchWindowUsProperty[] = "debug.stagefright.ccodec_input_batch_window_us";
+constexpr int32_t kDefaultInputBatchWindowUs = 2000;
+
 static bool areRenderMetricsEnabled() {
     std::string v = GetServerConfigurableFlag("media_native", "render_metrics_enabled", "false");
     return v == "true";
@@ -119,6 +126,105 @@ static uint32_t convertFlags(uint32_t flags, bool toC2) {
 
 }  // namespace
 
+/**
+ * Queues the input batch of a channel once its window elapses. One looper serves all channels
+ * of the process.
+ */
+class CCodecBufferChannel::InputBatchTimer : public AHandler {
+private:
+    enum {
+        kWhatTimeout,
+    };
+
+public:
+    static sp<InputBatchTimer> getInstance() {
+        static sp<InputBatchTimer> instance(new InputBatchTimer);
+        static std::once_flag flag;
+        // Call Init() only once.
+        std::call_once(flag, Init, instance);
+        return instance;
+    }
+
+    ~InputBatchTimer() = default;
+
+    void schedule(
+            const std::weak_ptr<CCodecBufferChannel> &channel,
+            uint32_t generation,
+            int64_t delayUs) {
+        sp<AMessage> msg = new AMessage(kWhatTimeout, this);
+        msg->setObject("channel", new WrapperObject<std::weak_ptr<CCodecBufferChannel>>{channel});
+        msg->setInt32("generation", generation);
+        msg->post(delayUs);
+    }
+
+protected:
+    void onMessageReceived(const sp<AMessage> &msg) override {
+        switch (msg->what()) {
+            case kWhatTimeout: {
+                sp<RefBase> obj;
+                int32_t generation;
+                CHECK(msg->findObject("channel", &obj));
+                CHECK(msg->findInt32("generation", &generation));
+                std::shared_ptr<CCodecBufferChannel> channel =
+                        static_cast<WrapperObject<std::weak_ptr<CCodecBufferChannel>> *>(
+                                obj.get())->value.lock();
+                if (channel) {
+                    channel->onInputBatchTimeout(generation);
+                }
+                break;
+            }
+
+            default: {
+                TRESPASS("InputBatchTimer: unrecognized message");
+            }
+        }
+    }
+
+private:
+    InputBatchTimer() : mLooper(new ALooper) {}
+
+    static void Init(const sp<InputBatchTimer> &thiz) {
+        thiz->mLooper->setName("CCodecInputBatch");
+        thiz->mLooper->registerHandler(thiz);
+        thiz->mLooper->start();
+    }
+
+    sp<ALooper> mLooper;
+};
+
+/**
+ * Queues the input batch of a channel to its component.
+ */
+class CCodecBufferChannel::BatchedComponent : public InputBatcher::Component {
+public:
+    explicit BatchedComponent(CCodecBufferChannel *channel) : mChannel(channel) {}
+
+    c2_status_t queue(std::list<std::unique_ptr<C2Work>> *items) override {
+        ALOGV("[%s] queueing %zu work items", mChannel->mName, items->size());
+        c2_status_t err = mChannel->mComponent->queue(items);
+        if (err != C2_OK) {
+            Mutexed<PipelineWatcher>::Locked watcher(mChannel->mPipelineWatcher);
+            for (const std::unique_ptr<C2Work> &work : *items) {
+                watcher->onWorkDone(work->input.ordinal.frameIndex.peeku());
+            }
+        }
+        return err;
+    }
+
+    size_t framesInPipeline() override {
+        // The watcher tracks the held back work as well.
+        return mChannel->mPipelineWatcher.lock()->framesInPipeline();
+    }
+
+    void scheduleTimeout(uint32_t generation, int64_t delayUs) override {
+        InputBatchTimer::getInstance()->schedule(
+                mChannel->weak_from_this(), generation, delayUs);
+    }
+
+private:
+    CCodecBufferChannel *const mChannel;
+};
+
 CCodecBufferChannel::QueueGuard::QueueGuard(
         CCodecBufferChannel::QueueSync &sync) : mSync(sync) {
     Mutex::Autolock l(mSync.mGuardLock);
@@ -191,7 +297,9 @@ CCodecBufferChannel::CCodecBufferChannel(
       mInputMetEos(false),
       mLastInputBufferAvailableTs(0u),
       mIsHWDecoder(false),
-      mSendEncryptedInfoBuffer(false) {
+      mSendEncryptedInfoBuffer(false),
+      mBatchedComponent(new BatchedComponent(this)),
+      mInputBatcher(mBatchedComponent.get()) {
     {
         Mutexed<Input>::Locked input(mInput);
         input->buffers.reset(new DummyInputBuffers(""));
@@ -212,6 +320,13 @@ CCodecBufferChannel::CCodecBufferChannel(
         Mutexed<BlockPools>::Locked pools(mBlockPools);
         pools->outputPoolId = C2BlockPool::BASIC_LINEAR;
     }
+    mReportingOutputs = false;
+    mInput.setContention(&mLockStats.input);
+    mOutput.setContention(&mLockStats.output);
+    mPipelineWatcher.setContention(&mLockStats.pipelineWatcher);
+    mOutputSurface.setContention(&mLockStats.outputSurface);
+    mBlockPools.setContention(&mLockStats.blockPools);
+    mInputBatcher.setContention(&mLockStats.inputBatch);
     std::string value = GetServerConfigurableFlag("media_native", "ccodec_rendering_depth", "3");
     android::base::ParseInt(value, &mRenderingDepth);
     mOutputSurface.lock()->maxDequeueBuffers = kSmoothnessFactor + mRenderingDepth;
@@ -293,6 +408,7 @@ status_t CCodecBufferChannel::queueInputBufferInternal(
 
     if (buffer->size() > 0u) {
         Mutexed<Input>::Locked input(mInput);
+        (void)expireReleasedInputs(input);
         std::shared_ptr<C2Buffer> c2buffer;
         if (!input->buffers->releaseBuffer(buffer, &c2buffer, false)) {
             return -ENOENT;
@@ -421,14 +537,9 @@ status_t CCodecBufferChannel::queueInputBufferInternal(
                         now);
             }
         }
-        err = mComponent->queue(&items);
+        err = queueToComponent(&items);
     }
-    if (err != C2_OK) {
-        Mutexed<PipelineWatcher>::Locked watcher(mPipelineWatcher);
-        for (const std::unique_ptr<C2Work> &work : items) {
-            watcher->onWorkDone(work->input.ordinal.frameIndex.peeku());
-        }
-    } else {
+    if (err == C2_OK) {
         Mutexed<Input>::Locked input(mInput);
         bool released = false;
         if (copy) {
@@ -444,6 +555,30 @@ status_t CCodecBufferChannel::queueInputBufferInternal(
     return err;
 }
 
+c2_status_t CCodecBufferChannel::queueToComponent(std::list<std::unique_ptr<C2Work>> *items) {
+    return mInputBatcher.queue(items);
+}
+
+void CCodecBufferChannel::reportInputBatchError(c2_status_t err) {
+    if (err != C2_OK) {
+        ALOGE("[%s] failed to queue held back input: %s (%d)", mName, asString(err), err);
+        mCCodecCallback->onError(toStatusT(err, C2_OPERATION_Component_queue),
+                                 ACTION_CODE_FATAL);
+    }
+}
+
+void CCodecBufferChannel::onInputBatchTimeout(uint32_t generation) {
+    QueueGuard guard(mSync);
+    if (!guard.isRunning()) {
+        return;
+    }
+    reportInputBatchError(mInputBatcher.onTimeout(generation));
+}
+
+void CCodecBufferChannel::setLowLatencyMode(bool lowLatency) {
+    reportInputBatchError(mInputBatcher.setLowLatency(lowLatency));
+}
+
 status_t CCodecBufferChannel::setParameters(std::vector<std::unique_ptr<C2Param>> &params) {
     QueueGuard guard(mSync);
     if (!guard.isRunning()) {
@@ -1048,7 +1183,9 @@ void CCodecBufferChannel::queueDummyWork() {
     work->input.flags = C2FrameData::FLAG_DROP_FRAME;
     std::list<std::unique_ptr<C2Work>> items;
     items.push_back(std::move(work));
-    (void)mComponent->queue(&items);
+    // This is never held back, but goes after the held back input.
+    reportInputBatchError(mInputBatcher.flush());
+    (void)mInputBatcher.queue(&items);
 }
 
 void CCodecBufferChannel::feedInputBufferIfAvailable() {
@@ -1064,10 +1201,12 @@ void CCodecBufferChannel::feedInputBufferIfAvailable() {
     // if feedInputBufferIfAvailableInternal() successfully (has available input buffer),
     // mLastInputBufferAvailableTs would be updated. otherwise, not input buffer available
     if (mIsHWDecoder) {
-        std::lock_guard<std::mutex> tsLock(mTsLock);
+        // Load the timestamp before reading the clock, so that a concurrent update cannot
+        // make it later than |now|, and the unsigned difference wrap around.
+        uint64_t last = mLastInputBufferAvailableTs.load();
         uint64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
                 PipelineWatcher::Clock::now().time_since_epoch()).count();
-        if (now - mLastInputBufferAvailableTs > kPipelinePausedTimeoutMs) {
+        if (now > last && now - last > kPipelinePausedTimeoutMs) {
             ALOGV("long time elapsed since last input available, let's queue a specific work to "
                     "HAL to notify something");
             queueDummyWork();
@@ -1095,6 +1234,7 @@ void CCodecBufferChannel::feedInputBufferIfAvailableInternal() {
         size_t index;
         {
             Mutexed<Input>::Locked input(mInput);
+            (void)expireReleasedInputs(input);
             numActiveSlots = input->buffers->numActiveSlots();
             if (numActiveSlots >= input->numSlots) {
                 break;
@@ -1116,11 +1256,8 @@ void CCodecBufferChannel::feedInputBufferIfAvailableInternal() {
             }
         }
 
-        {
-            std::lock_guard<std::mutex> tsLock(mTsLock);
-            mLastInputBufferAvailableTs = std::chrono::duration_cast<std::chrono::milliseconds>(
-                    PipelineWatcher::Clock::now().time_since_epoch()).count();
-        }
+        mLastInputBufferAvailableTs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                PipelineWatcher::Clock::now().time_since_epoch()).count();
 
         ALOGV("[%s] new input index = %zu [%p]", mName, index, inBuffer.get());
         mCallback->onInputBufferAvailable(index, inBuffer);
@@ -1561,6 +1698,27 @@ void CCodecBufferChannel::getOutputBufferArray(Vector<sp<MediaCodecBuffer>> *arr
     output->buffers->getArray(array);
 }
 
+void CCodecBufferChannel::dumpLockStats(AString *out) const {
+    const std::initializer_list<std::pair<const char *, LockContention::Stats>> locks = {
+        {"input", mLockStats.input.stats()},
+        {"output", mLockStats.output.stats()},
+        {"pipeline-watcher", mLockStats.pipelineWatcher.stats()},
+        {"output-surface", mLockStats.outputSurface.stats()},
+        {"block-pools", mLockStats.blockPools.stats()},
+        {"input-batch", mLockStats.inputBatch.stats()},
+    };
+    for (const auto &[name, stats] : locks) {
+        out->append(android::base::StringPrintf(
+                "%s: %llu acquired, %llu contended, wait %lld us avg %lld us max\n",
+                name,
+                (unsigned long long)stats.acquisitions,
+                (unsigned long long)stats.contentions,
+                (long long)(stats.contentions == 0 ? 0
+                        : stats.totalWaitNs / stats.contentions / 1000),
+                (long long)(stats.maxWaitNs / 1000)).c_str());
+    }
+}
+
 status_t CCodecBufferChannel::start(
         const sp<AMessage> &inputFormat,
         const sp<AMessage> &outputFormat,
@@ -1574,6 +1732,7 @@ status_t CCodecBufferChannel::start(
     C2PortActualDelayTuning::output outputDelay(0);
     C2ActualPipelineDelayTuning pipelineDelay(0);
     C2SecureModeTuning secureMode(C2Config::SM_UNPROTECTED);
+    C2GlobalLowLatencyModeTuning lowLatency(C2_FALSE);
 
     c2_status_t err = mComponent->query(
             {
@@ -1586,6 +1745,7 @@ status_t CCodecBufferChannel::start(
                 &pipelineDelay,
                 &outputDelay,
                 &secureMode,
+                &lowLatency,
             },
             {},
             C2_DONT_BLOCK,
@@ -2004,6 +2164,13 @@ status_t CCodecBufferChannel::start(
         watcher->flush();
     }
 
+    mInputBatcher.configure(
+            std::max(property_get_int32(kInputBatchCountProperty, 0), 0),
+            std::max(property_get_int32(
+                    kInputBatchWindowUsProperty, kDefaultInputBatchWindowUs), 0),
+            lowLatency && lowLatency.value,
+            mTunneled);
+
     mInputMetEos = false;
     mSync.start();
     return OK;
@@ -2073,7 +2240,7 @@ status_t CCodecBufferChannel::requestInitialInputBuffers(
                         now);
             }
         }
-        err = mComponent->queue(&flushedConfigs);
+        err = queueToComponent(&flushedConfigs);
         if (err != C2_OK) {
             ALOGW("[%s] Error while queueing a flushed config", mName);
             return UNKNOWN_ERROR;
@@ -2104,11 +2271,8 @@ status_t CCodecBufferChannel::requestInitialInputBuffers(
     }
 
     if (!clientInputBuffers.empty()) {
-        {
-            std::lock_guard<std::mutex> tsLock(mTsLock);
-            mLastInputBufferAvailableTs = std::chrono::duration_cast<std::chrono::milliseconds>(
-                    PipelineWatcher::Clock::now().time_since_epoch()).count();
-        }
+        mLastInputBufferAvailableTs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                PipelineWatcher::Clock::now().time_since_epoch()).count();
     }
 
     for (const auto &[index, buffer] : clientInputBuffers) {
@@ -2120,6 +2284,8 @@ status_t CCodecBufferChannel::requestInitialInputBuffers(
 
 void CCodecBufferChannel::stop() {
     mSync.stop();
+    // Queue the held back input, for the component to flush or discard with the rest.
+    reportInputBatchError(mInputBatcher.flush());
     mFirstValidFrameIndex = mFrameIndex.load(std::memory_order_relaxed);
 }
 
@@ -2150,12 +2316,14 @@ void CCodecBufferChannel::reset() {
     mPipelineWatcher.lock()->flush();
     {
         Mutexed<Input>::Locked input(mInput);
+        (void)expireReleasedInputs(input);
         input->buffers.reset(new DummyInputBuffers(""));
         input->extraBuffers.flush();
     }
     {
         Mutexed<Output>::Locked output(mOutput);
         output->buffers.reset();
+        discardReadyOutputs();
     }
     // reset the frames that are being tracked for onFrameRendered callbacks
     mTrackedFrames.clear();
@@ -2217,6 +2385,7 @@ void CCodecBufferChannel::flush(const std::list<std::unique_ptr<C2Work>> &flushe
     mFlushedConfigs.lock()->swap(configs);
     {
         Mutexed<Input>::Locked input(mInput);
+        (void)expireReleasedInputs(input);
         input->buffers->flush();
         input->extraBuffers.flush();
     }
@@ -2226,6 +2395,7 @@ void CCodecBufferChannel::flush(const std::list<std::unique_ptr<C2Work>> &flushe
             output->buffers->flush(flushedWork);
             output->buffers->flushStash();
         }
+        discardReadyOutputs();
     }
 }
 
@@ -2235,6 +2405,7 @@ void CCodecBufferChannel::onWorkDone(
     if (handleWork(std::move(work), outputFormat, initData)) {
         feedInputBufferIfAvailable();
     }
+    reportInputBatchError(mInputBatcher.onWorkDone());
 }
 
 void CCodecBufferChannel::onInputBufferDone(
@@ -2242,27 +2413,55 @@ void CCodecBufferChannel::onInputBufferDone(
     if (mInputSurface) {
         return;
     }
-    std::shared_ptr<C2Buffer> buffer =
-            mPipelineWatcher.lock()->onInputBufferReleased(frameIndex, arrayIndex);
+    ReleasedInput released;
+    released.frameIndex = frameIndex;
+    {
+        // Pushing with the pipeline watcher locked keeps a single writer to mReleasedInputs.
+        Mutexed<PipelineWatcher>::Locked watcher(mPipelineWatcher);
+        released.buffer = watcher->onInputBufferReleased(frameIndex, arrayIndex);
+        if (mReleasedInputs.push(std::move(released))) {
+            watcher.unlock();
+            // The buffer is expired by the next thread locking mInput: this one if the input
+            // buffers can be fed to the client, or the client otherwise.
+            feedInputBufferIfAvailable();
+            return;
+        }
+    }
+    // The ring is full: expire the buffer here.
     bool newInputSlotAvailable = false;
     {
         Mutexed<Input>::Locked input(mInput);
-        if (input->lastFlushIndex >= frameIndex) {
-            ALOGD("[%s] Ignoring stale input buffer done callback: "
-                  "last flush index = %lld, frameIndex = %lld",
-                  mName, input->lastFlushIndex.peekll(), (long long)frameIndex);
-        } else {
-            newInputSlotAvailable = input->buffers->expireComponentBuffer(buffer);
-            if (!newInputSlotAvailable) {
-                (void)input->extraBuffers.expireComponentBuffer(buffer);
-            }
-        }
+        newInputSlotAvailable = expireReleasedInput(input, released);
     }
     if (newInputSlotAvailable) {
         feedInputBufferIfAvailable();
     }
 }
 
+bool CCodecBufferChannel::expireReleasedInput(
+        Mutexed<Input>::Locked &input, const ReleasedInput &released) {
+    if (input->lastFlushIndex >= released.frameIndex) {
+        ALOGD("[%s] Ignoring stale input buffer done callback: "
+              "last flush index = %lld, frameIndex = %lld",
+              mName, input->lastFlushIndex.peekll(), (long long)released.frameIndex);
+        return false;
+    }
+    if (input->buffers->expireComponentBuffer(released.buffer)) {
+        return true;
+    }
+    (void)input->extraBuffers.expireComponentBuffer(released.buffer);
+    return false;
+}
+
+bool CCodecBufferChannel::expireReleasedInputs(Mutexed<Input>::Locked &input) {
+    bool newInputSlotAvailable = false;
+    ReleasedInput released;
+    while (mReleasedInputs.pop(&released)) {
+        newInputSlotAvailable |= expireReleasedInput(input, released);
+    }
+    return newInputSlotAvailable;
+}
+
 bool CCodecBufferChannel::handleWork(
         std::unique_ptr<C2Work> work,
         const sp<AMessage> &outputFormat,
@@ -2547,11 +2746,8 @@ bool CCodecBufferChannel::handleWork(
             outBuffer->meta()->setInt32("flags", BUFFER_FLAG_CODEC_CONFIG);
             ALOGV("[%s] onWorkDone: csd index = %zu [%p]", mName, index, outBuffer.get());
 
-            // TRICKY: we want popped buffers reported in order, so sending
-            // the callback while holding the lock here. This assumes that
-            // onOutputBufferAvailable() does not block. onOutputBufferAvailable()
-            // callbacks are always sent with the Output lock held.
-            mCallback->onOutputBufferAvailable(index, outBuffer);
+            // Queued with the Output lock held, so that the buffers are reported in order.
+            queueReadyOutput(index, outBuffer);
         } else {
             ALOGD("[%s] onWorkDone: unable to register csd", mName);
             output.unlock();
@@ -2623,6 +2819,50 @@ bool CCodecBufferChannel::handleWork(
 }
 
 void CCodecBufferChannel::sendOutputBuffers() {
+    registerOutputBuffers();
+    reportReadyOutputs();
+}
+
+void CCodecBufferChannel::queueReadyOutput(size_t index, const sp<MediaCodecBuffer> &buffer) {
+    ReadyOutput ready;
+    ready.index = index;
+    ready.buffer = buffer;
+    while (!mReadyOutputs.push(std::move(ready))) {
+        // The ring is full: report the oldest buffers, or let the thread reporting them do it.
+        reportReadyOutputs();
+        std::this_thread::yield();
+    }
+}
+
+void CCodecBufferChannel::reportReadyOutputs() {
+    // One thread reports at a time, so that the buffers are reported in order. A thread that
+    // finds another one reporting leaves its buffers to it, as the reporting thread checks the
+    // ring again after it stops reporting.
+    while (!mReadyOutputs.empty()) {
+        if (mReportingOutputs.exchange(true)) {
+            return;
+        }
+        ReadyOutput ready;
+        while (mReadyOutputs.pop(&ready)) {
+            mCallback->onOutputBufferAvailable(ready.index, ready.buffer);
+        }
+        mReportingOutputs = false;
+    }
+}
+
+void CCodecBufferChannel::discardReadyOutputs() {
+    // No buffer may be reported once the output buffers are flushed, so wait for the thread
+    // that may be reporting them.
+    while (mReportingOutputs.exchange(true)) {
+        std::this_thread::yield();
+    }
+    ReadyOutput ready;
+    while (mReadyOutputs.pop(&ready)) {
+    }
+    mReportingOutputs = false;
+}
+
+void CCodecBufferChannel::registerOutputBuffers() {
     OutputBuffers::BufferAction action;
     size_t index;
     sp<MediaCodecBuffer> outBuffer;
@@ -2648,10 +2888,7 @@ void CCodecBufferChannel::sendOutputBuffers() {
             break;
         case OutputBuffers::NOTIFY_CLIENT:
         {
-            // TRICKY: we want popped buffers reported in order, so sending
-            // the callback while holding the lock here. This assumes that
-            // onOutputBufferAvailable() does not block. onOutputBufferAvailable()
-            // callbacks are always sent with the Output lock held.
+            // Queued with the Output lock held, so that the buffers are reported in order.
             if (c2Buffer) {
                 std::shared_ptr<const C2AccessUnitInfos::output> bufferMetadata =
                         std::static_pointer_cast<const C2AccessUnitInfos::output>(
@@ -2672,13 +2909,13 @@ void CCodecBufferChannel::sendOutputBuffers() {
                     outBuffer->meta()->setObject("accessUnitInfo", obj);
                 }
             }
-            mCallback->onOutputBufferAvailable(index, outBuffer);
+            queueReadyOutput(index, outBuffer);
             break;
         }
         case OutputBuffers::REALLOCATE:
             if (++reallocTryNum > kMaxReallocTry) {
                 output.unlock();
-                ALOGE("[%s] sendOutputBuffers: tried %d realloc and failed",
+                ALOGE("[%s] registerOutputBuffers: tried %d realloc and failed",
                           mName, kMaxReallocTry);
                 mCCodecCallback->onError(UNKNOWN_ERROR, ACTION_CODE_FATAL);
                 return;
@@ -2690,14 +2927,16 @@ void CCodecBufferChannel::sendOutputBuffers() {
             static_cast<OutputBuffersArray*>(output->buffers.get())->
                     realloc(c2Buffer);
             output.unlock();
+            // report the buffers registered before the change first
+            reportReadyOutputs();
             mCCodecCallback->onOutputBuffersChanged();
             break;
         case OutputBuffers::RETRY:
-            ALOGV("[%s] sendOutputBuffers: unable to register output buffer",
+            ALOGV("[%s] registerOutputBuffers: unable to register output buffer",
                   mName);
             return;
         default:
-            LOG_ALWAYS_FATAL("[%s] sendOutputBuffers: "
+            LOG_ALWAYS_FATAL("[%s] registerOutputBuffers: "
                     "corrupted BufferAction value (%d) "
                     "returned from popFromStashAndRegister.",
                     mName, int(action));
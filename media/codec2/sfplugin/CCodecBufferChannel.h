@@ -19,6 +19,7 @@
 #define CCODEC_BUFFER_CHANNEL_H_
 
 #include <deque>
+#include <list>
 #include <map>
 #include <memory>
 #include <vector>
@@ -34,8 +35,10 @@
 
 #include "CCodecBuffers.h"
 #include "FrameReassembler.h"
+#include "InputBatcher.h"
 #include "InputSurfaceWrapper.h"
 #include "PipelineWatcher.h"
+#include "SingleWriterRing.h"
 
 namespace android {
 
@@ -106,6 +109,7 @@ public:
     status_t discardBuffer(const sp<MediaCodecBuffer> &buffer) override;
     void getInputBufferArray(Vector<sp<MediaCodecBuffer>> *array) override;
     void getOutputBufferArray(Vector<sp<MediaCodecBuffer>> *array) override;
+    void dumpLockStats(AString *out) const override;
 
     // Methods below are interface for CCodec to use.
 
@@ -135,6 +139,11 @@ public:
      */
     status_t setParameters(std::vector<std::unique_ptr<C2Param>> &params);
 
+    /**
+     * Notify the low latency mode of the component, which disables input batching.
+     */
+    void setLowLatencyMode(bool lowLatency);
+
     /**
      * Start queueing buffers to the component. This object should never queue
      * buffers before this call has completed.
@@ -393,8 +402,7 @@ private:
     std::atomic_bool mInputMetEos;
     std::once_flag mRenderWarningFlag;
 
-    uint64_t mLastInputBufferAvailableTs;
-    std::mutex mTsLock;
+    std::atomic_uint64_t mLastInputBufferAvailableTs;
     bool mIsHWDecoder;
 
     sp<ICrypto> mCrypto;
@@ -406,6 +414,91 @@ private:
     std::atomic_bool mSendEncryptedInfoBuffer;
 
     std::atomic_bool mTunneled;
+
+    /**
+     * Input work batching, enabled by setting debug.stagefright.ccodec_input_batch_count to
+     * N > 1. See InputBatcher.
+     */
+    class BatchedComponent;
+    std::unique_ptr<BatchedComponent> mBatchedComponent;
+    InputBatcher mInputBatcher;
+
+    class InputBatchTimer;
+
+    /**
+     * Queue the work items to the component, or add them to the input batch. Items of earlier
+     * calls are always queued first.
+     */
+    c2_status_t queueToComponent(std::list<std::unique_ptr<C2Work>> *items);
+    /**
+     * Report a failure to queue held back work items outside of a client call to the codec as
+     * a fatal error.
+     */
+    void reportInputBatchError(c2_status_t err);
+    void onInputBatchTimeout(uint32_t generation);
+
+    /**
+     * Input buffers released by the component, which are expired from mInput by the next
+     * thread that locks it, so that the component callback does not wait for the client to
+     * access mInput. Pushed only with mPipelineWatcher locked, and popped only with mInput
+     * locked.
+     */
+    struct ReleasedInput {
+        uint64_t frameIndex = 0u;
+        std::shared_ptr<C2Buffer> buffer;
+    };
+    SingleWriterRing<ReleasedInput, 64> mReleasedInputs;
+
+    /**
+     * Expire |released| from the input buffers. Returns true if it freed an input slot.
+     */
+    bool expireReleasedInput(Mutexed<Input>::Locked &input, const ReleasedInput &released);
+    /**
+     * Expire the buffers of mReleasedInputs. Returns true if any of them freed an input slot.
+     */
+    bool expireReleasedInputs(Mutexed<Input>::Locked &input);
+
+    /**
+     * Output buffers registered for the client, which are reported to it after mOutput is
+     * unlocked, in the order they were registered. Pushed only with mOutput locked, and popped
+     * only by the thread that set mReportingOutputs.
+     */
+    struct ReadyOutput {
+        size_t index = 0u;
+        sp<MediaCodecBuffer> buffer;
+    };
+    SingleWriterRing<ReadyOutput, 64> mReadyOutputs;
+    std::atomic_bool mReportingOutputs;
+
+    /**
+     * Queue a registered output buffer to be reported to the client. Must be called with
+     * mOutput locked.
+     */
+    void queueReadyOutput(size_t index, const sp<MediaCodecBuffer> &buffer);
+    /**
+     * Report the buffers of mReadyOutputs to the client, unless another thread is already
+     * reporting them. In that case, that thread also reports the buffers queued before.
+     */
+    void reportReadyOutputs();
+    /**
+     * Drop the buffers of mReadyOutputs, waiting for a thread reporting them to stop. Must be
+     * called with mOutput locked.
+     */
+    void discardReadyOutputs();
+    /**
+     * Register the stashed output buffers, and queue them to be reported to the client.
+     */
+    void registerOutputBuffers();
+
+    // contention of the locks of the channel, reported by dumpLockStats()
+    struct LockStats {
+        LockContention input;
+        LockContention output;
+        LockContention pipelineWatcher;
+        LockContention outputSurface;
+        LockContention blockPools;
+        LockContention inputBatch;
+    } mLockStats;
 };
 
 // Conversion of a c2_status_t value to a status_t value may depend on the
@@ -0,0 +1,120 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "InputBatcher"
+
+#include <log/log.h>
+
+#include "InputBatcher.h"
+
+namespace android {
+
+InputBatcher::InputBatcher(Component *component)
+    : mComponent(component),
+      mEnabled(false) {
+}
+
+void InputBatcher::configure(size_t maxCount, int64_t windowUs, bool lowLatency, bool tunneled) {
+    Mutexed<Batch>::Locked batch(mBatch);
+    batch->maxCount = maxCount;
+    batch->windowUs = windowUs;
+    batch->lowLatency = lowLatency;
+    batch->tunneled = tunneled;
+    mEnabled = maxCount > 1u;
+}
+
+c2_status_t InputBatcher::queue(std::list<std::unique_ptr<C2Work>> *items) {
+    Mutexed<Batch>::Locked batch(mBatch);
+    bool batchable = batch->maxCount > 1u && !batch->lowLatency && !batch->tunneled;
+    for (const std::unique_ptr<C2Work> &work : *items) {
+        batchable = batchable && work->input.flags == 0 && work->input.configUpdate.empty();
+    }
+    if (batchable) {
+        // Hold back input only while the component has earlier work to process, so that it
+        // never sits idle waiting for a batch to fill up. The held back work and |items| are
+        // in the pipeline as well.
+        batchable = mComponent->framesInPipeline() > batch->items.size() + items->size();
+    }
+    bool wasEmpty = batch->items.empty();
+    batch->items.splice(batch->items.end(), *items);
+    if (batchable && batch->items.size() < batch->maxCount) {
+        if (wasEmpty) {
+            mComponent->scheduleTimeout(++batch->generation, batch->windowUs);
+        }
+        return C2_OK;
+    }
+    return queueBatch(batch);
+}
+
+c2_status_t InputBatcher::flush() {
+    Mutexed<Batch>::Locked batch(mBatch);
+    return queueBatch(batch);
+}
+
+c2_status_t InputBatcher::setLowLatency(bool lowLatency) {
+    Mutexed<Batch>::Locked batch(mBatch);
+    batch->lowLatency = lowLatency;
+    return lowLatency ? queueBatch(batch) : C2_OK;
+}
+
+c2_status_t InputBatcher::onWorkDone() {
+    if (!mEnabled) {
+        return C2_OK;
+    }
+    Mutexed<Batch>::Locked batch(mBatch);
+    if (batch->items.empty()
+            || mComponent->framesInPipeline() > batch->items.size()) {
+        return C2_OK;
+    }
+    // The component ran out of work; do not wait for the batch to fill up.
+    return queueBatch(batch);
+}
+
+c2_status_t InputBatcher::onTimeout(uint32_t generation) {
+    Mutexed<Batch>::Locked batch(mBatch);
+    if (batch->generation != generation) {
+        // the batch was queued since the timeout was scheduled
+        return C2_OK;
+    }
+    return queueBatch(batch);
+}
+
+c2_status_t InputBatcher::queueBatch(Mutexed<Batch>::Locked &batch) {
+    // This also invalidates the pending timeout.
+    ++batch->generation;
+    if (batch->items.empty()) {
+        return C2_OK;
+    }
+    std::list<std::unique_ptr<C2Work>> items;
+    items.swap(batch->items);
+    const uint64_t ticket = batch->nextTicket++;
+    batch.unlock();
+
+    Mutexed<QueueOrder>::Locked order(mQueueOrder);
+    while (order->serving != ticket) {
+        order.waitForCondition(order->served);
+    }
+    order.unlock();
+    ALOGV("queueing %zu work items", items.size());
+    c2_status_t err = mComponent->queue(&items);
+    order.lock();
+    ++order->serving;
+    order->served.broadcast();
+    return err;
+}
+
+}  // namespace android
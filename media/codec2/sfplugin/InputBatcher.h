@@ -0,0 +1,140 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INPUT_BATCHER_H_
+#define INPUT_BATCHER_H_
+
+#include <atomic>
+#include <list>
+#include <memory>
+
+#include <C2Work.h>
+#include <media/stagefright/foundation/Mutexed.h>
+#include <utils/Condition.h>
+
+namespace android {
+
+/**
+ * Input work batching.
+ *
+ * Input work is held back while the component is busy with earlier work, and queued to the
+ * component in one transaction of up to maxCount items, or once the oldest item was held for
+ * the batch window. Work with flags or config updates, tunneled and low latency codecs are not
+ * batched.
+ *
+ * The batch is not locked while the component is called, nor while waiting for an earlier
+ * call: the work items are taken out of the batch together with a ticket, and the calls to the
+ * component are made in ticket order, so that the component sees the work in the same order as
+ * without batching.
+ */
+class InputBatcher {
+public:
+    /**
+     * The component the work is queued to.
+     */
+    class Component {
+    public:
+        virtual ~Component() = default;
+
+        /**
+         * Queue the work items to the component. Never called concurrently.
+         */
+        virtual c2_status_t queue(std::list<std::unique_ptr<C2Work>> *items) = 0;
+
+        /**
+         * \return the number of work items queued to the batcher and not done yet, including
+         *         the held back items and those being queued.
+         */
+        virtual size_t framesInPipeline() = 0;
+
+        /**
+         * Call InputBatcher::onTimeout() with |generation| after |delayUs|.
+         */
+        virtual void scheduleTimeout(uint32_t generation, int64_t delayUs) = 0;
+    };
+
+    explicit InputBatcher(Component *component);
+
+    void setContention(LockContention *contention) {
+        mBatch.setContention(contention);
+    }
+
+    /**
+     * Set up batching for a start of the codec. Batching is off unless maxCount > 1.
+     */
+    void configure(size_t maxCount, int64_t windowUs, bool lowLatency, bool tunneled);
+
+    /**
+     * Queue the work items to the component, or add them to the batch. Items of earlier calls
+     * are always queued first.
+     */
+    c2_status_t queue(std::list<std::unique_ptr<C2Work>> *items);
+
+    /**
+     * Queue the held back work items.
+     */
+    c2_status_t flush();
+
+    /**
+     * Queue the held back work items if the low latency mode is turned on.
+     */
+    c2_status_t setLowLatency(bool lowLatency);
+
+    /**
+     * Queue the held back work items if the component ran out of other work.
+     */
+    c2_status_t onWorkDone();
+
+    /**
+     * Queue the held back work items, unless they were queued since the timeout of
+     * |generation| was scheduled.
+     */
+    c2_status_t onTimeout(uint32_t generation);
+
+private:
+    struct Batch {
+        size_t maxCount = 0u;
+        int64_t windowUs = 0;
+        bool lowLatency = false;
+        bool tunneled = false;
+        std::list<std::unique_ptr<C2Work>> items;
+        uint32_t generation = 0u;  // of the pending timeout
+        uint64_t nextTicket = 0u;
+    };
+
+    struct QueueOrder {
+        uint64_t serving = 0u;  // ticket of the next call to the component
+        Condition served;
+    };
+
+    /**
+     * Queue the items of |batch|, unlocking it before calling the component.
+     */
+    c2_status_t queueBatch(Mutexed<Batch>::Locked &batch);
+
+    Component *const mComponent;
+    Mutexed<Batch> mBatch;
+    Mutexed<QueueOrder> mQueueOrder;
+    // whether work may be held back, so that onWorkDone() can skip the batch lock if not
+    std::atomic_bool mEnabled;
+
+    InputBatcher(const InputBatcher &) = delete;
+    InputBatcher &operator=(const InputBatcher &) = delete;
+};
+
+}  // namespace android
+
+#endif  // INPUT_BATCHER_H_
@@ -148,6 +148,10 @@ bool PipelineWatcher::pipelineFull(size_t *pipelineRoom) const {
     return false;
 }
 
+size_t PipelineWatcher::framesInPipeline() const {
+    return mFramesInPipeline.size();
+}
+
 PipelineWatcher::Clock::duration PipelineWatcher::elapsed(
         const PipelineWatcher::Clock::time_point &now, size_t n) const {
     if (mFramesInPipeline.size() <= n) {
@@ -115,6 +115,11 @@ public:
      */
     bool pipelineFull(size_t *pipelineRoom = nullptr) const;
 
+    /**
+     * \return  number of work items queued and not yet done.
+     */
+    size_t framesInPipeline() const;
+
     /**
      * Return elapsed processing time of a work item, nth from the longest
      * processing time to the shortest.
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SINGLE_WRITER_RING_H_
+#define SINGLE_WRITER_RING_H_
+
+#include <stddef.h>
+
+#include <array>
+#include <atomic>
+#include <utility>
+
+namespace android {
+
+/**
+ * Bounded lock-free FIFO with a single writer and a single reader.
+ *
+ * The writer and the reader need not always be the same threads, but pushes must be serialized
+ * among themselves, e.g. by a lock that every writer holds anyway, and so must pops. A push and
+ * a pop never wait for each other.
+ *
+ * The indices are updated with sequentially consistent stores, so that a reader which stops
+ * reading, then publishes that through another atomic, and then checks empty() sees any item
+ * pushed by a writer that checked that atomic after its push.
+ */
+template<typename T, size_t N>
+class SingleWriterRing {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "the capacity must be a power of 2");
+
+public:
+    SingleWriterRing() = default;
+
+    /**
+     * Append |item|, unless the ring is full. Writer side.
+     *
+     * \return true if |item| was moved into the ring.
+     */
+    inline bool push(T &&item) {
+        const size_t tail = mTail.load(std::memory_order_relaxed);
+        if (tail - mHead.load(std::memory_order_acquire) == N) {
+            return false;
+        }
+        mItems[tail & (N - 1)] = std::move(item);
+        mTail.store(tail + 1);
+        return true;
+    }
+
+    /**
+     * Remove the oldest item into |item|, unless the ring is empty. Reader side.
+     *
+     * \return true if an item was removed.
+     */
+    inline bool pop(T *item) {
+        const size_t head = mHead.load(std::memory_order_relaxed);
+        if (head == mTail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        *item = std::move(mItems[head & (N - 1)]);
+        // do not keep the resources of a moved-from item alive until the slot is reused
+        mItems[head & (N - 1)] = T();
+        mHead.store(head + 1);
+        return true;
+    }
+
+    /**
+     * \return true if there is no item in the ring. This may be called from any thread, but is
+     *         only a snapshot unless called by the reader with no writer, or vice versa.
+     */
+    inline bool empty() const {
+        return mHead.load() == mTail.load();
+    }
+
+private:
+    std::array<T, N> mItems{};
+    // the writer and the reader update different cache lines
+    alignas(64) std::atomic<size_t> mHead{0};
+    alignas(64) std::atomic<size_t> mTail{0};
+
+    SingleWriterRing(const SingleWriterRing&) = delete;
+    void operator=(const SingleWriterRing&) = delete;
+};
+
+}  // namespace android
+
+#endif  // SINGLE_WRITER_RING_H_
@@ -0,0 +1,295 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "InputBatcher.h"
+
+#include <gtest/gtest.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <C2Config.h>
+
+namespace android {
+
+namespace {
+
+/**
+ * Records the work queued to it. The pipeline holds the work queued to the batcher until
+ * done() is called.
+ */
+class FakeComponent : public InputBatcher::Component {
+public:
+    c2_status_t queue(std::list<std::unique_ptr<C2Work>> *items) override {
+        std::unique_lock<std::mutex> l(mLock);
+        mCalls.emplace_back();
+        for (const std::unique_ptr<C2Work> &work : *items) {
+            mCalls.back().push_back(work->input.ordinal.frameIndex.peeku());
+        }
+        items->clear();
+        ++mInQueue;
+        mCond.notify_all();
+        mCond.wait(l, [this] { return !mBlocked; });
+        --mInQueue;
+        return mResult;
+    }
+
+    size_t framesInPipeline() override {
+        std::lock_guard<std::mutex> l(mLock);
+        return mFramesInPipeline;
+    }
+
+    void scheduleTimeout(uint32_t generation, int64_t delayUs) override {
+        std::lock_guard<std::mutex> l(mLock);
+        mTimeouts.push_back(generation);
+        mDelayUs = delayUs;
+    }
+
+    // Simulates the client queueing a work item, which enters the pipeline first.
+    c2_status_t queueTo(InputBatcher *batcher, uint64_t frameIndex, uint32_t flags = 0) {
+        {
+            std::lock_guard<std::mutex> l(mLock);
+            ++mFramesInPipeline;
+        }
+        std::list<std::unique_ptr<C2Work>> items;
+        items.push_back(std::make_unique<C2Work>());
+        items.back()->input.ordinal.frameIndex = frameIndex;
+        items.back()->input.flags = (C2FrameData::flags_t)flags;
+        return batcher->queue(&items);
+    }
+
+    void done() {
+        std::lock_guard<std::mutex> l(mLock);
+        --mFramesInPipeline;
+    }
+
+    void block(bool blocked) {
+        std::lock_guard<std::mutex> l(mLock);
+        mBlocked = blocked;
+        mCond.notify_all();
+    }
+
+    void waitForQueue() {
+        std::unique_lock<std::mutex> l(mLock);
+        mCond.wait(l, [this] { return mInQueue > 0; });
+    }
+
+    std::vector<std::vector<uint64_t>> calls() {
+        std::lock_guard<std::mutex> l(mLock);
+        return mCalls;
+    }
+
+    std::vector<uint32_t> timeouts() {
+        std::lock_guard<std::mutex> l(mLock);
+        return mTimeouts;
+    }
+
+    int64_t delayUs() {
+        std::lock_guard<std::mutex> l(mLock);
+        return mDelayUs;
+    }
+
+    c2_status_t mResult = C2_OK;
+
+private:
+    std::mutex mLock;
+    std::condition_variable mCond;
+    std::vector<std::vector<uint64_t>> mCalls;
+    std::vector<uint32_t> mTimeouts;
+    int64_t mDelayUs = 0;
+    size_t mFramesInPipeline = 0u;
+    bool mBlocked = false;
+    int mInQueue = 0;
+};
+
+using Calls = std::vector<std::vector<uint64_t>>;
+
+}  // namespace
+
+TEST(InputBatcherTest, DisabledByDefault) {
+    FakeComponent component;
+    InputBatcher batcher(&component);
+    component.queueTo(&batcher, 0);
+    component.queueTo(&batcher, 1);
+    EXPECT_EQ((Calls{{0}, {1}}), component.calls());
+    EXPECT_TRUE(component.timeouts().empty());
+}
+
+TEST(InputBatcherTest, HoldsBackOnlyWhileWorkIsInFlight) {
+    FakeComponent component;
+    InputBatcher batcher(&component);
+    batcher.configure(4u, 2000, false /* lowLatency */, false /* tunneled */);
+
+    // the component is idle: do not wait for more input
+    ASSERT_EQ(C2_OK, component.queueTo(&batcher, 0));
+    EXPECT_EQ((Calls{{0}}), component.calls());
+    EXPECT_TRUE(component.timeouts().empty());
+
+    // the component is busy with frame 0
+    ASSERT_EQ(C2_OK, component.queueTo(&batcher, 1));
+    ASSERT_EQ(C2_OK, component.queueTo(&batcher, 2));
+    EXPECT_EQ((Calls{{0}}), component.calls());
+    EXPECT_EQ(1u, component.timeouts().size());
+    EXPECT_EQ(2000, component.delayUs());
+
+    // frame 0 is done, so that only the held back work is in the pipeline
+    component.done();
+    ASSERT_EQ(C2_OK, batcher.onWorkDone());
+    EXPECT_EQ((Calls{{0}, {1, 2}}), component.calls());
+}
+
+TEST(InputBatcherTest, QueuesAtMaxCount) {
+    FakeComponent component;
+    InputBatcher batcher(&component);
+    batcher.configure(3u, 2000, false /* lowLatency */, false /* tunneled */);
+    component.queueTo(&batcher, 0);
+    for (uint64_t i = 1; i <= 4; ++i) {
+        component.queueTo(&batcher, i);
+    }
+    EXPECT_EQ((Calls{{0}, {1, 2, 3}}), component.calls());
+    // one timeout per batch
+    EXPECT_EQ(2u, component.timeouts().size());
+
+    // the component is still busy
+    ASSERT_EQ(C2_OK, batcher.onWorkDone());
+    EXPECT_EQ((Calls{{0}, {1, 2, 3}}), component.calls());
+}
+
+TEST(InputBatcherTest, FlagsAndConfigUpdatesFlushInOrder) {
+    FakeComponent component;
+    InputBatcher batcher(&component);
+    batcher.configure(4u, 2000, false /* lowLatency */, false /* tunneled */);
+    component.queueTo(&batcher, 0);
+    component.queueTo(&batcher, 1);
+    component.queueTo(&batcher, 2, C2FrameData::FLAG_END_OF_STREAM);
+    EXPECT_EQ((Calls{{0}, {1, 2}}), component.calls());
+
+    component.queueTo(&batcher, 3);
+    std::list<std::unique_ptr<C2Work>> items;
+    items.push_back(std::make_unique<C2Work>());
+    items.back()->input.ordinal.frameIndex = 4;
+    items.back()->input.configUpdate.push_back(
+            C2Param::Copy(C2StreamBitrateInfo::input(0u, 1000000u)));
+    ASSERT_EQ(C2_OK, batcher.queue(&items));
+    EXPECT_EQ((Calls{{0}, {1, 2}, {3, 4}}), component.calls());
+}
+
+TEST(InputBatcherTest, LowLatencyBypass) {
+    FakeComponent component;
+    InputBatcher batcher(&component);
+    batcher.configure(4u, 2000, true /* lowLatency */, false /* tunneled */);
+    component.queueTo(&batcher, 0);
+    component.queueTo(&batcher, 1);
+    EXPECT_EQ((Calls{{0}, {1}}), component.calls());
+
+    ASSERT_EQ(C2_OK, batcher.setLowLatency(false));
+    component.queueTo(&batcher, 2);
+    EXPECT_EQ((Calls{{0}, {1}}), component.calls());
+
+    // turning the low latency mode on queues the held back work
+    ASSERT_EQ(C2_OK, batcher.setLowLatency(true));
+    EXPECT_EQ((Calls{{0}, {1}, {2}}), component.calls());
+    component.queueTo(&batcher, 3);
+    EXPECT_EQ((Calls{{0}, {1}, {2}, {3}}), component.calls());
+}
+
+TEST(InputBatcherTest, TunneledBypass) {
+    FakeComponent component;
+    InputBatcher batcher(&component);
+    batcher.configure(4u, 2000, false /* lowLatency */, true /* tunneled */);
+    component.queueTo(&batcher, 0);
+    component.queueTo(&batcher, 1);
+    EXPECT_EQ((Calls{{0}, {1}}), component.calls());
+    EXPECT_TRUE(component.timeouts().empty());
+}
+
+TEST(InputBatcherTest, IgnoresStaleTimeout) {
+    FakeComponent component;
+    InputBatcher batcher(&component);
+    batcher.configure(2u, 2000, false /* lowLatency */, false /* tunneled */);
+    component.queueTo(&batcher, 0);
+    component.queueTo(&batcher, 1);
+    ASSERT_EQ(1u, component.timeouts().size());
+    uint32_t first = component.timeouts()[0];
+
+    // the batch fills up before its timeout
+    component.queueTo(&batcher, 2);
+    EXPECT_EQ((Calls{{0}, {1, 2}}), component.calls());
+    component.queueTo(&batcher, 3);
+    ASSERT_EQ(2u, component.timeouts().size());
+    uint32_t second = component.timeouts()[1];
+    EXPECT_NE(first, second);
+
+    ASSERT_EQ(C2_OK, batcher.onTimeout(first));
+    EXPECT_EQ((Calls{{0}, {1, 2}}), component.calls());
+    ASSERT_EQ(C2_OK, batcher.onTimeout(second));
+    EXPECT_EQ((Calls{{0}, {1, 2}, {3}}), component.calls());
+
+    // a timeout after a flush does nothing either
+    component.queueTo(&batcher, 4);
+    ASSERT_EQ(3u, component.timeouts().size());
+    ASSERT_EQ(C2_OK, batcher.flush());
+    ASSERT_EQ(C2_OK, batcher.onTimeout(component.timeouts()[2]));
+    EXPECT_EQ((Calls{{0}, {1, 2}, {3}, {4}}), component.calls());
+}
+
+TEST(InputBatcherTest, ReturnsQueueError) {
+    FakeComponent component;
+    InputBatcher batcher(&component);
+    batcher.configure(4u, 2000, false /* lowLatency */, false /* tunneled */);
+    component.queueTo(&batcher, 0);
+    component.queueTo(&batcher, 1);
+    component.mResult = C2_CORRUPTED;
+    EXPECT_EQ(C2_CORRUPTED, batcher.flush());
+    // nothing is held back anymore
+    EXPECT_EQ(C2_OK, batcher.flush());
+}
+
+// The batch is not locked while the component is called, nor while a call waits for an
+// earlier call, and the component still sees the work in order.
+TEST(InputBatcherTest, QueuesOutsideOfBatchLock) {
+    FakeComponent component;
+    InputBatcher batcher(&component);
+    batcher.configure(4u, 2000, false /* lowLatency */, false /* tunneled */);
+    component.queueTo(&batcher, 0);
+    component.queueTo(&batcher, 1);
+
+    component.block(true);
+    std::thread flusher([&batcher] { batcher.flush(); });
+    component.waitForQueue();
+
+    // work is still held back while the component is blocked
+    ASSERT_EQ(C2_OK, component.queueTo(&batcher, 2));
+    ASSERT_EQ(C2_OK, batcher.onWorkDone());
+    EXPECT_EQ((Calls{{0}, {1}}), component.calls());
+
+    // an end of stream queues the batch after the blocked call, waiting outside of the batch
+    // lock
+    std::thread eos([&component, &batcher] {
+        component.queueTo(&batcher, 3, C2FrameData::FLAG_END_OF_STREAM);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ASSERT_EQ(C2_OK, batcher.onWorkDone());
+
+    component.block(false);
+    flusher.join();
+    eos.join();
+    EXPECT_EQ((Calls{{0}, {1}, {2, 3}}), component.calls());
+}
+
+}  // namespace android
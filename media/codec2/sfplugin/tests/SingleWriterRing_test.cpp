@@ -0,0 +1,85 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SingleWriterRing.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <thread>
+
+namespace android {
+
+TEST(SingleWriterRingTest, KeepsOrderUpToCapacity) {
+    SingleWriterRing<int, 4> ring;
+    int item = 0;
+    EXPECT_TRUE(ring.empty());
+    EXPECT_FALSE(ring.pop(&item));
+    for (int i = 0; i < 4; ++i) {
+        int value = i;
+        EXPECT_TRUE(ring.push(std::move(value)));
+    }
+    int value = 4;
+    EXPECT_FALSE(ring.push(std::move(value)));
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(ring.pop(&item));
+        EXPECT_EQ(i, item);
+    }
+    EXPECT_TRUE(ring.empty());
+}
+
+TEST(SingleWriterRingTest, ReleasesPoppedItems) {
+    SingleWriterRing<std::shared_ptr<int>, 2> ring;
+    std::shared_ptr<int> value = std::make_shared<int>(1);
+    std::weak_ptr<int> weak = value;
+    EXPECT_TRUE(ring.push(std::move(value)));
+    std::shared_ptr<int> item;
+    EXPECT_TRUE(ring.pop(&item));
+    item.reset();
+    EXPECT_TRUE(weak.expired());
+
+    // an item that does not fit is left to the caller
+    std::shared_ptr<int> kept = std::make_shared<int>(2);
+    EXPECT_TRUE(ring.push(std::make_shared<int>(3)));
+    EXPECT_TRUE(ring.push(std::make_shared<int>(4)));
+    EXPECT_FALSE(ring.push(std::move(kept)));
+    ASSERT_NE(nullptr, kept);
+    EXPECT_EQ(2, *kept);
+}
+
+TEST(SingleWriterRingTest, PassesItemsBetweenThreads) {
+    constexpr int kItems = 100000;
+    SingleWriterRing<int, 16> ring;
+    std::thread writer([&ring] {
+        for (int i = 0; i < kItems; ++i) {
+            int value = i;
+            while (!ring.push(std::move(value))) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    for (int i = 0; i < kItems; ++i) {
+        int item;
+        while (!ring.pop(&item)) {
+            std::this_thread::yield();
+        }
+        ASSERT_EQ(i, item);
+    }
+    writer.join();
+    EXPECT_TRUE(ring.empty());
+}
+
+} // namespace android
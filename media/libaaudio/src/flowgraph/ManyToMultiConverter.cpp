@@ -18,11 +18,16 @@
 
 #include "ManyToMultiConverter.h"
 
+#if FLOWGRAPH_ANDROID_INTERNAL
+#include <media/AudioFormatConversion.h>
+#endif
+
 using namespace FLOWGRAPH_OUTER_NAMESPACE::flowgraph;
 
 ManyToMultiConverter::ManyToMultiConverter(int32_t channelCount)
         : inputs(channelCount)
-        , output(*this, channelCount) {
+        , output(*this, channelCount)
+        , mInputBuffers(channelCount) {
     for (int i = 0; i < channelCount; i++) {
         inputs[i] = std::make_unique<FlowGraphPortFloatInput>(*this, 1);
     }
@@ -31,6 +36,12 @@ ManyToMultiConverter::ManyToMultiConverter(int32_t channelCount)
 int32_t ManyToMultiConverter::onProcess(int32_t numFrames) {
     int32_t channelCount = output.getSamplesPerFrame();
 
+#if FLOWGRAPH_ANDROID_INTERNAL
+    for (int ch = 0; ch < channelCount; ch++) {
+        mInputBuffers[ch] = inputs[ch]->getBuffer();
+    }
+    android::interleave_float(output.getBuffer(), mInputBuffers.data(), channelCount, numFrames);
+#else
     for (int ch = 0; ch < channelCount; ch++) {
         const float *inputBuffer = inputs[ch]->getBuffer();
         float *outputBuffer = output.getBuffer() + ch;
@@ -42,6 +53,7 @@ int32_t ManyToMultiConverter::onProcess(int32_t numFrames) {
             outputBuffer += channelCount; // advance to next multichannel frame
         }
     }
+#endif
     return numFrames;
 }
 
@@ -46,6 +46,8 @@ public:
     }
 
 private:
+    // the input buffers of the current onProcess(), for interleaving
+    std::vector<const float *> mInputBuffers;
 };
 
 } /* namespace FLOWGRAPH_OUTER_NAMESPACE::flowgraph */
@@ -18,13 +18,19 @@
 #include "FlowGraphNode.h"
 #include "MultiToManyConverter.h"
 
+#if FLOWGRAPH_ANDROID_INTERNAL
+#include <media/AudioFormatConversion.h>
+#endif
+
 using namespace FLOWGRAPH_OUTER_NAMESPACE::flowgraph;
 
 MultiToManyConverter::MultiToManyConverter(int32_t channelCount)
         : outputs(channelCount)
-        , input(*this, channelCount) {
+        , input(*this, channelCount)
+        , mOutputBuffers(channelCount) {
     for (int i = 0; i < channelCount; i++) {
         outputs[i] = std::make_unique<FlowGraphPortFloatOutput>(*this, 1);
+        mOutputBuffers[i] = outputs[i]->getBuffer();
     }
 }
 
@@ -33,6 +39,9 @@ MultiToManyConverter::~MultiToManyConverter() = default;
 int32_t MultiToManyConverter::onProcess(int32_t numFrames) {
     int32_t channelCount = input.getSamplesPerFrame();
 
+#if FLOWGRAPH_ANDROID_INTERNAL
+    android::deinterleave_float(mOutputBuffers.data(), input.getBuffer(), channelCount, numFrames);
+#else
     for (int ch = 0; ch < channelCount; ch++) {
         const float *inputBuffer = input.getBuffer() + ch;
         float *outputBuffer = outputs[ch]->getBuffer();
@@ -42,6 +51,7 @@ int32_t MultiToManyConverter::onProcess(int32_t numFrames) {
             inputBuffer += channelCount;
         }
     }
+#endif
 
     return numFrames;
 }
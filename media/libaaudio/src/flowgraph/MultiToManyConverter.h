@@ -19,6 +19,7 @@
 
 #include <unistd.h>
 #include <sys/types.h>
+#include <vector>
 
 #include "FlowGraphNode.h"
 
@@ -42,6 +43,10 @@ namespace FLOWGRAPH_OUTER_NAMESPACE::flowgraph {
 
         std::vector<std::unique_ptr<flowgraph::FlowGraphPortFloatOutput>> outputs;
         flowgraph::FlowGraphPortFloatInput input;
+
+    private:
+        // the output buffers, for deinterleaving
+        std::vector<float *> mOutputBuffers;
     };
 
 } /* namespace FLOWGRAPH_OUTER_NAMESPACE::flowgraph */
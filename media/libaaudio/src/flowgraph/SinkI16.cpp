@@ -20,7 +20,7 @@
 #include "SinkI16.h"
 
 #if FLOWGRAPH_ANDROID_INTERNAL
-#include <audio_utils/primitives.h>
+#include <media/AudioFormatConversion.h>
 #endif
 
 using namespace FLOWGRAPH_OUTER_NAMESPACE::flowgraph;
@@ -42,7 +42,8 @@ int32_t SinkI16::read(void *data, int32_t numFrames) {
         const float *signal = input.getBuffer();
         int32_t numSamples = framesRead * channelCount;
 #if FLOWGRAPH_ANDROID_INTERNAL
-        memcpy_to_i16_from_float(shortData, signal, numSamples);
+        android::convert_by_audio_format(shortData, AUDIO_FORMAT_PCM_16_BIT,
+                signal, AUDIO_FORMAT_PCM_FLOAT, numSamples);
         shortData += numSamples;
         signal += numSamples;
 #else
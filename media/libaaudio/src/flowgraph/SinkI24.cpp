@@ -22,7 +22,7 @@
 #include "SinkI24.h"
 
 #if FLOWGRAPH_ANDROID_INTERNAL
-#include <audio_utils/primitives.h>
+#include <media/AudioFormatConversion.h>
 #endif
 
 using namespace FLOWGRAPH_OUTER_NAMESPACE::flowgraph;
@@ -44,7 +44,8 @@ int32_t SinkI24::read(void *data, int32_t numFrames) {
         const float *floatData = input.getBuffer();
         int32_t numSamples = framesRead * channelCount;
 #if FLOWGRAPH_ANDROID_INTERNAL
-        memcpy_to_p24_from_float(byteData, floatData, numSamples);
+        android::convert_by_audio_format(byteData, AUDIO_FORMAT_PCM_24_BIT_PACKED,
+                floatData, AUDIO_FORMAT_PCM_FLOAT, numSamples);
         static const int kBytesPerI24Packed = 3;
         byteData += numSamples * kBytesPerI24Packed;
         floatData += numSamples;
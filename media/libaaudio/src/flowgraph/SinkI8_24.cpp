@@ -19,7 +19,7 @@
 #include "SinkI8_24.h"
 
 #if FLOWGRAPH_ANDROID_INTERNAL
-#include <audio_utils/primitives.h>
+#include <media/AudioFormatConversion.h>
 #endif
 
 using namespace FLOWGRAPH_OUTER_NAMESPACE::flowgraph;
@@ -41,7 +41,8 @@ int32_t SinkI8_24::read(void *data, int32_t numFrames) {
         const float *signal = input.getBuffer();
         int32_t numSamples = framesRead * channelCount;
 #if FLOWGRAPH_ANDROID_INTERNAL
-        memcpy_to_q8_23_from_float_with_clamp(intData, signal, numSamples);
+        android::convert_by_audio_format(intData, AUDIO_FORMAT_PCM_8_24_BIT,
+                signal, AUDIO_FORMAT_PCM_FLOAT, numSamples);
         intData += numSamples;
         signal += numSamples;
 #else
@@ -21,7 +21,7 @@
 #include "SourceI16.h"
 
 #if FLOWGRAPH_ANDROID_INTERNAL
-#include <audio_utils/primitives.h>
+#include <media/AudioFormatConversion.h>
 #endif
 
 using namespace FLOWGRAPH_OUTER_NAMESPACE::flowgraph;
@@ -42,7 +42,8 @@ int32_t SourceI16::onProcess(int32_t numFrames) {
     const int16_t *shortData = &shortBase[mFrameIndex * channelCount];
 
 #if FLOWGRAPH_ANDROID_INTERNAL
-    memcpy_to_float_from_i16(floatData, shortData, numSamples);
+    android::convert_by_audio_format(floatData, AUDIO_FORMAT_PCM_FLOAT,
+            shortData, AUDIO_FORMAT_PCM_16_BIT, numSamples);
 #else
     for (int i = 0; i < numSamples; i++) {
         *floatData++ = *shortData++ * (1.0f / 32768);
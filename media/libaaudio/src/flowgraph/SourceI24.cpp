@@ -21,7 +21,7 @@
 #include "SourceI24.h"
 
 #if FLOWGRAPH_ANDROID_INTERNAL
-#include <audio_utils/primitives.h>
+#include <media/AudioFormatConversion.h>
 #endif
 
 using namespace FLOWGRAPH_OUTER_NAMESPACE::flowgraph;
@@ -44,7 +44,8 @@ int32_t SourceI24::onProcess(int32_t numFrames) {
     const uint8_t *byteData = &byteBase[mFrameIndex * channelCount * kBytesPerI24Packed];
 
 #if FLOWGRAPH_ANDROID_INTERNAL
-    memcpy_to_float_from_p24(floatData, byteData, numSamples);
+    android::convert_by_audio_format(floatData, AUDIO_FORMAT_PCM_FLOAT,
+            byteData, AUDIO_FORMAT_PCM_24_BIT_PACKED, numSamples);
 #else
     static const float scale = 1. / (float)(1UL << 31);
     for (int i = 0; i < numSamples; i++) {
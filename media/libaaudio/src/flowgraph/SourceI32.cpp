@@ -21,7 +21,7 @@
 #include "SourceI32.h"
 
 #if FLOWGRAPH_ANDROID_INTERNAL
-#include <audio_utils/primitives.h>
+#include <media/AudioFormatConversion.h>
 #endif
 
 using namespace FLOWGRAPH_OUTER_NAMESPACE::flowgraph;
@@ -42,7 +42,8 @@ int32_t SourceI32::onProcess(int32_t numFrames) {
     const int32_t *intData = &intBase[mFrameIndex * channelCount];
 
 #if FLOWGRAPH_ANDROID_INTERNAL
-    memcpy_to_float_from_i32(floatData, intData, numSamples);
+    android::convert_by_audio_format(floatData, AUDIO_FORMAT_PCM_FLOAT,
+            intData, AUDIO_FORMAT_PCM_32_BIT, numSamples);
 #else
     for (int i = 0; i < numSamples; i++) {
         *floatData++ = *intData++ * kScale;
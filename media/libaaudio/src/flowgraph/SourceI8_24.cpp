@@ -21,7 +21,7 @@
 #include "SourceI8_24.h"
 
 #if FLOWGRAPH_ANDROID_INTERNAL
-#include <audio_utils/primitives.h>
+#include <media/AudioFormatConversion.h>
 #endif
 
 using namespace FLOWGRAPH_OUTER_NAMESPACE::flowgraph;
@@ -42,7 +42,8 @@ int32_t SourceI8_24::onProcess(int32_t numFrames) {
     const int32_t *intData = &intBase[mFrameIndex * channelCount];
 
 #if FLOWGRAPH_ANDROID_INTERNAL
-    memcpy_to_float_from_q8_23(floatData, intData, numSamples);
+    android::convert_by_audio_format(floatData, AUDIO_FORMAT_PCM_FLOAT,
+            intData, AUDIO_FORMAT_PCM_8_24_BIT, numSamples);
 #else
     for (int i = 0; i < numSamples; i++) {
         *floatData++ = *intData++ * kScale;
@@ -24,6 +24,7 @@
 #include <error/expected_utils.h>
 #include <media/AidlConversionNdk.h>
 #include <media/AidlConversionEffect.h>
+#include <media/VisualizerSpectrum.h>
 #include <system/audio_effects/effect_visualizer.h>
 
 #include <utils/Log.h>
@@ -174,5 +175,38 @@ status_t AidlConversionVisualizer::visualizerMeasure(uint32_t* replySize, void*
     return OK;
 }
 
+status_t AidlConversionVisualizer::visualizerFft(uint32_t* replySize, void* pReplyData) {
+    // pffft real transforms need a multiple of 32 points
+    if (!replySize || !pReplyData || *replySize != mCaptureSize ||
+        mCaptureSize < VISUALIZER_CAPTURE_SIZE_MIN || mCaptureSize % 32 != 0) {
+        ALOGE("%s illegal param replySize %p pReplyData %p", __func__, replySize, pReplyData);
+        return BAD_VALUE;
+    }
+
+    uint8_t capture[VISUALIZER_CAPTURE_SIZE_MAX];
+    uint32_t captureSize = mCaptureSize;
+    RETURN_STATUS_IF_ERROR(visualizerCapture(&captureSize, capture));
+    if (captureSize != mCaptureSize) {
+        ALOGE("%s capture of %u samples, expected %u", __func__, captureSize, mCaptureSize);
+        return BAD_VALUE;
+    }
+    if (mFftSize != mCaptureSize) {
+        mFftSetup.reset(pffft_new_setup(mCaptureSize, PFFFT_REAL));
+        mFftData.reset((float*)pffft_aligned_malloc(mCaptureSize * sizeof(float)));
+        mFftWork.reset((float*)pffft_aligned_malloc(mCaptureSize * sizeof(float)));
+        if (!mFftSetup || !mFftData || !mFftWork) {
+            ALOGE("%s no FFT of size %u", __func__, mCaptureSize);
+            mFftSize = 0;
+            return NO_MEMORY;
+        }
+        mFftSize = mCaptureSize;
+    }
+    Visualizer_unpackCapture(capture, mCaptureSize, mFftData.get());
+    pffft_transform_ordered(mFftSetup.get(), mFftData.get(), mFftData.get(), mFftWork.get(),
+                            PFFFT_FORWARD);
+    Visualizer_packSpectrum(mFftData.get(), mCaptureSize, (uint8_t*)pReplyData);
+    return OK;
+}
+
 } // namespace effect
 } // namespace android
@@ -16,7 +16,10 @@
 
 #pragma once
 
+#include <memory>
+
 #include <aidl/android/hardware/audio/effect/IEffect.h>
+#include <pffft.h>
 #include "EffectConversionHelperAidl.h"
 
 namespace android {
@@ -33,10 +36,20 @@ class AidlConversionVisualizer : public EffectConversionHelperAidl {
 
   private:
     uint32_t mCaptureSize = 0;
+    // for visualizerFft(), sized for mFftSize points
+    uint32_t mFftSize = 0;
+    std::unique_ptr<PFFFT_Setup, decltype(&pffft_destroy_setup)> mFftSetup{
+            nullptr, &pffft_destroy_setup};
+    std::unique_ptr<float, decltype(&pffft_aligned_free)> mFftData{nullptr, &pffft_aligned_free};
+    std::unique_ptr<float, decltype(&pffft_aligned_free)> mFftWork{nullptr, &pffft_aligned_free};
+
     status_t setParameter(utils::EffectParamReader& param) override;
     status_t getParameter(utils::EffectParamWriter& param) override;
     status_t visualizerCapture(uint32_t* replySize, void* pReplyData) override;
     status_t visualizerMeasure(uint32_t* replySize, void* pReplyData) override;
+    // The AIDL visualizer has no spectrum parameter: the spectrum is computed from a capture on
+    // the calling thread, which is not the audio thread.
+    status_t visualizerFft(uint32_t* replySize, void* pReplyData) override;
 };
 
 }  // namespace effect
@@ -0,0 +1,611 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "AudioFormatConversion"
+//#define LOG_NDEBUG 0
+
+#include <string.h>
+
+#include <algorithm>
+
+#include <audio_utils/format.h>
+#include <audio_utils/primitives.h>
+#include <media/AudioFormatConversion.h>
+
+// The vector kernels process 4 samples at a time.  AArch64 NEON has the rounding
+// conversions needed for bit-exactness; on x86 SSE2 is the baseline, and packed 24 bit
+// samples additionally need the SSSE3 byte shuffle.
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#define FORMAT_CONVERSION_USE_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+#define FORMAT_CONVERSION_USE_SSE
+#endif
+
+namespace android {
+
+namespace {
+
+// Number of frames converted through the float scratch buffers of the channel functions.
+constexpr size_t kChunkFrames = 256;
+
+// Scalar access to sample i of a buffer, matching the audio_utils primitives.
+template <audio_format_t FORMAT>
+struct ScalarSample;
+
+template <>
+struct ScalarSample<AUDIO_FORMAT_PCM_16_BIT> {
+    static float load(const void *src, size_t i) {
+        return float_from_i16(static_cast<const int16_t *>(src)[i]);
+    }
+    static void store(void *dst, size_t i, float f) {
+        static_cast<int16_t *>(dst)[i] = clamp16_from_float(f);
+    }
+};
+
+template <>
+struct ScalarSample<AUDIO_FORMAT_PCM_24_BIT_PACKED> {
+    static float load(const void *src, size_t i) {
+        return float_from_p24(static_cast<const uint8_t *>(src) + i * 3);
+    }
+    static void store(void *dst, size_t i, float f) {
+        const int32_t ival = clamp24_from_float(f);
+        uint8_t *p = static_cast<uint8_t *>(dst) + i * 3;
+        p[0] = ival;
+        p[1] = ival >> 8;
+        p[2] = ival >> 16;
+    }
+};
+
+template <>
+struct ScalarSample<AUDIO_FORMAT_PCM_8_24_BIT> {
+    static float load(const void *src, size_t i) {
+        return float_from_q8_23(static_cast<const int32_t *>(src)[i]);
+    }
+    static void store(void *dst, size_t i, float f) {
+        static_cast<int32_t *>(dst)[i] = clamp24_from_float(f);
+    }
+};
+
+template <>
+struct ScalarSample<AUDIO_FORMAT_PCM_32_BIT> {
+    static float load(const void *src, size_t i) {
+        return float_from_i32(static_cast<const int32_t *>(src)[i]);
+    }
+    static void store(void *dst, size_t i, float f) {
+        static_cast<int32_t *>(dst)[i] = clamp32_from_float(f);
+    }
+};
+
+template <>
+struct ScalarSample<AUDIO_FORMAT_PCM_FLOAT> {
+    static float load(const void *src, size_t i) {
+        return static_cast<const float *>(src)[i];
+    }
+    static void store(void *dst, size_t i, float f) {
+        static_cast<float *>(dst)[i] = f;
+    }
+};
+
+// Vector access to samples i to i + 3 of a buffer, as floats.
+// kEnabled is false if there is no vector kernel for the format.
+template <audio_format_t FORMAT>
+struct VectorSample {
+    static constexpr bool kEnabled = false;
+};
+
+#if defined(FORMAT_CONVERSION_USE_NEON)
+
+using vfloat = float32x4_t;
+
+template <>
+struct VectorSample<AUDIO_FORMAT_PCM_16_BIT> {
+    static constexpr bool kEnabled = true;
+    static vfloat load(const void *src, size_t i) {
+        const int32x4_t x = vmovl_s16(vld1_s16(static_cast<const int16_t *>(src) + i));
+        return vmulq_n_f32(vcvtq_f32_s32(x), 1.f / (1 << 15));
+    }
+    static void store(void *dst, size_t i, vfloat v) {
+        // round to nearest even, saturating, as clamp16_from_float()
+        const int32x4_t x = vcvtnq_s32_f32(vmulq_n_f32(v, 1 << 15));
+        vst1_s16(static_cast<int16_t *>(dst) + i, vqmovn_s32(x));
+    }
+};
+
+// Rounds to nearest with ties away from zero, clamped to 24 bits, as clamp24_from_float().
+inline int32x4_t clamp24(vfloat v) {
+    v = vmulq_n_f32(v, 1 << 23);
+    v = vminq_f32(vmaxq_f32(v, vdupq_n_f32(-0x800000)), vdupq_n_f32(0x7fffff));
+    return vcvtaq_s32_f32(v);
+}
+
+template <>
+struct VectorSample<AUDIO_FORMAT_PCM_24_BIT_PACKED> {
+    static constexpr bool kEnabled = true;
+    static vfloat load(const void *src, size_t i) {
+        // place the 3 bytes of each sample in the upper bytes of a 32 bit lane
+        static const uint8_t kUnpack[16] = {
+            0xff, 0, 1, 2, 0xff, 3, 4, 5, 0xff, 6, 7, 8, 0xff, 9, 10, 11 };
+        const uint8_t *p = static_cast<const uint8_t *>(src) + i * 3;
+        uint32_t tail;
+        memcpy(&tail, p + 8, sizeof(tail));
+        const uint8x16_t bytes = vcombine_u8(vld1_u8(p), vreinterpret_u8_u32(vdup_n_u32(tail)));
+        const int32x4_t x = vreinterpretq_s32_u8(vqtbl1q_u8(bytes, vld1q_u8(kUnpack)));
+        return vmulq_n_f32(vcvtq_f32_s32(x), 1.f / (1U << 31));
+    }
+    static void store(void *dst, size_t i, vfloat v) {
+        static const uint8_t kPack[16] = {
+            0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, 0xff, 0xff, 0xff, 0xff };
+        const uint8x16_t packed = vqtbl1q_u8(vreinterpretq_u8_s32(clamp24(v)), vld1q_u8(kPack));
+        uint8_t *p = static_cast<uint8_t *>(dst) + i * 3;
+        vst1_u8(p, vget_low_u8(packed));
+        const uint32_t tail = vgetq_lane_u32(vreinterpretq_u32_u8(packed), 2);
+        memcpy(p + 8, &tail, sizeof(tail));
+    }
+};
+
+template <>
+struct VectorSample<AUDIO_FORMAT_PCM_8_24_BIT> {
+    static constexpr bool kEnabled = true;
+    static vfloat load(const void *src, size_t i) {
+        const int32x4_t x = vld1q_s32(static_cast<const int32_t *>(src) + i);
+        return vmulq_n_f32(vcvtq_f32_s32(x), 1.f / (1 << 23));
+    }
+    static void store(void *dst, size_t i, vfloat v) {
+        vst1q_s32(static_cast<int32_t *>(dst) + i, clamp24(v));
+    }
+};
+
+template <>
+struct VectorSample<AUDIO_FORMAT_PCM_32_BIT> {
+    static constexpr bool kEnabled = true;
+    static vfloat load(const void *src, size_t i) {
+        const int32x4_t x = vld1q_s32(static_cast<const int32_t *>(src) + i);
+        return vmulq_n_f32(vcvtq_f32_s32(x), 1.f / (1U << 31));
+    }
+    static void store(void *dst, size_t i, vfloat v) {
+        // ties away from zero, saturating, as clamp32_from_float()
+        vst1q_s32(static_cast<int32_t *>(dst) + i, vcvtaq_s32_f32(vmulq_n_f32(v, 1U << 31)));
+    }
+};
+
+template <>
+struct VectorSample<AUDIO_FORMAT_PCM_FLOAT> {
+    static constexpr bool kEnabled = true;
+    static vfloat load(const void *src, size_t i) {
+        return vld1q_f32(static_cast<const float *>(src) + i);
+    }
+    static void store(void *dst, size_t i, vfloat v) {
+        vst1q_f32(static_cast<float *>(dst) + i, v);
+    }
+};
+
+#elif defined(FORMAT_CONVERSION_USE_SSE)
+
+using vfloat = __m128;
+
+// Rounds to nearest with ties away from zero, for |x| < 2^31.
+// The fraction x - trunc(x) is exact, so the adjustment matches the scalar rounding.
+inline __m128i roundAway(__m128 x) {
+    const __m128i t = _mm_cvttps_epi32(x);
+    const __m128 frac = _mm_sub_ps(x, _mm_cvtepi32_ps(t));
+    // comparisons are all ones (-1) where true
+    const __m128i up = _mm_castps_si128(_mm_cmpge_ps(frac, _mm_set1_ps(0.5f)));
+    const __m128i down = _mm_castps_si128(_mm_cmple_ps(frac, _mm_set1_ps(-0.5f)));
+    return _mm_add_epi32(_mm_sub_epi32(t, up), down);
+}
+
+inline __m128i selectBits(__m128i mask, __m128i a, __m128i b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+template <>
+struct VectorSample<AUDIO_FORMAT_PCM_16_BIT> {
+    static constexpr bool kEnabled = true;
+    static vfloat load(const void *src, size_t i) {
+        __m128i x = _mm_loadl_epi64(
+                reinterpret_cast<const __m128i *>(static_cast<const int16_t *>(src) + i));
+        x = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+        return _mm_mul_ps(_mm_cvtepi32_ps(x), _mm_set1_ps(1.f / (1 << 15)));
+    }
+    static void store(void *dst, size_t i, vfloat v) {
+        // round to nearest even (the default MXCSR mode) as clamp16_from_float()
+        v = _mm_mul_ps(v, _mm_set1_ps(1 << 15));
+        v = _mm_min_ps(_mm_max_ps(v, _mm_set1_ps(-0x8000)), _mm_set1_ps(0x7fff));
+        const __m128i x = _mm_cvtps_epi32(v);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(static_cast<int16_t *>(dst) + i),
+                _mm_packs_epi32(x, x));
+    }
+};
+
+// Clamps to 24 bits with ties away from zero, as clamp24_from_float().
+inline __m128i clamp24(vfloat v) {
+    v = _mm_mul_ps(v, _mm_set1_ps(1 << 23));
+    v = _mm_min_ps(_mm_max_ps(v, _mm_set1_ps(-0x800000)), _mm_set1_ps(0x7fffff));
+    return roundAway(v);
+}
+
+#if defined(__SSSE3__)
+template <>
+struct VectorSample<AUDIO_FORMAT_PCM_24_BIT_PACKED> {
+    static constexpr bool kEnabled = true;
+    static vfloat load(const void *src, size_t i) {
+        // place the 3 bytes of each sample in the upper bytes of a 32 bit lane
+        const __m128i kUnpack = _mm_setr_epi8(
+                -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+        const uint8_t *p = static_cast<const uint8_t *>(src) + i * 3;
+        int32_t tail;
+        memcpy(&tail, p + 8, sizeof(tail));
+        const __m128i bytes = _mm_unpacklo_epi64(
+                _mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)), _mm_cvtsi32_si128(tail));
+        const __m128i x = _mm_shuffle_epi8(bytes, kUnpack);
+        return _mm_mul_ps(_mm_cvtepi32_ps(x), _mm_set1_ps(1.f / (1U << 31)));
+    }
+    static void store(void *dst, size_t i, vfloat v) {
+        const __m128i kPack = _mm_setr_epi8(
+                0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+        const __m128i packed = _mm_shuffle_epi8(clamp24(v), kPack);
+        uint8_t *p = static_cast<uint8_t *>(dst) + i * 3;
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(p), packed);
+        const int32_t tail = _mm_cvtsi128_si32(_mm_srli_si128(packed, 8));
+        memcpy(p + 8, &tail, sizeof(tail));
+    }
+};
+#endif
+
+template <>
+struct VectorSample<AUDIO_FORMAT_PCM_8_24_BIT> {
+    static constexpr bool kEnabled = true;
+    static vfloat load(const void *src, size_t i) {
+        const __m128i x = _mm_loadu_si128(
+                reinterpret_cast<const __m128i *>(static_cast<const int32_t *>(src) + i));
+        return _mm_mul_ps(_mm_cvtepi32_ps(x), _mm_set1_ps(1.f / (1 << 23)));
+    }
+    static void store(void *dst, size_t i, vfloat v) {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(static_cast<int32_t *>(dst) + i),
+                clamp24(v));
+    }
+};
+
+template <>
+struct VectorSample<AUDIO_FORMAT_PCM_32_BIT> {
+    static constexpr bool kEnabled = true;
+    static vfloat load(const void *src, size_t i) {
+        const __m128i x = _mm_loadu_si128(
+                reinterpret_cast<const __m128i *>(static_cast<const int32_t *>(src) + i));
+        return _mm_mul_ps(_mm_cvtepi32_ps(x), _mm_set1_ps(1.f / (1U << 31)));
+    }
+    static void store(void *dst, size_t i, vfloat v) {
+        // out of range values saturate, as clamp32_from_float()
+        __m128i x = roundAway(_mm_mul_ps(v, _mm_set1_ps(1U << 31)));
+        x = selectBits(_mm_castps_si128(_mm_cmple_ps(v, _mm_set1_ps(-1.f))),
+                _mm_set1_epi32(INT32_MIN), x);
+        x = selectBits(_mm_castps_si128(_mm_cmpge_ps(v, _mm_set1_ps(1.f))),
+                _mm_set1_epi32(INT32_MAX), x);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(static_cast<int32_t *>(dst) + i), x);
+    }
+};
+
+template <>
+struct VectorSample<AUDIO_FORMAT_PCM_FLOAT> {
+    static constexpr bool kEnabled = true;
+    static vfloat load(const void *src, size_t i) {
+        return _mm_loadu_ps(static_cast<const float *>(src) + i);
+    }
+    static void store(void *dst, size_t i, vfloat v) {
+        _mm_storeu_ps(static_cast<float *>(dst) + i, v);
+    }
+};
+
+#endif // FORMAT_CONVERSION_USE_SSE
+
+template <audio_format_t DST, audio_format_t SRC>
+void convertSamples(void *dst, const void *src, size_t count) {
+    size_t i = 0;
+    if constexpr (VectorSample<DST>::kEnabled && VectorSample<SRC>::kEnabled) {
+        // Both vectors are loaded before either is stored, which with forward
+        // progression keeps an in place conversion to a smaller sample size safe.
+        for (; i + 8 <= count; i += 8) {
+            const auto v0 = VectorSample<SRC>::load(src, i);
+            const auto v1 = VectorSample<SRC>::load(src, i + 4);
+            VectorSample<DST>::store(dst, i, v0);
+            VectorSample<DST>::store(dst, i + 4, v1);
+        }
+        if (i + 4 <= count) {
+            VectorSample<DST>::store(dst, i, VectorSample<SRC>::load(src, i));
+            i += 4;
+        }
+    }
+    for (; i < count; ++i) {
+        ScalarSample<DST>::store(dst, i, ScalarSample<SRC>::load(src, i));
+    }
+}
+
+bool isVectorFormat(audio_format_t format) {
+    switch (format) {
+    case AUDIO_FORMAT_PCM_16_BIT:
+        return VectorSample<AUDIO_FORMAT_PCM_16_BIT>::kEnabled;
+    case AUDIO_FORMAT_PCM_24_BIT_PACKED:
+        return VectorSample<AUDIO_FORMAT_PCM_24_BIT_PACKED>::kEnabled;
+    case AUDIO_FORMAT_PCM_8_24_BIT:
+        return VectorSample<AUDIO_FORMAT_PCM_8_24_BIT>::kEnabled;
+    case AUDIO_FORMAT_PCM_32_BIT:
+        return VectorSample<AUDIO_FORMAT_PCM_32_BIT>::kEnabled;
+    default:
+        return false;
+    }
+}
+
+using ConvertFunc = void (*)(void *dst, const void *src, size_t count);
+
+// Returns the kernel converting to or from float, or nullptr if there is none.
+ConvertFunc getConvertFunc(audio_format_t dstFormat, audio_format_t srcFormat) {
+    if (srcFormat == AUDIO_FORMAT_PCM_FLOAT) {
+        switch (dstFormat) {
+        case AUDIO_FORMAT_PCM_16_BIT:
+            return convertSamples<AUDIO_FORMAT_PCM_16_BIT, AUDIO_FORMAT_PCM_FLOAT>;
+        case AUDIO_FORMAT_PCM_24_BIT_PACKED:
+            return convertSamples<AUDIO_FORMAT_PCM_24_BIT_PACKED, AUDIO_FORMAT_PCM_FLOAT>;
+        case AUDIO_FORMAT_PCM_8_24_BIT:
+            return convertSamples<AUDIO_FORMAT_PCM_8_24_BIT, AUDIO_FORMAT_PCM_FLOAT>;
+        case AUDIO_FORMAT_PCM_32_BIT:
+            return convertSamples<AUDIO_FORMAT_PCM_32_BIT, AUDIO_FORMAT_PCM_FLOAT>;
+        default:
+            break;
+        }
+    } else if (dstFormat == AUDIO_FORMAT_PCM_FLOAT) {
+        switch (srcFormat) {
+        case AUDIO_FORMAT_PCM_16_BIT:
+            return convertSamples<AUDIO_FORMAT_PCM_FLOAT, AUDIO_FORMAT_PCM_16_BIT>;
+        case AUDIO_FORMAT_PCM_24_BIT_PACKED:
+            return convertSamples<AUDIO_FORMAT_PCM_FLOAT, AUDIO_FORMAT_PCM_24_BIT_PACKED>;
+        case AUDIO_FORMAT_PCM_8_24_BIT:
+            return convertSamples<AUDIO_FORMAT_PCM_FLOAT, AUDIO_FORMAT_PCM_8_24_BIT>;
+        case AUDIO_FORMAT_PCM_32_BIT:
+            return convertSamples<AUDIO_FORMAT_PCM_FLOAT, AUDIO_FORMAT_PCM_32_BIT>;
+        default:
+            break;
+        }
+    }
+    return nullptr;
+}
+
+void upmixFloat(float *dst, const float *src, size_t frames) {
+    size_t i = 0;
+#if defined(FORMAT_CONVERSION_USE_NEON)
+    for (; i + 4 <= frames; i += 4) {
+        const float32x4_t v = vld1q_f32(src + i);
+        const float32x4x2_t pair = {{v, v}};
+        vst2q_f32(dst + 2 * i, pair);
+    }
+#elif defined(FORMAT_CONVERSION_USE_SSE)
+    for (; i + 4 <= frames; i += 4) {
+        const __m128 v = _mm_loadu_ps(src + i);
+        _mm_storeu_ps(dst + 2 * i, _mm_unpacklo_ps(v, v));
+        _mm_storeu_ps(dst + 2 * i + 4, _mm_unpackhi_ps(v, v));
+    }
+#endif
+    for (; i < frames; ++i) {
+        dst[2 * i] = dst[2 * i + 1] = src[i];
+    }
+}
+
+void downmixFloat(float *dst, const float *src, size_t frames) {
+    size_t i = 0;
+#if defined(FORMAT_CONVERSION_USE_NEON)
+    for (; i + 4 <= frames; i += 4) {
+        const float32x4x2_t v = vld2q_f32(src + 2 * i);
+        vst1q_f32(dst + i, vmulq_n_f32(vaddq_f32(v.val[0], v.val[1]), 0.5f));
+    }
+#elif defined(FORMAT_CONVERSION_USE_SSE)
+    for (; i + 4 <= frames; i += 4) {
+        const __m128 a = _mm_loadu_ps(src + 2 * i);
+        const __m128 b = _mm_loadu_ps(src + 2 * i + 4);
+        const __m128 left = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m128 right = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_add_ps(left, right), _mm_set1_ps(0.5f)));
+    }
+#endif
+    for (; i < frames; ++i) {
+        dst[i] = (src[2 * i] + src[2 * i + 1]) * 0.5f;
+    }
+}
+
+} // namespace
+
+bool format_conversion_is_vectorized(audio_format_t dstFormat, audio_format_t srcFormat)
+{
+    // only conversions to or from float have kernels
+    return VectorSample<AUDIO_FORMAT_PCM_FLOAT>::kEnabled
+            && (srcFormat == AUDIO_FORMAT_PCM_FLOAT ? isVectorFormat(dstFormat)
+                    : dstFormat == AUDIO_FORMAT_PCM_FLOAT && isVectorFormat(srcFormat));
+}
+
+void convert_by_audio_format(void *dst, audio_format_t dstFormat,
+        const void *src, audio_format_t srcFormat, size_t count)
+{
+    const ConvertFunc convert = getConvertFunc(dstFormat, srcFormat);
+    if (convert != nullptr) {
+        convert(dst, src, count);
+    } else if (dst != src || dstFormat != srcFormat) {
+        memcpy_by_audio_format(dst, dstFormat, src, srcFormat, count);
+    }
+}
+
+void upmix_to_stereo_by_audio_format(void *dst, audio_format_t dstFormat,
+        const void *src, audio_format_t srcFormat, size_t frames)
+{
+    if (dstFormat == AUDIO_FORMAT_PCM_FLOAT && srcFormat == AUDIO_FORMAT_PCM_FLOAT) {
+        upmixFloat(static_cast<float *>(dst), static_cast<const float *>(src), frames);
+        return;
+    }
+    const size_t srcFrameSize = audio_bytes_per_sample(srcFormat);
+    const size_t dstFrameSize = audio_bytes_per_sample(dstFormat) * 2;
+    float mono[kChunkFrames];
+    float stereo[kChunkFrames * 2];
+    for (size_t offset = 0; offset < frames; offset += kChunkFrames) {
+        const size_t count = std::min(frames - offset, kChunkFrames);
+        const void *in = static_cast<const uint8_t *>(src) + offset * srcFrameSize;
+        void *out = static_cast<uint8_t *>(dst) + offset * dstFrameSize;
+        const float *monoIn = static_cast<const float *>(in);
+        if (srcFormat != AUDIO_FORMAT_PCM_FLOAT) {
+            convert_by_audio_format(mono, AUDIO_FORMAT_PCM_FLOAT, in, srcFormat, count);
+            monoIn = mono;
+        }
+        if (dstFormat == AUDIO_FORMAT_PCM_FLOAT) {
+            upmixFloat(static_cast<float *>(out), monoIn, count);
+        } else {
+            upmixFloat(stereo, monoIn, count);
+            convert_by_audio_format(out, dstFormat, stereo, AUDIO_FORMAT_PCM_FLOAT, count * 2);
+        }
+    }
+}
+
+void downmix_to_mono_by_audio_format(void *dst, audio_format_t dstFormat,
+        const void *src, audio_format_t srcFormat, size_t frames)
+{
+    if (dstFormat == AUDIO_FORMAT_PCM_FLOAT && srcFormat == AUDIO_FORMAT_PCM_FLOAT) {
+        downmixFloat(static_cast<float *>(dst), static_cast<const float *>(src), frames);
+        return;
+    }
+    const size_t srcFrameSize = audio_bytes_per_sample(srcFormat) * 2;
+    const size_t dstFrameSize = audio_bytes_per_sample(dstFormat);
+    float stereo[kChunkFrames * 2];
+    float mono[kChunkFrames];
+    for (size_t offset = 0; offset < frames; offset += kChunkFrames) {
+        const size_t count = std::min(frames - offset, kChunkFrames);
+        const void *in = static_cast<const uint8_t *>(src) + offset * srcFrameSize;
+        void *out = static_cast<uint8_t *>(dst) + offset * dstFrameSize;
+        const float *stereoIn = static_cast<const float *>(in);
+        if (srcFormat != AUDIO_FORMAT_PCM_FLOAT) {
+            convert_by_audio_format(stereo, AUDIO_FORMAT_PCM_FLOAT, in, srcFormat, count * 2);
+            stereoIn = stereo;
+        }
+        if (dstFormat == AUDIO_FORMAT_PCM_FLOAT) {
+            downmixFloat(static_cast<float *>(out), stereoIn, count);
+        } else {
+            downmixFloat(mono, stereoIn, count);
+            convert_by_audio_format(out, dstFormat, mono, AUDIO_FORMAT_PCM_FLOAT, count);
+        }
+    }
+}
+
+void interleave_float(float *dst, const float * const *src,
+        uint32_t channelCount, size_t frames)
+{
+    size_t i = 0;
+#if defined(FORMAT_CONVERSION_USE_NEON)
+    if (channelCount == 2) {
+        for (; i + 4 <= frames; i += 4) {
+            const float32x4x2_t v = {{vld1q_f32(src[0] + i), vld1q_f32(src[1] + i)}};
+            vst2q_f32(dst + 2 * i, v);
+        }
+    } else if (channelCount == 4) {
+        for (; i + 4 <= frames; i += 4) {
+            const float32x4x4_t v = {{vld1q_f32(src[0] + i), vld1q_f32(src[1] + i),
+                    vld1q_f32(src[2] + i), vld1q_f32(src[3] + i)}};
+            vst4q_f32(dst + 4 * i, v);
+        }
+    }
+#elif defined(FORMAT_CONVERSION_USE_SSE)
+    if (channelCount == 2) {
+        for (; i + 4 <= frames; i += 4) {
+            const __m128 a = _mm_loadu_ps(src[0] + i);
+            const __m128 b = _mm_loadu_ps(src[1] + i);
+            _mm_storeu_ps(dst + 2 * i, _mm_unpacklo_ps(a, b));
+            _mm_storeu_ps(dst + 2 * i + 4, _mm_unpackhi_ps(a, b));
+        }
+    } else if (channelCount == 4) {
+        for (; i + 4 <= frames; i += 4) {
+            __m128 r0 = _mm_loadu_ps(src[0] + i);
+            __m128 r1 = _mm_loadu_ps(src[1] + i);
+            __m128 r2 = _mm_loadu_ps(src[2] + i);
+            __m128 r3 = _mm_loadu_ps(src[3] + i);
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            _mm_storeu_ps(dst + 4 * i, r0);
+            _mm_storeu_ps(dst + 4 * i + 4, r1);
+            _mm_storeu_ps(dst + 4 * i + 8, r2);
+            _mm_storeu_ps(dst + 4 * i + 12, r3);
+        }
+    }
+#endif
+    for (uint32_t ch = 0; ch < channelCount; ++ch) {
+        const float *in = src[ch] + i;
+        float *out = dst + i * channelCount + ch;
+        for (size_t j = i; j < frames; ++j) {
+            *out = *in++;
+            out += channelCount;
+        }
+    }
+}
+
+void deinterleave_float(float * const *dst, const float *src,
+        uint32_t channelCount, size_t frames)
+{
+    size_t i = 0;
+#if defined(FORMAT_CONVERSION_USE_NEON)
+    if (channelCount == 2) {
+        for (; i + 4 <= frames; i += 4) {
+            const float32x4x2_t v = vld2q_f32(src + 2 * i);
+            vst1q_f32(dst[0] + i, v.val[0]);
+            vst1q_f32(dst[1] + i, v.val[1]);
+        }
+    } else if (channelCount == 4) {
+        for (; i + 4 <= frames; i += 4) {
+            const float32x4x4_t v = vld4q_f32(src + 4 * i);
+            vst1q_f32(dst[0] + i, v.val[0]);
+            vst1q_f32(dst[1] + i, v.val[1]);
+            vst1q_f32(dst[2] + i, v.val[2]);
+            vst1q_f32(dst[3] + i, v.val[3]);
+        }
+    }
+#elif defined(FORMAT_CONVERSION_USE_SSE)
+    if (channelCount == 2) {
+        for (; i + 4 <= frames; i += 4) {
+            const __m128 a = _mm_loadu_ps(src + 2 * i);
+            const __m128 b = _mm_loadu_ps(src + 2 * i + 4);
+            _mm_storeu_ps(dst[0] + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+            _mm_storeu_ps(dst[1] + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+        }
+    } else if (channelCount == 4) {
+        for (; i + 4 <= frames; i += 4) {
+            __m128 r0 = _mm_loadu_ps(src + 4 * i);
+            __m128 r1 = _mm_loadu_ps(src + 4 * i + 4);
+            __m128 r2 = _mm_loadu_ps(src + 4 * i + 8);
+            __m128 r3 = _mm_loadu_ps(src + 4 * i + 12);
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            _mm_storeu_ps(dst[0] + i, r0);
+            _mm_storeu_ps(dst[1] + i, r1);
+            _mm_storeu_ps(dst[2] + i, r2);
+            _mm_storeu_ps(dst[3] + i, r3);
+        }
+    }
+#endif
+    for (uint32_t ch = 0; ch < channelCount; ++ch) {
+        const float *in = src + i * channelCount + ch;
+        float *out = dst[ch] + i;
+        for (size_t j = i; j < frames; ++j) {
+            *out++ = *in;
+            in += channelCount;
+        }
+    }
+}
+
+} // namespace android
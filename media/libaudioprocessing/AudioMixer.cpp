@@ -59,6 +59,10 @@
 // Set to default copy buffer size in frames for input processing.
 static constexpr size_t kCopyBufferFrameCount = 256;
 
+// Set to true to run the track format and channel conversion providers
+// as a single FusedBufferProvider when more than one is needed.
+static constexpr bool kUseFusedBufferProviders = true;
+
 namespace android {
 
 // ----------------------------------------------------------------------------
@@ -137,9 +141,21 @@ bool AudioMixer::setChannelMasks(int name,
     return true;
 }
 
+bool AudioMixer::Track::unprepareForFusion() {
+    if (mFusedBufferProvider.get() == nullptr) {
+        return false;
+    }
+    // release any buffers held by the mFusedBufferProvider
+    // before deallocating any of its stages.
+    mFusedBufferProvider->reset();
+    mFusedBufferProvider.reset(nullptr);
+    return true;
+}
+
 void AudioMixer::Track::unprepareForDownmix() {
     ALOGV("AudioMixer::unprepareForDownmix(%p)", this);
 
+    const bool unfused = unprepareForFusion();
     if (mPostDownmixReformatBufferProvider.get() != nullptr) {
         // release any buffers held by the mPostDownmixReformatBufferProvider
         // before deallocating the mDownmixerBufferProvider.
@@ -153,6 +169,9 @@ void AudioMixer::Track::unprepareForDownmix() {
         reconfigureBufferProviders();
     } else {
         ALOGV(" nothing to do, no downmixer to delete");
+        if (unfused) {
+            reconfigureBufferProviders();
+        }
     }
 }
 
@@ -219,7 +238,7 @@ status_t AudioMixer::Track::prepareForDownmix()
 
 void AudioMixer::Track::unprepareForReformat() {
     ALOGV("AudioMixer::unprepareForReformat(%p)", this);
-    bool requiresReconfigure = false;
+    bool requiresReconfigure = unprepareForFusion();
     if (mReformatBufferProvider.get() != nullptr) {
         mReformatBufferProvider.reset(nullptr);
         requiresReconfigure = true;
@@ -346,17 +365,28 @@ void AudioMixer::Track::reconfigureBufferProviders()
         mAdjustChannelsBufferProvider->setBufferProvider(bufferProvider);
         bufferProvider = mAdjustChannelsBufferProvider.get();
     }
-    if (mReformatBufferProvider.get() != nullptr) {
-        mReformatBufferProvider->setBufferProvider(bufferProvider);
-        bufferProvider = mReformatBufferProvider.get();
-    }
-    if (mDownmixerBufferProvider.get() != nullptr) {
-        mDownmixerBufferProvider->setBufferProvider(bufferProvider);
-        bufferProvider = mDownmixerBufferProvider.get();
+    // the reformat, downmix and post downmix reformat stages are all CopyBufferProviders.
+    std::vector<CopyBufferProvider *> stages;
+    for (PassthruBufferProvider *provider : {mReformatBufferProvider.get(),
+            mDownmixerBufferProvider.get(), mPostDownmixReformatBufferProvider.get()}) {
+        if (provider != nullptr) {
+            stages.push_back(static_cast<CopyBufferProvider *>(provider));
+        }
     }
-    if (mPostDownmixReformatBufferProvider.get() != nullptr) {
-        mPostDownmixReformatBufferProvider->setBufferProvider(bufferProvider);
-        bufferProvider = mPostDownmixReformatBufferProvider.get();
+    if (kUseFusedBufferProviders && stages.size() > 1) {
+        if (mFusedBufferProvider.get() == nullptr
+                || static_cast<FusedBufferProvider *>(mFusedBufferProvider.get())
+                        ->getStages() != stages) {
+            mFusedBufferProvider.reset(new FusedBufferProvider(stages, kCopyBufferFrameCount));
+        }
+        mFusedBufferProvider->setBufferProvider(bufferProvider);
+        bufferProvider = mFusedBufferProvider.get();
+    } else {
+        mFusedBufferProvider.reset(nullptr);
+        for (CopyBufferProvider *stage : stages) {
+            stage->setBufferProvider(bufferProvider);
+            bufferProvider = stage;
+        }
     }
     if (mTimestretchBufferProvider.get() != nullptr) {
         mTimestretchBufferProvider->setBufferProvider(bufferProvider);
@@ -539,6 +569,8 @@ void AudioMixer::setBufferProvider(int name, AudioBufferProvider* bufferProvider
     // reset order from downstream to upstream buffer providers.
     if (track->mTimestretchBufferProvider.get() != nullptr) {
         track->mTimestretchBufferProvider->reset();
+    } else if (track->mFusedBufferProvider.get() != nullptr) {
+        track->mFusedBufferProvider->reset();
     } else if (track->mPostDownmixReformatBufferProvider.get() != nullptr) {
         track->mPostDownmixReformatBufferProvider->reset();
     } else if (track->mDownmixerBufferProvider != nullptr) {
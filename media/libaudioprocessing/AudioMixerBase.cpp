@@ -625,6 +625,7 @@ void AudioMixerBase::process__validate()
     bool all16BitsStereoNoResample = true;
     bool resampling = false;
     bool volumeRamp = false;
+    bool allMultiTrackMixable = kUseNewMixer;
 
     mEnabled.clear();
     mGroups.clear();
@@ -656,6 +657,9 @@ void AudioMixerBase::process__validate()
         if (n & NEEDS_MUTE) {
             t->hook = &TrackBase::track__nop;
         } else {
+            if (!t->isMultiTrackMixable()) {
+                allMultiTrackMixable = false;
+            }
             if (n & NEEDS_AUX) {
                 all16BitsStereoNoResample = false;
             }
@@ -717,6 +721,11 @@ void AudioMixerBase::process__validate()
         } else {
             // we keep temp arrays around.
             mHook = &AudioMixerBase::process__genericNoResampling;
+            if (allMultiTrackMixable && mEnabled.size() > 1) {
+                mMultiTracks.reserve(mEnabled.size());
+                mMultiTracksRamp.reserve(mEnabled.size());
+                mHook = &AudioMixerBase::process__multiTrackNoResampling;
+            }
             if (all16BitsStereoNoResample && !volumeRamp) {
                 if (mEnabled.size() == 1) {
                     const std::shared_ptr<TrackBase> &t = mTracks[mEnabled[0]];
@@ -736,8 +745,9 @@ void AudioMixerBase::process__validate()
     }
 
     ALOGV("mixer configuration change: %zu "
-        "all16BitsStereoNoResample=%d, resampling=%d, volumeRamp=%d",
-        mEnabled.size(), all16BitsStereoNoResample, resampling, volumeRamp);
+        "all16BitsStereoNoResample=%d, resampling=%d, volumeRamp=%d, multiTrack=%d",
+        mEnabled.size(), all16BitsStereoNoResample, resampling, volumeRamp,
+        mHook == &AudioMixerBase::process__multiTrackNoResampling);
 
     process();
 
@@ -1090,6 +1100,47 @@ void AudioMixerBase::process__nop()
     }
 }
 
+// Mixes one block of frameCount frames of a non-resampled track into outTemp through
+// the track hook, acquiring new buffers from the provider as needed.
+// numFrames is the position of the block within the mixer buffer.
+void AudioMixerBase::mixTrackBlock(
+        TrackBase *t, int32_t *outTemp, size_t frameCount, size_t numFrames)
+{
+    int32_t *aux = NULL;
+    if (CC_UNLIKELY(t->needs & NEEDS_AUX)) {
+        aux = t->auxBuffer + numFrames;
+    }
+    for (int outFrames = frameCount; outFrames > 0; ) {
+        // t->in == nullptr can happen if the track was flushed just after having
+        // been enabled for mixing.
+        if (t->mIn == nullptr) {
+            break;
+        }
+        size_t inFrames = (t->frameCount > outFrames)?outFrames:t->frameCount;
+        if (inFrames > 0) {
+            (t->*t->hook)(
+                    outTemp + (frameCount - outFrames) * t->mMixerChannelCount,
+                    inFrames, mResampleTemp.get() /* naked ptr */, aux);
+            t->frameCount -= inFrames;
+            outFrames -= inFrames;
+            if (CC_UNLIKELY(aux != NULL)) {
+                aux += inFrames;
+            }
+        }
+        if (t->frameCount == 0 && outFrames) {
+            t->bufferProvider->releaseBuffer(&t->buffer);
+            t->buffer.frameCount = (mFrameCount - numFrames) -
+                    (frameCount - outFrames);
+            t->bufferProvider->getNextBuffer(&t->buffer);
+            t->mIn = t->buffer.raw;
+            if (t->mIn == nullptr) {
+                break;
+            }
+            t->frameCount = t->buffer.frameCount;
+        }
+    }
+}
+
 // generic code without resampling
 void AudioMixerBase::process__genericNoResampling()
 {
@@ -1115,44 +1166,152 @@ void AudioMixerBase::process__genericNoResampling()
         do {
             const size_t frameCount = std::min((size_t)BLOCKSIZE, mFrameCount - numFrames);
             memset(outTemp, 0, sizeof(outTemp));
+            for (const int name : group) {
+                mixTrackBlock(mTracks[name].get(), outTemp, frameCount, numFrames);
+            }
+
+            const std::shared_ptr<TrackBase> &t1 = mTracks[group[0]];
+            convertMixerFormat(out, t1->mMixerFormat, outTemp, t1->mMixerInFormat,
+                    frameCount * t1->mMixerChannelCount);
+            // TODO: fix ugly casting due to choice of out pointer type
+            out = reinterpret_cast<int32_t*>((uint8_t*)out
+                    + frameCount * t1->mMixerChannelCount
+                    * audio_bytes_per_sample(t1->mMixerFormat));
+            numFrames += frameCount;
+        } while (numFrames < mFrameCount);
+
+        // release each track's buffer
+        for (const int name : group) {
+            const std::shared_ptr<TrackBase> &t = mTracks[name];
+            t->bufferProvider->releaseBuffer(&t->buffer);
+        }
+    }
+}
+
+// Mixes up to MULTITRACK_MAX_TRACKS stereo tracks, each with at least frameCount
+// frames available at mIn, into out with the multi-track kernels of AudioMixerOps.h.
+template <typename TO, typename TI>
+void AudioMixerBase::mixMultiTracks(
+        TO *out, size_t frameCount, TrackBase * const *tracks, size_t count, bool ramp)
+{
+    // float input uses float volumes, int16_t input uses the legacy integer volumes.
+    constexpr bool useFloat = std::is_same_v<TI, float>;
+    using TV = std::conditional_t<useFloat, float, int16_t>;
+    using TVR = std::conditional_t<useFloat, float, int32_t>;
+
+    const TI *in[MULTITRACK_MAX_TRACKS];
+    for (size_t i = 0; i < count; ++i) {
+        in[i] = static_cast<const TI *>(tracks[i]->mIn);
+    }
+    if (ramp) {
+        TVR vol[MULTITRACK_MAX_TRACKS][FCC_2];
+        TVR volinc[MULTITRACK_MAX_TRACKS][FCC_2];
+        for (size_t i = 0; i < count; ++i) {
+            for (size_t c = 0; c < FCC_2; ++c) {
+                if constexpr (useFloat) {
+                    vol[i][c] = tracks[i]->mPrevVolume[c];
+                    volinc[i][c] = tracks[i]->mVolumeInc[c];
+                } else {
+                    vol[i][c] = tracks[i]->prevVolume[c];
+                    volinc[i][c] = tracks[i]->volumeInc[c];
+                }
+            }
+        }
+        volumeRampMultiTracks<TO, TI, TVR>(out, frameCount, in, vol, volinc, count);
+        for (size_t i = 0; i < count; ++i) {
+            for (size_t c = 0; c < FCC_2; ++c) {
+                if constexpr (useFloat) {
+                    tracks[i]->mPrevVolume[c] = vol[i][c];
+                } else {
+                    tracks[i]->prevVolume[c] = vol[i][c];
+                }
+            }
+            tracks[i]->adjustVolumeRamp(false /* aux */, useFloat);
+        }
+    } else {
+        TV vol[MULTITRACK_MAX_TRACKS][FCC_2];
+        for (size_t i = 0; i < count; ++i) {
+            for (size_t c = 0; c < FCC_2; ++c) {
+                if constexpr (useFloat) {
+                    vol[i][c] = tracks[i]->mVolume[c];
+                } else {
+                    vol[i][c] = tracks[i]->volume[c];
+                }
+            }
+        }
+        volumeMultiTracks<TO, TI, TV>(out, frameCount, in, vol, count);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        tracks[i]->mIn = in[i] + frameCount * FCC_2;
+    }
+}
+
+// multi-track code without resampling, used when all tracks are stereo without aux.
+// Tracks with a whole block of input available are accumulated several at a time,
+// the others fall back to their track hook as in process__genericNoResampling.
+void AudioMixerBase::process__multiTrackNoResampling()
+{
+    ALOGVV("process__multiTrackNoResampling\n");
+    int32_t outTemp[BLOCKSIZE * MAX_NUM_CHANNELS] __attribute__((aligned(32)));
+
+    for (const auto &pair : mGroups) {
+        const auto &group = pair.second;
+
+        // acquire buffer
+        for (const int name : group) {
+            const std::shared_ptr<TrackBase> &t = mTracks[name];
+            t->buffer.frameCount = mFrameCount;
+            t->bufferProvider->getNextBuffer(&t->buffer);
+            t->frameCount = t->buffer.frameCount;
+            t->mIn = t->buffer.raw;
+        }
+
+        const std::shared_ptr<TrackBase> &t1 = mTracks[group[0]];
+        const bool useFloat = t1->mMixerInFormat == AUDIO_FORMAT_PCM_FLOAT;
+        int32_t *out = (int *)pair.first;
+        size_t numFrames = 0;
+        do {
+            const size_t frameCount = std::min((size_t)BLOCKSIZE, mFrameCount - numFrames);
+            memset(outTemp, 0, sizeof(outTemp));
+            mMultiTracks.clear();
+            mMultiTracksRamp.clear();
             for (const int name : group) {
                 const std::shared_ptr<TrackBase> &t = mTracks[name];
-                int32_t *aux = NULL;
-                if (CC_UNLIKELY(t->needs & NEEDS_AUX)) {
-                    aux = t->auxBuffer + numFrames;
+                if (t->mIn != nullptr && t->frameCount >= frameCount
+                        && (t->needs & NEEDS_MUTE) == 0) {
+                    (t->needsRamp() ? mMultiTracksRamp : mMultiTracks).push_back(t.get());
+                } else {
+                    mixTrackBlock(t.get(), outTemp, frameCount, numFrames);
                 }
-                for (int outFrames = frameCount; outFrames > 0; ) {
-                    // t->in == nullptr can happen if the track was flushed just after having
-                    // been enabled for mixing.
-                    if (t->mIn == nullptr) {
-                        break;
-                    }
-                    size_t inFrames = (t->frameCount > outFrames)?outFrames:t->frameCount;
-                    if (inFrames > 0) {
-                        (t.get()->*t->hook)(
-                                outTemp + (frameCount - outFrames) * t->mMixerChannelCount,
-                                inFrames, mResampleTemp.get() /* naked ptr */, aux);
-                        t->frameCount -= inFrames;
-                        outFrames -= inFrames;
-                        if (CC_UNLIKELY(aux != NULL)) {
-                            aux += inFrames;
-                        }
+            }
+            for (const bool ramp : {false, true}) {
+                const std::vector<TrackBase *> &tracks = ramp ? mMultiTracksRamp : mMultiTracks;
+                for (size_t i = 0; i < tracks.size(); i += MULTITRACK_MAX_TRACKS) {
+                    const size_t count = std::min(MULTITRACK_MAX_TRACKS, tracks.size() - i);
+                    if (useFloat) {
+                        mixMultiTracks<float /*TO*/, float /*TI*/>(
+                                reinterpret_cast<float *>(outTemp), frameCount,
+                                tracks.data() + i, count, ramp);
+                    } else {
+                        mixMultiTracks<int32_t /*TO*/, int16_t /*TI*/>(
+                                outTemp, frameCount, tracks.data() + i, count, ramp);
                     }
-                    if (t->frameCount == 0 && outFrames) {
+                }
+                // advance and refill as mixTrackBlock does once the buffer is consumed.
+                for (TrackBase *t : tracks) {
+                    t->frameCount -= frameCount;
+                    if (t->frameCount == 0 && numFrames + frameCount < mFrameCount) {
                         t->bufferProvider->releaseBuffer(&t->buffer);
-                        t->buffer.frameCount = (mFrameCount - numFrames) -
-                                (frameCount - outFrames);
+                        t->buffer.frameCount = mFrameCount - numFrames - frameCount;
                         t->bufferProvider->getNextBuffer(&t->buffer);
                         t->mIn = t->buffer.raw;
-                        if (t->mIn == nullptr) {
-                            break;
+                        if (t->mIn != nullptr) {
+                            t->frameCount = t->buffer.frameCount;
                         }
-                        t->frameCount = t->buffer.frameCount;
                     }
                 }
             }
 
-            const std::shared_ptr<TrackBase> &t1 = mTracks[group[0]];
             convertMixerFormat(out, t1->mMixerFormat, outTemp, t1->mMixerInFormat,
                     frameCount * t1->mMixerChannelCount);
             // TODO: fix ugly casting due to choice of out pointer type
@@ -1507,7 +1666,18 @@ void AudioMixerBase::TrackBase::track__Resample(TO* out, size_t outFrameCount, T
     ALOGVV("track__Resample\n");
     mResampler->setSampleRate(sampleRate);
     const bool ramp = needsRamp();
-    if (MIXTYPE == MIXTYPE_MONOEXPAND || MIXTYPE == MIXTYPE_STEREOEXPAND // custom volume handling
+    if (MIXTYPE != MIXTYPE_MONOEXPAND && MIXTYPE != MIXTYPE_STEREOEXPAND
+            && std::is_same_v<TI, float> && ramp && aux == NULL
+            && mResampler->setVolumeRamp(
+                    mPrevVolume[0], mPrevVolume[1], mVolumeInc[0], mVolumeInc[1])) {
+        // if ramp without aux: the resampler applies the float volume ramp
+        // and accumulates into out in a single pass.
+        mResampler->resample((int32_t*)out, outFrameCount, bufferProvider);
+        mResampler->getVolume(&mPrevVolume[0], &mPrevVolume[1]);
+        adjustVolumeRamp(false /* aux */, true /* useFloat */);
+
+    } else if (MIXTYPE == MIXTYPE_MONOEXPAND
+            || MIXTYPE == MIXTYPE_STEREOEXPAND // custom volume handling
             || ramp || aux != NULL) {
         // if ramp:        resample with unity gain to temp buffer and scale/mix in 2nd step.
         // if aux != NULL: resample with unity gain to temp buffer then apply send level.
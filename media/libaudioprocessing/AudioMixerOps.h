@@ -21,6 +21,17 @@
 #include <audio_utils/primitives.h>
 #include <system/audio.h>
 
+#if defined(__aarch64__) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define MIXER_OPS_USE_NEON
+#elif defined(__SSE2__)
+#include <immintrin.h>
+#define MIXER_OPS_USE_SSE2
+// The AVX2 kernels are compiled with a target attribute and selected at runtime,
+// as x86 builds do not generally enable AVX2.
+#define MIXER_OPS_USE_AVX2
+#endif
+
 namespace android {
 
 // Hack to make static_assert work in a constexpr
@@ -604,6 +615,349 @@ inline void volumeMulti(TO* out, size_t frameCount,
     }
 }
 
+/*
+ * The volumeMultiTracks and volumeRampMultiTracks functions mix several
+ * stereo tracks into a single stereo output in one pass.  The output is read
+ * and written once per block of frames instead of once per track, and the
+ * accumulation is kept in vector registers where available.
+ *
+ * These are used by AudioMixerBase::process__multiTrackNoResampling() for
+ * stereo tracks that are not resampled and have no aux send.
+ *
+ *   TO: int32_t (Q4.27) or float
+ *   TI: int16_t (Q0.15) or float
+ *   TV: int16_t (U4.12) or int32_t (U4.28, ramp only) or float
+ *
+ *   in:     per track input pointers, each to frameCount interleaved stereo frames.
+ *   vol:    per track left and right volume.
+ *   volinc: per track left and right volume increment (ramp only).
+ *   tracks: number of tracks, at most MULTITRACK_MAX_TRACKS.
+ *
+ * This accumulates into the out pointer.
+ */
+
+constexpr size_t MULTITRACK_MAX_TRACKS = 8;
+
+template <typename TO, typename TI, typename TV>
+inline void volumeMultiTracksScalar(TO* out, size_t frameCount,
+        const TI* const* in, const TV (*vol)[FCC_2], size_t tracks)
+{
+    for (size_t i = 0; i < frameCount * FCC_2; i += FCC_2) {
+        TO left = out[i];
+        TO right = out[i + 1];
+        for (size_t t = 0; t < tracks; ++t) {
+            left += MixMul<TO, TI, TV>(in[t][i], vol[t][0]);
+            right += MixMul<TO, TI, TV>(in[t][i + 1], vol[t][1]);
+        }
+        out[i] = left;
+        out[i + 1] = right;
+    }
+}
+
+template <typename TO, typename TI, typename TV>
+inline void volumeRampMultiTracksScalar(TO* out, size_t frameCount,
+        const TI* const* in, TV (*vol)[FCC_2], const TV (*volinc)[FCC_2], size_t tracks)
+{
+    for (size_t i = 0; i < frameCount * FCC_2; i += FCC_2) {
+        TO left = out[i];
+        TO right = out[i + 1];
+        for (size_t t = 0; t < tracks; ++t) {
+            left += MixMul<TO, TI, TV>(in[t][i], vol[t][0]);
+            right += MixMul<TO, TI, TV>(in[t][i + 1], vol[t][1]);
+            vol[t][0] += volinc[t][0];
+            vol[t][1] += volinc[t][1];
+        }
+        out[i] = left;
+        out[i + 1] = right;
+    }
+}
+
+template <typename TO, typename TI, typename TV>
+inline void volumeMultiTracks(TO* out, size_t frameCount,
+        const TI* const* in, const TV (*vol)[FCC_2], size_t tracks)
+{
+    volumeMultiTracksScalar<TO, TI, TV>(out, frameCount, in, vol, tracks);
+}
+
+template <typename TO, typename TI, typename TV>
+inline void volumeRampMultiTracks(TO* out, size_t frameCount,
+        const TI* const* in, TV (*vol)[FCC_2], const TV (*volinc)[FCC_2], size_t tracks)
+{
+    volumeRampMultiTracksScalar<TO, TI, TV>(out, frameCount, in, vol, volinc, tracks);
+}
+
+template <typename TV>
+inline void advanceMultiTrackVolume(TV (*vol)[FCC_2], const TV (*volinc)[FCC_2],
+        size_t frameCount, size_t tracks)
+{
+    for (size_t t = 0; t < tracks; ++t) {
+        vol[t][0] += frameCount * volinc[t][0];
+        vol[t][1] += frameCount * volinc[t][1];
+    }
+}
+
+#if defined(MIXER_OPS_USE_AVX2)
+
+// Returns whether the CPU supports AVX2, checked once. The result only depends on
+// the CPU, so each translation unit may keep its own copy.
+static inline bool mixerOpsUseAvx2()
+{
+    static const bool useAvx2 = [] {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+    }();
+    return useAvx2;
+}
+
+/*
+ * The AVX2 kernels process whole vectors of 8 samples, and return the number
+ * of samples processed. The caller finishes the remaining samples.
+ */
+
+__attribute__((target("avx2")))
+inline size_t volumeMultiTracksAvx2(float* out, size_t sampleCount,
+        const float* const* in, const float (*vol)[FCC_2], size_t tracks)
+{
+    __m256 volv[MULTITRACK_MAX_TRACKS];
+    for (size_t t = 0; t < tracks; ++t) {
+        volv[t] = _mm256_setr_ps(vol[t][0], vol[t][1], vol[t][0], vol[t][1],
+                vol[t][0], vol[t][1], vol[t][0], vol[t][1]);
+    }
+    size_t i = 0;
+    for (; i + 8 <= sampleCount; i += 8) {
+        __m256 accum = _mm256_loadu_ps(out + i);
+        for (size_t t = 0; t < tracks; ++t) {
+            accum = _mm256_add_ps(accum, _mm256_mul_ps(_mm256_loadu_ps(in[t] + i), volv[t]));
+        }
+        _mm256_storeu_ps(out + i, accum);
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+inline size_t volumeMultiTracksAvx2(int32_t* out, size_t sampleCount,
+        const int16_t* const* in, const int16_t (*vol)[FCC_2], size_t tracks)
+{
+    __m256i volv[MULTITRACK_MAX_TRACKS];
+    for (size_t t = 0; t < tracks; ++t) {
+        volv[t] = _mm256_setr_epi32(vol[t][0], vol[t][1], vol[t][0], vol[t][1],
+                vol[t][0], vol[t][1], vol[t][0], vol[t][1]);
+    }
+    size_t i = 0;
+    for (; i + 8 <= sampleCount; i += 8) {
+        __m256i accum = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(out + i));
+        for (size_t t = 0; t < tracks; ++t) {
+            const __m256i value = _mm256_cvtepi16_epi32(
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(in[t] + i)));
+            accum = _mm256_add_epi32(accum, _mm256_mullo_epi32(value, volv[t]));
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), accum);
+    }
+    return i;
+}
+
+// Does not update vol; the caller advances it by the frames processed.
+__attribute__((target("avx2")))
+inline size_t volumeRampMultiTracksAvx2(float* out, size_t sampleCount,
+        const float* const* in, const float (*vol)[FCC_2], const float (*volinc)[FCC_2],
+        size_t tracks)
+{
+    __m256 volv[MULTITRACK_MAX_TRACKS];
+    __m256 incv[MULTITRACK_MAX_TRACKS];
+    for (size_t t = 0; t < tracks; ++t) {
+        const float l = vol[t][0], r = vol[t][1];
+        const float dl = volinc[t][0], dr = volinc[t][1];
+        volv[t] = _mm256_setr_ps(l, r, l + dl, r + dr,
+                l + 2 * dl, r + 2 * dr, l + 3 * dl, r + 3 * dr);
+        incv[t] = _mm256_setr_ps(4 * dl, 4 * dr, 4 * dl, 4 * dr,
+                4 * dl, 4 * dr, 4 * dl, 4 * dr);
+    }
+    size_t i = 0;
+    for (; i + 8 <= sampleCount; i += 8) {
+        __m256 accum = _mm256_loadu_ps(out + i);
+        for (size_t t = 0; t < tracks; ++t) {
+            accum = _mm256_add_ps(accum, _mm256_mul_ps(_mm256_loadu_ps(in[t] + i), volv[t]));
+            volv[t] = _mm256_add_ps(volv[t], incv[t]);
+        }
+        _mm256_storeu_ps(out + i, accum);
+    }
+    return i;
+}
+
+#endif // MIXER_OPS_USE_AVX2
+
+template <>
+inline void volumeMultiTracks<float, float, float>(float* out, size_t frameCount,
+        const float* const* in, const float (*vol)[FCC_2], size_t tracks)
+{
+    size_t i = 0;
+    const size_t sampleCount = frameCount * FCC_2;
+#if defined(MIXER_OPS_USE_AVX2)
+    if (mixerOpsUseAvx2()) {
+        i = volumeMultiTracksAvx2(out, sampleCount, in, vol, tracks);
+    }
+#endif
+#if defined(MIXER_OPS_USE_SSE2)
+    __m128 volv[MULTITRACK_MAX_TRACKS];
+    for (size_t t = 0; t < tracks; ++t) {
+        volv[t] = _mm_setr_ps(vol[t][0], vol[t][1], vol[t][0], vol[t][1]);
+    }
+    for (; i + 4 <= sampleCount; i += 4) {
+        __m128 accum = _mm_loadu_ps(out + i);
+        for (size_t t = 0; t < tracks; ++t) {
+            accum = _mm_add_ps(accum, _mm_mul_ps(_mm_loadu_ps(in[t] + i), volv[t]));
+        }
+        _mm_storeu_ps(out + i, accum);
+    }
+#elif defined(MIXER_OPS_USE_NEON)
+    float32x4_t volv[MULTITRACK_MAX_TRACKS];
+    for (size_t t = 0; t < tracks; ++t) {
+        const float32x2_t lr = vld1_f32(vol[t]);
+        volv[t] = vcombine_f32(lr, lr);
+    }
+    for (; i + 4 <= sampleCount; i += 4) {
+        float32x4_t accum = vld1q_f32(out + i);
+        for (size_t t = 0; t < tracks; ++t) {
+            accum = vmlaq_f32(accum, vld1q_f32(in[t] + i), volv[t]);
+        }
+        vst1q_f32(out + i, accum);
+    }
+#endif
+    if (i < sampleCount) {
+        const float *tail[MULTITRACK_MAX_TRACKS];
+        for (size_t t = 0; t < tracks; ++t) {
+            tail[t] = in[t] + i;
+        }
+        volumeMultiTracksScalar<float, float, float>(
+                out + i, (sampleCount - i) / FCC_2, tail, vol, tracks);
+    }
+}
+
+template <>
+inline void volumeMultiTracks<int32_t, int16_t, int16_t>(int32_t* out, size_t frameCount,
+        const int16_t* const* in, const int16_t (*vol)[FCC_2], size_t tracks)
+{
+    size_t i = 0;
+    const size_t sampleCount = frameCount * FCC_2;
+#if defined(MIXER_OPS_USE_AVX2)
+    if (mixerOpsUseAvx2()) {
+        i = volumeMultiTracksAvx2(out, sampleCount, in, vol, tracks);
+    }
+#endif
+#if defined(MIXER_OPS_USE_SSE2)
+    __m128i volv[MULTITRACK_MAX_TRACKS];
+    for (size_t t = 0; t < tracks; ++t) {
+        volv[t] = _mm_setr_epi16(vol[t][0], vol[t][1], vol[t][0], vol[t][1],
+                vol[t][0], vol[t][1], vol[t][0], vol[t][1]);
+    }
+    for (; i + 8 <= sampleCount; i += 8) {
+        __m128i accumLo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(out + i));
+        __m128i accumHi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(out + i + 4));
+        for (size_t t = 0; t < tracks; ++t) {
+            // 16 x 16 -> 32 bit products, assembled from the low and high halves.
+            const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in[t] + i));
+            const __m128i productLo = _mm_mullo_epi16(value, volv[t]);
+            const __m128i productHi = _mm_mulhi_epi16(value, volv[t]);
+            accumLo = _mm_add_epi32(accumLo, _mm_unpacklo_epi16(productLo, productHi));
+            accumHi = _mm_add_epi32(accumHi, _mm_unpackhi_epi16(productLo, productHi));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), accumLo);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 4), accumHi);
+    }
+#elif defined(MIXER_OPS_USE_NEON)
+    int16x4_t volv[MULTITRACK_MAX_TRACKS];
+    for (size_t t = 0; t < tracks; ++t) {
+        const int16_t lrlr[4] = {vol[t][0], vol[t][1], vol[t][0], vol[t][1]};
+        volv[t] = vld1_s16(lrlr);
+    }
+    for (; i + 8 <= sampleCount; i += 8) {
+        int32x4_t accumLo = vld1q_s32(out + i);
+        int32x4_t accumHi = vld1q_s32(out + i + 4);
+        for (size_t t = 0; t < tracks; ++t) {
+            const int16x8_t value = vld1q_s16(in[t] + i);
+            accumLo = vmlal_s16(accumLo, vget_low_s16(value), volv[t]);
+            accumHi = vmlal_s16(accumHi, vget_high_s16(value), volv[t]);
+        }
+        vst1q_s32(out + i, accumLo);
+        vst1q_s32(out + i + 4, accumHi);
+    }
+#endif
+    if (i < sampleCount) {
+        const int16_t *tail[MULTITRACK_MAX_TRACKS];
+        for (size_t t = 0; t < tracks; ++t) {
+            tail[t] = in[t] + i;
+        }
+        volumeMultiTracksScalar<int32_t, int16_t, int16_t>(
+                out + i, (sampleCount - i) / FCC_2, tail, vol, tracks);
+    }
+}
+
+/*
+ * The vectorized float ramp computes the volume of each frame in the vector
+ * as vol + k * volinc from the start of the vector, so the result may differ
+ * from volumeRampMultiTracksScalar() in the last bits of precision.
+ */
+template <>
+inline void volumeRampMultiTracks<float, float, float>(float* out, size_t frameCount,
+        const float* const* in, float (*vol)[FCC_2], const float (*volinc)[FCC_2], size_t tracks)
+{
+    size_t i = 0;
+    const size_t sampleCount = frameCount * FCC_2;
+#if defined(MIXER_OPS_USE_AVX2)
+    if (mixerOpsUseAvx2()) {
+        i = volumeRampMultiTracksAvx2(out, sampleCount, in, vol, volinc, tracks);
+        advanceMultiTrackVolume<float>(vol, volinc, i / FCC_2, tracks);
+    }
+#endif
+    const size_t vectorStart = i;
+#if defined(MIXER_OPS_USE_SSE2)
+    __m128 volv[MULTITRACK_MAX_TRACKS];
+    __m128 incv[MULTITRACK_MAX_TRACKS];
+    for (size_t t = 0; t < tracks; ++t) {
+        const float l = vol[t][0], r = vol[t][1];
+        const float dl = volinc[t][0], dr = volinc[t][1];
+        volv[t] = _mm_setr_ps(l, r, l + dl, r + dr);
+        incv[t] = _mm_setr_ps(2 * dl, 2 * dr, 2 * dl, 2 * dr);
+    }
+    for (; i + 4 <= sampleCount; i += 4) {
+        __m128 accum = _mm_loadu_ps(out + i);
+        for (size_t t = 0; t < tracks; ++t) {
+            accum = _mm_add_ps(accum, _mm_mul_ps(_mm_loadu_ps(in[t] + i), volv[t]));
+            volv[t] = _mm_add_ps(volv[t], incv[t]);
+        }
+        _mm_storeu_ps(out + i, accum);
+    }
+#elif defined(MIXER_OPS_USE_NEON)
+    float32x4_t volv[MULTITRACK_MAX_TRACKS];
+    float32x4_t incv[MULTITRACK_MAX_TRACKS];
+    for (size_t t = 0; t < tracks; ++t) {
+        const float l = vol[t][0], r = vol[t][1];
+        const float dl = volinc[t][0], dr = volinc[t][1];
+        const float start[4] = {l, r, l + dl, r + dr};
+        const float step[4] = {2 * dl, 2 * dr, 2 * dl, 2 * dr};
+        volv[t] = vld1q_f32(start);
+        incv[t] = vld1q_f32(step);
+    }
+    for (; i + 4 <= sampleCount; i += 4) {
+        float32x4_t accum = vld1q_f32(out + i);
+        for (size_t t = 0; t < tracks; ++t) {
+            accum = vmlaq_f32(accum, vld1q_f32(in[t] + i), volv[t]);
+            volv[t] = vaddq_f32(volv[t], incv[t]);
+        }
+        vst1q_f32(out + i, accum);
+    }
+#endif
+    advanceMultiTrackVolume<float>(vol, volinc, (i - vectorStart) / FCC_2, tracks);
+    if (i < sampleCount) {
+        const float *tail[MULTITRACK_MAX_TRACKS];
+        for (size_t t = 0; t < tracks; ++t) {
+            tail[t] = in[t] + i;
+        }
+        volumeRampMultiTracksScalar<float, float, float>(
+                out + i, (sampleCount - i) / FCC_2, tail, vol, volinc, tracks);
+    }
+}
+
 };
 
 #endif /* ANDROID_AUDIO_MIXER_OPS_H */
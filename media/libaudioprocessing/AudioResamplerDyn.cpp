@@ -23,6 +23,12 @@
 #include <dlfcn.h>
 #include <math.h>
 
+#include <atomic>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <tuple>
+
 #include <cutils/compiler.h>
 #include <cutils/properties.h>
 #include <utils/Log.h>
@@ -40,8 +46,29 @@
 // use this for our buffer alignment.  Should be at least 32 bytes.
 constexpr size_t CACHE_LINE_SIZE = 64;
 
+// number of most recently designed filters kept in the cache even when
+// no resampler uses them, so that track teardown and recreation stays cheap.
+constexpr size_t kFirCacheRetainedFilters = 4;
+
+// number of filters each thread keeps for lookups without the cache lock.
+constexpr size_t kFirCacheThreadFilters = 2;
+
 namespace android {
 
+// statistics of the filter cache, for all coefficient types.
+static std::atomic<size_t> sFirCacheFilters;
+static std::atomic<size_t> sFirCacheBytes;
+static std::atomic<uint64_t> sFirCacheHits;
+static std::atomic<uint64_t> sFirCacheMisses;
+
+#if USE_AVX_DISPATCH
+int& firSimdLevel()
+{
+    static int level = detectFirSimdLevel();
+    return level;
+}
+#endif
+
 /*
  * InBuffer is a type agnostic input buffer.
  *
@@ -181,10 +208,11 @@ template<typename TC, typename TI, typename TO>
 AudioResamplerDyn<TC, TI, TO>::AudioResamplerDyn(
         int inChannelCount, int32_t sampleRate, src_quality quality)
     : AudioResampler(inChannelCount, sampleRate, quality),
-      mResampleFunc(0), mFilterSampleRate(0), mFilterQuality(DEFAULT_QUALITY),
-    mCoefBuffer(NULL)
+      mVolumeRamp(false), mResampleFunc(0), mResampleRampFunc(0),
+      mFilterSampleRate(0), mFilterQuality(DEFAULT_QUALITY)
 {
     mVolumeSimd[0] = mVolumeSimd[1] = 0;
+    mVolumeIncSimd[0] = mVolumeIncSimd[1] = 0;
     // The AudioResampler base class assumes we are always ready for 1:1 resampling.
     // We reset mInSampleRate to 0, so setSampleRate() will calculate filters for
     // setSampleRate() for 1:1. (May be removed if precalculated filters are used.)
@@ -207,7 +235,6 @@ AudioResamplerDyn<TC, TI, TO>::AudioResamplerDyn(
 template<typename TC, typename TI, typename TO>
 AudioResamplerDyn<TC, TI, TO>::~AudioResamplerDyn()
 {
-    free(mCoefBuffer);
 }
 
 template<typename TC, typename TI, typename TO>
@@ -230,6 +257,36 @@ void AudioResamplerDyn<TC, TI, TO>::setVolume(float left, float right)
         mVolumeSimd[0] = u4_28_from_float(clampFloatVol(left));
         mVolumeSimd[1] = u4_28_from_float(clampFloatVol(right));
     }
+    mVolumeIncSimd[0] = mVolumeIncSimd[1] = 0;
+    mVolumeRamp = false;
+}
+
+template<typename TC, typename TI, typename TO>
+bool AudioResamplerDyn<TC, TI, TO>::setVolumeRamp(
+        float left, float right, float leftInc, float rightInc)
+{
+    // The ramp is only fused for float output, where the volume matches
+    // the float volume ramp of the mixer exactly.
+    if (!is_same<TO, float>::value || mResampleRampFunc == nullptr) {
+        return false;
+    }
+    setVolume(left, right);
+    mVolumeIncSimd[0] = static_cast<TO>(leftInc);
+    mVolumeIncSimd[1] = static_cast<TO>(rightInc);
+    mVolumeRamp = true;
+    return true;
+}
+
+template<typename TC, typename TI, typename TO>
+void AudioResamplerDyn<TC, TI, TO>::getVolume(float *left, float *right) const
+{
+    if (is_same<TO, float>::value || is_same<TO, double>::value) {
+        *left = static_cast<float>(mVolumeSimd[0]);
+        *right = static_cast<float>(mVolumeSimd[1]);
+    } else {
+        *left = float_from_u4_28(mVolumeSimd[0]);
+        *right = float_from_u4_28(mVolumeSimd[1]);
+    }
 }
 
 // TODO: update to C++11
@@ -263,24 +320,14 @@ void AudioResamplerDyn<TC, TI, TO>::createKaiserFir(Constants &c,
     const int phases = c.mL;
     const int halfLength = c.mHalfNumCoefs;
 
-    // create buffer
-    TC *coefs = nullptr;
-    int ret = posix_memalign(
-            reinterpret_cast<void **>(&coefs),
-            CACHE_LINE_SIZE /* alignment */,
-            (phases + 1) * halfLength * sizeof(TC));
-    LOG_ALWAYS_FATAL_IF(ret != 0, "Cannot allocate buffer memory, ret %d", ret);
-    c.mFirCoefs = coefs;
-    free(mCoefBuffer);
-    mCoefBuffer = coefs;
-
     // square the computed minimum passband value (extra safety).
     double attenuation =
             computeWindowedSincMinimumPassbandValue(stopBandAtten);
     attenuation *= attenuation;
 
-    // design filter
-    firKaiserGen(coefs, phases, halfLength, stopBandAtten, fcr, attenuation);
+    // design filter, or reuse an identical one.
+    mCoefBuffer = getSharedFir(phases, halfLength, stopBandAtten, fcr, attenuation);
+    c.mFirCoefs = mCoefBuffer.get();
 
     // update the design criteria
     mNormalizedCutoffFrequency = fcr;
@@ -313,6 +360,89 @@ void AudioResamplerDyn<TC, TI, TO>::createKaiserFir(Constants &c,
 #endif
 }
 
+template<typename TC, typename TI, typename TO>
+std::shared_ptr<const TC> AudioResamplerDyn<TC, TI, TO>::getSharedFir(int phases,
+        int halfLength, double stopBandAtten, double fcr, double attenuation)
+{
+    // The attenuation is derived from stopBandAtten, so it is not part of the key.
+    using Key = std::tuple<int, int, double, double>;
+    static std::mutex sLock;
+    static std::map<Key, std::weak_ptr<const TC>> sCache;
+    static std::deque<std::shared_ptr<const TC>> sRetained;
+    // The filters last used by this thread, probed without the lock so that a
+    // mixer thread does not contend with the resamplers of other threads.
+    static thread_local std::deque<std::pair<Key, std::shared_ptr<const TC>>> tRecent;
+
+    const Key key{phases, halfLength, stopBandAtten, fcr};
+    const auto useOnThisThread = [&key](const std::shared_ptr<const TC> &coefs) {
+        tRecent.emplace_front(key, coefs);
+        if (tRecent.size() > kFirCacheThreadFilters) {
+            tRecent.pop_back();
+        }
+        return coefs;
+    };
+    for (const auto &[recentKey, coefs] : tRecent) {
+        if (recentKey == key) {
+            ++sFirCacheHits;
+            return coefs;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(sLock);
+        auto it = sCache.find(key);
+        if (it != sCache.end()) {
+            std::shared_ptr<const TC> coefs = it->second.lock();
+            if (coefs) {
+                ++sFirCacheHits;
+                return useOnThisThread(coefs);
+            }
+        }
+    }
+    ++sFirCacheMisses;
+
+    // create buffer and design the filter without holding the lock.
+    const size_t size = (phases + 1) * halfLength * sizeof(TC);
+    TC *coefs = nullptr;
+    int ret = posix_memalign(
+            reinterpret_cast<void **>(&coefs),
+            CACHE_LINE_SIZE /* alignment */,
+            size);
+    LOG_ALWAYS_FATAL_IF(ret != 0, "Cannot allocate buffer memory, ret %d", ret);
+    firKaiserGen(coefs, phases, halfLength, stopBandAtten, fcr, attenuation);
+
+    ++sFirCacheFilters;
+    sFirCacheBytes += size;
+    std::shared_ptr<const TC> shared(coefs, [size](const TC *p) {
+        free(const_cast<TC *>(p));
+        --sFirCacheFilters;
+        sFirCacheBytes -= size;
+    });
+
+    std::lock_guard<std::mutex> lock(sLock);
+    for (auto it = sCache.begin(); it != sCache.end(); ) {
+        if (it->second.expired()) {
+            it = sCache.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    auto [it, inserted] = sCache.emplace(key, shared);
+    if (!inserted) {
+        // another resampler designed the same filter concurrently, use that one
+        // unless it has been released since.
+        std::shared_ptr<const TC> existing = it->second.lock();
+        if (existing) {
+            return useOnThisThread(existing);
+        }
+        it->second = shared;
+    }
+    sRetained.push_front(shared);
+    if (sRetained.size() > kFirCacheRetainedFilters) {
+        sRetained.pop_back();
+    }
+    return useOnThisThread(shared);
+}
+
 // recursive gcd. Using objdump, it appears the tail recursion is converted to a while loop.
 static int gcd(int n, int m)
 {
@@ -555,7 +685,7 @@ void AudioResamplerDyn<TC, TI, TO>::setSampleRate(int32_t inSampleRate)
 #undef AUDIORESAMPLERDYN_CASE
 #define AUDIORESAMPLERDYN_CASE(CHANNEL, LOCKED) \
     case CHANNEL: if constexpr (CHANNEL <= FCC_LIMIT) {\
-        mResampleFunc = &AudioResamplerDyn<TC, TI, TO>::resample<CHANNEL, LOCKED, 16>; \
+        mResampleFunc = &AudioResamplerDyn<TC, TI, TO>::resample<CHANNEL, LOCKED, 16, false>; \
     } break
 
     if (locked) {
@@ -615,6 +745,25 @@ void AudioResamplerDyn<TC, TI, TO>::setSampleRate(int32_t inSampleRate)
     }
 #pragma pop_macro("AUDIORESAMPLERDYN_CASE")
 
+    // Volume ramps are fused into the resampler only for mono and stereo input,
+    // which are the channel counts the mixer ramps with separate left and right volumes.
+    mResampleRampFunc = nullptr;
+    if constexpr (is_same<TO, float>::value) {
+        if (mChannelCount == 1) {
+            mResampleRampFunc = locked
+                    ? &AudioResamplerDyn<TC, TI, TO>::resample<1, true, 16, true>
+                    : &AudioResamplerDyn<TC, TI, TO>::resample<1, false, 16, true>;
+        } else if (mChannelCount == 2) {
+            mResampleRampFunc = locked
+                    ? &AudioResamplerDyn<TC, TI, TO>::resample<2, true, 16, true>
+                    : &AudioResamplerDyn<TC, TI, TO>::resample<2, false, 16, true>;
+        }
+    }
+    if (mResampleRampFunc == nullptr) {
+        mVolumeIncSimd[0] = mVolumeIncSimd[1] = 0;
+        mVolumeRamp = false;
+    }
+
 #ifdef DEBUG_RESAMPLER
     printf("channels:%d  %s  stride:%d  %s  coef:%d  shift:%d\n",
             mChannelCount, locked ? "locked" : "interpolated",
@@ -626,11 +775,12 @@ template<typename TC, typename TI, typename TO>
 size_t AudioResamplerDyn<TC, TI, TO>::resample(int32_t* out, size_t outFrameCount,
             AudioBufferProvider* provider)
 {
-    return (this->*mResampleFunc)(reinterpret_cast<TO*>(out), outFrameCount, provider);
+    return (this->*(mVolumeRamp ? mResampleRampFunc : mResampleFunc))(
+            reinterpret_cast<TO*>(out), outFrameCount, provider);
 }
 
 template<typename TC, typename TI, typename TO>
-template<int CHANNELS, bool LOCKED, int STRIDE>
+template<int CHANNELS, bool LOCKED, int STRIDE, bool RAMP>
 size_t AudioResamplerDyn<TC, TI, TO>::resample(TO* out, size_t outFrameCount,
         AudioBufferProvider* provider)
 {
@@ -727,6 +877,12 @@ size_t AudioResamplerDyn<TC, TI, TO>::resample(TO* out, size_t outFrameCount,
 
             outputIndex += OUTPUT_CHANNELS;
 
+            if constexpr (RAMP) {
+                // fir() reads the volume through volumeSimd, which points to mVolumeSimd.
+                mVolumeSimd[0] += mVolumeIncSimd[0];
+                mVolumeSimd[1] += mVolumeIncSimd[1];
+            }
+
             phaseFraction += phaseIncrement;
             while (phaseFraction >= phaseWrapLimit) {
                 if (inputIndex >= frameCount) {
@@ -766,5 +922,15 @@ template class AudioResamplerDyn<float, float, float>;
 template class AudioResamplerDyn<int16_t, int16_t, int32_t>;
 template class AudioResamplerDyn<int32_t, int16_t, int32_t>;
 
+AudioResampler::FilterCacheStats AudioResampler::getFilterCacheStats()
+{
+    FilterCacheStats stats;
+    stats.filters = sFirCacheFilters;
+    stats.bytes = sFirCacheBytes;
+    stats.hits = sFirCacheHits;
+    stats.misses = sFirCacheMisses;
+    return stats;
+}
+
 // ----------------------------------------------------------------------------
 } // namespace android
@@ -21,6 +21,8 @@
 #include <sys/types.h>
 #include <android/log.h>
 
+#include <memory>
+
 #include <media/AudioResampler.h>
 
 namespace android {
@@ -52,6 +54,10 @@ public:
 
     virtual void setVolume(float left, float right);
 
+    virtual bool setVolumeRamp(float left, float right, float leftInc, float rightInc);
+
+    virtual void getVolume(float *left, float *right) const;
+
     virtual size_t resample(int32_t* out, size_t outFrameCount,
             AudioBufferProvider* provider);
 
@@ -152,7 +158,13 @@ private:
 
     void createKaiserFir(Constants &c, double stopBandAtten, double fcr);
 
-    template<int CHANNELS, bool LOCKED, int STRIDE>
+    // Returns the filter bank for the design parameters, shared with other
+    // resamplers through a process-wide cache.  The bank is read-only and
+    // released when the last resampler using it drops its reference.
+    static std::shared_ptr<const TC> getSharedFir(int phases, int halfLength,
+            double stopBandAtten, double fcr, double attenuation);
+
+    template<int CHANNELS, bool LOCKED, int STRIDE, bool RAMP>
     size_t resample(TO* out, size_t outFrameCount, AudioBufferProvider* provider);
 
     // define a pointer to member function type for resample
@@ -163,10 +175,14 @@ private:
            InBuffer mInBuffer;
           Constants mConstants;        // current set of coefficient parameters
     TO __attribute__ ((aligned (8))) mVolumeSimd[2]; // must be aligned or NEON may crash
+                 TO mVolumeIncSimd[2]; // per output frame volume increment, if mVolumeRamp
+               bool mVolumeRamp;       // true if setVolumeRamp() is in effect
      resample_ABP_t mResampleFunc;     // called function for resampling
+     resample_ABP_t mResampleRampFunc; // called function for resampling with volume ramp,
+                                       // nullptr if not supported for this configuration.
             int32_t mFilterSampleRate; // designed filter sample rate.
         src_quality mFilterQuality;    // designed filter quality.
-              void* mCoefBuffer;       // if a filter is created, this is not null
+    std::shared_ptr<const TC> mCoefBuffer; // if a filter is created, this is not null
 
     // Property selected design parameters.
               // This will enable fixed high quality resampling.
@@ -46,7 +46,41 @@ namespace android {
 #include <tmmintrin.h>
 #else
 #define USE_SSE (false)
-#define USE_AVX2(false)
+#define USE_AVX2 (false)
+#endif
+
+// On x86, the float FIR kernels also have AVX2 (8-wide) and AVX-512 (16-wide)
+// variants compiled with function target attributes, and selected at runtime
+// by firSimdLevel() when the CPU supports them.
+#if USE_SSE
+#define USE_AVX_DISPATCH (true)
+#include <immintrin.h>
+
+enum {
+    FIR_SIMD_SSE,
+    FIR_SIMD_AVX2,
+    FIR_SIMD_AVX512,
+};
+
+static inline int detectFirSimdLevel()
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return FIR_SIMD_AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return FIR_SIMD_AVX2;
+    }
+    return FIR_SIMD_SSE;
+}
+
+// Returns the SIMD level used by the float FIR kernels, detected once.
+// Tests may assign a lower level to compare the kernels with each other.
+// Defined once in AudioResamplerDyn.cpp, so that the assignment reaches the
+// kernels compiled into the library.
+int& firSimdLevel();
+#else
+#define USE_AVX_DISPATCH (false)
 #endif
 
 
@@ -159,6 +159,20 @@ struct InterpNull {
     }
 };
 
+#if USE_AVX_DISPATCH
+// Multichannel float kernels for CHANNELS > 2, defined in AudioResamplerFirProcessSSE.h.
+// Returns false if the CPU does not support them.
+template <int CHANNELS, bool FIXED>
+static inline bool ProcessMultiChannelAVX(float* out,
+        size_t count,
+        const float* coefsP,
+        const float* coefsN,
+        const float* sP,
+        const float* sN,
+        float lerpP,
+        const float* volumeLR);
+#endif
+
 /*
  * Calculates a single output frame (two samples).
  *
@@ -189,6 +203,15 @@ void ProcessBase(TO* const out,
     static_assert(CHANNELS > 0, "CHANNELS must be > 0");
 
     if (CHANNELS > 2) {
+#if USE_AVX_DISPATCH
+        if constexpr (CHANNELS > 2 && is_same<TC, float>::value
+                && is_same<TI, float>::value && is_same<TO, float>::value) {
+            if (ProcessMultiChannelAVX<CHANNELS, is_same<TFUNC, InterpNull>::value>(
+                    out, count, coefsP, coefsN, sP, sN, lerpP, volumeLR)) {
+                return;
+            }
+        }
+#endif
         // TO accum[CHANNELS];
         Accumulator<CHANNELS, TO> accum;
 
@@ -34,6 +34,10 @@ namespace android {
 // SSEx specializations are enabled for Process() and ProcessL() in AudioResamplerFirProcess.h
 //
 
+template <int CHANNELS>
+static inline void ProcessSSEStore(float* out, __m128 accL, __m128 accR,
+        const float* volumeLR);
+
 template <int CHANNELS, int STRIDE, bool FIXED>
 static inline void ProcessSSEIntrinsic(float* out,
         int count,
@@ -58,9 +62,7 @@ static inline void ProcessSSEIntrinsic(float* out,
 
     __m128 accL, accR;
     accL = _mm_setzero_ps();
-    if (CHANNELS == 2) {
-        accR = _mm_setzero_ps();
-    }
+    accR = _mm_setzero_ps();
 
     do {
         __m128 posCoef = _mm_load_ps(coefsP);
@@ -146,6 +148,14 @@ static inline void ProcessSSEIntrinsic(float* out,
         }
     } while (count -= 4);
 
+    ProcessSSEStore<CHANNELS>(out, accL, accR, volumeLR);
+}
+
+// Sums the 4-wide accumulators, applies the volume and accumulates into out.
+template <int CHANNELS>
+static inline void ProcessSSEStore(float* out, __m128 accL, __m128 accR,
+        const float* volumeLR)
+{
     // multiply by volume and save
     __m128 vLR = _mm_setzero_ps();
     __m128 outSamp;
@@ -173,6 +183,363 @@ static inline void ProcessSSEIntrinsic(float* out,
     _mm_storel_pi(reinterpret_cast<__m64*>(out), outSamp);
 }
 
+#if USE_AVX_DISPATCH
+
+//
+// AVX2 (8-wide) and AVX-512 (16-wide) variants of ProcessSSEIntrinsic().
+//
+// These are compiled with function target attributes and only called after
+// firSimdLevel() has checked the CPU, so the library remains usable on CPUs
+// with SSSE3 only.  The sP and sN sample pointers point to the current frame
+// and are advanced by each step.
+//
+
+template <int CHANNELS, bool FIXED>
+__attribute__((target("avx2,fma"), always_inline))
+static inline void ProcessAVX2Step(__m256& accL, __m256& accR,
+        const float*& coefsP, const float*& coefsN,
+        const float*& coefsP1, const float*& coefsN1,
+        const float*& sP, const float*& sN, __m256 interp)
+{
+    __m256 posCoef = _mm256_loadu_ps(coefsP);
+    __m256 negCoef = _mm256_loadu_ps(coefsN);
+    coefsP += 8;
+    coefsN += 8;
+
+    if (!FIXED) { // interpolate
+        const __m256 posCoef1 = _mm256_loadu_ps(coefsP1);
+        const __m256 negCoef1 = _mm256_loadu_ps(coefsN1);
+        coefsP1 += 8;
+        coefsN1 += 8;
+
+        // posCoef = interp * (posCoef1 - posCoef) + posCoef
+        // negCoef = interp * (negCoef - negCoef1) + negCoef1
+        posCoef = _mm256_fmadd_ps(_mm256_sub_ps(posCoef1, posCoef), interp, posCoef);
+        negCoef = _mm256_fmadd_ps(_mm256_sub_ps(negCoef, negCoef1), interp, negCoef1);
+    }
+    if (CHANNELS == 1) {
+        // reverse the positive samples, frames 0 to -7.
+        const __m256 posSamp = _mm256_permutevar8x32_ps(_mm256_loadu_ps(sP - 7),
+                _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+        const __m256 negSamp = _mm256_loadu_ps(sN);
+        sP -= 8;
+        sN += 8;
+
+        accL = _mm256_fmadd_ps(posSamp, posCoef, accL);
+        accL = _mm256_fmadd_ps(negSamp, negCoef, accL);
+    } else {
+        // deinterleave within each 4 frame half, reversing the positives,
+        // then gather the left and right halves.
+        const __m256i posIndex = _mm256_setr_epi32(6, 4, 2, 0, 7, 5, 3, 1);
+        const __m256i negIndex = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+        const __m256 posSamp0 = _mm256_permutevar8x32_ps(_mm256_loadu_ps(sP - 14), posIndex);
+        const __m256 posSamp1 = _mm256_permutevar8x32_ps(_mm256_loadu_ps(sP - 6), posIndex);
+        const __m256 negSamp0 = _mm256_permutevar8x32_ps(_mm256_loadu_ps(sN), negIndex);
+        const __m256 negSamp1 = _mm256_permutevar8x32_ps(_mm256_loadu_ps(sN + 8), negIndex);
+        sP -= 16;
+        sN += 16;
+
+        const __m256 posSampL = _mm256_permute2f128_ps(posSamp1, posSamp0, 0x20);
+        const __m256 posSampR = _mm256_permute2f128_ps(posSamp1, posSamp0, 0x31);
+        const __m256 negSampL = _mm256_permute2f128_ps(negSamp0, negSamp1, 0x20);
+        const __m256 negSampR = _mm256_permute2f128_ps(negSamp0, negSamp1, 0x31);
+
+        accL = _mm256_fmadd_ps(posSampL, posCoef, accL);
+        accR = _mm256_fmadd_ps(posSampR, posCoef, accR);
+        accL = _mm256_fmadd_ps(negSampL, negCoef, accL);
+        accR = _mm256_fmadd_ps(negSampR, negCoef, accR);
+    }
+}
+
+template <int CHANNELS>
+__attribute__((target("avx2,fma"), always_inline))
+static inline void ProcessAVX2Store(float* out, __m256 accL, __m256 accR,
+        const float* volumeLR)
+{
+    ProcessSSEStore<CHANNELS>(out,
+            _mm_add_ps(_mm256_castps256_ps128(accL), _mm256_extractf128_ps(accL, 1)),
+            _mm_add_ps(_mm256_castps256_ps128(accR), _mm256_extractf128_ps(accR, 1)),
+            volumeLR);
+}
+
+template <int CHANNELS, bool FIXED>
+__attribute__((target("avx2,fma")))
+static void ProcessAVX2Intrinsic(float* out,
+        int count,
+        const float* coefsP,
+        const float* coefsN,
+        const float* sP,
+        const float* sN,
+        const float* volumeLR,
+        float lerpP,
+        const float* coefsP1,
+        const float* coefsN1)
+{
+    ALOG_ASSERT(count > 0 && (count & 7) == 0); // multiple of 8
+    static_assert(CHANNELS == 1 || CHANNELS == 2, "CHANNELS must be 1 or 2");
+
+    const __m256 interp = _mm256_set1_ps(lerpP);
+    __m256 accL = _mm256_setzero_ps();
+    __m256 accR = _mm256_setzero_ps();
+    do {
+        ProcessAVX2Step<CHANNELS, FIXED>(accL, accR,
+                coefsP, coefsN, coefsP1, coefsN1, sP, sN, interp);
+    } while (count -= 8);
+
+    ProcessAVX2Store<CHANNELS>(out, accL, accR, volumeLR);
+}
+
+template <int CHANNELS, bool FIXED>
+__attribute__((target("avx512f,avx2,fma")))
+static void ProcessAVX512Intrinsic(float* out,
+        int count,
+        const float* coefsP,
+        const float* coefsN,
+        const float* sP,
+        const float* sN,
+        const float* volumeLR,
+        float lerpP,
+        const float* coefsP1,
+        const float* coefsN1)
+{
+    ALOG_ASSERT(count > 0 && (count & 7) == 0); // multiple of 8
+    static_assert(CHANNELS == 1 || CHANNELS == 2, "CHANNELS must be 1 or 2");
+
+    const __m512 interp = _mm512_set1_ps(lerpP);
+    __m512 accL = _mm512_setzero_ps();
+    __m512 accR = _mm512_setzero_ps();
+
+    // permutation indices for the positive (reversed) and negative samples.
+    const __m512i reverse = _mm512_setr_epi32(
+            15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    const __m512i posIndexL = _mm512_setr_epi32(
+            30, 28, 26, 24, 22, 20, 18, 16, 14, 12, 10, 8, 6, 4, 2, 0);
+    const __m512i posIndexR = _mm512_setr_epi32(
+            31, 29, 27, 25, 23, 21, 19, 17, 15, 13, 11, 9, 7, 5, 3, 1);
+    const __m512i negIndexL = _mm512_setr_epi32(
+            0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+    const __m512i negIndexR = _mm512_setr_epi32(
+            1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31);
+
+    for (; count >= 16; count -= 16) {
+        __m512 posCoef = _mm512_loadu_ps(coefsP);
+        __m512 negCoef = _mm512_loadu_ps(coefsN);
+        coefsP += 16;
+        coefsN += 16;
+
+        if (!FIXED) { // interpolate
+            const __m512 posCoef1 = _mm512_loadu_ps(coefsP1);
+            const __m512 negCoef1 = _mm512_loadu_ps(coefsN1);
+            coefsP1 += 16;
+            coefsN1 += 16;
+
+            posCoef = _mm512_fmadd_ps(_mm512_sub_ps(posCoef1, posCoef), interp, posCoef);
+            negCoef = _mm512_fmadd_ps(_mm512_sub_ps(negCoef, negCoef1), interp, negCoef1);
+        }
+        if (CHANNELS == 1) {
+            const __m512 posSamp = _mm512_permutexvar_ps(reverse, _mm512_loadu_ps(sP - 15));
+            const __m512 negSamp = _mm512_loadu_ps(sN);
+            sP -= 16;
+            sN += 16;
+
+            accL = _mm512_fmadd_ps(posSamp, posCoef, accL);
+            accL = _mm512_fmadd_ps(negSamp, negCoef, accL);
+        } else {
+            // positive frames -15 to 0, negative frames 1 to 16.
+            const __m512 posSamp0 = _mm512_loadu_ps(sP - 30);
+            const __m512 posSamp1 = _mm512_loadu_ps(sP - 14);
+            const __m512 negSamp0 = _mm512_loadu_ps(sN);
+            const __m512 negSamp1 = _mm512_loadu_ps(sN + 16);
+            sP -= 32;
+            sN += 32;
+
+            accL = _mm512_fmadd_ps(_mm512_permutex2var_ps(posSamp0, posIndexL, posSamp1),
+                    posCoef, accL);
+            accR = _mm512_fmadd_ps(_mm512_permutex2var_ps(posSamp0, posIndexR, posSamp1),
+                    posCoef, accR);
+            accL = _mm512_fmadd_ps(_mm512_permutex2var_ps(negSamp0, negIndexL, negSamp1),
+                    negCoef, accL);
+            accR = _mm512_fmadd_ps(_mm512_permutex2var_ps(negSamp0, negIndexR, negSamp1),
+                    negCoef, accR);
+        }
+    }
+
+    // fold to 8-wide, and finish an odd multiple of 8 coefficients.
+    __m256 accL8 = _mm256_add_ps(_mm512_castps512_ps256(accL),
+            _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(accL), 1)));
+    __m256 accR8 = _mm256_add_ps(_mm512_castps512_ps256(accR),
+            _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(accR), 1)));
+    if (count != 0) {
+        ProcessAVX2Step<CHANNELS, FIXED>(accL8, accR8,
+                coefsP, coefsN, coefsP1, coefsN1, sP, sN, _mm512_castps512_ps256(interp));
+    }
+
+    ProcessAVX2Store<CHANNELS>(out, accL8, accR8, volumeLR);
+}
+
+/*
+ * Multichannel kernels, vectorized over the channels of a frame instead of
+ * over the filter taps. The interpolated coefficient is computed once per tap
+ * and applied to all channels.
+ */
+template <int CHANNELS, bool FIXED>
+__attribute__((target("avx2,fma")))
+static void ProcessAVX2MultiChannel(float* out,
+        size_t count,
+        const float* coefsP,
+        const float* coefsN,
+        const float* sP,
+        const float* sN,
+        float lerpP,
+        const float* volumeLR)
+{
+    constexpr int CHUNKS = (CHANNELS + 7) / 8;
+    constexpr int LAST = CHANNELS - (CHUNKS - 1) * 8; // channels in the last chunk
+    const __m256i lastMask = _mm256_cmpgt_epi32(
+            _mm256_set1_epi32(LAST), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+
+    __m256 accum[CHUNKS];
+    for (int j = 0; j < CHUNKS; ++j) {
+        accum[j] = _mm256_setzero_ps();
+    }
+    for (size_t i = 0; i < count; ++i) {
+        const float coefP = FIXED ? coefsP[0] : lerpP * (coefsP[count] - coefsP[0]) + coefsP[0];
+        const float coefN = FIXED ? coefsN[0] : lerpP * (coefsN[0] - coefsN[count]) + coefsN[count];
+        const __m256 posCoef = _mm256_set1_ps(coefP);
+        const __m256 negCoef = _mm256_set1_ps(coefN);
+        for (int j = 0; j < CHUNKS; ++j) {
+            if (j == CHUNKS - 1 && LAST != 8) {
+                accum[j] = _mm256_fmadd_ps(
+                        _mm256_maskload_ps(sP + j * 8, lastMask), posCoef, accum[j]);
+                accum[j] = _mm256_fmadd_ps(
+                        _mm256_maskload_ps(sN + j * 8, lastMask), negCoef, accum[j]);
+            } else {
+                accum[j] = _mm256_fmadd_ps(_mm256_loadu_ps(sP + j * 8), posCoef, accum[j]);
+                accum[j] = _mm256_fmadd_ps(_mm256_loadu_ps(sN + j * 8), negCoef, accum[j]);
+            }
+        }
+        coefsP++;
+        coefsN++;
+        sP -= CHANNELS;
+        sN += CHANNELS;
+    }
+
+    const __m256 volume = _mm256_set1_ps(volumeLR[0]);
+    for (int j = 0; j < CHUNKS; ++j) {
+        if (j == CHUNKS - 1 && LAST != 8) {
+            const __m256 outSamp = _mm256_maskload_ps(out + j * 8, lastMask);
+            _mm256_maskstore_ps(out + j * 8, lastMask,
+                    _mm256_fmadd_ps(accum[j], volume, outSamp));
+        } else {
+            _mm256_storeu_ps(out + j * 8,
+                    _mm256_fmadd_ps(accum[j], volume, _mm256_loadu_ps(out + j * 8)));
+        }
+    }
+}
+
+template <int CHANNELS, bool FIXED>
+__attribute__((target("avx512f,avx2,fma")))
+static void ProcessAVX512MultiChannel(float* out,
+        size_t count,
+        const float* coefsP,
+        const float* coefsN,
+        const float* sP,
+        const float* sN,
+        float lerpP,
+        const float* volumeLR)
+{
+    constexpr int CHUNKS = (CHANNELS + 15) / 16;
+    constexpr int LAST = CHANNELS - (CHUNKS - 1) * 16; // channels in the last chunk
+    constexpr __mmask16 lastMask = static_cast<__mmask16>((1u << LAST) - 1);
+
+    __m512 accum[CHUNKS];
+    for (int j = 0; j < CHUNKS; ++j) {
+        accum[j] = _mm512_setzero_ps();
+    }
+    for (size_t i = 0; i < count; ++i) {
+        const float coefP = FIXED ? coefsP[0] : lerpP * (coefsP[count] - coefsP[0]) + coefsP[0];
+        const float coefN = FIXED ? coefsN[0] : lerpP * (coefsN[0] - coefsN[count]) + coefsN[count];
+        const __m512 posCoef = _mm512_set1_ps(coefP);
+        const __m512 negCoef = _mm512_set1_ps(coefN);
+        for (int j = 0; j < CHUNKS; ++j) {
+            const __mmask16 mask = j == CHUNKS - 1 ? lastMask : 0xFFFF;
+            accum[j] = _mm512_fmadd_ps(
+                    _mm512_maskz_loadu_ps(mask, sP + j * 16), posCoef, accum[j]);
+            accum[j] = _mm512_fmadd_ps(
+                    _mm512_maskz_loadu_ps(mask, sN + j * 16), negCoef, accum[j]);
+        }
+        coefsP++;
+        coefsN++;
+        sP -= CHANNELS;
+        sN += CHANNELS;
+    }
+
+    const __m512 volume = _mm512_set1_ps(volumeLR[0]);
+    for (int j = 0; j < CHUNKS; ++j) {
+        const __mmask16 mask = j == CHUNKS - 1 ? lastMask : 0xFFFF;
+        const __m512 outSamp = _mm512_maskz_loadu_ps(mask, out + j * 16);
+        _mm512_mask_storeu_ps(out + j * 16, mask,
+                _mm512_fmadd_ps(accum[j], volume, outSamp));
+    }
+}
+
+template <int CHANNELS, bool FIXED>
+static inline bool ProcessMultiChannelAVX(float* out,
+        size_t count,
+        const float* coefsP,
+        const float* coefsN,
+        const float* sP,
+        const float* sN,
+        float lerpP,
+        const float* volumeLR)
+{
+    switch (firSimdLevel()) {
+    case FIR_SIMD_AVX512:
+        ProcessAVX512MultiChannel<CHANNELS, FIXED>(
+                out, count, coefsP, coefsN, sP, sN, lerpP, volumeLR);
+        return true;
+    case FIR_SIMD_AVX2:
+        ProcessAVX2MultiChannel<CHANNELS, FIXED>(
+                out, count, coefsP, coefsN, sP, sN, lerpP, volumeLR);
+        return true;
+    default:
+        return false;
+    }
+}
+
+#endif // USE_AVX_DISPATCH
+
+// Selects the widest kernel supported by the CPU for mono and stereo.
+template <int CHANNELS, bool FIXED>
+static inline void ProcessSSEDispatch(float* out,
+        int count,
+        const float* coefsP,
+        const float* coefsN,
+        const float* sP,
+        const float* sN,
+        const float* volumeLR,
+        float lerpP,
+        const float* coefsP1,
+        const float* coefsN1)
+{
+#if USE_AVX_DISPATCH
+    switch (firSimdLevel()) {
+    case FIR_SIMD_AVX512:
+        ProcessAVX512Intrinsic<CHANNELS, FIXED>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+                lerpP, coefsP1, coefsN1);
+        return;
+    case FIR_SIMD_AVX2:
+        ProcessAVX2Intrinsic<CHANNELS, FIXED>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+                lerpP, coefsP1, coefsN1);
+        return;
+    default:
+        break;
+    }
+#endif
+    ProcessSSEIntrinsic<CHANNELS, 16, FIXED>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+            lerpP, coefsP1, coefsN1);
+}
+
 template<>
 inline void ProcessL<1, 16>(float* const out,
         int count,
@@ -182,7 +549,7 @@ inline void ProcessL<1, 16>(float* const out,
         const float* sN,
         const float* const volumeLR)
 {
-    ProcessSSEIntrinsic<1, 16, true>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+    ProcessSSEDispatch<1, true>(out, count, coefsP, coefsN, sP, sN, volumeLR,
             0 /*lerpP*/, NULL /*coefsP1*/, NULL /*coefsN1*/);
 }
 
@@ -195,7 +562,7 @@ inline void ProcessL<2, 16>(float* const out,
         const float* sN,
         const float* const volumeLR)
 {
-    ProcessSSEIntrinsic<2, 16, true>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+    ProcessSSEDispatch<2, true>(out, count, coefsP, coefsN, sP, sN, volumeLR,
             0 /*lerpP*/, NULL /*coefsP1*/, NULL /*coefsN1*/);
 }
 
@@ -211,7 +578,7 @@ inline void Process<1, 16>(float* const out,
         float lerpP,
         const float* const volumeLR)
 {
-    ProcessSSEIntrinsic<1, 16, false>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+    ProcessSSEDispatch<1, false>(out, count, coefsP, coefsN, sP, sN, volumeLR,
             lerpP, coefsP1, coefsN1);
 }
 
@@ -227,7 +594,7 @@ inline void Process<2, 16>(float* const out,
         float lerpP,
         const float* const volumeLR)
 {
-    ProcessSSEIntrinsic<2, 16, false>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+    ProcessSSEDispatch<2, false>(out, count, coefsP, coefsN, sP, sN, volumeLR,
             lerpP, coefsP1, coefsN1);
 }
 
@@ -26,6 +26,7 @@
 #include <media/audiohal/EffectBufferHalInterface.h>
 #include <media/audiohal/EffectHalInterface.h>
 #include <media/audiohal/EffectsFactoryHalInterface.h>
+#include <media/AudioFormatConversion.h>
 #include <media/AudioResamplerPublic.h>
 #include <media/BufferProviders.h>
 #include <system/audio_effects/effect_downmix.h>
@@ -140,6 +141,51 @@ void CopyBufferProvider::setBufferProvider(AudioBufferProvider *p) {
     PassthruBufferProvider::setBufferProvider(p);
 }
 
+FusedBufferProvider::FusedBufferProvider(const std::vector<CopyBufferProvider *> &stages,
+        size_t bufferFrameCount) :
+        CopyBufferProvider(
+                stages.front()->getInputFrameSize(),
+                stages.back()->getOutputFrameSize(),
+                bufferFrameCount),
+        mStages(stages),
+        mScratchSize(0),
+        mScratch(NULL)
+{
+    ALOGV("FusedBufferProvider(%p)(%zu stages, %zu)", this, stages.size(), bufferFrameCount);
+    // the intermediate frames are those between two consecutive stages.
+    for (size_t i = 0; i + 1 < mStages.size(); ++i) {
+        mScratchSize = std::max(mScratchSize,
+                kScratchFrameCount * mStages[i]->getOutputFrameSize());
+    }
+    if (mScratchSize != 0) {
+        (void)posix_memalign(&mScratch, 32, 2 * mScratchSize);
+    }
+}
+
+FusedBufferProvider::~FusedBufferProvider()
+{
+    ALOGV("~FusedBufferProvider(%p)", this);
+    free(mScratch);
+}
+
+void FusedBufferProvider::copyFrames(void *dst, const void *src, size_t frames)
+{
+    const size_t lastStage = mStages.size() - 1;
+    while (frames > 0) {
+        const size_t count = std::min(frames, kScratchFrameCount);
+        const void *in = src;
+        for (size_t i = 0; i < lastStage; ++i) {
+            void *out = (uint8_t*)mScratch + (i & 1) * mScratchSize;
+            mStages[i]->copyFrames(out, in, count);
+            in = out;
+        }
+        mStages[lastStage]->copyFrames(dst, in, count);
+        src = (const uint8_t*)src + count * mInputFrameSize;
+        dst = (uint8_t*)dst + count * mOutputFrameSize;
+        frames -= count;
+    }
+}
+
 DownmixerBufferProvider::DownmixerBufferProvider(
         audio_channel_mask_t inputChannelMask,
         audio_channel_mask_t outputChannelMask, audio_format_t format,
@@ -411,7 +457,7 @@ ReformatBufferProvider::ReformatBufferProvider(int32_t channelCount,
 
 void ReformatBufferProvider::copyFrames(void *dst, const void *src, size_t frames)
 {
-    memcpy_by_audio_format(dst, mOutputFormat, src, mInputFormat, frames * mChannelCount);
+    convert_by_audio_format(dst, mOutputFormat, src, mInputFormat, frames * mChannelCount);
 }
 
 ClampFloatBufferProvider::ClampFloatBufferProvider(int32_t channelCount, size_t bufferFrameCount) :
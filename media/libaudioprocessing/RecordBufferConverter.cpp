@@ -19,6 +19,7 @@
 
 #include <audio_utils/primitives.h>
 #include <audio_utils/format.h>
+#include <media/AudioFormatConversion.h>
 #include <media/AudioMixer.h>  // for UNITY_GAIN_FLOAT
 #include <media/AudioResampler.h>
 #include <media/BufferProviders.h>
@@ -193,8 +194,8 @@ status_t RecordBufferConverter::updateParameters(
     if (mResampler != NULL) {
         mBufFrameSize = max(mSrcChannelCount, (uint32_t)FCC_2)
                 * audio_bytes_per_sample(AUDIO_FORMAT_PCM_FLOAT);
-    } else if (mIsLegacyUpmix || mIsLegacyDownmix) { // legacy modes always float
-        mBufFrameSize = mDstChannelCount * audio_bytes_per_sample(AUDIO_FORMAT_PCM_FLOAT);
+    } else if (mIsLegacyUpmix || mIsLegacyDownmix) { // legacy modes convert in one pass
+        mBufFrameSize = 0;
     } else if (mSrcChannelMask != mDstChannelMask && mDstFormat != mSrcFormat) {
         mBufFrameSize = mDstChannelCount * audio_bytes_per_sample(mSrcFormat);
     } else {
@@ -231,19 +232,13 @@ void RecordBufferConverter::convertNoResampler(
         (void)posix_memalign(&mBuf, 32, mBufFrames * mBufFrameSize);
     }
     // do we need to do legacy upmix and downmix?
-    if (mIsLegacyUpmix || mIsLegacyDownmix) {
-        void *dstBuf = mBuf != NULL ? mBuf : dst;
-        if (mIsLegacyUpmix) {
-            upmix_to_stereo_float_from_mono_float((float *)dstBuf,
-                    (const float *)src, frames);
-        } else /*mIsLegacyDownmix */ {
-            downmix_to_mono_float_from_stereo_float((float *)dstBuf,
-                    (const float *)src, frames);
-        }
-        if (mBuf != NULL) {
-            memcpy_by_audio_format(dst, mDstFormat, mBuf, AUDIO_FORMAT_PCM_FLOAT,
-                    frames * mDstChannelCount);
-        }
+    // These also convert to the destination format in the same pass.
+    if (mIsLegacyUpmix) {
+        upmix_to_stereo_by_audio_format(dst, mDstFormat, src, AUDIO_FORMAT_PCM_FLOAT, frames);
+        return;
+    }
+    if (mIsLegacyDownmix) {
+        downmix_to_mono_by_audio_format(dst, mDstFormat, src, AUDIO_FORMAT_PCM_FLOAT, frames);
         return;
     }
     // do we need to do channel mask conversion?
@@ -257,7 +252,7 @@ void RecordBufferConverter::convertNoResampler(
     }
     // convert to destination buffer
     const void *convertBuf = mBuf != NULL ? mBuf : src;
-    memcpy_by_audio_format(dst, mDstFormat, convertBuf, mSrcFormat,
+    convert_by_audio_format(dst, mDstFormat, convertBuf, mSrcFormat,
             frames * mDstChannelCount);
 }
 
@@ -270,19 +265,18 @@ void RecordBufferConverter::convertResampler(
     } else if (mIsLegacyDownmix
             || (mSrcChannelMask == mDstChannelMask && mSrcChannelCount == 1)) {
         // the resampler outputs stereo for mono input channel (a feature?)
-        // must convert to mono
-        downmix_to_mono_float_from_stereo_float((float *)src,
-                (const float *)src, frames);
+        // must convert to mono, and to the destination format in the same pass
+        downmix_to_mono_by_audio_format(dst, mDstFormat, src, AUDIO_FORMAT_PCM_FLOAT, frames);
+        return;
     } else if (mSrcChannelMask != mDstChannelMask) {
         // convert to mono channel again for channel mask conversion (could be skipped
         // with further optimization).
-        if (mSrcChannelCount == 1) {
-            downmix_to_mono_float_from_stereo_float((float *)src,
-                (const float *)src, frames);
-        }
         // convert to destination format (in place, OK as float is larger than other types)
-        if (mDstFormat != AUDIO_FORMAT_PCM_FLOAT) {
-            memcpy_by_audio_format(src, mDstFormat, src, AUDIO_FORMAT_PCM_FLOAT,
+        if (mSrcChannelCount == 1) {
+            downmix_to_mono_by_audio_format(src, mDstFormat,
+                    src, AUDIO_FORMAT_PCM_FLOAT, frames);
+        } else if (mDstFormat != AUDIO_FORMAT_PCM_FLOAT) {
+            convert_by_audio_format(src, mDstFormat, src, AUDIO_FORMAT_PCM_FLOAT,
                     frames * mSrcChannelCount);
         }
         // channel convert and save to dst
@@ -291,7 +285,7 @@ void RecordBufferConverter::convertResampler(
         return;
     }
     // convert to destination format and save to dst
-    memcpy_by_audio_format(dst, mDstFormat, src, AUDIO_FORMAT_PCM_FLOAT,
+    convert_by_audio_format(dst, mDstFormat, src, AUDIO_FORMAT_PCM_FLOAT,
             frames * mDstChannelCount);
 }
 
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_AUDIO_FORMAT_CONVERSION_H
+#define ANDROID_AUDIO_FORMAT_CONVERSION_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <system/audio.h>
+
+namespace android {
+
+/*
+ * Vectorized sample format conversion.
+ *
+ * The conversions between AUDIO_FORMAT_PCM_FLOAT and AUDIO_FORMAT_PCM_16_BIT,
+ * AUDIO_FORMAT_PCM_24_BIT_PACKED, AUDIO_FORMAT_PCM_8_24_BIT or AUDIO_FORMAT_PCM_32_BIT
+ * use NEON or SSE kernels where available. The results are bit-exact with the
+ * corresponding audio_utils primitives, including clamping and rounding, so these
+ * functions can replace memcpy_by_audio_format() and the float channel helpers.
+ * Any other format pair falls back to memcpy_by_audio_format().
+ */
+
+// Returns true if convert_by_audio_format() has a vector kernel for the format pair.
+bool format_conversion_is_vectorized(audio_format_t dstFormat, audio_format_t srcFormat);
+
+// Converts count samples from srcFormat to dstFormat, as memcpy_by_audio_format() does.
+// The conversion may be done in place (dst == src) if the dst sample size is not larger
+// than the src sample size; otherwise the buffers must not overlap.
+void convert_by_audio_format(void *dst, audio_format_t dstFormat,
+        const void *src, audio_format_t srcFormat, size_t count);
+
+// Converts mono frames to stereo frames by duplicating each sample, while converting
+// the format. Equivalent to upmix_to_stereo_float_from_mono_float() for float.
+// The buffers must not overlap.
+void upmix_to_stereo_by_audio_format(void *dst, audio_format_t dstFormat,
+        const void *src, audio_format_t srcFormat, size_t frames);
+
+// Converts stereo frames to mono frames by averaging the two channels, while converting
+// the format. Equivalent to downmix_to_mono_float_from_stereo_float() for float.
+// The conversion may be done in place if a dst frame is not larger than a src frame.
+void downmix_to_mono_by_audio_format(void *dst, audio_format_t dstFormat,
+        const void *src, audio_format_t srcFormat, size_t frames);
+
+// Interleaves channelCount planar float buffers into frames of channelCount samples.
+void interleave_float(float *dst, const float * const *src,
+        uint32_t channelCount, size_t frames);
+
+// Splits frames of channelCount float samples into channelCount planar buffers.
+void deinterleave_float(float * const *dst, const float *src,
+        uint32_t channelCount, size_t frames);
+
+} // namespace android
+
+#endif // ANDROID_AUDIO_FORMAT_CONVERSION_H
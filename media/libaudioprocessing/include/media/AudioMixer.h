@@ -77,6 +77,7 @@ private:
             // Ensure the order of destruction of buffer providers as they
             // release the upstream provider in the destructor.
             mTimestretchBufferProvider.reset(nullptr);
+            mFusedBufferProvider.reset(nullptr);
             mPostDownmixReformatBufferProvider.reset(nullptr);
             mDownmixerBufferProvider.reset(nullptr);
             mReformatBufferProvider.reset(nullptr);
@@ -90,6 +91,7 @@ private:
             return mMixerChannelCount + mMixerHapticChannelCount;
         }
 
+        bool        unprepareForFusion();
         status_t    prepareForDownmix();
         void        unprepareForDownmix();
         status_t    prepareForReformat();
@@ -124,6 +126,9 @@ private:
          * 6) mPostDownmixReformatBufferProvider: If not NULL, performs reformatting from
          *    the downmixer requirements to the mixer engine input requirements.
          * 7) mTimestretchBufferProvider: Adds timestretching for playback rate
+         *
+         * When more than one of 4), 5) and 6) is needed, they are run by
+         * mFusedBufferProvider, which replaces them in the chain.
          */
         AudioBufferProvider* mInputBufferProvider;    // externally provided buffer provider.
         std::unique_ptr<PassthruBufferProvider> mTeeBufferProvider;
@@ -132,6 +137,7 @@ private:
         std::unique_ptr<PassthruBufferProvider> mDownmixerBufferProvider;
         std::unique_ptr<PassthruBufferProvider> mPostDownmixReformatBufferProvider;
         std::unique_ptr<PassthruBufferProvider> mTimestretchBufferProvider;
+        std::unique_ptr<PassthruBufferProvider> mFusedBufferProvider;
 
         audio_format_t mDownmixRequiresFormat;  // required downmixer format
                                                 // AUDIO_FORMAT_PCM_16_BIT if 16 bit necessary
@@ -233,6 +233,12 @@ public:
         bool        useStereoVolume() const { return channelMask == AUDIO_CHANNEL_OUT_STEREO
                                         && isAudioChannelPositionMask(mMixerChannelMask); }
 
+        // True if the track may be mixed by process__multiTrackNoResampling():
+        // stereo mixer output from a non-mono track, without resampling or aux send.
+        bool        isMultiTrackMixable() const {
+                        return mMixerChannelCount == FCC_2 && channelCount >= FCC_2
+                                && (needs & (NEEDS_RESAMPLE | NEEDS_AUX)) == 0; }
+
         static hook_t getTrackHook(int trackType, uint32_t channelCount,
                 audio_format_t mixerInFormat, audio_format_t mixerOutFormat);
 
@@ -349,12 +355,19 @@ public:
     void process__validate();
     void process__nop();
     void process__genericNoResampling();
+    void process__multiTrackNoResampling();
     void process__genericResampling();
     void process__oneTrack16BitsStereoNoResampling();
 
     template <int MIXTYPE, typename TO, typename TI, typename TA>
     void process__noResampleOneTrack();
 
+    void mixTrackBlock(TrackBase *t, int32_t *outTemp, size_t frameCount, size_t numFrames);
+
+    template <typename TO, typename TI>
+    static void mixMultiTracks(TO *out, size_t frameCount,
+            TrackBase * const *tracks, size_t count, bool ramp);
+
     static process_hook_t getProcessHook(int processType, uint32_t channelCount,
             audio_format_t mixerInFormat, audio_format_t mixerOutFormat,
             bool useStereoVolume);
@@ -380,6 +393,11 @@ public:
     // track names that are enabled, in increasing order (by construction).
     std::vector<int /* name */> mEnabled;
 
+    // tracks of the current block handled by process__multiTrackNoResampling(),
+    // kept as members to avoid allocation on the mixer thread.
+    std::vector<TrackBase *> mMultiTracks;
+    std::vector<TrackBase *> mMultiTracksRamp;
+
     // track smart pointers, by name, in increasing order of name.
     std::map<int /* name */, std::shared_ptr<TrackBase>> mTracks;
 };
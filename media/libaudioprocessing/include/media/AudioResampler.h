@@ -60,6 +60,22 @@ public:
     virtual void setSampleRate(int32_t inSampleRate);
     virtual void setVolume(float left, float right);
 
+    // Sets the volume as setVolume() does, plus a per output frame volume increment.
+    // resample() then applies the volume ramp while accumulating into 'out', so the
+    // caller does not need to resample at unity gain into a temporary buffer.
+    // The ramp remains in effect until the next setVolume() or setVolumeRamp() call.
+    //
+    // Returns false if the resampler does not support volume ramps for its
+    // configuration, in which case the volume is unchanged.
+    virtual bool setVolumeRamp(float left __unused, float right __unused,
+            float leftInc __unused, float rightInc __unused) { return false; }
+
+    // Returns the current volume, including any ramp applied by resample().
+    virtual void getVolume(float *left, float *right) const {
+        *left = static_cast<float>(mVolume[0]) / (1 << 12);  // U4.12
+        *right = static_cast<float>(mVolume[1]) / (1 << 12);
+    }
+
     // Resample int16_t samples from provider and accumulate into 'out'.
     // A mono provider delivers a sequence of samples.
     // A stereo provider delivers a sequence of interleaved pairs of samples.
@@ -80,6 +96,16 @@ public:
     virtual void reset();
     virtual size_t getUnreleasedFrames() const { return mInputIndex; }
 
+    // Statistics of the filter coefficients shared by the dynamic quality resamplers.
+    struct FilterCacheStats {
+        size_t filters;   // number of filter banks currently allocated
+        size_t bytes;     // total size of the filter banks
+        uint64_t hits;    // filter designs served from the cache
+        uint64_t misses;  // filter designs computed
+    };
+
+    static FilterCacheStats getFilterCacheStats();
+
     // called from destructor, so must not be virtual
     src_quality getQuality() const { return mQuality; }
 
@@ -20,6 +20,8 @@
 #include <stdint.h>
 #include <sys/types.h>
 
+#include <vector>
+
 #include <audio_utils/ChannelMix.h>
 #include <media/AudioBufferProvider.h>
 #include <media/AudioResamplerPublic.h>
@@ -87,6 +89,9 @@ public:
     // of the internal buffers.
     virtual void copyFrames(void *dst, const void *src, size_t frames) = 0;
 
+    size_t getInputFrameSize() const { return mInputFrameSize; }
+    size_t getOutputFrameSize() const { return mOutputFrameSize; }
+
 protected:
     const size_t         mInputFrameSize;
     const size_t         mOutputFrameSize;
@@ -196,6 +201,32 @@ protected:
     const uint32_t       mChannelCount;
 };
 
+// FusedBufferProvider derives from CopyBufferProvider to run a chain of
+// CopyBufferProvider stages as a single provider.  Instead of each stage obtaining
+// its input through getNextBuffer() and copying it into its own buffer, the
+// copyFrames() of every stage is called in turn on blocks of kScratchFrameCount
+// frames, alternating between the two halves of one small scratch buffer that
+// stays cache resident.  The stages are not owned, and their own upstream
+// buffer providers and private buffers are not used.
+class FusedBufferProvider : public CopyBufferProvider {
+public:
+    FusedBufferProvider(const std::vector<CopyBufferProvider *> &stages,
+            size_t bufferFrameCount);
+    ~FusedBufferProvider() override;
+
+    void copyFrames(void *dst, const void *src, size_t frames) override;
+
+    const std::vector<CopyBufferProvider *> &getStages() const { return mStages; }
+
+    // Frames converted at a time through the scratch buffer.
+    static constexpr size_t kScratchFrameCount = 128;
+
+private:
+    const std::vector<CopyBufferProvider *> mStages;
+    size_t               mScratchSize;  // size in bytes of each half of mScratch
+    void                *mScratch;
+};
+
 // TimestretchBufferProvider derives from PassthruBufferProvider for time stretching
 class TimestretchBufferProvider : public PassthruBufferProvider {
 public:
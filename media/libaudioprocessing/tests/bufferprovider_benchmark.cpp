@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <media/BufferProviders.h>
+#include <system/audio.h>
+
+using namespace android;
+
+// Endlessly provides the same block of (silent) frames.
+class SourceProvider : public AudioBufferProvider {
+public:
+    SourceProvider(size_t frameSize, size_t frameCount)
+        : mData(frameSize * frameCount), mFrameCount(frameCount) {}
+
+    status_t getNextBuffer(Buffer* buffer) override {
+        buffer->raw = mData.data();
+        buffer->frameCount = std::min(buffer->frameCount, mFrameCount);
+        return OK;
+    }
+
+    void releaseBuffer(Buffer* buffer) override {
+        buffer->raw = nullptr;
+        buffer->frameCount = 0;
+    }
+
+private:
+    std::vector<uint8_t> mData;
+    const size_t mFrameCount;
+};
+
+constexpr size_t kCopyBufferFrameCount = 256;
+
+// The 3 stage chain used by the mixer with a downmixer requiring 16 bit data:
+// reformat float to 16 bit, remix 5.1 to stereo, and reformat back to float.
+static std::vector<std::unique_ptr<CopyBufferProvider>> createStages() {
+    std::vector<std::unique_ptr<CopyBufferProvider>> stages;
+    stages.emplace_back(new ReformatBufferProvider(
+            audio_channel_count_from_out_mask(AUDIO_CHANNEL_OUT_5POINT1),
+            AUDIO_FORMAT_PCM_FLOAT, AUDIO_FORMAT_PCM_16_BIT, kCopyBufferFrameCount));
+    stages.emplace_back(new RemixBufferProvider(
+            AUDIO_CHANNEL_OUT_5POINT1, AUDIO_CHANNEL_OUT_STEREO, AUDIO_FORMAT_PCM_16_BIT,
+            kCopyBufferFrameCount));
+    stages.emplace_back(new ReformatBufferProvider(
+            audio_channel_count_from_out_mask(AUDIO_CHANNEL_OUT_STEREO),
+            AUDIO_FORMAT_PCM_16_BIT, AUDIO_FORMAT_PCM_FLOAT, kCopyBufferFrameCount));
+    return stages;
+}
+
+// Pulls one mixer buffer of frames through the provider, as a track hook does.
+static void pullFrames(AudioBufferProvider* provider, size_t frameCount) {
+    while (frameCount > 0) {
+        AudioBufferProvider::Buffer buffer;
+        buffer.frameCount = frameCount;
+        if (provider->getNextBuffer(&buffer) != OK || buffer.frameCount == 0) {
+            break;
+        }
+        benchmark::DoNotOptimize(buffer.raw);
+        frameCount -= buffer.frameCount;
+        provider->releaseBuffer(&buffer);
+    }
+}
+
+static void BM_ChainedProviders(benchmark::State& state) {
+    const size_t frameCount = state.range(0);
+    auto stages = createStages();
+    SourceProvider source(stages.front()->getInputFrameSize(), frameCount);
+
+    AudioBufferProvider* provider = &source;
+    for (auto& stage : stages) {
+        stage->setBufferProvider(provider);
+        provider = stage.get();
+    }
+    for (auto _ : state) {
+        pullFrames(provider, frameCount);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * frameCount);
+}
+
+static void BM_FusedProviders(benchmark::State& state) {
+    const size_t frameCount = state.range(0);
+    auto stages = createStages();
+    SourceProvider source(stages.front()->getInputFrameSize(), frameCount);
+
+    std::vector<CopyBufferProvider*> stagePointers;
+    for (auto& stage : stages) {
+        stagePointers.push_back(stage.get());
+    }
+    FusedBufferProvider fused(stagePointers, kCopyBufferFrameCount);
+    fused.setBufferProvider(&source);
+    for (auto _ : state) {
+        pullFrames(&fused, frameCount);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * frameCount);
+}
+
+static void FrameCountArgs(benchmark::internal::Benchmark* b) {
+    for (int frameCount : {192, 480, 960, 1920}) {
+        b->Arg(frameCount);
+    }
+}
+
+BENCHMARK(BM_ChainedProviders)->Apply(FrameCountArgs);
+BENCHMARK(BM_FusedProviders)->Apply(FrameCountArgs);
+
+BENCHMARK_MAIN();
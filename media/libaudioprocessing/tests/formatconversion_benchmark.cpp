@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vector>
+
+#include <audio_utils/format.h>
+#include <audio_utils/primitives.h>
+#include <benchmark/benchmark.h>
+#include <media/AudioFormatConversion.h>
+#include <system/audio.h>
+
+using namespace android;
+
+// Compares the vectorized conversions with the scalar audio_utils loops they replace.
+// The "Scalar" variants call memcpy_by_audio_format() and the float channel helpers.
+
+constexpr size_t kFrameCount = 1024;
+
+// samples in [-1, 1), so the conversions do not clamp
+static std::vector<float> makeSamples(size_t count) {
+    std::vector<float> samples(count);
+    for (size_t i = 0; i < count; ++i) {
+        samples[i] = (static_cast<int>(i * 7919 % 65536) - 32768) / 32768.f;
+    }
+    return samples;
+}
+
+template <audio_format_t DST, audio_format_t SRC, bool VECTOR>
+static void BM_Convert(benchmark::State& state) {
+    const size_t count = kFrameCount * state.range(0);
+    const std::vector<float> samples = makeSamples(count);
+    std::vector<uint8_t> src(count * audio_bytes_per_sample(SRC));
+    std::vector<uint8_t> dst(count * audio_bytes_per_sample(DST));
+    memcpy_by_audio_format(src.data(), SRC, samples.data(), AUDIO_FORMAT_PCM_FLOAT, count);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(src.data());
+        if (VECTOR) {
+            convert_by_audio_format(dst.data(), DST, src.data(), SRC, count);
+        } else {
+            memcpy_by_audio_format(dst.data(), DST, src.data(), SRC, count);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+template <audio_format_t DST, bool VECTOR>
+static void BM_UpmixToStereo(benchmark::State& state) {
+    const std::vector<float> src = makeSamples(kFrameCount);
+    std::vector<float> stereo(kFrameCount * 2);
+    std::vector<uint8_t> dst(kFrameCount * 2 * audio_bytes_per_sample(DST));
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(src.data());
+        if (VECTOR) {
+            upmix_to_stereo_by_audio_format(dst.data(), DST,
+                    src.data(), AUDIO_FORMAT_PCM_FLOAT, kFrameCount);
+        } else {
+            // the RecordBufferConverter legacy upmix, through a float staging buffer
+            upmix_to_stereo_float_from_mono_float(stereo.data(), src.data(), kFrameCount);
+            memcpy_by_audio_format(dst.data(), DST,
+                    stereo.data(), AUDIO_FORMAT_PCM_FLOAT, kFrameCount * 2);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * kFrameCount);
+}
+
+template <audio_format_t DST, bool VECTOR>
+static void BM_DownmixToMono(benchmark::State& state) {
+    const std::vector<float> src = makeSamples(kFrameCount * 2);
+    std::vector<float> mono(kFrameCount);
+    std::vector<uint8_t> dst(kFrameCount * audio_bytes_per_sample(DST));
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(src.data());
+        if (VECTOR) {
+            downmix_to_mono_by_audio_format(dst.data(), DST,
+                    src.data(), AUDIO_FORMAT_PCM_FLOAT, kFrameCount);
+        } else {
+            downmix_to_mono_float_from_stereo_float(mono.data(), src.data(), kFrameCount);
+            memcpy_by_audio_format(dst.data(), DST,
+                    mono.data(), AUDIO_FORMAT_PCM_FLOAT, kFrameCount);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * kFrameCount);
+}
+
+template <bool VECTOR>
+static void BM_Interleave(benchmark::State& state) {
+    const uint32_t channelCount = state.range(0);
+    std::vector<std::vector<float>> planes(channelCount, makeSamples(kFrameCount));
+    std::vector<const float *> src;
+    for (const auto &plane : planes) {
+        src.push_back(plane.data());
+    }
+    std::vector<float> dst(kFrameCount * channelCount);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(src.data());
+        if (VECTOR) {
+            interleave_float(dst.data(), src.data(), channelCount, kFrameCount);
+        } else {
+            // the flowgraph ManyToMultiConverter loop
+            for (uint32_t ch = 0; ch < channelCount; ++ch) {
+                const float *in = src[ch];
+                float *out = dst.data() + ch;
+                for (size_t i = 0; i < kFrameCount; ++i) {
+                    *out = *in++;
+                    out += channelCount;
+                }
+            }
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * kFrameCount * channelCount);
+}
+
+template <bool VECTOR>
+static void BM_Deinterleave(benchmark::State& state) {
+    const uint32_t channelCount = state.range(0);
+    const std::vector<float> src = makeSamples(kFrameCount * channelCount);
+    std::vector<std::vector<float>> planes(channelCount, std::vector<float>(kFrameCount));
+    std::vector<float *> dst;
+    for (auto &plane : planes) {
+        dst.push_back(plane.data());
+    }
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(src.data());
+        if (VECTOR) {
+            deinterleave_float(dst.data(), src.data(), channelCount, kFrameCount);
+        } else {
+            // the flowgraph MultiToManyConverter loop
+            for (uint32_t ch = 0; ch < channelCount; ++ch) {
+                const float *in = src.data() + ch;
+                float *out = dst[ch];
+                for (size_t i = 0; i < kFrameCount; ++i) {
+                    *out++ = *in;
+                    in += channelCount;
+                }
+            }
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * kFrameCount * channelCount);
+}
+
+static void ChannelArgs(benchmark::internal::Benchmark* b) {
+    for (int channels : {1, 2, 4, 6, 8}) {
+        b->Arg(channels);
+    }
+}
+
+#define BENCHMARK_CONVERT(DST, SRC) \
+    BENCHMARK_TEMPLATE(BM_Convert, DST, SRC, false)->Apply(ChannelArgs); \
+    BENCHMARK_TEMPLATE(BM_Convert, DST, SRC, true)->Apply(ChannelArgs)
+
+BENCHMARK_CONVERT(AUDIO_FORMAT_PCM_16_BIT, AUDIO_FORMAT_PCM_FLOAT);
+BENCHMARK_CONVERT(AUDIO_FORMAT_PCM_FLOAT, AUDIO_FORMAT_PCM_16_BIT);
+BENCHMARK_CONVERT(AUDIO_FORMAT_PCM_24_BIT_PACKED, AUDIO_FORMAT_PCM_FLOAT);
+BENCHMARK_CONVERT(AUDIO_FORMAT_PCM_FLOAT, AUDIO_FORMAT_PCM_24_BIT_PACKED);
+BENCHMARK_CONVERT(AUDIO_FORMAT_PCM_8_24_BIT, AUDIO_FORMAT_PCM_FLOAT);
+BENCHMARK_CONVERT(AUDIO_FORMAT_PCM_FLOAT, AUDIO_FORMAT_PCM_8_24_BIT);
+BENCHMARK_CONVERT(AUDIO_FORMAT_PCM_32_BIT, AUDIO_FORMAT_PCM_FLOAT);
+BENCHMARK_CONVERT(AUDIO_FORMAT_PCM_FLOAT, AUDIO_FORMAT_PCM_32_BIT);
+
+BENCHMARK_TEMPLATE(BM_UpmixToStereo, AUDIO_FORMAT_PCM_FLOAT, false);
+BENCHMARK_TEMPLATE(BM_UpmixToStereo, AUDIO_FORMAT_PCM_FLOAT, true);
+BENCHMARK_TEMPLATE(BM_UpmixToStereo, AUDIO_FORMAT_PCM_16_BIT, false);
+BENCHMARK_TEMPLATE(BM_UpmixToStereo, AUDIO_FORMAT_PCM_16_BIT, true);
+
+BENCHMARK_TEMPLATE(BM_DownmixToMono, AUDIO_FORMAT_PCM_FLOAT, false);
+BENCHMARK_TEMPLATE(BM_DownmixToMono, AUDIO_FORMAT_PCM_FLOAT, true);
+BENCHMARK_TEMPLATE(BM_DownmixToMono, AUDIO_FORMAT_PCM_16_BIT, false);
+BENCHMARK_TEMPLATE(BM_DownmixToMono, AUDIO_FORMAT_PCM_16_BIT, true);
+
+BENCHMARK_TEMPLATE(BM_Interleave, false)->Apply(ChannelArgs);
+BENCHMARK_TEMPLATE(BM_Interleave, true)->Apply(ChannelArgs);
+BENCHMARK_TEMPLATE(BM_Deinterleave, false)->Apply(ChannelArgs);
+BENCHMARK_TEMPLATE(BM_Deinterleave, true)->Apply(ChannelArgs);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "formatconversion_tests"
+#include <log/log.h>
+
+#include <random>
+#include <vector>
+
+#include <audio_utils/format.h>
+#include <audio_utils/primitives.h>
+#include <gtest/gtest.h>
+#include <media/AudioFormatConversion.h>
+
+using namespace android;
+
+// Not a multiple of the vector width, so the scalar tail is exercised as well.
+constexpr size_t kSamples = 1021;
+
+static const audio_format_t kIntegerFormats[] = {
+    AUDIO_FORMAT_PCM_16_BIT,
+    AUDIO_FORMAT_PCM_24_BIT_PACKED,
+    AUDIO_FORMAT_PCM_8_24_BIT,
+    AUDIO_FORMAT_PCM_32_BIT,
+};
+
+// Random float samples, with out of range values and values halfway between
+// integer sample values, to check clamping and rounding.
+static std::vector<float> makeFloatSamples(size_t count)
+{
+    std::minstd_rand gen(42);
+    std::uniform_real_distribution<float> dis(-1.25f, 1.25f);
+    std::uniform_int_distribution<int> lsb(-0x800000, 0x7fffff);
+    std::vector<float> samples(count);
+    for (size_t i = 0; i < count; ++i) {
+        switch (i % 8) {
+        case 0:
+            samples[i] = (lsb(gen) + 0.5f) / (1 << 23);
+            break;
+        case 1:
+            samples[i] = ((lsb(gen) >> 8) + 0.5f) / (1 << 15);
+            break;
+        case 2:
+            samples[i] = (i & 8) ? 1.f : -1.f;
+            break;
+        default:
+            samples[i] = dis(gen);
+            break;
+        }
+    }
+    return samples;
+}
+
+TEST(formatconversion_tests, from_float)
+{
+    const std::vector<float> src = makeFloatSamples(kSamples);
+    for (const audio_format_t format : kIntegerFormats) {
+        const size_t size = kSamples * audio_bytes_per_sample(format);
+        std::vector<uint8_t> expected(size);
+        std::vector<uint8_t> actual(size);
+        memcpy_by_audio_format(expected.data(), format, src.data(), AUDIO_FORMAT_PCM_FLOAT,
+                kSamples);
+        convert_by_audio_format(actual.data(), format, src.data(), AUDIO_FORMAT_PCM_FLOAT,
+                kSamples);
+        EXPECT_EQ(expected, actual) << "format " << format;
+
+        // in place, to a smaller or equal sample size
+        std::vector<float> inPlace = src;
+        convert_by_audio_format(inPlace.data(), format, inPlace.data(), AUDIO_FORMAT_PCM_FLOAT,
+                kSamples);
+        EXPECT_EQ(0, memcmp(expected.data(), inPlace.data(), size)) << "format " << format;
+    }
+}
+
+TEST(formatconversion_tests, to_float)
+{
+    const std::vector<float> samples = makeFloatSamples(kSamples);
+    for (const audio_format_t format : kIntegerFormats) {
+        std::vector<uint8_t> src(kSamples * audio_bytes_per_sample(format));
+        memcpy_by_audio_format(src.data(), format, samples.data(), AUDIO_FORMAT_PCM_FLOAT,
+                kSamples);
+        std::vector<float> expected(kSamples);
+        std::vector<float> actual(kSamples);
+        memcpy_by_audio_format(expected.data(), AUDIO_FORMAT_PCM_FLOAT, src.data(), format,
+                kSamples);
+        convert_by_audio_format(actual.data(), AUDIO_FORMAT_PCM_FLOAT, src.data(), format,
+                kSamples);
+        EXPECT_EQ(0, memcmp(expected.data(), actual.data(), kSamples * sizeof(float)))
+                << "format " << format;
+    }
+}
+
+TEST(formatconversion_tests, fallback)
+{
+    // integer to integer conversions are done by memcpy_by_audio_format()
+    EXPECT_FALSE(format_conversion_is_vectorized(
+            AUDIO_FORMAT_PCM_24_BIT_PACKED, AUDIO_FORMAT_PCM_16_BIT));
+    std::vector<int16_t> src(kSamples);
+    for (size_t i = 0; i < kSamples; ++i) {
+        src[i] = i * 64;
+    }
+    std::vector<uint8_t> expected(kSamples * 3);
+    std::vector<uint8_t> actual(kSamples * 3);
+    memcpy_by_audio_format(expected.data(), AUDIO_FORMAT_PCM_24_BIT_PACKED,
+            src.data(), AUDIO_FORMAT_PCM_16_BIT, kSamples);
+    convert_by_audio_format(actual.data(), AUDIO_FORMAT_PCM_24_BIT_PACKED,
+            src.data(), AUDIO_FORMAT_PCM_16_BIT, kSamples);
+    EXPECT_EQ(expected, actual);
+}
+
+TEST(formatconversion_tests, upmix_downmix)
+{
+    const std::vector<float> mono = makeFloatSamples(kSamples);
+    std::vector<float> stereo(kSamples * 2);
+    upmix_to_stereo_float_from_mono_float(stereo.data(), mono.data(), kSamples);
+    const std::vector<float> stereoIn = makeFloatSamples(kSamples * 2);
+    std::vector<float> downmixed(kSamples);
+    downmix_to_mono_float_from_stereo_float(downmixed.data(), stereoIn.data(), kSamples);
+
+    for (const audio_format_t format : kIntegerFormats) {
+        const size_t sampleSize = audio_bytes_per_sample(format);
+
+        std::vector<uint8_t> expected(kSamples * 2 * sampleSize);
+        std::vector<uint8_t> actual(kSamples * 2 * sampleSize);
+        memcpy_by_audio_format(expected.data(), format, stereo.data(), AUDIO_FORMAT_PCM_FLOAT,
+                kSamples * 2);
+        upmix_to_stereo_by_audio_format(actual.data(), format,
+                mono.data(), AUDIO_FORMAT_PCM_FLOAT, kSamples);
+        EXPECT_EQ(expected, actual) << "format " << format;
+
+        expected.resize(kSamples * sampleSize);
+        actual.resize(kSamples * sampleSize);
+        memcpy_by_audio_format(expected.data(), format, downmixed.data(), AUDIO_FORMAT_PCM_FLOAT,
+                kSamples);
+        downmix_to_mono_by_audio_format(actual.data(), format,
+                stereoIn.data(), AUDIO_FORMAT_PCM_FLOAT, kSamples);
+        EXPECT_EQ(expected, actual) << "format " << format;
+    }
+
+    // float to float, in place for the downmix
+    std::vector<float> actual(kSamples * 2);
+    upmix_to_stereo_by_audio_format(actual.data(), AUDIO_FORMAT_PCM_FLOAT,
+            mono.data(), AUDIO_FORMAT_PCM_FLOAT, kSamples);
+    EXPECT_EQ(stereo, actual);
+    actual = stereoIn;
+    downmix_to_mono_by_audio_format(actual.data(), AUDIO_FORMAT_PCM_FLOAT,
+            actual.data(), AUDIO_FORMAT_PCM_FLOAT, kSamples);
+    actual.resize(kSamples);
+    EXPECT_EQ(downmixed, actual);
+}
+
+TEST(formatconversion_tests, interleave)
+{
+    for (uint32_t channelCount = 1; channelCount <= FCC_8; ++channelCount) {
+        const size_t frames = kSamples / channelCount;
+        const std::vector<float> interleaved = makeFloatSamples(frames * channelCount);
+        std::vector<std::vector<float>> planes(channelCount, std::vector<float>(frames));
+        std::vector<float *> dst;
+        std::vector<const float *> src;
+        for (auto &plane : planes) {
+            dst.push_back(plane.data());
+            src.push_back(plane.data());
+        }
+
+        deinterleave_float(dst.data(), interleaved.data(), channelCount, frames);
+        for (uint32_t ch = 0; ch < channelCount; ++ch) {
+            for (size_t i = 0; i < frames; ++i) {
+                ASSERT_EQ(interleaved[i * channelCount + ch], planes[ch][i])
+                        << "channels " << channelCount << " channel " << ch << " frame " << i;
+            }
+        }
+
+        std::vector<float> actual(frames * channelCount);
+        interleave_float(actual.data(), src.data(), channelCount, frames);
+        EXPECT_EQ(interleaved, actual) << "channels " << channelCount;
+    }
+}
@@ -15,7 +15,9 @@
  */
 
 #include <inttypes.h>
+#include <memory>
 #include <type_traits>
+#include <vector>
 #define LOG_ALWAYS_FATAL(...)
 
 #include <../AudioMixerOps.h>
@@ -101,4 +103,97 @@ BENCHMARK_TEMPLATE(BM_VolumeMulti, MIXTYPE_MULTI_SAVEONLY_MONOVOL, 8);
 BENCHMARK_TEMPLATE(BM_VolumeMulti, MIXTYPE_MULTI_STEREOVOL, 8);
 BENCHMARK_TEMPLATE(BM_VolumeMulti, MIXTYPE_MULTI_SAVEONLY_STEREOVOL, 8);
 
+// N-track stereo mixes, comparing one volumeMulti() pass per track
+// with the multi-track kernels accumulating up to MULTITRACK_MAX_TRACKS per pass.
+template <typename TO, typename TI, typename TV>
+static void BM_VolumeMultiPerTrack(benchmark::State& state) {
+    constexpr size_t FRAME_COUNT = 1000;
+    constexpr size_t SAMPLE_COUNT = FRAME_COUNT * FCC_2;
+    const size_t tracks = state.range(0);
+
+    TO out[SAMPLE_COUNT]{};
+    std::vector<TI> in(SAMPLE_COUNT * tracks);
+    const TV vol[FCC_2] = {1, 1};
+
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(out);
+        benchmark::DoNotOptimize(in.data());
+        for (size_t t = 0; t < tracks; ++t) {
+            volumeMulti<MIXTYPE_MULTI_STEREOVOL, FCC_2>(
+                    out, FRAME_COUNT, in.data() + t * SAMPLE_COUNT,
+                    (TO *)nullptr /* aux */, vol, TV{});
+        }
+        benchmark::ClobberMemory();
+    }
+}
+
+template <typename TO, typename TI, typename TV>
+static void BM_VolumeMultiTracks(benchmark::State& state) {
+    constexpr size_t FRAME_COUNT = 1000;
+    constexpr size_t SAMPLE_COUNT = FRAME_COUNT * FCC_2;
+    const size_t tracks = state.range(0);
+
+    TO out[SAMPLE_COUNT]{};
+    std::vector<TI> in(SAMPLE_COUNT * tracks);
+    std::vector<const TI *> inp(tracks);
+    std::unique_ptr<TV[][FCC_2]> vol(new TV[tracks][FCC_2]);
+    for (size_t t = 0; t < tracks; ++t) {
+        inp[t] = in.data() + t * SAMPLE_COUNT;
+        vol[t][0] = vol[t][1] = 1;
+    }
+
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(out);
+        benchmark::DoNotOptimize(in.data());
+        for (size_t t = 0; t < tracks; t += MULTITRACK_MAX_TRACKS) {
+            volumeMultiTracks<TO, TI, TV>(out, FRAME_COUNT, inp.data() + t,
+                    vol.get() + t, std::min(MULTITRACK_MAX_TRACKS, tracks - t));
+        }
+        benchmark::ClobberMemory();
+    }
+}
+
+template <typename TO, typename TI, typename TV>
+static void BM_VolumeRampMultiTracks(benchmark::State& state) {
+    constexpr size_t FRAME_COUNT = 1000;
+    constexpr size_t SAMPLE_COUNT = FRAME_COUNT * FCC_2;
+    const size_t tracks = state.range(0);
+
+    TO out[SAMPLE_COUNT]{};
+    std::vector<TI> in(SAMPLE_COUNT * tracks);
+    std::vector<const TI *> inp(tracks);
+    std::unique_ptr<TV[][FCC_2]> vol(new TV[tracks][FCC_2]);
+    std::unique_ptr<TV[][FCC_2]> volinc(new TV[tracks][FCC_2]);
+    for (size_t t = 0; t < tracks; ++t) {
+        inp[t] = in.data() + t * SAMPLE_COUNT;
+        vol[t][0] = vol[t][1] = 0;
+        volinc[t][0] = volinc[t][1] = 1;
+    }
+
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(out);
+        benchmark::DoNotOptimize(in.data());
+        for (size_t t = 0; t < tracks; t += MULTITRACK_MAX_TRACKS) {
+            volumeRampMultiTracks<TO, TI, TV>(out, FRAME_COUNT, inp.data() + t,
+                    vol.get() + t, volinc.get() + t,
+                    std::min(MULTITRACK_MAX_TRACKS, tracks - t));
+        }
+        benchmark::ClobberMemory();
+    }
+}
+
+static void MultiTrackArgs(benchmark::internal::Benchmark* b) {
+    for (int tracks : {1, 2, 4, 8, 16, 24, 32}) {
+        b->Arg(tracks);
+    }
+}
+
+BENCHMARK_TEMPLATE(BM_VolumeMultiPerTrack, float, float, float)->Apply(MultiTrackArgs);
+BENCHMARK_TEMPLATE(BM_VolumeMultiTracks, float, float, float)->Apply(MultiTrackArgs);
+BENCHMARK_TEMPLATE(BM_VolumeRampMultiTracks, float, float, float)->Apply(MultiTrackArgs);
+
+BENCHMARK_TEMPLATE(BM_VolumeMultiPerTrack, int32_t, int16_t, int16_t)->Apply(MultiTrackArgs);
+BENCHMARK_TEMPLATE(BM_VolumeMultiTracks, int32_t, int16_t, int16_t)->Apply(MultiTrackArgs);
+BENCHMARK_TEMPLATE(BM_VolumeRampMultiTracks, int32_t, int16_t, int32_t)->Apply(MultiTrackArgs);
+
 BENCHMARK_MAIN();
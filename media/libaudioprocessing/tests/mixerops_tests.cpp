@@ -18,8 +18,10 @@
 #define LOG_TAG "mixerop_tests"
 #include <log/log.h>
 
+#include <cmath>
 #include <inttypes.h>
 #include <type_traits>
+#include <vector>
 
 #include <../AudioMixerOps.h>
 #include <gtest/gtest.h>
@@ -173,3 +175,54 @@ TEST(mixerops, channel_equivalence) {
         EXPECT_EQ(system, actual);
     }
 }
+
+template <typename TO, typename TI, typename TV>
+static void testMultiTracks(TV volume, TV volumeInc) {
+    constexpr size_t FRAME_COUNT = 1001; // odd to exercise the scalar tail.
+    constexpr size_t SAMPLE_COUNT = FRAME_COUNT * FCC_2;
+
+    for (size_t tracks = 1; tracks <= MULTITRACK_MAX_TRACKS; ++tracks) {
+        std::vector<TI> in(SAMPLE_COUNT * tracks);
+        const TI *inp[MULTITRACK_MAX_TRACKS];
+        TV vol[MULTITRACK_MAX_TRACKS][FCC_2];
+        TV volinc[MULTITRACK_MAX_TRACKS][FCC_2];
+        TV volScalar[MULTITRACK_MAX_TRACKS][FCC_2];
+        for (size_t i = 0; i < in.size(); ++i) {
+            in[i] = static_cast<TI>(static_cast<int>(i % 255) - 127);
+        }
+        for (size_t t = 0; t < tracks; ++t) {
+            inp[t] = in.data() + t * SAMPLE_COUNT;
+            vol[t][0] = volScalar[t][0] = volume;
+            vol[t][1] = volScalar[t][1] = volume / 2;
+            volinc[t][0] = volinc[t][1] = volumeInc;
+        }
+
+        TO out[SAMPLE_COUNT]{};
+        TO outScalar[SAMPLE_COUNT]{};
+        volumeMultiTracks<TO, TI, TV>(out, FRAME_COUNT, inp, vol, tracks);
+        volumeMultiTracksScalar<TO, TI, TV>(outScalar, FRAME_COUNT, inp, vol, tracks);
+        for (size_t i = 0; i < SAMPLE_COUNT; ++i) {
+            ASSERT_EQ(outScalar[i], out[i]) << "tracks " << tracks << " sample " << i;
+        }
+
+        volumeRampMultiTracks<TO, TI, TV>(out, FRAME_COUNT, inp, vol, volinc, tracks);
+        volumeRampMultiTracksScalar<TO, TI, TV>(
+                outScalar, FRAME_COUNT, inp, volScalar, volinc, tracks);
+        for (size_t i = 0; i < SAMPLE_COUNT; ++i) {
+            if constexpr (std::is_floating_point_v<TO>) {
+                // the vectorized ramp computes volumes by multiplication, not accumulation.
+                ASSERT_NEAR(outScalar[i], out[i], 1e-3 * std::abs(outScalar[i]) + 1e-4)
+                        << "tracks " << tracks << " sample " << i;
+            } else {
+                ASSERT_EQ(outScalar[i], out[i]) << "tracks " << tracks << " sample " << i;
+            }
+        }
+    }
+}
+
+TEST(mixerops, multitracks_float) {
+    testMultiTracks<float, float, float>(0.5f, 1e-4f);
+}
+TEST(mixerops, multitracks_int16) {
+    testMultiTracks<int32_t, int16_t, int16_t>(0x800, 0);
+}
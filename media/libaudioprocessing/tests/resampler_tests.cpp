@@ -30,6 +30,8 @@
 
 #include <iostream>
 #include <memory>
+#include <random>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -40,6 +42,9 @@
 #include <media/AudioResampler.h>
 #include "../AudioResamplerDyn.h"
 #include "../AudioResamplerFirGen.h"
+#include "../AudioResamplerFirOps.h"
+#include "../AudioResamplerFirProcess.h"
+#include "../AudioResamplerFirProcessSSE.h"
 #include "test_utils.h"
 
 template <typename T>
@@ -371,6 +376,202 @@ TEST(audioflinger_resampler, bufferincrement_interpolatedphase_multi_float) {
     }
 }
 
+/* Volume ramp test
+ *
+ * Compares the volume ramp applied by the resampler during resample() with
+ * resampling at unity gain and applying the same ramp afterwards, as the mixer
+ * does when the resampler does not support volume ramps.
+ */
+void testVolumeRamp(size_t channels, unsigned inputFreq, unsigned outputFreq,
+        enum android::AudioResampler::src_quality quality)
+{
+    constexpr float kVolume[2] = {0.25f, 0.75f};
+    constexpr float kVolumeInc[2] = {1e-4f, -2e-4f};
+    const size_t outputChannels = channels == 1 ? 2 : channels;
+
+    SignalProvider provider;
+    provider.setChirp<float>(channels, 0., outputFreq/2., outputFreq, outputFreq/2000.);
+    const size_t outputFrames = ((int64_t) provider.getNumFrames() * outputFreq) / inputFreq;
+    std::vector<size_t> outputIncr{outputFrames};
+
+    // reference: unity gain resample, then ramp.
+    std::vector<float> reference(outputFrames * outputChannels);
+    std::unique_ptr<android::AudioResampler> resampler(android::AudioResampler::create(
+            AUDIO_FORMAT_PCM_FLOAT, channels, outputFreq, quality));
+    resampler->setSampleRate(inputFreq);
+    resampler->setVolume(android::AudioResampler::UNITY_GAIN_FLOAT,
+            android::AudioResampler::UNITY_GAIN_FLOAT);
+    resample(channels, reference.data(), outputFrames, outputIncr, &provider, resampler.get());
+    float volume[2] = {kVolume[0], kVolume[1]};
+    for (size_t i = 0; i < reference.size(); i += outputChannels) {
+        reference[i] *= volume[0];
+        reference[i + 1] *= volume[1];
+        volume[0] += kVolumeInc[0];
+        volume[1] += kVolumeInc[1];
+    }
+
+    // test: ramp applied by the resampler.
+    provider.reset();
+    std::vector<float> test(outputFrames * outputChannels);
+    resampler.reset(android::AudioResampler::create(
+            AUDIO_FORMAT_PCM_FLOAT, channels, outputFreq, quality));
+    resampler->setSampleRate(inputFreq);
+    ASSERT_TRUE(resampler->setVolumeRamp(kVolume[0], kVolume[1], kVolumeInc[0], kVolumeInc[1]));
+    resample(channels, test.data(), outputFrames, outputIncr, &provider, resampler.get());
+
+    for (size_t i = 0; i < test.size(); ++i) {
+        ASSERT_NEAR(reference[i], test[i], 1e-6f) << "sample " << i;
+    }
+    float left, right;
+    resampler->getVolume(&left, &right);
+    EXPECT_EQ(volume[0], left);
+    EXPECT_EQ(volume[1], right);
+}
+
+TEST(audioflinger_resampler, volumeramp_float) {
+    static const enum android::AudioResampler::src_quality kQualityArray[] = {
+            android::AudioResampler::DYN_LOW_QUALITY,
+            android::AudioResampler::DYN_MED_QUALITY,
+            android::AudioResampler::DYN_HIGH_QUALITY,
+    };
+
+    for (size_t i = 0; i < ARRAY_SIZE(kQualityArray); ++i) {
+        testVolumeRamp(1, 44100, 48000, kQualityArray[i]);
+        testVolumeRamp(2, 44100, 48000, kQualityArray[i]);
+        testVolumeRamp(2, 48000, 32000, kQualityArray[i]);
+    }
+}
+
+/* Filter cache test
+ *
+ * Resamplers with the same design parameters share one read-only filter bank,
+ * and a different rate designs a new one.
+ */
+TEST(audioflinger_resampler, filtercache) {
+    using ResamplerType = android::AudioResamplerDyn<float, float, float>;
+    auto createResampler = [](unsigned inputFreq, unsigned outputFreq) {
+        std::unique_ptr<ResamplerType> rdyn(static_cast<ResamplerType *>(
+                android::AudioResampler::create(AUDIO_FORMAT_PCM_FLOAT, 2 /* channels */,
+                        outputFreq, android::AudioResampler::DYN_HIGH_QUALITY)));
+        rdyn->setSampleRate(inputFreq);
+        return rdyn;
+    };
+
+    auto first = createResampler(44100, 48000);
+    const android::AudioResampler::FilterCacheStats before =
+            android::AudioResampler::getFilterCacheStats();
+    auto second = createResampler(44100, 48000);
+    const android::AudioResampler::FilterCacheStats after =
+            android::AudioResampler::getFilterCacheStats();
+    EXPECT_EQ(first->getFilterCoefs(), second->getFilterCoefs());
+    EXPECT_EQ(before.hits + 1, after.hits);
+    EXPECT_EQ(before.misses, after.misses);
+    EXPECT_EQ(before.filters, after.filters);
+
+    auto third = createResampler(37800, 48000); // not used by other tests
+    EXPECT_NE(first->getFilterCoefs(), third->getFilterCoefs());
+    EXPECT_EQ(after.misses + 1, android::AudioResampler::getFilterCacheStats().misses);
+
+    // another thread finds the filter in the shared cache.
+    const android::AudioResampler::FilterCacheStats beforeThread =
+            android::AudioResampler::getFilterCacheStats();
+    std::thread([&] {
+        auto fourth = createResampler(44100, 48000);
+        EXPECT_EQ(first->getFilterCoefs(), fourth->getFilterCoefs());
+    }).join();
+    const android::AudioResampler::FilterCacheStats afterThread =
+            android::AudioResampler::getFilterCacheStats();
+    EXPECT_EQ(beforeThread.hits + 1, afterThread.hits);
+    EXPECT_EQ(beforeThread.misses, afterThread.misses);
+}
+
+#if USE_AVX_DISPATCH
+/* FIR kernel SIMD level test
+ *
+ * Compares the float fir() output for each SIMD level supported by the CPU
+ * with a straightforward scalar dot product, for locked and interpolated phase.
+ * The kernels sum in a different order and may use fused multiply-add,
+ * so the results are compared with a small tolerance rather than bit-exact.
+ */
+template <int CHANNELS>
+void testFirSimdLevel(int halfNumCoefs)
+{
+    constexpr int kPhases = 16;
+    constexpr int kCoefShift = 27;
+    constexpr uint32_t kPhaseWrapLimit = uint32_t(kPhases) << kCoefShift;
+    constexpr int kOutChannels = CHANNELS == 1 ? 2 : CHANNELS;
+    const float volumeLR[2] __attribute__((aligned(8))) = {0.5f, 0.75f};
+
+    std::minstd_rand gen(CHANNELS * 1000 + halfNumCoefs);
+    std::uniform_real_distribution<float> dis(-1.f, 1.f);
+    std::vector<float> coefs((kPhases + 1) * halfNumCoefs);
+    for (auto &c : coefs) c = dis(gen);
+    std::vector<float> input(2 * halfNumCoefs * CHANNELS);
+    for (auto &s : input) s = dis(gen);
+    // sample positions are -halfNumCoefs + 1 to halfNumCoefs relative to samples.
+    const float *samples = input.data() + (halfNumCoefs - 1) * CHANNELS;
+
+    const int savedLevel = android::firSimdLevel();
+    for (bool locked : {true, false}) {
+        for (uint32_t phase : {0u, 0x12345678u, kPhaseWrapLimit - 1}) {
+            if (locked) phase &= ~((1u << kCoefShift) - 1);
+
+            // reference
+            const uint32_t indexP = phase >> kCoefShift;
+            const uint32_t indexN = locked ? (kPhaseWrapLimit - phase) >> kCoefShift
+                    : (kPhaseWrapLimit - phase - 1) >> kCoefShift;
+            const float lerpP = locked ? 0.f
+                    : float(phase << (32 - kCoefShift)) * float(1. / (65536. * 65536.));
+            float reference[kOutChannels]{};
+            for (int j = 0; j < CHANNELS; ++j) {
+                double accum = 0.;
+                for (int i = 0; i < halfNumCoefs; ++i) {
+                    const float *cP = &coefs[indexP * halfNumCoefs + i];
+                    const float *cN = &coefs[indexN * halfNumCoefs + i];
+                    const float coefP = locked ? cP[0] : lerpP * (cP[halfNumCoefs] - cP[0]) + cP[0];
+                    const float coefN = locked ? cN[0]
+                            : lerpP * (cN[0] - cN[halfNumCoefs]) + cN[halfNumCoefs];
+                    accum += coefP * samples[j - i * CHANNELS];
+                    accum += coefN * samples[j + (i + 1) * CHANNELS];
+                }
+                reference[j] = accum * volumeLR[CHANNELS == 2 ? j : 0];
+            }
+            if (CHANNELS == 1) {
+                reference[1] = reference[0] / volumeLR[0] * volumeLR[1];
+            }
+
+            for (int level = android::FIR_SIMD_SSE; level <= savedLevel; ++level) {
+                android::firSimdLevel() = level;
+                float out[kOutChannels] __attribute__((aligned(8))) = {};
+                if (locked) {
+                    android::fir<CHANNELS, true, 16>(out, phase, kPhaseWrapLimit, kCoefShift,
+                            halfNumCoefs, coefs.data(), samples, volumeLR);
+                } else {
+                    android::fir<CHANNELS, false, 16>(out, phase, kPhaseWrapLimit, kCoefShift,
+                            halfNumCoefs, coefs.data(), samples, volumeLR);
+                }
+                for (int j = 0; j < kOutChannels; ++j) {
+                    EXPECT_NEAR(reference[j], out[j], 1e-5f * halfNumCoefs)
+                            << "channels " << CHANNELS << " level " << level
+                            << " locked " << locked << " phase " << phase << " sample " << j;
+                }
+            }
+        }
+    }
+    android::firSimdLevel() = savedLevel;
+}
+
+TEST(audioflinger_resampler, fir_simd_level) {
+    for (int halfNumCoefs : {8, 16, 24, 64}) {
+        testFirSimdLevel<1>(halfNumCoefs);
+        testFirSimdLevel<2>(halfNumCoefs);
+        testFirSimdLevel<6>(halfNumCoefs);
+        testFirSimdLevel<8>(halfNumCoefs);
+        testFirSimdLevel<12>(halfNumCoefs);
+    }
+}
+#endif // USE_AVX_DISPATCH
+
 /* Simple aliasing test
  *
  * This checks stopband response of the chirp signal to make sure frequencies
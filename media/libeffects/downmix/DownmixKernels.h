@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_DOWNMIXKERNELS_H_
+#define ANDROID_DOWNMIXKERNELS_H_
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <array>
+#include <iterator>
+
+#include <system/audio.h>
+
+namespace android::downmix {
+
+/*
+ * Stereo downmix kernels specialized at compile time on the input channel mask.
+ *
+ * The mix matrix of a mask is generated by the compiler from the channel position bits, with
+ * the same coefficients as the generic audio_utils ChannelMix, so the kernels are drop-in
+ * replacements for the masks they cover. The matrix is fully unrolled into the frame loop,
+ * which processes two frames per iteration as a single {L0, R0, L1, R1} vector, mapped by the
+ * compiler onto NEON or SSE registers.
+ */
+
+constexpr float COEF_25 = 0.2508909536f;
+constexpr float COEF_35 = 0.3543928915f;
+constexpr float COEF_36 = 0.3552343859f;
+constexpr float COEF_61 = 0.6057043428f;
+constexpr float MINUS_3_DB = M_SQRT1_2;
+
+/* {left, right} gains of each channel position, indexed by the position bit */
+constexpr float kStereoGains[][2] = {
+    {1.f, 0.f},                 // AUDIO_CHANNEL_OUT_FRONT_LEFT
+    {0.f, 1.f},                 // AUDIO_CHANNEL_OUT_FRONT_RIGHT
+    {MINUS_3_DB, MINUS_3_DB},   // AUDIO_CHANNEL_OUT_FRONT_CENTER
+    {0.5f, 0.5f},               // AUDIO_CHANNEL_OUT_LOW_FREQUENCY
+    {MINUS_3_DB, 0.f},          // AUDIO_CHANNEL_OUT_BACK_LEFT
+    {0.f, MINUS_3_DB},          // AUDIO_CHANNEL_OUT_BACK_RIGHT
+    {COEF_61, COEF_25},         // AUDIO_CHANNEL_OUT_FRONT_LEFT_OF_CENTER
+    {COEF_25, COEF_61},         // AUDIO_CHANNEL_OUT_FRONT_RIGHT_OF_CENTER
+    {0.5f, 0.5f},               // AUDIO_CHANNEL_OUT_BACK_CENTER
+    {MINUS_3_DB, 0.f},          // AUDIO_CHANNEL_OUT_SIDE_LEFT
+    {0.f, MINUS_3_DB},          // AUDIO_CHANNEL_OUT_SIDE_RIGHT
+    {COEF_36, COEF_36},         // AUDIO_CHANNEL_OUT_TOP_CENTER
+    {1.f, 0.f},                 // AUDIO_CHANNEL_OUT_TOP_FRONT_LEFT
+    {MINUS_3_DB, MINUS_3_DB},   // AUDIO_CHANNEL_OUT_TOP_FRONT_CENTER
+    {0.f, 1.f},                 // AUDIO_CHANNEL_OUT_TOP_FRONT_RIGHT
+    {MINUS_3_DB, 0.f},          // AUDIO_CHANNEL_OUT_TOP_BACK_LEFT
+    {COEF_35, COEF_35},         // AUDIO_CHANNEL_OUT_TOP_BACK_CENTER
+    {0.f, MINUS_3_DB},          // AUDIO_CHANNEL_OUT_TOP_BACK_RIGHT
+    {COEF_61, 0.f},             // AUDIO_CHANNEL_OUT_TOP_SIDE_LEFT
+    {0.f, COEF_61},             // AUDIO_CHANNEL_OUT_TOP_SIDE_RIGHT
+    {1.f, 0.f},                 // AUDIO_CHANNEL_OUT_BOTTOM_FRONT_LEFT
+    {MINUS_3_DB, MINUS_3_DB},   // AUDIO_CHANNEL_OUT_BOTTOM_FRONT_CENTER
+    {0.f, 1.f},                 // AUDIO_CHANNEL_OUT_BOTTOM_FRONT_RIGHT
+    {0.f, MINUS_3_DB},          // AUDIO_CHANNEL_OUT_LOW_FREQUENCY_2
+    {MINUS_3_DB, 0.f},          // AUDIO_CHANNEL_OUT_FRONT_WIDE_LEFT
+    {0.f, MINUS_3_DB},          // AUDIO_CHANNEL_OUT_FRONT_WIDE_RIGHT
+};
+
+/*
+ * Returns the {left, right} gains of the channels of MASK, in buffer order.
+ * With a second LFE, each LFE is sent at -3dB to its own side only.
+ */
+template <uint32_t MASK>
+constexpr auto makeStereoMatrix() {
+    std::array<std::array<float, 2>, __builtin_popcount(MASK)> matrix{};
+    size_t channel = 0;
+    for (size_t bit = 0; bit < std::size(kStereoGains); ++bit) {
+        if ((MASK & (1u << bit)) == 0) continue;
+        matrix[channel] = {kStereoGains[bit][0], kStereoGains[bit][1]};
+        if ((1u << bit) == AUDIO_CHANNEL_OUT_LOW_FREQUENCY
+                && (MASK & AUDIO_CHANNEL_OUT_LOW_FREQUENCY_2) != 0) {
+            matrix[channel] = {MINUS_3_DB, 0.f};
+        }
+        ++channel;
+    }
+    return matrix;
+}
+
+typedef float float_x4 __attribute__((vector_size(4 * sizeof(float))));
+
+/* Input frames are not aligned on a vector boundary */
+inline float_x4 loadFrames(const float* p) {
+    float_x4 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline void storeFrames(float* p, const float_x4& v) {
+    memcpy(p, &v, sizeof(v));
+}
+
+/* The legacy downmix clamps its output to [-1, 1], and so does ChannelMix */
+inline float_x4 clampFrames(float_x4 v) {
+    for (size_t i = 0; i < 4; ++i) {
+        v[i] = fminf(fmaxf(v[i], -1.f), 1.f);
+    }
+    return v;
+}
+
+/*
+ * Downmixes frameCount frames of MASK to stereo.
+ * With ACCUMULATE, the downmix is added to the content of dst.
+ */
+template <uint32_t MASK, bool ACCUMULATE>
+void downmixToStereo(const float* src, float* dst, size_t frameCount) {
+    static constexpr auto kMatrix = makeStereoMatrix<MASK>();
+    constexpr size_t kChannels = kMatrix.size();
+    static_assert(MASK < (1u << std::size(kStereoGains)), "unsupported channel position");
+
+    for (; frameCount >= 2; frameCount -= 2) {
+        float_x4 ch{};
+        for (size_t i = 0; i < kChannels; ++i) {
+            const float_x4 x = {src[i], src[i], src[i + kChannels], src[i + kChannels]};
+            const float_x4 gain = {kMatrix[i][0], kMatrix[i][1], kMatrix[i][0], kMatrix[i][1]};
+            ch += gain * x;
+        }
+        if constexpr (ACCUMULATE) {
+            ch += loadFrames(dst);
+        }
+        storeFrames(dst, clampFrames(ch));
+        src += 2 * kChannels;
+        dst += 4;
+    }
+    if (frameCount > 0) {
+        float left = 0.f;
+        float right = 0.f;
+        for (size_t i = 0; i < kChannels; ++i) {
+            left += kMatrix[i][0] * src[i];
+            right += kMatrix[i][1] * src[i];
+        }
+        if constexpr (ACCUMULATE) {
+            left += dst[0];
+            right += dst[1];
+        }
+        dst[0] = fminf(fmaxf(left, -1.f), 1.f);
+        dst[1] = fminf(fmaxf(right, -1.f), 1.f);
+    }
+}
+
+using StereoDownmixFunc = void (*)(const float* src, float* dst, size_t frameCount);
+
+template <bool ACCUMULATE>
+StereoDownmixFunc getStereoDownmixKernel(audio_channel_mask_t mask) {
+    switch (mask) {
+        case AUDIO_CHANNEL_OUT_5POINT1:
+            return downmixToStereo<AUDIO_CHANNEL_OUT_5POINT1, ACCUMULATE>;
+        case AUDIO_CHANNEL_OUT_5POINT1_SIDE:
+            return downmixToStereo<AUDIO_CHANNEL_OUT_5POINT1_SIDE, ACCUMULATE>;
+        case AUDIO_CHANNEL_OUT_5POINT1POINT2:
+            return downmixToStereo<AUDIO_CHANNEL_OUT_5POINT1POINT2, ACCUMULATE>;
+        case AUDIO_CHANNEL_OUT_5POINT1POINT4:
+            return downmixToStereo<AUDIO_CHANNEL_OUT_5POINT1POINT4, ACCUMULATE>;
+        case AUDIO_CHANNEL_OUT_7POINT1:
+            return downmixToStereo<AUDIO_CHANNEL_OUT_7POINT1, ACCUMULATE>;
+        case AUDIO_CHANNEL_OUT_7POINT1POINT2:
+            return downmixToStereo<AUDIO_CHANNEL_OUT_7POINT1POINT2, ACCUMULATE>;
+        case AUDIO_CHANNEL_OUT_7POINT1POINT4:
+            return downmixToStereo<AUDIO_CHANNEL_OUT_7POINT1POINT4, ACCUMULATE>;
+        case AUDIO_CHANNEL_OUT_9POINT1POINT4:
+            return downmixToStereo<AUDIO_CHANNEL_OUT_9POINT1POINT4, ACCUMULATE>;
+        case AUDIO_CHANNEL_OUT_9POINT1POINT6:
+            return downmixToStereo<AUDIO_CHANNEL_OUT_9POINT1POINT6, ACCUMULATE>;
+        default:
+            return nullptr;
+    }
+}
+
+/* Returns the kernel for mask, or nullptr if the mask needs the generic ChannelMix */
+inline StereoDownmixFunc getStereoDownmixKernel(audio_channel_mask_t mask, bool accumulate) {
+    return accumulate ? getStereoDownmixKernel<true>(mask) : getStereoDownmixKernel<false>(mask);
+}
+
+}  // namespace android::downmix
+
+#endif /*ANDROID_DOWNMIXKERNELS_H_*/
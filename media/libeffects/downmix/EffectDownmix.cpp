@@ -18,6 +18,7 @@
 //#define LOG_NDEBUG 0
 #include <log/log.h>
 
+#include "DownmixKernels.h"
 #include "EffectDownmix.h"
 #include <audio_utils/ChannelMix.h>
 
@@ -41,6 +42,8 @@ struct downmix_object_t {
     bool apply_volume_correction;
     uint8_t input_channel_count;
     android::audio_utils::channels::ChannelMix<AUDIO_CHANNEL_OUT_STEREO> channelMix;
+    // specialized fold for the input mask and access mode, nullptr to use channelMix
+    android::downmix::StereoDownmixFunc foldKernel;
 };
 
 typedef struct downmix_module_s {
@@ -369,7 +372,9 @@ static int32_t Downmix_Process(effect_handle_t self,
           break;
 
       case DOWNMIX_TYPE_FOLD: {
-            if (!pDownmixer->channelMix.process(
+            if (pDownmixer->foldKernel != nullptr) {
+                pDownmixer->foldKernel(pSrc, pDst, numFrames);
+            } else if (!pDownmixer->channelMix.process(
                     pSrc, pDst, numFrames, accumulate, downmixInputChannelMask)) {
                 ALOGE("Multichannel configuration %#x is not supported",
                       downmixInputChannelMask);
@@ -668,6 +673,13 @@ static int Downmix_Configure(downmix_module_t *pDwmModule, effect_config_t *pCon
         pDownmixer->input_channel_count =
                 audio_channel_count_from_out_mask(pConfig->inputCfg.channels);
     }
+#ifdef DOWNMIX_ALWAYS_USE_GENERIC_DOWNMIXER
+    pDownmixer->foldKernel = nullptr;
+#else
+    pDownmixer->foldKernel = android::downmix::getStereoDownmixKernel(
+            (audio_channel_mask_t)pConfig->inputCfg.channels,
+            pConfig->outputCfg.accessMode == EFFECT_BUFFER_ACCESS_ACCUMULATE);
+#endif
 
     Downmix_Reset(pDownmixer, init);
 
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "dsp/DPFrequency.h"
+
+// The media stream configuration: 48 kHz, 10 ms frames (a 512 point FFT with the
+// framework's half block overlap), and 6 MBC bands.
+constexpr size_t kSampleRate = 48000;
+constexpr size_t kFrameCount = 480;
+constexpr size_t kBlockSize = 512;
+constexpr uint32_t kEqBandCount = 6;
+constexpr uint32_t kMbcBandCount = 6;
+
+constexpr float kEqCutoffsHz[kEqBandCount] = {100, 300, 1000, 3000, 8000, 24000};
+constexpr float kMbcCutoffsHz[kMbcBandCount] = {150, 500, 1500, 4000, 10000, 24000};
+
+/*******************************************************************
+ * The first parameter is the channel count.
+ * The second parameter selects the stages in use:
+ * 0: MBC only, 1: preEq, MBC, postEq and limiter
+ *******************************************************************/
+
+static void BM_DYNAMICS_PROCESSING(benchmark::State& state) {
+    const uint32_t channelCount = state.range(0);
+    const bool allStages = state.range(1) != 0;
+
+    dp_fx::DPFrequency dynamics;
+    dynamics.init(channelCount, allStages /* preEqInUse */, kEqBandCount, true /* mbcInUse */,
+                  kMbcBandCount, allStages /* postEqInUse */, kEqBandCount,
+                  allStages /* limiterInUse */);
+    for (uint32_t ch = 0; ch < channelCount; ch++) {
+        dp_fx::DPChannel* channel = dynamics.getChannel(ch);
+        for (uint32_t b = 0; b < kEqBandCount && allStages; b++) {
+            dp_fx::DPEqBand band;
+            band.init(true /* enabled */, kEqCutoffsHz[b], (b % 2 == 0) ? 3.f : -3.f);
+            channel->getPreEq()->setBand(b, band);
+            channel->getPostEq()->setBand(b, band);
+        }
+        channel->getPreEq()->setEnabled(allStages);
+        channel->getPostEq()->setEnabled(allStages);
+        for (uint32_t b = 0; b < kMbcBandCount; b++) {
+            dp_fx::DPMbcBand band;
+            band.init(true /* enabled */, kMbcCutoffsHz[b], 3 /* attackTime */,
+                      80 /* releaseTime */, 2 /* ratio */, -30 /* threshold */, 6 /* kneeWidth */,
+                      -90 /* noiseGateThreshold */, 1 /* expanderRatio */, 0 /* preGain */,
+                      2 /* postGain */);
+            channel->getMbc()->setBand(b, band);
+        }
+        channel->getMbc()->setEnabled(true);
+        if (allStages) {
+            dp_fx::DPLimiter limiter;
+            limiter.init(true /* inUse */, true /* enabled */, 0 /* linkGroup */,
+                         1 /* attackTime */, 60 /* releaseTime */, 10 /* ratio */,
+                         -2 /* threshold */, 0 /* postGain */);
+            channel->setLimiter(limiter);
+        }
+    }
+    dynamics.configure(kBlockSize, kBlockSize / 2, kSampleRate);
+
+    // Initialize input buffer with deterministic pseudo-random values
+    std::minstd_rand gen(channelCount);
+    std::uniform_real_distribution<> dis(-1.0f, 1.0f);
+    std::vector<float> input(kFrameCount * channelCount);
+    std::vector<float> output(kFrameCount * channelCount);
+    for (auto& in : input) {
+        in = dis(gen);
+    }
+
+    // Run the test
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(input.data());
+        benchmark::DoNotOptimize(output.data());
+
+        dynamics.processSamples(input.data(), output.data(), input.size());
+
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations() * kFrameCount);
+}
+
+static void DynamicsProcessingArgs(benchmark::internal::Benchmark* b) {
+    for (int channelCount : {1, 2, 6, 8}) {
+        for (int allStages : {0, 1}) {
+            b->Args({channelCount, allStages});
+        }
+    }
+}
+
+BENCHMARK(BM_DYNAMICS_PROCESSING)->Apply(DynamicsProcessingArgs);
+
+BENCHMARK_MAIN();
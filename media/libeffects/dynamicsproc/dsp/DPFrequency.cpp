@@ -20,11 +20,11 @@
 #include <log/log.h>
 #include "DPFrequency.h"
 #include <algorithm>
+#include <cmath>
 #include <sys/param.h>
 
 namespace dp_fx {
 
-using Eigen::MatrixXd;
 #define MAX_BLOCKSIZE 16384 //For this implementation
 #define MIN_BLOCKSIZE 8
 
@@ -50,6 +50,102 @@ template <> bool compareEquality<float>(float a, float b) {
 #define IS_CHANGED(c, a, b) { c |= !compareEquality(a,b); \
     (a) = (b); }
 
+//sum of the squared magnitude of bins binStart to binStop, scaled by the squared bin gains.
+//spectrum is in RealFft order, and nyquistBin is N/2.
+static float bandEnergy(const float *spectrum, const float *gains, size_t binStart,
+        size_t binStop, size_t nyquistBin) {
+    float energy = 0;
+    size_t k = binStart;
+    if (k == 0 && k <= binStop) {
+        energy += spectrum[0] * spectrum[0] * gains[0] * gains[0];
+        k++;
+    }
+    for (; k <= binStop && k < nyquistBin; k++) {
+        const float re = spectrum[2 * k];
+        const float im = spectrum[2 * k + 1];
+        energy += (re * re + im * im) * gains[k] * gains[k];
+    }
+    if (k == nyquistBin && k <= binStop) {
+        energy += spectrum[1] * spectrum[1] * gains[k] * gains[k];
+    }
+    return energy;
+}
+
+//== RealFft
+RealFft::~RealFft() {
+    if (mSetup != nullptr) {
+        pffft_destroy_setup(mSetup);
+    }
+}
+
+void RealFft::configure(size_t size) {
+    if (size == mSize) {
+        return;
+    }
+    if (mSetup != nullptr) {
+        pffft_destroy_setup(mSetup);
+    }
+    mSize = size;
+    //pffft real transforms need a multiple of 32 points
+    mSetup = size % 32 == 0 ? pffft_new_setup(size, PFFFT_REAL) : nullptr;
+    mWork.resize(size);
+    mCos.clear();
+    mSin.clear();
+    if (mSetup == nullptr) {
+        mCos.resize(size);
+        mSin.resize(size);
+        for (size_t n = 0; n < size; n++) {
+            mCos[n] = cos(2 * M_PI * n / size);
+            mSin[n] = sin(2 * M_PI * n / size);
+        }
+    }
+}
+
+void RealFft::forward(float *data) {
+    if (mSetup != nullptr) {
+        pffft_transform_ordered(mSetup, data, data, mWork.data(), PFFFT_FORWARD);
+        return;
+    }
+    //direct transform
+    const size_t half = mSize / 2;
+    for (size_t k = 0; k <= half; k++) {
+        float re = 0;
+        float im = 0;
+        for (size_t n = 0; n < mSize; n++) {
+            const size_t index = (k * n) % mSize;
+            re += data[n] * mCos[index];
+            im -= data[n] * mSin[index];
+        }
+        if (k == 0) {
+            mWork[0] = re;
+        } else if (k == half) {
+            mWork[1] = re;
+        } else {
+            mWork[2 * k] = re;
+            mWork[2 * k + 1] = im;
+        }
+    }
+    std::copy(mWork.begin(), mWork.end(), data);
+}
+
+void RealFft::inverse(float *data) {
+    if (mSetup != nullptr) {
+        pffft_transform_ordered(mSetup, data, data, mWork.data(), PFFFT_BACKWARD);
+        return;
+    }
+    //direct transform, using the hermitian symmetry of the spectrum
+    const size_t half = mSize / 2;
+    for (size_t n = 0; n < mSize; n++) {
+        float value = data[0] + ((n & 1) ? -data[1] : data[1]);
+        for (size_t k = 1; k < half; k++) {
+            const size_t index = (k * n) % mSize;
+            value += 2 * (data[2 * k] * mCos[index] - data[2 * k + 1] * mSin[index]);
+        }
+        mWork[n] = value;
+    }
+    std::copy(mWork.begin(), mWork.end(), data);
+}
+
 //ChannelBuffers helper
 void ChannelBuffer::initBuffers(unsigned int blockSize, unsigned int overlapSize,
         unsigned int halfFftSize, unsigned int samplingRate, DPBase &dpBase) {
@@ -66,6 +162,8 @@ void ChannelBuffer::initBuffers(unsigned int blockSize, unsigned int overlapSize
     input.resize(mBlockSize);
     output.resize(mBlockSize);
     outTail.resize(overlapSize);
+    spectrum.resize(mBlockSize);
+    binGains.resize(halfFftSize);
 
     //module vectors
     mPreEqFactorVector.resize(halfFftSize, 1.0);
@@ -163,12 +261,15 @@ void DPFrequency::configure(size_t blockSize, size_t overlapSize,
     //effective number of frames processed per second
     mBlocksPerSecond = (float)mSamplingRate / (mBlockSize - mOverlapSize);
 
+    mFft.configure(mBlockSize);
+
     fill_window(mVWindow, RDSP_WINDOW_HANNING_FLAT_TOP, mBlockSize, mOverlapSize);
 
     //split window into analysis and synthesis. Both are the sqrt() of original
     //window
-    Eigen::Map<Eigen::VectorXf> eWindow(&mVWindow[0], mVWindow.size());
-    eWindow = eWindow.array().sqrt();
+    for (size_t i = 0; i < mVWindow.size(); i++) {
+        mVWindow[i] = sqrt(mVWindow[i]);
+    }
 
     //compute window rms for energy compensation
     mWindowRms = 0;
@@ -477,40 +578,40 @@ size_t DPFrequency::processChannelBuffers(CBufferVector &channelBuffers) {
 size_t DPFrequency::processFirstStages(ChannelBuffer &cb) {
 
     //##apply window
-    Eigen::Map<Eigen::VectorXf> eWindow(&mVWindow[0], mVWindow.size());
-    Eigen::Map<Eigen::VectorXf> eInput(&cb.input[0], cb.input.size());
-
-    Eigen::VectorXf eWin = eInput.cwiseProduct(eWindow); //apply window
+    float *spectrum = cb.spectrum.data();
+    for (size_t k = 0; k < mBlockSize; k++) {
+        spectrum[k] = cb.input[k] * mVWindow[k];
+    }
 
     //##fft
-    //Note: we are using eigen with the default scaling, which ensures that
-    //  IFFT( FFT(x) ) = x.
-    // TODO: optimize by using the noscale option, and compensate with dB scale offsets
-    mFftServer.fwd(cb.complexTemp, eWin);
+    //Note: the transforms are unscaled, the 1/N scaling of the inverse transform is applied
+    //  along with the bin gains in processLastStages().
+    mFft.forward(spectrum);
 
-    size_t cSize = cb.complexTemp.size();
-    size_t maxBin = std::min(cSize/2, mHalfFFTSize);
+    //The stages only compute the gain of each bin here. The spectrum itself is scaled once,
+    //by the combined gain, in processLastStages().
+    //The preEq, postEq and output gains apply to bins below nyquistBin, the mbc to all bins.
+    const size_t nyquistBin = mHalfFFTSize - 1;
+    float *gains = cb.binGains.data();
 
     //== EqPre (always runs)
-    for (size_t k = 0; k < maxBin; k++) {
-        cb.complexTemp[k] *= cb.mPreEqFactorVector[k];
-    }
+    std::copy(cb.mPreEqFactorVector.begin(), cb.mPreEqFactorVector.begin() + nyquistBin, gains);
+    gains[nyquistBin] = 1;
 
     //== MBC
     if (cb.mMbcInUse && cb.mMbcEnabled) {
         for (size_t band = 0; band < cb.mMbcBands.size(); band++) {
             ChannelBuffer::MbcBandParams *pMbcBandParams = &cb.mMbcBands[band];
-            float fEnergySum = 0;
+            const size_t binStop = std::min(pMbcBandParams->binStop, nyquistBin);
 
             //apply pre gain.
             float preGainFactor = dBtoLinear(pMbcBandParams->gainPreDb);
             float preGainSquared = preGainFactor * preGainFactor;
 
-            for (size_t k = pMbcBandParams->binStart; k <= pMbcBandParams->binStop; k++) {
-                fEnergySum += std::norm(cb.complexTemp[k]) * preGainSquared; //mag squared
-            }
+            float fEnergySum = bandEnergy(spectrum, gains, pMbcBandParams->binStart, binStop,
+                    nyquistBin) * preGainSquared; //mag squared
 
-            //Eigen FFT is full spectrum, even if the source was real data.
+            //The spectrum only holds the first half of the bins of the real input.
             // Each half spectrum has half the energy. This is taken into account with the * 2
             // factor in the energy computations.
             // energy = sqrt(sum_components_squared) number_points
@@ -567,8 +668,8 @@ size_t DPFrequency::processFirstStages(ChannelBuffer &cb) {
             newFactor *= dBtoLinear(pMbcBandParams->gainPostDb);
 
             //apply to this band
-            for (size_t k = pMbcBandParams->binStart; k <= pMbcBandParams->binStop; k++) {
-                cb.complexTemp[k] *= newFactor;
+            for (size_t k = pMbcBandParams->binStart; k <= binStop; k++) {
+                gains[k] *= newFactor;
             }
 
         } //end per band process
@@ -577,17 +678,14 @@ size_t DPFrequency::processFirstStages(ChannelBuffer &cb) {
 
     //== EqPost
     if (cb.mPostEqInUse && cb.mPostEqEnabled) {
-        for (size_t k = 0; k < maxBin; k++) {
-            cb.complexTemp[k] *= cb.mPostEqFactorVector[k];
+        for (size_t k = 0; k < nyquistBin; k++) {
+            gains[k] *= cb.mPostEqFactorVector[k];
         }
     }
 
     //== Limiter. First Pass
     if (cb.mLimiterInUse && cb.mLimiterEnabled) {
-        float fEnergySum = 0;
-        for (size_t k = 0; k < maxBin; k++) {
-            fEnergySum += std::norm(cb.complexTemp[k]);
-        }
+        float fEnergySum = bandEnergy(spectrum, gains, 0, nyquistBin - 1, nyquistBin);
 
         //see explanation above for energy computation logic
         fEnergySum = sqrt(fEnergySum * 2) / (mBlockSize * mWindowRms);
@@ -654,22 +752,28 @@ size_t DPFrequency::processLastStages(ChannelBuffer &cb) {
         outputGainFactor *= factor;
     }
 
-    //apply to all if != 1.0
-    if (!compareEquality(outputGainFactor, 1.0f)) {
-        size_t cSize = cb.complexTemp.size();
-        size_t maxBin = std::min(cSize/2, mHalfFFTSize);
-        for (size_t k = 0; k < maxBin; k++) {
-            cb.complexTemp[k] *= outputGainFactor;
-        }
+    //apply the bin gains, the output gain and the inverse fft scaling in a single pass.
+    //the output gain does not apply to the nyquist bin.
+    const size_t nyquistBin = mHalfFFTSize - 1;
+    const float scale = 1.0f / mBlockSize;
+    const float outputScale = outputGainFactor * scale;
+    float *spectrum = cb.spectrum.data();
+    const float *gains = cb.binGains.data();
+    spectrum[0] *= gains[0] * outputScale;
+    spectrum[1] *= gains[nyquistBin] * scale;
+    for (size_t k = 1; k < nyquistBin; k++) {
+        const float gain = gains[k] * outputScale;
+        spectrum[2 * k] *= gain;
+        spectrum[2 * k + 1] *= gain;
     }
 
-    //##ifft directly to output.
-    Eigen::Map<Eigen::VectorXf> eOutput(&cb.output[0], cb.output.size());
-    mFftServer.inv(eOutput, cb.complexTemp);
+    //##ifft
+    mFft.inverse(spectrum);
 
     //apply rest of window for resynthesis
-    Eigen::Map<Eigen::VectorXf> eWindow(&mVWindow[0], mVWindow.size());
-    eOutput = eOutput.cwiseProduct(eWindow);
+    for (size_t k = 0; k < mBlockSize; k++) {
+        cb.output[k] = spectrum[k] * mVWindow[k];
+    }
 
     return mBlockSize;
 }
@@ -18,8 +18,7 @@
 #ifndef DPFREQUENCY_H_
 #define DPFREQUENCY_H_
 
-#include <Eigen/Dense>
-#include <unsupported/Eigen/FFT>
+#include <pffft.h>
 
 #include "RDsp.h"
 #include "SHCircularBuffer.h"
@@ -31,6 +30,49 @@ namespace dp_fx {
 
 using FXBuffer = SHCircularBuffer<float>;
 
+//allocator with the SIMD alignment required by pffft
+template <typename T>
+struct AlignedAllocator {
+    using value_type = T;
+    AlignedAllocator() = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U> &) {}
+    T *allocate(size_t n) {
+        return static_cast<T *>(pffft_aligned_malloc(n * sizeof(T)));
+    }
+    void deallocate(T *p, size_t) {
+        pffft_aligned_free(p);
+    }
+    template <typename U>
+    bool operator==(const AlignedAllocator<U> &) const { return true; }
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U> &) const { return false; }
+};
+
+using AlignedFloatVec = std::vector<float, AlignedAllocator<float>>;
+
+//Real input FFT, planned once for a given size. The transforms are done in place and
+//unscaled. The half spectrum is ordered as:
+//  {re(0), re(N/2), re(1), im(1), re(2), im(2), ..., re(N/2 - 1), im(N/2 - 1)}
+class RealFft {
+public:
+    RealFft() = default;
+    ~RealFft();
+    RealFft(const RealFft &) = delete;
+    RealFft &operator=(const RealFft &) = delete;
+
+    void configure(size_t size);
+    void forward(float *data);
+    void inverse(float *data);
+
+private:
+    size_t mSize = 0;
+    PFFFT_Setup *mSetup = nullptr; //nullptr for the sizes too small for pffft
+    AlignedFloatVec mWork;
+    FloatVec mCos;  //twiddles of the direct transform used for small sizes
+    FloatVec mSin;
+};
+
 class ChannelBuffer {
 public:
     FXBuffer cBInput;   // Circular Buffer input
@@ -39,7 +81,8 @@ public:
     FloatVec output;    // time domain temp vector for output
     FloatVec outTail;   // time domain temp vector for output tail (for overlap-add method)
 
-    Eigen::VectorXcf complexTemp; // complex temp vector for frequency domain operations
+    AlignedFloatVec spectrum; // half spectrum of the windowed input, in RealFft order
+    AlignedFloatVec binGains; // combined preEq, mbc and postEq gain of each bin
 
     //Current parameters
     float inputGainDb;
@@ -152,7 +195,7 @@ private:
     //dsp
     FloatVec mVWindow;  //window class.
     float mWindowRms;
-    Eigen::FFT<float> mFftServer;
+    RealFft mFft;
 };
 
 } //namespace dp_fx
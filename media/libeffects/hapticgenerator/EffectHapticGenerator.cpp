@@ -40,6 +40,9 @@ static constexpr float DEFAULT_RESONANT_FREQUENCY = 150.0f;
 static constexpr float DEFAULT_BSF_ZERO_Q = 8.0f;
 static constexpr float DEFAULT_BSF_POLE_Q = 4.0f;
 static constexpr float DEFAULT_DISTORTION_OUTPUT_GAIN = 1.5f;
+// The lowest sample rate at which the band-limited part of the processing chain runs in decimated
+// processing. Its filters have corner frequencies of at most 700Hz.
+static constexpr float DECIMATED_MIN_SAMPLE_RATE = 4000.0f;
 
 // This is the only symbol that needs to be exported
 __attribute__ ((visibility ("default")))
@@ -107,6 +110,7 @@ std::string hapticParamToString(const struct HapticGeneratorParam& param) {
     ss << "\t\t- distortion input gain: " << param.distortionInputGain << '\n';
     ss << "\t\t- distortion cube threshold: " << param.distortionCubeThreshold << '\n';
     ss << "\t\t- distortion output gain: " << param.distortionOutputGain << '\n';
+    ss << "\t\t- decimated processing: " << param.decimatedProcessing << '\n';
     return ss.str();
 }
 
@@ -157,12 +161,30 @@ int HapticGenerator_Init(struct HapticGeneratorContext *context) {
     context->param.distortionCubeThreshold = 0.1f;
     context->param.distortionOutputGain = getFloatProperty(
             "vendor.audio.hapticgenerator.distortion.output.gain", DEFAULT_DISTORTION_OUTPUT_GAIN);
+    context->param.decimatedProcessing = android::base::GetBoolProperty(
+            "vendor.audio.hapticgenerator.decimated", false);
     ALOGD("%s\n%s", __func__, hapticParamToString(context->param).c_str());
 
     context->state = HAPTICGENERATOR_STATE_INITIALIZED;
     return 0;
 }
 
+/**
+ * \brief band-pass filter coefficients for the processing chain.
+ *
+ * The gain of bpfCoefs() at the ringing frequency is proportional to the sample rate, so with
+ * decimation the filter is scaled to keep the gain it has at the audio sample rate.
+ *
+ * \param sampleRate the sample rate of the filter, already divided by decimationFactor
+ */
+BiquadFilterCoefficients HapticGenerator_bpfCoefs(float ringingFrequency, float q,
+                                                  float sampleRate, size_t decimationFactor) {
+    BiquadFilterCoefficients coefficient = bpfCoefs(ringingFrequency, q, sampleRate);
+    coefficient[0] *= decimationFactor;
+    coefficient[1] *= decimationFactor;
+    return coefficient;
+}
+
 void addBiquadFilter(
         std::vector<std::function<void(float *, const float *, size_t)>> &processingChain,
         struct HapticGeneratorProcessorsRecord &processorsRecord,
@@ -180,14 +202,21 @@ void addBiquadFilter(
  * \brief build haptic generator processing chain.
  *
  * \param processingChain
+ * \param lowRateProcessingChain the chain for the linear processors after the ramp when
+ *        decimating
+ * \param postProcessingChain the chain for the distortion after interpolation when decimating
  * \param processorsRecord a structure to cache all the shared pointers for processors
  * \param sampleRate the audio sampling rate. Use a float here as it may be used to create filters
+ * \param decimationFactor the sample rate reduction of lowRateProcessingChain, 1 to use
+ *        processingChain only
  * \param channelCount haptic channel count
  */
 void HapticGenerator_buildProcessingChain(
         std::vector<std::function<void(float*, const float*, size_t)>>& processingChain,
+        std::vector<std::function<void(float*, const float*, size_t)>>& lowRateProcessingChain,
+        std::vector<std::function<void(float*, const float*, size_t)>>& postProcessingChain,
         struct HapticGeneratorProcessorsRecord& processorsRecord, float sampleRate,
-        const struct HapticGeneratorParam* param) {
+        size_t decimationFactor, const struct HapticGeneratorParam* param) {
     const size_t channelCount = param->hapticChannelCount;
     float highPassCornerFrequency = 50.0f;
     auto hpf = createHPF2(highPassCornerFrequency, sampleRate, channelCount);
@@ -206,23 +235,33 @@ void HapticGenerator_buildProcessingChain(
             ramp->process(out, in, frameCount);
     });
 
+    // The linear processors after the ramp are band limited to less than 1kHz, so with
+    // decimation they run at the reduced sample rate. The filters before the ramp, and the
+    // nonlinear ramp and distortion, stay at the audio sample rate, where their harmonics do not
+    // alias.
+    auto& bandLimitedChain = decimationFactor > 1 ? lowRateProcessingChain : processingChain;
+    const float audioSampleRate = sampleRate;
+    sampleRate /= decimationFactor;
+
     highPassCornerFrequency = 60.0f;
     hpf = createHPF2(highPassCornerFrequency, sampleRate, channelCount);
-    addBiquadFilter(processingChain, processorsRecord, hpf);
+    addBiquadFilter(bandLimitedChain, processorsRecord, hpf);
     lowPassCornerFrequency = 700.0f;
     lpf = createLPF2(lowPassCornerFrequency, sampleRate, channelCount);
-    addBiquadFilter(processingChain, processorsRecord, lpf);
+    addBiquadFilter(bandLimitedChain, processorsRecord, lpf);
 
     lowPassCornerFrequency = 400.0f;
     lpf = createLPF2(lowPassCornerFrequency, sampleRate, channelCount);
-    addBiquadFilter(processingChain, processorsRecord, lpf);
+    addBiquadFilter(bandLimitedChain, processorsRecord, lpf);
     lowPassCornerFrequency = 500.0f;
     lpf = createLPF2(lowPassCornerFrequency, sampleRate, channelCount);
-    addBiquadFilter(processingChain, processorsRecord, lpf);
+    addBiquadFilter(bandLimitedChain, processorsRecord, lpf);
 
-    auto bpf = createBPF(param->resonantFrequency, param->bpfQ, sampleRate, channelCount);
+    auto bpf = std::make_shared<HapticBiquadFilter>(
+            channelCount, HapticGenerator_bpfCoefs(param->resonantFrequency, param->bpfQ,
+                                                   sampleRate, decimationFactor));
     processorsRecord.bpf = bpf;
-    addBiquadFilter(processingChain, processorsRecord, bpf);
+    addBiquadFilter(bandLimitedChain, processorsRecord, bpf);
 
     float normalizationPower = param->slowEnvNormalizationPower;
     // The process chain captures the shared pointer of the slow envelope in lambda. It will
@@ -233,7 +272,7 @@ void HapticGenerator_buildProcessingChain(
             5.0f /*envCornerFrequency*/, sampleRate, normalizationPower,
             0.01f /*envOffset*/, channelCount);
     processorsRecord.slowEnvs.push_back(slowEnv);
-    processingChain.push_back([slowEnv](float *out, const float *in, size_t frameCount) {
+    bandLimitedChain.push_back([slowEnv](float *out, const float *in, size_t frameCount) {
             slowEnv->process(out, in, frameCount);
     });
 
@@ -241,17 +280,18 @@ void HapticGenerator_buildProcessingChain(
     auto bsf = createBSF(
             param->resonantFrequency, param->bsfZeroQ, param->bsfPoleQ, sampleRate, channelCount);
     processorsRecord.bsf = bsf;
-    addBiquadFilter(processingChain, processorsRecord, bsf);
+    addBiquadFilter(bandLimitedChain, processorsRecord, bsf);
 
     // The process chain captures the shared pointer of the Distortion in lambda. It will
     // be the only reference to the Distortion.
     // The process record will keep a weak pointer to the Distortion so that it is possible
     // to access the Distortion outside of the process chain.
     auto distortion = std::make_shared<Distortion>(
-            param->distortionCornerFrequency, sampleRate, param->distortionInputGain,
+            param->distortionCornerFrequency, audioSampleRate, param->distortionInputGain,
             param->distortionCubeThreshold, param->distortionOutputGain, channelCount);
     processorsRecord.distortions.push_back(distortion);
-    processingChain.push_back([distortion](float *out, const float *in, size_t frameCount) {
+    auto& distortionChain = decimationFactor > 1 ? postProcessingChain : processingChain;
+    distortionChain.push_back([distortion](float *out, const float *in, size_t frameCount) {
             distortion->process(out, in, frameCount);
     });
 }
@@ -266,6 +306,8 @@ int HapticGenerator_Configure(struct HapticGeneratorContext *context, effect_con
     }
     if (&context->config != config) {
         context->processingChain.clear();
+        context->lowRateProcessingChain.clear();
+        context->postProcessingChain.clear();
         context->processorsRecord.filters.clear();
         context->processorsRecord.ramps.clear();
         context->processorsRecord.slowEnvs.clear();
@@ -285,9 +327,27 @@ int HapticGenerator_Configure(struct HapticGeneratorContext *context, effect_con
             context->param.hapticChannelSource[i] = 0;
         }
 
+        context->decimationFactor = 1;
+        if (context->param.decimatedProcessing) {
+            context->decimationFactor = std::max<size_t>(
+                    1, (size_t) (config->inputCfg.samplingRate / DECIMATED_MIN_SAMPLE_RATE));
+        }
+        if (context->decimationFactor > 1) {
+            context->decimator = std::make_shared<Decimator>(
+                    context->decimationFactor, context->param.hapticChannelCount);
+            context->interpolator = std::make_shared<Interpolator>(
+                    context->decimationFactor, context->param.hapticChannelCount);
+        } else {
+            context->decimator = nullptr;
+            context->interpolator = nullptr;
+        }
+
         HapticGenerator_buildProcessingChain(context->processingChain,
+                                             context->lowRateProcessingChain,
+                                             context->postProcessingChain,
                                              context->processorsRecord,
                                              config->inputCfg.samplingRate,
+                                             context->decimationFactor,
                                              &context->param);
     }
     return 0;
@@ -303,6 +363,10 @@ int HapticGenerator_Reset(struct HapticGeneratorContext *context) {
     for (auto& distortion : context->processorsRecord.distortions) {
         distortion->clear();
     }
+    if (context->decimator != nullptr) {
+        context->decimator->clear();
+        context->interpolator->clear();
+    }
     return 0;
 }
 
@@ -349,18 +413,22 @@ int HapticGenerator_SetParameter(struct HapticGeneratorContext *context,
               context->param.resonantFrequency, context->param.bsfZeroQ, context->param.bsfPoleQ,
               context->param.maxHapticAmplitude);
 
+        // The band-pass and band-stop filters run at the reduced rate when decimating.
+        const float sampleRate =
+                (float) context->config.inputCfg.samplingRate / context->decimationFactor;
         if (context->processorsRecord.bpf != nullptr) {
             context->processorsRecord.bpf->setCoefficients(
-                    bpfCoefs(context->param.resonantFrequency,
-                             context->param.bpfQ,
-                             context->config.inputCfg.samplingRate));
+                    HapticGenerator_bpfCoefs(context->param.resonantFrequency,
+                                             context->param.bpfQ,
+                                             sampleRate,
+                                             context->decimationFactor));
         }
         if (context->processorsRecord.bsf != nullptr) {
             context->processorsRecord.bsf->setCoefficients(
                     bsfCoefs(context->param.resonantFrequency,
                              context->param.bsfZeroQ,
                              context->param.bsfPoleQ,
-                             context->config.inputCfg.samplingRate));
+                             sampleRate));
         }
         HapticGenerator_Reset(context);
     } break;
@@ -505,6 +573,25 @@ int32_t HapticGenerator_Process(effect_handle_t self,
     float* hapticOutBuffer = HapticGenerator_runProcessingChain(
             context->processingChain, context->inputBuffer.data(),
             context->outputBuffer.data(), inBuffer->frameCount);
+    if (context->decimator != nullptr) {
+        const size_t lowRateSampleCount =
+                (inBuffer->frameCount / context->decimationFactor + 1)
+                * context->param.hapticChannelCount;
+        if (lowRateSampleCount > context->lowRateInputBuffer.size()) {
+            context->lowRateInputBuffer.resize(lowRateSampleCount);
+            context->lowRateOutputBuffer.resize(lowRateSampleCount);
+        }
+        const size_t lowRateFrameCount = context->decimator->process(
+                context->lowRateInputBuffer.data(), hapticOutBuffer, inBuffer->frameCount);
+        const float* lowRateOutBuffer = HapticGenerator_runProcessingChain(
+                context->lowRateProcessingChain, context->lowRateInputBuffer.data(),
+                context->lowRateOutputBuffer.data(), lowRateFrameCount);
+        context->interpolator->process(hapticOutBuffer, lowRateOutBuffer, inBuffer->frameCount);
+        float* otherBuffer = hapticOutBuffer == context->inputBuffer.data()
+                ? context->outputBuffer.data() : context->inputBuffer.data();
+        hapticOutBuffer = HapticGenerator_runProcessingChain(
+                context->postProcessingChain, hapticOutBuffer, otherBuffer, inBuffer->frameCount);
+    }
         os::scaleHapticData(hapticOutBuffer, hapticSampleCount,
                             { /*level=*/context->param.maxHapticIntensity},
                             context->param.maxHapticAmplitude);
@@ -62,6 +62,9 @@ struct HapticGeneratorParam {
     float distortionInputGain;
     float distortionCubeThreshold;
     float distortionOutputGain;
+
+    // Whether to run the band-limited part of the processing chain at a reduced sample rate.
+    bool decimatedProcessing;
 };
 
 // A structure to keep all shared pointers for all processors in HapticGenerator.
@@ -93,6 +96,16 @@ struct HapticGeneratorContext {
     // input buffer and frame count.
     std::vector<std::function<void(float*, const float*, size_t)>> processingChain;
 
+    // In decimated processing, the processing chain is followed by the decimator, the
+    // lowRateProcessingChain running at the audio sample rate divided by decimationFactor, the
+    // interpolator, and the postProcessingChain of the nonlinear processors, back at the audio
+    // sample rate. Otherwise decimationFactor is 1 and the other two chains are empty.
+    size_t decimationFactor = 1;
+    std::vector<std::function<void(float*, const float*, size_t)>> lowRateProcessingChain;
+    std::vector<std::function<void(float*, const float*, size_t)>> postProcessingChain;
+    std::shared_ptr<Decimator> decimator;
+    std::shared_ptr<Interpolator> interpolator;
+
     // inputBuffer is where to keep input buffer for the generating algorithm. It will be
     // constructed according to HapticGeneratorParam.hapticChannelSource.
     std::vector<float> inputBuffer;
@@ -100,6 +113,10 @@ struct HapticGeneratorContext {
     // outputBuffer is a buffer having the same length as inputBuffer. It can be used as
     // intermediate buffer in the generating algorithm.
     std::vector<float> outputBuffer;
+
+    // The buffers for lowRateProcessingChain, same as inputBuffer and outputBuffer.
+    std::vector<float> lowRateInputBuffer;
+    std::vector<float> lowRateOutputBuffer;
 };
 
 //-----------------------------------------------------------------------------
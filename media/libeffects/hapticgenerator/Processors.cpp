@@ -20,6 +20,7 @@
 
 #include <assert.h>
 
+#include <algorithm>
 #include <cmath>
 
 #include "Processors.h"
@@ -168,9 +169,131 @@ void Distortion::clear() {
     mLpf->clear();
 }
 
+// Implementation of Decimator
+
+Decimator::Decimator(size_t factor, size_t channelCount)
+        : mFactor(factor),
+          mChannelCount(channelCount),
+          mCoefs(resamplerCoefs(factor)),
+          mHistory(2 * mCoefs.size() * channelCount) {}
+
+size_t Decimator::process(float *out, const float *in, size_t frameCount) {
+    const size_t length = mCoefs.size();
+    size_t outFrameCount = 0;
+    for (size_t i = 0; i < frameCount; ++i) {
+        for (size_t c = 0; c < mChannelCount; ++c) {
+            mHistory[mHistoryIdx * mChannelCount + c] = *in;
+            mHistory[(mHistoryIdx + length) * mChannelCount + c] = *in;
+            in++;
+        }
+        mHistoryIdx = mHistoryIdx + 1 == length ? 0 : mHistoryIdx + 1;
+        if (++mPhase < mFactor) {
+            continue;
+        }
+        mPhase = 0;
+        // The coefficients are symmetric, so the order of the frames does not matter.
+        const float *history = &mHistory[mHistoryIdx * mChannelCount];
+        for (size_t c = 0; c < mChannelCount; ++c) {
+            float acc = 0.0f;
+            for (size_t j = 0; j < length; ++j) {
+                acc += mCoefs[j] * history[j * mChannelCount + c];
+            }
+            *out++ = acc;
+        }
+        ++outFrameCount;
+    }
+    return outFrameCount;
+}
+
+void Decimator::clear() {
+    std::fill(mHistory.begin(), mHistory.end(), 0.0f);
+    mHistoryIdx = 0;
+    mPhase = 0;
+}
+
+// Implementation of Interpolator
+
+Interpolator::Interpolator(size_t factor, size_t channelCount)
+        : mFactor(factor),
+          mChannelCount(channelCount),
+          mTaps(kResamplerTapsPerPhase),
+          mPhaseCoefs(factor * kResamplerTapsPerPhase),
+          mHistory(2 * kResamplerTapsPerPhase * channelCount) {
+    // Sub filter p applies to the frame written p frames after the last input frame.
+    // It is scaled by the factor to make up for the frames that are not input.
+    const std::vector<float> coefs = resamplerCoefs(factor);
+    for (size_t p = 0; p < factor; ++p) {
+        for (size_t k = 0; k < mTaps; ++k) {
+            // the history is oldest first, so tap k applies to history frame mTaps - 1 - k
+            mPhaseCoefs[p * mTaps + mTaps - 1 - k] = factor * coefs[p + k * factor];
+        }
+    }
+}
+
+void Interpolator::process(float *out, const float *in, size_t frameCount) {
+    for (size_t i = 0; i < frameCount; ++i) {
+        if (++mPhase == mFactor) {
+            mPhase = 0;
+            for (size_t c = 0; c < mChannelCount; ++c) {
+                mHistory[mHistoryIdx * mChannelCount + c] = *in;
+                mHistory[(mHistoryIdx + mTaps) * mChannelCount + c] = *in;
+                in++;
+            }
+            mHistoryIdx = mHistoryIdx + 1 == mTaps ? 0 : mHistoryIdx + 1;
+        }
+        const float *coefs = &mPhaseCoefs[mPhase * mTaps];
+        const float *history = &mHistory[mHistoryIdx * mChannelCount];
+        for (size_t c = 0; c < mChannelCount; ++c) {
+            float acc = 0.0f;
+            for (size_t j = 0; j < mTaps; ++j) {
+                acc += coefs[j] * history[j * mChannelCount + c];
+            }
+            *out++ = acc;
+        }
+    }
+}
+
+void Interpolator::clear() {
+    std::fill(mHistory.begin(), mHistory.end(), 0.0f);
+    mHistoryIdx = 0;
+    mPhase = 0;
+}
 
 // Implementation of helper functions
 
+std::vector<float> resamplerCoefs(size_t factor) {
+    // The cutoff is below the reduced nyquist, the transition band aliases onto frequencies
+    // which the haptic generator filters out at the reduced rate anyway.
+    constexpr double kCutoff = 0.425;   // of the reduced sample rate
+    constexpr double kKaiserBeta = 5.65; // about 60 dB stop band attenuation
+    const auto besselI0 = [](double x) {
+        double sum = 1.0;
+        double term = 1.0;
+        for (int k = 1; k < 32; ++k) {
+            term *= (x / (2 * k)) * (x / (2 * k));
+            sum += term;
+        }
+        return sum;
+    };
+    const size_t length = factor * kResamplerTapsPerPhase;
+    const double fc = kCutoff / factor;
+    const double center = (length - 1) / 2.0;
+    std::vector<double> coefs(length);
+    double sum = 0.0;
+    for (size_t n = 0; n < length; ++n) {
+        const double t = n - center;
+        const double sinc = t == 0.0 ? 2 * fc : sin(2 * M_PI * fc * t) / (M_PI * t);
+        const double r = t / (center + 1);
+        coefs[n] = sinc * besselI0(kKaiserBeta * sqrt(1 - r * r)) / besselI0(kKaiserBeta);
+        sum += coefs[n];
+    }
+    std::vector<float> result(length);
+    for (size_t n = 0; n < length; ++n) {
+        result[n] = coefs[n] / sum;
+    }
+    return result;
+}
+
 BiquadFilterCoefficients cascadeFirstOrderFilters(const BiquadFilterCoefficients &coefs1,
                                                    const BiquadFilterCoefficients &coefs2) {
     assert(coefs1[2] == 0.0f);
@@ -90,8 +90,58 @@ private:
     const size_t mChannelCount;
 };
 
+// A class providing a polyphase FIR decimator, which reduces the sample rate by an integer factor.
+// The frames are filtered by resamplerCoefs() and only the kept frames are computed.
+class Decimator {
+public:
+    Decimator(size_t factor, size_t channelCount);
+
+    // Returns the number of frames written to out, which is at most frameCount / factor + 1.
+    size_t process(float *out, const float *in, size_t frameCount);
+
+    void clear();
+
+private:
+    const size_t mFactor;
+    const size_t mChannelCount;
+    const std::vector<float> mCoefs;
+    // The last mCoefs.size() frames, stored twice so that they are contiguous from mHistoryIdx.
+    std::vector<float> mHistory;
+    size_t mHistoryIdx = 0;
+    size_t mPhase = 0;
+};
+
+// A class providing a polyphase FIR interpolator, the counterpart of Decimator.
+// process() reads a frame of in each time a Decimator with the same factor would have written
+// one, so a Decimator and an Interpolator processing the same frame counts stay aligned.
+class Interpolator {
+public:
+    Interpolator(size_t factor, size_t channelCount);
+
+    // Writes frameCount frames to out.
+    void process(float *out, const float *in, size_t frameCount);
+
+    void clear();
+
+private:
+    const size_t mFactor;
+    const size_t mChannelCount;
+    const size_t mTaps;
+    // mFactor sub filters of mTaps coefficients, in history order.
+    std::vector<float> mPhaseCoefs;
+    // The last mTaps frames of in, stored twice so that they are contiguous from mHistoryIdx.
+    std::vector<float> mHistory;
+    size_t mHistoryIdx = 0;
+    size_t mPhase = 0;
+};
+
 // Helper functions
 
+// Low pass filter for decimating or interpolating by factor: a Kaiser windowed sinc with
+// kResamplerTapsPerPhase taps per phase and unity gain at DC.
+constexpr size_t kResamplerTapsPerPhase = 8;
+std::vector<float> resamplerCoefs(size_t factor);
+
 BiquadFilterCoefficients cascadeFirstOrderFilters(const BiquadFilterCoefficients &coefs1,
                                                   const BiquadFilterCoefficients &coefs2);
 
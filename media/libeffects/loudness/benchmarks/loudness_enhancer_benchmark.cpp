@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <math.h>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "dsp/core/dynamic_range_compression.h"
+
+// The effect processes stereo float, scaled to the int16_t range of the compressor
+constexpr size_t kSampleRate = 48000;
+constexpr float kScale = 1 << 15;
+constexpr float kInverseScale = 1.f / kScale;
+constexpr float kTargetGainmB = 1500;
+
+/*******************************************************************
+ * The first parameter is the frame count.
+ * The second parameter selects the compressor:
+ * 0: per frame Compress(), 1: CompressBlock()
+ *******************************************************************/
+static void BM_LOUDNESS_ENHANCER(benchmark::State& state) {
+    const size_t frameCount = state.range(0);
+    const bool block = state.range(1) != 0;
+
+    const float targetAmp = pow(10, kTargetGainmB / 2000.0f);
+    const float inputAmp = targetAmp * kScale;
+    le_fx::AdaptiveDynamicRangeCompression compressor;
+    compressor.Initialize(targetAmp, kSampleRate);
+
+    // Initialize input buffer with deterministic pseudo-random values
+    std::minstd_rand gen(frameCount);
+    std::uniform_real_distribution<> dis(-1.0f, 1.0f);
+    std::vector<float> input(frameCount * 2);
+    for (auto& in : input) {
+        in = dis(gen);
+    }
+    std::vector<float> buffer(input.size());
+
+    // Run the test
+    for (auto _ : state) {
+        // The compressor works in place, and would converge on its own output
+        buffer = input;
+        benchmark::DoNotOptimize(buffer.data());
+
+        if (block) {
+            compressor.CompressBlock(buffer.data(), frameCount, inputAmp, kInverseScale);
+        } else {
+            for (size_t i = 0; i < buffer.size(); i += 2) {
+                float left = inputAmp * buffer[i];
+                float right = inputAmp * buffer[i + 1];
+                compressor.Compress(&left, &right);
+                buffer[i] = left * kInverseScale;
+                buffer[i + 1] = right * kInverseScale;
+            }
+        }
+
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations() * frameCount);
+}
+
+static void LoudnessEnhancerArgs(benchmark::internal::Benchmark* b) {
+    for (int frameCount : {240, 441, 480, 960}) {
+        for (int block : {0, 1}) {
+            b->Args({frameCount, block});
+        }
+    }
+}
+
+BENCHMARK(BM_LOUDNESS_ENHANCER)->Apply(LoudnessEnhancerArgs);
+
+BENCHMARK_MAIN();
@@ -15,6 +15,8 @@
  */
 //#define LOG_NDEBUG 0
 
+#include <string.h>
+
 #include <cmath>
 
 #include "common/core/math.h"
@@ -134,5 +136,119 @@ void AdaptiveDynamicRangeCompression::Compress(float *x1, float *x2) {
   }
 }
 
+namespace {
+
+typedef float float_x4 __attribute__((vector_size(4 * sizeof(float))));
+typedef int32_t int32_x4 __attribute__((vector_size(4 * sizeof(int32_t))));
+
+// The samples are not aligned on a vector boundary
+inline float_x4 load_x4(const float *p) {
+  float_x4 v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline void store_x4(float *p, const float_x4 &v) {
+  memcpy(p, &v, sizeof(v));
+}
+
+inline float_x4 broadcast_x4(float x) {
+  return float_x4{x, x, x, x};
+}
+
+inline float_x4 select_x4(const int32_x4 &mask, const float_x4 &a,
+                          const float_x4 &b) {
+  return reinterpret_cast<float_x4>((reinterpret_cast<int32_x4>(a) & mask) |
+                                    (reinterpret_cast<int32_x4>(b) & ~mask));
+}
+
+inline float_x4 abs_x4(const float_x4 &v) {
+  return reinterpret_cast<float_x4>(reinterpret_cast<int32_x4>(v) & 0x7fffffff);
+}
+
+inline float_x4 max_x4(const float_x4 &a, const float_x4 &b) {
+  return select_x4(a > b, a, b);
+}
+
+inline float_x4 min_x4(const float_x4 &a, const float_x4 &b) {
+  return select_x4(a < b, a, b);
+}
+
+// math::fast_log(.) on four values
+inline float_x4 fast_log_x4(const float_x4 &val) {
+  int32_x4 x = reinterpret_cast<int32_x4>(val);
+  const float_x4 log_2 = __builtin_convertvector(((x >> 23) & 255) - 128, float_x4);
+  x &= ~(255 << 23);
+  x += 127 << 23;
+  const float_x4 m = reinterpret_cast<float_x4>(x);
+  return (((-1.0f / 3) * m + 2) * m - 2.0f / 3 + log_2) *
+      0.693147180559945286226763982995180413126945495605468750f;
+}
+
+}  // namespace
+
+void AdaptiveDynamicRangeCompression::UpdateState(float cv) {
+  if (cv <= state_) {
+    state_ = alpha_attack_ * state_ + (1.0f - alpha_attack_) * cv;
+  } else {
+    state_ = alpha_release_ * state_ + (1.0f - alpha_release_) * cv;
+  }
+}
+
+void AdaptiveDynamicRangeCompression::CompressBlock(float *x, size_t frame_count,
+                                                    float input_gain,
+                                                    float output_gain) {
+  const float_x4 min_abs_x = broadcast_x4(kMinLogAbsValue);
+  const float_x4 limit = broadcast_x4(kFixedPointLimit);
+  while (frame_count > 0) {
+    const size_t block_size = std::min(frame_count, kGainBlockSize);
+    const size_t pair_count = block_size / 2;
+
+    // The envelope detector runs on every frame as in Compress(.), with the
+    // logarithm of two frames computed at once
+    const float prev_state = state_;
+    for (size_t i = 0; i < pair_count; ++i) {
+      const float_x4 abs_x =
+          max_x4(abs_x4(load_x4(x + 4 * i)) * input_gain, min_abs_x);
+      const float_x4 cv =
+          max_x4(fast_log_x4(abs_x) - knee_threshold_, float_x4{}) * slope_;
+      // The control value of the louder channel is the smaller one
+      UpdateState(std::min(cv[0], cv[1]));
+      UpdateState(std::min(cv[2], cv[3]));
+    }
+    if (block_size & 1) {
+      const float *last = x + 2 * block_size - 2;
+      const float max_abs_x =
+          std::max(std::max(std::fabs(last[0]), std::fabs(last[1])) * input_gain,
+                   kMinLogAbsValue);
+      UpdateState(std::max(math::fast_log(max_abs_x) - knee_threshold_, 0.0f) *
+                  slope_);
+    }
+
+    // The gain is only evaluated at the end of the block, and ramps linearly
+    // from the end of the previous block
+    const float start_gain = compressor_gain_;
+    compressor_gain_ *= expf(state_ - prev_state);
+    const float step = (compressor_gain_ - start_gain) / block_size;
+    float_x4 gain = {start_gain + step, start_gain + step,
+                     start_gain + 2 * step, start_gain + 2 * step};
+    const float_x4 gain_step = broadcast_x4(2 * step);
+    for (size_t i = 0; i < pair_count; ++i) {
+      const float_x4 y = load_x4(x + 4 * i) * input_gain * gain;
+      store_x4(x + 4 * i, max_x4(min_x4(y, limit), -limit) * output_gain);
+      gain += gain_step;
+    }
+    if (block_size & 1) {
+      for (size_t c = 2 * block_size - 2; c < 2 * block_size; ++c) {
+        const float y = x[c] * input_gain * compressor_gain_;
+        x[c] = std::max(std::min(y, kFixedPointLimit), -kFixedPointLimit) *
+               output_gain;
+      }
+    }
+    x += 2 * block_size;
+    frame_count -= block_size;
+  }
+}
+
 }  // namespace le_fx
 
@@ -23,6 +23,8 @@
 #include "dsp/core/basic.h"
 #include "dsp/core/interpolation.h"
 
+#include <stddef.h>
+
 #include <android/log.h>
 
 namespace le_fx {
@@ -58,6 +60,17 @@ class AdaptiveDynamicRangeCompression {
   // Stereo channel version of the compressor
   void Compress(float *x1, float *x2);
 
+  // Block version of the stereo compressor, for `frame_count` interleaved stereo
+  // frames, in place. The input is scaled by `input_gain` before compression and
+  // the output by `output_gain` after the fixed-point limit.
+  //
+  // The envelope detector runs on every frame, but the gain is only evaluated
+  // every kGainBlockSize frames and linearly interpolated in between, so the
+  // exp(.) is computed once per block instead of once per frame. The frames
+  // are processed two at a time with SIMD.
+  void CompressBlock(float *x, size_t frame_count, float input_gain,
+                     float output_gain);
+
   // This version is slower than Compress(.) but faster than CompressSlow(.)
   float CompressNormalSpeed(float x);
 
@@ -91,6 +104,11 @@ class AdaptiveDynamicRangeCompression {
   static const float kTauAttack;
   // The release time of the envelope detector
   static const float kTauRelease;
+  // The number of frames per gain update of CompressBlock(.)
+  static constexpr size_t kGainBlockSize = 16;
+
+  // Updates the envelope detector with a control value
+  void UpdateState(float cv);
 
   float sampling_rate_;
   // the internal state of the envelope detector
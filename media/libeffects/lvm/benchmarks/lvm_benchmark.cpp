@@ -16,14 +16,18 @@
 
 #include <array>
 #include <climits>
+#include <cmath>
 #include <cstdlib>
 #include <random>
 #include <vector>
 #include <log/log.h>
+#include <audio_utils/BiquadFilter.h>
 #include <benchmark/benchmark.h>
 #include <hardware/audio_effect.h>
 #include <system/audio.h>
 
+#include "BiquadCascade.h"
+
 extern audio_effect_library_t AUDIO_EFFECT_LIBRARY_INFO_SYM;
 constexpr effect_uuid_t kEffectUuids[] = {
         // NXP SW BassBoost
@@ -235,4 +239,88 @@ static void LVMArgs(benchmark::internal::Benchmark* b) {
 
 BENCHMARK(BM_LVM)->Apply(LVMArgs);
 
+/*******************************************************************
+ * The band filters of the 5-band equalizer, with every band boosted or cut.
+ * BM_EQ5/0 runs one audio_utils BiquadFilter per band and adds its scaled
+ * output to the signal, as LVEQNB_Process() used to.
+ * BM_EQ5/1 runs the same bands as one BiquadCascade pass.
+ * The second parameter is the number of channels.
+ *******************************************************************/
+
+constexpr size_t kEqBands = 5;
+constexpr float kEqFrequencies[kEqBands] = {60, 230, 910, 3600, 14000};
+constexpr float kEqGainsdB[kEqBands] = {3, -6, 9, 2, -4};
+constexpr float kEqQFactor = 0.96f;
+
+struct EqBand {
+    float A0;  // band pass gain
+    float B1;  // -b1
+    float B2;  // -b2
+    float G;   // linear gain - 1
+};
+
+static EqBand makeEqBand(size_t band) {
+    const float w = 2 * M_PI * kEqFrequencies[band] / kSampleRate;
+    const float alpha = std::sin(w) / (2 * kEqQFactor);
+    const float a0 = 1 + alpha;
+    return {alpha / a0, 2 * std::cos(w) / a0, -(1 - alpha) / a0,
+            std::pow(10.f, kEqGainsdB[band] / 20) - 1};
+}
+
+static void BM_EQ5(benchmark::State& state) {
+    const bool cascade = state.range(0) != 0;
+    const size_t channelCount = state.range(1);
+    const size_t sampleCount = kFrameCount * channelCount;
+
+    std::minstd_rand gen(channelCount);
+    std::uniform_real_distribution<> dis(-1.0f, 1.0f);
+    std::vector<float> input(sampleCount);
+    for (auto& in : input) {
+        in = dis(gen);
+    }
+    std::vector<float> output(sampleCount);
+    std::vector<float> temp(sampleCount);
+
+    std::vector<android::audio_utils::BiquadFilter<float>> biquads;
+    std::vector<float> gains;
+    std::vector<BiquadCascade::Section> sections;
+    for (size_t band = 0; band < kEqBands; ++band) {
+        const EqBand eq = makeEqBand(band);
+        const std::array<float, android::audio_utils::kBiquadNumCoefs> coefs = {
+                eq.A0, 0.0, -eq.A0, -eq.B1, -eq.B2};
+        biquads.emplace_back(channelCount, coefs);
+        gains.push_back(eq.G);
+        sections.push_back({{eq.G * eq.A0, 0.0, -eq.G * eq.A0, -eq.B1, -eq.B2}, 1.0f});
+    }
+    BiquadCascade biquadCascade(channelCount);
+    biquadCascade.setSections(sections);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(input.data());
+        if (cascade) {
+            biquadCascade.process(output.data(), input.data(), kFrameCount);
+        } else {
+            std::copy(input.begin(), input.end(), output.begin());
+            for (size_t band = 0; band < kEqBands; ++band) {
+                biquads[band].process(temp.data(), output.data(), kFrameCount);
+                for (size_t i = 0; i < sampleCount; ++i) {
+                    output[i] += temp[i] * gains[band];
+                }
+            }
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * kFrameCount);
+}
+
+static void EQ5Args(benchmark::internal::Benchmark* b) {
+    for (int cascade = 0; cascade <= 1; ++cascade) {
+        for (int channelCount : {2, 6, 8}) {
+            b->Args({cascade, channelCount});
+        }
+    }
+}
+
+BENCHMARK(BM_EQ5)->Apply(EQ5Args);
+
 BENCHMARK_MAIN();
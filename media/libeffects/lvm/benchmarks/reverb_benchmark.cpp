@@ -16,6 +16,7 @@
 
 #include <array>
 #include <climits>
+#include <cmath>
 #include <cstdlib>
 #include <random>
 #include <vector>
@@ -23,6 +24,7 @@
 #include <benchmark/benchmark.h>
 #include <hardware/audio_effect.h>
 #include <system/audio.h>
+#include "ConvolutionReverb.h"
 #include "EffectReverb.h"
 
 extern audio_effect_library_t AUDIO_EFFECT_LIBRARY_INFO_SYM;
@@ -177,4 +179,53 @@ static void REVERBArgs(benchmark::internal::Benchmark* b) {
 
 BENCHMARK(BM_REVERB)->Apply(REVERBArgs);
 
+/*******************************************************************
+ * The impulse response reverb used by the presets which have an impulse
+ * response file. The parameter is the impulse response length in seconds,
+ * the cost is to be compared with BM_REVERB/x/0 above.
+ *******************************************************************/
+
+static void BM_CONVOLUTION_REVERB(benchmark::State& state) {
+    const size_t impulseFrames = state.range(0) * kSampleRate;
+    constexpr size_t channelCount = FCC_2;
+
+    // Exponentially decaying noise, with a T60 of the impulse response length
+    std::minstd_rand gen(impulseFrames);
+    std::uniform_real_distribution<> dis(-1.0f, 1.0f);
+    std::vector<float> impulse(impulseFrames * channelCount);
+    const float decay = std::pow(1e-3f, 1.f / impulseFrames);
+    float gain = 0.1f;
+    for (size_t i = 0; i < impulseFrames; i++) {
+        for (size_t j = 0; j < channelCount; j++) {
+            impulse[i * channelCount + j] = dis(gen) * gain;
+        }
+        gain *= decay;
+    }
+    std::vector<float> input(kFrameCount * channelCount);
+    std::vector<float> output(kFrameCount * channelCount);
+    for (auto& in : input) {
+        in = dis(gen);
+    }
+
+    auto reverb = android::ConvolutionReverb::create(impulse.data(), channelCount, impulseFrames);
+    if (reverb == nullptr) {
+        ALOGE("ConvolutionReverb::create failed\n");
+        return;
+    }
+
+    // Run the test
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(input.data());
+        benchmark::DoNotOptimize(output.data());
+
+        reverb->process(input.data(), channelCount, output.data(), kFrameCount);
+
+        benchmark::ClobberMemory();
+    }
+
+    state.SetComplexityN(state.range(0));
+}
+
+BENCHMARK(BM_CONVOLUTION_REVERB)->Arg(1)->Arg(2)->Arg(4)->Arg(8);
+
 BENCHMARK_MAIN();
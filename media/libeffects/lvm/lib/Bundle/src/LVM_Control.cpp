@@ -279,11 +279,11 @@ void LVM_SetTrebleBoost(LVM_Instance_t* pInstance, LVM_ControlParams_t* pParams)
             /*
              * Create biquad instance
              */
-            std::array<LVM_FLOAT, android::audio_utils::kBiquadNumCoefs> coefs = {
-                    LVM_TrebleBoostCoefs[Offset].A0, LVM_TrebleBoostCoefs[Offset].A1, 0.0,
-                    -(LVM_TrebleBoostCoefs[Offset].B1), 0.0};
-            pInstance->pTEBiquad.reset(
-                    new android::audio_utils::BiquadFilter<LVM_FLOAT>(pParams->NrChannels, coefs));
+            const BiquadCascade::Section section = {
+                    {LVM_TrebleBoostCoefs[Offset].A0, LVM_TrebleBoostCoefs[Offset].A1, 0.0,
+                     -(LVM_TrebleBoostCoefs[Offset].B1), 0.0}};
+            pInstance->TEBiquad.setSections({section});
+            pInstance->TEBiquad.setChannelCount(pParams->NrChannels);
         }
     } else {
         /*
@@ -33,10 +33,10 @@
 /*                                                                                  */
 /************************************************************************************/
 
-#include <audio_utils/BiquadFilter.h>
 #include "LVM.h"            /* LifeVibes */
 #include "LVM_Common.h"     /* LifeVibes common */
 #include "BIQUAD.h"         /* Biquad library */
+#include "BiquadCascade.h"  /* Biquad cascade */
 #include "LVC_Mixer.h"      /* Mixer library */
 #include "LVCS_Private.h"   /* Concert Sound */
 #include "LVDBE_Private.h"  /* Dynamic Bass Enhancement */
@@ -177,8 +177,7 @@ typedef struct {
     LVM_INT16 VC_AVLFixedVolume;         /* AVL fixed volume */
 
     /* Treble Enhancement */
-    std::unique_ptr<android::audio_utils::BiquadFilter<LVM_FLOAT>>
-            pTEBiquad; /* Biquad filter instance */
+    BiquadCascade TEBiquad;    /* Biquad filter instance */
     LVM_INT16 TE_Active;       /* Control flag */
 
     /* Headroom */
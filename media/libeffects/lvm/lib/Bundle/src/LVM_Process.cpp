@@ -178,7 +178,7 @@ LVM_ReturnStatus_en LVM_Process(LVM_Handle_t hInstance, const LVM_FLOAT* pInData
                 /*
                  * Apply the filter
                  */
-                pInstance->pTEBiquad->process(pProcessed, pProcessed, NrFrames);
+                pInstance->TEBiquad.process(pProcessed, pProcessed, NrFrames);
                 for (auto i = 0; i < NrChannels * NrFrames; i++) {
                     pProcessed[i] = LVM_Clamp(pProcessed[i]);
                 }
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _BIQUAD_CASCADE_H_
+#define _BIQUAD_CASCADE_H_
+
+#include <array>
+#include <vector>
+
+#include "LVM_Types.h"
+
+/**********************************************************************************
+   BIQUAD CASCADE
+***********************************************************************************/
+
+/*
+ * A cascade of biquad sections applied to interleaved multichannel data.
+ *
+ * Each section is in transposed direct form II. For every frame, the channels are
+ * loaded into SIMD lanes (4 channels per vector, then 2, then 1) and pushed through
+ * all the sections before the frame is stored, so a cascade of N sections costs a
+ * single pass over the data instead of N.
+ *
+ * The coefficients use the audio_utils BiquadFilter convention {b0, b1, b2, a1, a2}:
+ *     h[n] = b0 * x[n] + b1 * x[n-1] + b2 * x[n-2] - a1 * h[n-1] - a2 * h[n-2]
+ * and a section outputs y[n] = dry * x[n] + h[n]. A non-zero dry gain keeps peaking
+ * filters in their "input plus scaled band pass" form, which is much less sensitive
+ * to rounding than the equivalent single biquad at low frequencies.
+ */
+class BiquadCascade {
+  public:
+    static constexpr size_t kNumCoefs = 5;
+    using Coefs = std::array<LVM_FLOAT, kNumCoefs>;
+
+    struct Section {
+        Coefs coefs;
+        LVM_FLOAT dry = 0;
+    };
+
+    BiquadCascade() = default;
+    explicit BiquadCascade(size_t channelCount);
+
+    /* Sets the number of interleaved channels, and clears the filter history */
+    void setChannelCount(size_t channelCount);
+
+    /* Replaces the sections. The history is kept if the number of sections is unchanged */
+    void setSections(const std::vector<Section>& sections);
+
+    /* Clears the filter history */
+    void clear();
+
+    size_t getSectionCount() const { return mSections.size(); }
+
+    /* Filters frameCount frames. pIn and pOut may be the same buffer */
+    void process(LVM_FLOAT* pOut, const LVM_FLOAT* pIn, size_t frameCount);
+
+  private:
+    template <typename V, size_t LANES>
+    void processLanes(LVM_FLOAT* pOut, const LVM_FLOAT* pIn, size_t frameCount,
+                      size_t channel);
+
+    size_t mChannelCount = 0;
+    std::vector<Section> mSections;
+    /* The two state variables of each section, indexed by section * mChannelCount + channel */
+    std::vector<LVM_FLOAT> mState1;
+    std::vector<LVM_FLOAT> mState2;
+};
+
+#endif /* _BIQUAD_CASCADE_H_ */
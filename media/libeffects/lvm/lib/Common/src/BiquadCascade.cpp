@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <algorithm>
+#include <type_traits>
+
+#include "BiquadCascade.h"
+
+namespace {
+
+/* Channel lanes, mapped by the compiler onto NEON or SSE registers */
+typedef LVM_FLOAT LVM_FLOAT_x2 __attribute__((vector_size(2 * sizeof(LVM_FLOAT))));
+typedef LVM_FLOAT LVM_FLOAT_x4 __attribute__((vector_size(4 * sizeof(LVM_FLOAT))));
+
+/* Sections are processed in passes of at most this many, so their state stays in registers */
+constexpr size_t kSectionsPerPass = 8;
+
+template <typename V>
+inline V broadcast(LVM_FLOAT value) {
+    if constexpr (std::is_same_v<V, LVM_FLOAT>) {
+        return value;
+    } else {
+        V v;
+        for (size_t i = 0; i < sizeof(V) / sizeof(LVM_FLOAT); ++i) {
+            v[i] = value;
+        }
+        return v;
+    }
+}
+
+/* Interleaved frames are not aligned on a vector boundary */
+template <typename V>
+inline V load(const LVM_FLOAT* p) {
+    V v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+template <typename V>
+inline void store(LVM_FLOAT* p, const V& v) {
+    memcpy(p, &v, sizeof(v));
+}
+
+}  // namespace
+
+BiquadCascade::BiquadCascade(size_t channelCount) : mChannelCount(channelCount) {}
+
+void BiquadCascade::setChannelCount(size_t channelCount) {
+    mChannelCount = channelCount;
+    mState1.assign(mSections.size() * mChannelCount, 0);
+    mState2.assign(mSections.size() * mChannelCount, 0);
+}
+
+void BiquadCascade::setSections(const std::vector<Section>& sections) {
+    const bool keepState = sections.size() == mSections.size();
+    mSections = sections;
+    if (!keepState) {
+        clear();
+    }
+}
+
+void BiquadCascade::clear() {
+    mState1.assign(mSections.size() * mChannelCount, 0);
+    mState2.assign(mSections.size() * mChannelCount, 0);
+}
+
+void BiquadCascade::process(LVM_FLOAT* pOut, const LVM_FLOAT* pIn, size_t frameCount) {
+    if (mSections.empty()) {
+        if (pOut != pIn) {
+            memcpy(pOut, pIn, frameCount * mChannelCount * sizeof(LVM_FLOAT));
+        }
+        return;
+    }
+    size_t channel = 0;
+    for (; channel + 4 <= mChannelCount; channel += 4) {
+        processLanes<LVM_FLOAT_x4, 4>(pOut, pIn, frameCount, channel);
+    }
+    if (channel + 2 <= mChannelCount) {
+        processLanes<LVM_FLOAT_x2, 2>(pOut, pIn, frameCount, channel);
+        channel += 2;
+    }
+    if (channel < mChannelCount) {
+        processLanes<LVM_FLOAT, 1>(pOut, pIn, frameCount, channel);
+    }
+}
+
+/*
+ * Filters LANES channels starting at channel through all the sections.
+ * Each channel is only read and written by this call, so in place processing is safe.
+ */
+template <typename V, size_t LANES>
+void BiquadCascade::processLanes(LVM_FLOAT* pOut, const LVM_FLOAT* pIn, size_t frameCount,
+                                 size_t channel) {
+    const size_t sectionCount = mSections.size();
+    for (size_t first = 0; first < sectionCount; first += kSectionsPerPass) {
+        const size_t count = std::min(kSectionsPerPass, sectionCount - first);
+        V b0[kSectionsPerPass], b1[kSectionsPerPass], b2[kSectionsPerPass];
+        V a1[kSectionsPerPass], a2[kSectionsPerPass], dry[kSectionsPerPass];
+        V s1[kSectionsPerPass], s2[kSectionsPerPass];
+        for (size_t i = 0; i < count; ++i) {
+            const Coefs& coefs = mSections[first + i].coefs;
+            b0[i] = broadcast<V>(coefs[0]);
+            b1[i] = broadcast<V>(coefs[1]);
+            b2[i] = broadcast<V>(coefs[2]);
+            a1[i] = broadcast<V>(coefs[3]);
+            a2[i] = broadcast<V>(coefs[4]);
+            dry[i] = broadcast<V>(mSections[first + i].dry);
+            s1[i] = load<V>(&mState1[(first + i) * mChannelCount + channel]);
+            s2[i] = load<V>(&mState2[(first + i) * mChannelCount + channel]);
+        }
+
+        /* the passes after the first one filter the output of the previous pass */
+        const LVM_FLOAT* in = (first == 0 ? pIn : pOut) + channel;
+        LVM_FLOAT* out = pOut + channel;
+        for (size_t frame = 0; frame < frameCount; ++frame) {
+            V x = load<V>(in);
+            for (size_t i = 0; i < count; ++i) {
+                const V h = b0[i] * x + s1[i];
+                s1[i] = b1[i] * x - a1[i] * h + s2[i];
+                s2[i] = b2[i] * x - a2[i] * h;
+                x = dry[i] * x + h;
+            }
+            store(out, x);
+            in += mChannelCount;
+            out += mChannelCount;
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            store(&mState1[(first + i) * mChannelCount + channel], s1[i]);
+            store(&mState2[(first + i) * mChannelCount + channel], s2[i]);
+        }
+    }
+    static_assert(sizeof(V) == LANES * sizeof(LVM_FLOAT));
+}
@@ -177,12 +177,18 @@ void LVEQNB_SetFilters(LVEQNB_Instance_t* pInstance, LVEQNB_Params_t* pParams) {
 void LVEQNB_SetCoefficients(LVEQNB_Instance_t* pInstance) {
     LVM_UINT16 i;                    /* Filter band index */
     LVEQNB_BiquadType_en BiquadType; /* Filter biquad type */
+    std::vector<BiquadCascade::Section> sections;
 
-    pInstance->gain.resize(pInstance->Params.NBands);
     /*
      * Set the coefficients for each band by the init function
      */
     for (i = 0; i < pInstance->Params.NBands; i++) {
+        /*
+         * Bands with a 0dB gain are not processed
+         */
+        if (pInstance->pBandDefinitions[i].Gain == 0) {
+            continue;
+        }
         /*
          * Check band type for correct initialisation method and recalculate the coefficients
          */
@@ -196,22 +202,19 @@ void LVEQNB_SetCoefficients(LVEQNB_Instance_t* pInstance) {
                 LVEQNB_SinglePrecCoefs((LVM_UINT16)pInstance->Params.SampleRate,
                                        &pInstance->pBandDefinitions[i], &Coefficients);
                 /*
-                 * Set the coefficients
+                 * The band adds G times the band pass filter to its input
                  */
-                pInstance->gain[i] = Coefficients.G;
-                std::array<LVM_FLOAT, android::audio_utils::kBiquadNumCoefs> coefs = {
-                        Coefficients.A0, 0.0, -(Coefficients.A0), -(Coefficients.B1),
-                        -(Coefficients.B2)};
-                pInstance->eqBiquad[i]
-                        .setCoefficients<
-                                std::array<LVM_FLOAT, android::audio_utils::kBiquadNumCoefs>>(
-                                coefs);
+                const LVM_FLOAT gainA0 = Coefficients.G * Coefficients.A0;
+                sections.push_back({{gainA0, 0.0, -gainA0, -(Coefficients.B1),
+                                     -(Coefficients.B2)},
+                                    1.0f /* dry */});
                 break;
             }
             default:
                 break;
         }
     }
+    pInstance->eqBiquads.setSections(sections);
 }
 
 /************************************************************************************/
@@ -226,9 +229,7 @@ void LVEQNB_SetCoefficients(LVEQNB_Instance_t* pInstance) {
 /*                                                                                  */
 /************************************************************************************/
 void LVEQNB_ClearFilterHistory(LVEQNB_Instance_t* pInstance) {
-    for (size_t i = 0; i < pInstance->eqBiquad.size(); i++) {
-        pInstance->eqBiquad[i].clear();
-    }
+    pInstance->eqBiquads.clear();
 }
 /****************************************************************************************/
 /*                                                                                      */
@@ -307,12 +308,10 @@ LVEQNB_ReturnStatus_en LVEQNB_Control(LVEQNB_Handle_t hInstance, LVEQNB_Params_t
              LVC_Mixer_GetTarget(&pInstance->BypassMixer.MixerStream[0]) == 0);
 
     /*
-     * Create biquad instance
+     * Resize the filter history
      */
     if (pParams->NrChannels != pInstance->Params.NrChannels) {
-        pInstance->eqBiquad.clear();
-        pInstance->eqBiquad.resize(pParams->NBands,
-                           android::audio_utils::BiquadFilter<LVM_FLOAT>(pParams->NrChannels));
+        pInstance->eqBiquads.setChannelCount(pParams->NrChannels);
     }
     if (bChange || modeChange) {
         LVEQNB_ClearFilterHistory(pInstance);
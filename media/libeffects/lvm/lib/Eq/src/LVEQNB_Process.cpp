@@ -93,32 +93,10 @@ LVEQNB_ReturnStatus_en LVEQNB_Process(
                    (LVM_INT16)NrSamples);
 
         /*
-         * For each section execte the filter unless the gain is 0dB
+         * Filter all the bands with a non-zero gain in a single pass
          */
         if (pInstance->NBands != 0) {
-            for (LVM_UINT16 i = 0; i < pInstance->NBands; i++) {
-                /*
-                 * Check if band is non-zero dB gain
-                 */
-                if (pInstance->pBandDefinitions[i].Gain != 0) {
-                    /*
-                     * Select single or double precision as required
-                     */
-                    switch (pInstance->pBiquadType[i]) {
-                        case LVEQNB_SinglePrecision_Float: {
-                            LVM_FLOAT* pTemp = pScratch + NrSamples;
-                            pInstance->eqBiquad[i].process(pTemp, pScratch, NrFrames);
-                            const auto gain = pInstance->gain[i];
-                            for (unsigned j = 0; j < NrSamples; ++j) {
-                                pScratch[j] += pTemp[j] * gain;
-                            }
-                            break;
-                        }
-                        default:
-                            break;
-                    }
-                }
-            }
+            pInstance->eqBiquads.process(pScratch, pScratch, NrFrames);
         }
 
         if (pInstance->bInOperatingModeTransition == LVM_TRUE) {
@@ -0,0 +1,122 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include <ConvolutionReverb.h>
+#include <gtest/gtest.h>
+
+using namespace android;
+
+// impulse response frames, impulse response channels, input channels, frames per process() call
+using ConvolutionReverbTestParam = std::tuple<size_t, size_t, size_t, size_t>;
+
+class ConvolutionReverbTest : public ::testing::TestWithParam<ConvolutionReverbTestParam> {
+  public:
+    ConvolutionReverbTest()
+        : mImpulseFrames(std::get<0>(GetParam())),
+          mImpulseChannels(std::get<1>(GetParam())),
+          mInChannels(std::get<2>(GetParam())),
+          mChunkFrames(std::get<3>(GetParam())) {}
+
+  protected:
+    static constexpr size_t kOutChannels = 2;
+
+    // the reverb output, computed as a direct convolution of the mono input
+    std::vector<float> directConvolution(const std::vector<float>& impulse,
+                                         const std::vector<float>& in, size_t frameCount) const {
+        std::vector<float> out(frameCount * kOutChannels);
+        for (size_t n = ConvolutionReverb::kHeadBlockSize; n < frameCount; ++n) {
+            // the reverb latency is kHeadBlockSize frames
+            const size_t last = n - ConvolutionReverb::kHeadBlockSize;
+            for (size_t channel = 0; channel < kOutChannels; ++channel) {
+                const size_t source = std::min(channel, mImpulseChannels - 1);
+                double sum = 0;
+                for (size_t k = 0; k < mImpulseFrames && k <= last; ++k) {
+                    sum += impulse[k * mImpulseChannels + source] * monoInput(in, last - k);
+                }
+                out[n * kOutChannels + channel] = sum;
+            }
+        }
+        return out;
+    }
+
+    double monoInput(const std::vector<float>& in, size_t frame) const {
+        if (mInChannels == 1) return in[frame];
+        return (in[2 * frame] + in[2 * frame + 1]) * 0.5;
+    }
+
+    const size_t mImpulseFrames;
+    const size_t mImpulseChannels;
+    const size_t mInChannels;
+    const size_t mChunkFrames;
+};
+
+TEST_P(ConvolutionReverbTest, MatchesDirectConvolution) {
+    std::minstd_rand gen(mImpulseFrames);
+    std::uniform_real_distribution<float> dis(-1.f, 1.f);
+
+    // a noise impulse response with an exponential decay, like a room
+    std::vector<float> impulse(mImpulseFrames * mImpulseChannels);
+    for (size_t i = 0; i < impulse.size(); ++i) {
+        const size_t frame = i / mImpulseChannels;
+        impulse[i] = dis(gen) * std::exp(-4.f * frame / mImpulseFrames);
+    }
+    // enough input for every partition of the impulse response to contribute
+    const size_t frameCount = mImpulseFrames + 2 * ConvolutionReverb::kTailBlockSize;
+    std::vector<float> in(frameCount * mInChannels);
+    std::generate(in.begin(), in.end(), [&] { return dis(gen); });
+
+    auto reverb = ConvolutionReverb::create(impulse.data(), mImpulseChannels, mImpulseFrames);
+    ASSERT_NE(nullptr, reverb);
+    EXPECT_EQ(mImpulseFrames + ConvolutionReverb::kHeadBlockSize, reverb->getTailFrames());
+
+    std::vector<float> out(frameCount * kOutChannels);
+    for (size_t frame = 0; frame < frameCount; frame += mChunkFrames) {
+        const size_t count = std::min(mChunkFrames, frameCount - frame);
+        reverb->process(in.data() + frame * mInChannels, mInChannels,
+                        out.data() + frame * kOutChannels, count);
+    }
+
+    const std::vector<float> expected = directConvolution(impulse, in, frameCount);
+    float peak = 0.f;
+    for (float sample : expected) peak = std::max(peak, std::abs(sample));
+    ASSERT_GT(peak, 0.f);
+    for (size_t i = 0; i < out.size(); ++i) {
+        ASSERT_NEAR(expected[i], out[i], peak * 1e-4f)
+                << "frame " << i / kOutChannels << " channel " << i % kOutChannels;
+    }
+
+    // after a reset, the same input gives the same output
+    reverb->reset();
+    std::vector<float> again(frameCount * kOutChannels);
+    reverb->process(in.data(), mInChannels, again.data(), frameCount);
+    EXPECT_EQ(out, again);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+        ConvolutionReverbTestAll, ConvolutionReverbTest,
+        ::testing::Combine(
+                // head only, exactly the head, and head plus tail partitions
+                ::testing::Values(100, ConvolutionReverb::kTailOffset,
+                                  3 * ConvolutionReverb::kTailBlockSize + 77),
+                ::testing::Values(1, 2),  // mono and stereo impulse responses
+                ::testing::Values(1, 2),  // mono and stereo input
+                ::testing::Values(37, 480)));
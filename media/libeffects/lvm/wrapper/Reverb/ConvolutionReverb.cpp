@@ -0,0 +1,393 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "ConvolutionReverb"
+//#define LOG_NDEBUG 0
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+
+#include <audio_utils/primitives.h>
+#include <log/log.h>
+
+#include "ConvolutionReverb.h"
+
+namespace android {
+namespace {
+
+constexpr uint16_t kWavFormatPcm = 1;
+constexpr uint16_t kWavFormatFloat = 3;
+constexpr uint16_t kWavFormatExtensible = 0xfffe;
+
+struct WavData {
+    uint16_t format = 0;
+    uint16_t channelCount = 0;
+    uint32_t sampleRate = 0;
+    uint16_t bitsPerSample = 0;
+    const uint8_t* samples = nullptr;
+    size_t frameCount = 0;
+};
+
+/* WAV files are little endian, as are all the platforms this runs on */
+template <typename T>
+T readLe(const uint8_t* p) {
+    T value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+bool parseWav(const uint8_t* data, size_t size, WavData* wav) {
+    if (size < 12 || memcmp(data, "RIFF", 4) != 0 || memcmp(data + 8, "WAVE", 4) != 0) {
+        return false;
+    }
+    bool hasFormat = false;
+    size_t offset = 12;
+    while (offset + 8 <= size) {
+        const uint8_t* chunk = data + offset;
+        const size_t chunkSize = std::min<size_t>(readLe<uint32_t>(chunk + 4), size - offset - 8);
+        const uint8_t* payload = chunk + 8;
+        if (memcmp(chunk, "fmt ", 4) == 0 && chunkSize >= 16) {
+            wav->format = readLe<uint16_t>(payload);
+            wav->channelCount = readLe<uint16_t>(payload + 2);
+            wav->sampleRate = readLe<uint32_t>(payload + 4);
+            wav->bitsPerSample = readLe<uint16_t>(payload + 14);
+            if (wav->format == kWavFormatExtensible && chunkSize >= 26) {
+                // the sub format GUID starts with the format code
+                wav->format = readLe<uint16_t>(payload + 24);
+            }
+            hasFormat = true;
+        } else if (memcmp(chunk, "data", 4) == 0 && hasFormat) {
+            if (wav->channelCount == 0 || wav->bitsPerSample == 0) {
+                return false;
+            }
+            wav->samples = payload;
+            wav->frameCount = chunkSize / (wav->channelCount * (wav->bitsPerSample / 8));
+            return true;
+        }
+        offset += 8 + chunkSize + (chunkSize & 1);  // chunks are padded to an even size
+    }
+    return false;
+}
+
+}  // namespace
+
+/* static */
+ConvolutionReverb::AlignedBuffer ConvolutionReverb::makeAlignedBuffer(size_t count) {
+    float* buffer = (float*)pffft_aligned_malloc(count * sizeof(float));
+    LOG_ALWAYS_FATAL_IF(buffer == nullptr, "%s: cannot allocate %zu floats", __func__, count);
+    memset(buffer, 0, count * sizeof(float));
+    return AlignedBuffer(buffer);
+}
+
+/* static */
+std::unique_ptr<ConvolutionReverb> ConvolutionReverb::createFromFile(const char* path,
+                                                                     uint32_t sampleRate) {
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        ALOGV("%s: no impulse response %s", __func__, path);
+        return nullptr;
+    }
+    struct stat st;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (data == MAP_FAILED) {
+        ALOGE("%s: cannot map %s", __func__, path);
+        return nullptr;
+    }
+
+    std::unique_ptr<ConvolutionReverb> reverb;
+    WavData wav;
+    if (!parseWav((const uint8_t*)data, st.st_size, &wav)) {
+        ALOGE("%s: %s is not a WAV file", __func__, path);
+    } else if (wav.sampleRate != sampleRate) {
+        ALOGE("%s: %s sample rate %u, expected %u", __func__, path, wav.sampleRate, sampleRate);
+    } else if (wav.channelCount != 1 && wav.channelCount != kOutChannels) {
+        ALOGE("%s: %s has %u channels", __func__, path, wav.channelCount);
+    } else if (!(wav.format == kWavFormatPcm && wav.bitsPerSample == 16) &&
+               !(wav.format == kWavFormatFloat && wav.bitsPerSample == 32)) {
+        ALOGE("%s: %s format %#x with %u bits is not supported", __func__, path, wav.format,
+              wav.bitsPerSample);
+    } else {
+        size_t frameCount = wav.frameCount;
+        if (frameCount > kMaxImpulseSeconds * sampleRate) {
+            ALOGW("%s: %s truncated to %zu seconds", __func__, path, kMaxImpulseSeconds);
+            frameCount = kMaxImpulseSeconds * sampleRate;
+        }
+        // the samples are not aligned in the file
+        std::vector<float> impulse(frameCount * wav.channelCount);
+        if (wav.format == kWavFormatPcm) {
+            std::vector<int16_t> pcm(impulse.size());
+            memcpy(pcm.data(), wav.samples, pcm.size() * sizeof(int16_t));
+            memcpy_to_float_from_i16(impulse.data(), pcm.data(), pcm.size());
+        } else {
+            memcpy(impulse.data(), wav.samples, impulse.size() * sizeof(float));
+        }
+        reverb = create(impulse.data(), wav.channelCount, frameCount);
+        ALOGV("%s: loaded %zu frames from %s", __func__, frameCount, path);
+    }
+    munmap(data, st.st_size);
+    return reverb;
+}
+
+/* static */
+std::unique_ptr<ConvolutionReverb> ConvolutionReverb::create(const float* impulse,
+                                                             size_t channelCount,
+                                                             size_t frameCount) {
+    if (impulse == nullptr || frameCount == 0 || (channelCount != 1 && channelCount != 2)) {
+        return nullptr;
+    }
+    // deinterleave, a mono impulse response feeds both outputs
+    std::vector<float> planes[kOutChannels];
+    for (size_t channel = 0; channel < kOutChannels; ++channel) {
+        planes[channel].resize(frameCount);
+        const size_t source = std::min(channel, channelCount - 1);
+        for (size_t i = 0; i < frameCount; ++i) {
+            planes[channel][i] = impulse[i * channelCount + source];
+        }
+    }
+
+    std::unique_ptr<ConvolutionReverb> reverb(new ConvolutionReverb(frameCount));
+    const float* head[kOutChannels] = {planes[0].data(), planes[1].data()};
+    reverb->mHead = std::make_unique<UniformConvolver>(kHeadBlockSize, head,
+                                                       std::min(frameCount, kTailOffset));
+    if (frameCount > kTailOffset) {
+        const float* tail[kOutChannels] = {planes[0].data() + kTailOffset,
+                                           planes[1].data() + kTailOffset};
+        reverb->mTail = std::make_unique<UniformConvolver>(kTailBlockSize, tail,
+                                                           frameCount - kTailOffset);
+    }
+    return reverb;
+}
+
+ConvolutionReverb::ConvolutionReverb(size_t impulseFrames)
+    : mImpulseFrames(impulseFrames),
+      mTailIn(makeAlignedBuffer(kTailBlockSize)),
+      mTailOut{makeAlignedBuffer(2 * kTailBlockSize), makeAlignedBuffer(2 * kTailBlockSize)} {
+    static_assert(kTailBlockSize % kHeadBlockSize == 0);
+    static_assert(kTailOffset == 2 * kTailBlockSize);
+    reset();
+}
+
+ConvolutionReverb::~ConvolutionReverb() = default;
+
+void ConvolutionReverb::reset() {
+    if (mHead != nullptr) mHead->reset();
+    if (mTail != nullptr) mTail->reset();
+    memset(mHeadIn, 0, sizeof(mHeadIn));
+    memset(mHeadOut, 0, sizeof(mHeadOut));
+    mHeadPos = 0;
+    memset(mTailIn.get(), 0, kTailBlockSize * sizeof(float));
+    for (const auto& tailOut : mTailOut) {
+        memset(tailOut.get(), 0, 2 * kTailBlockSize * sizeof(float));
+    }
+    mTailPos = 0;
+    mTailPending = false;
+    // The tail output of input frame n is read at frame n + kHeadBlockSize, like the head.
+    // The output of tail block k starts at frame (k + 2) * kTailBlockSize, in ring block k % 2.
+    mTailReadPos = 2 * kTailBlockSize - kHeadBlockSize;
+    mTailWriteBlock = 0;
+}
+
+/*
+ * The input is consumed in chunks which end on a head block boundary. As kTailBlockSize is a
+ * multiple of kHeadBlockSize, a chunk never crosses a tail block boundary either, and never
+ * wraps around the tail output ring.
+ *
+ * A tail block is pushed when its input is complete, and computed in one step per head block
+ * of the next tail block. The last step ends kTailBlockSize frames later, at the next push,
+ * while its output is only read from kHeadBlockSize frames after that.
+ */
+void ConvolutionReverb::process(const float* pIn, size_t inChannels, float* pOut,
+                                size_t frameCount) {
+    while (frameCount > 0) {
+        const size_t count = std::min(frameCount, kHeadBlockSize - mHeadPos);
+
+        float* headIn = mHeadIn + mHeadPos;
+        if (inChannels == 1) {
+            memcpy(headIn, pIn, count * sizeof(float));
+        } else {
+            for (size_t i = 0; i < count; ++i) {
+                headIn[i] = (pIn[2 * i] + pIn[2 * i + 1]) * 0.5f;
+            }
+        }
+        const float* tailOutL = mTailOut[0].get() + mTailReadPos;
+        const float* tailOutR = mTailOut[1].get() + mTailReadPos;
+        for (size_t i = 0; i < count; ++i) {
+            pOut[2 * i] = mHeadOut[0][mHeadPos + i] + tailOutL[i];
+            pOut[2 * i + 1] = mHeadOut[1][mHeadPos + i] + tailOutR[i];
+        }
+        if (mTail != nullptr) {
+            memcpy(mTailIn.get() + mTailPos, headIn, count * sizeof(float));
+        }
+
+        pIn += count * inChannels;
+        pOut += count * kOutChannels;
+        frameCount -= count;
+        mHeadPos += count;
+        mTailPos += count;
+        mTailReadPos = (mTailReadPos + count) % (2 * kTailBlockSize);
+
+        if (mHeadPos == kHeadBlockSize) {
+            float* headOut[kOutChannels] = {mHeadOut[0], mHeadOut[1]};
+            mHead->process(mHeadIn, headOut);
+            mHeadPos = 0;
+            if (mTailPending) {
+                const size_t offset = mTailWriteBlock * kTailBlockSize;
+                float* tailOut[kOutChannels] = {mTailOut[0].get() + offset,
+                                                mTailOut[1].get() + offset};
+                mTail->step(kTailBlockSize / kHeadBlockSize, tailOut);
+            }
+        }
+        if (mTailPos == kTailBlockSize) {
+            if (mTailPending) {
+                // the last step of the previous block was just done
+                mTailWriteBlock ^= 1;
+            }
+            if (mTail != nullptr) {
+                mTail->push(mTailIn.get());
+                mTailPending = true;
+            }
+            mTailPos = 0;
+        }
+    }
+}
+
+ConvolutionReverb::UniformConvolver::UniformConvolver(size_t blockSize,
+                                                      const float* const* filters,
+                                                      size_t frameCount)
+    : mBlockSize(blockSize),
+      mFftSize(2 * blockSize),
+      mPartitionCount((frameCount + blockSize - 1) / blockSize),
+      mSetup(pffft_new_setup(mFftSize, PFFFT_REAL)),
+      mFilterSpectra(makeAlignedBuffer(kOutChannels * mPartitionCount * mFftSize)),
+      mInputSpectra(makeAlignedBuffer(mPartitionCount * mFftSize)),
+      mInput(makeAlignedBuffer(mFftSize)),
+      mAccumulator(makeAlignedBuffer(mFftSize)),
+      mOutput(makeAlignedBuffer(kOutChannels * mFftSize)),
+      mWork(makeAlignedBuffer(mFftSize)),
+      // an FFT costs about as much as log2(mFftSize) / 2 complex spectrum multiplications
+      mTransformCost(std::max<size_t>(1, (31 - __builtin_clz(mFftSize)) / 2)),
+      // the forward FFT, then per channel the partitions and the inverse FFT
+      mItemCount(1 + kOutChannels * (mPartitionCount + 1)),
+      mBlockCost((1 + kOutChannels) * mTransformCost + kOutChannels * mPartitionCount) {
+    LOG_ALWAYS_FATAL_IF(mSetup == nullptr, "%s: no FFT of size %zu", __func__, mFftSize);
+    // The spectra stay in the unordered pffft layout, which pffft_zconvolve_accumulate()
+    // multiplies directly. The inverse FFT scaling is applied to the filters once here.
+    const float scale = 1.f / mFftSize;
+    for (size_t channel = 0; channel < kOutChannels; ++channel) {
+        for (size_t partition = 0; partition < mPartitionCount; ++partition) {
+            const size_t first = partition * mBlockSize;
+            const size_t count = std::min(mBlockSize, frameCount - first);
+            memset(mInput.get(), 0, mFftSize * sizeof(float));
+            for (size_t i = 0; i < count; ++i) {
+                mInput[i] = filters[channel][first + i] * scale;
+            }
+            pffft_transform(mSetup, mInput.get(),
+                            &mFilterSpectra[(channel * mPartitionCount + partition) * mFftSize],
+                            mWork.get(), PFFFT_FORWARD);
+        }
+    }
+    reset();
+}
+
+ConvolutionReverb::UniformConvolver::~UniformConvolver() {
+    pffft_destroy_setup(mSetup);
+}
+
+void ConvolutionReverb::UniformConvolver::reset() {
+    memset(mInputSpectra.get(), 0, mPartitionCount * mFftSize * sizeof(float));
+    memset(mInput.get(), 0, mFftSize * sizeof(float));
+    mNewest = 0;
+    mStep = 0;
+    mNextItem = mItemCount;
+    mDoneCost = 0;
+}
+
+void ConvolutionReverb::UniformConvolver::process(const float* pIn, float* const* pOut) {
+    push(pIn);
+    step(1 /* stepCount */, pOut);
+}
+
+void ConvolutionReverb::UniformConvolver::push(const float* pIn) {
+    LOG_ALWAYS_FATAL_IF(mNextItem != mItemCount, "%s: previous block not done", __func__);
+    // overlap-save: the previous and the current block are transformed together
+    memcpy(&mInput[mBlockSize], pIn, mBlockSize * sizeof(float));
+    mNewest = (mNewest + 1) % mPartitionCount;
+    mStep = 0;
+    mNextItem = 0;
+    mDoneCost = 0;
+}
+
+void ConvolutionReverb::UniformConvolver::step(size_t stepCount, float* const* pOut) {
+    ++mStep;
+    if (mStep < stepCount) {
+        // stop at the first item ending at or after this step's share of the block cost
+        const size_t target = mBlockCost * mStep / stepCount;
+        while (mNextItem < mItemCount && mDoneCost < target) {
+            doItem();
+        }
+        return;
+    }
+    while (mNextItem < mItemCount) {
+        doItem();
+    }
+    for (size_t channel = 0; channel < kOutChannels; ++channel) {
+        // the first half is circular convolution aliasing
+        memcpy(pOut[channel], &mOutput[channel * mFftSize + mBlockSize],
+               mBlockSize * sizeof(float));
+    }
+}
+
+size_t ConvolutionReverb::UniformConvolver::itemCost(size_t item) const {
+    return item == 0 || (item - 1) % (mPartitionCount + 1) == mPartitionCount ? mTransformCost
+                                                                                : 1;
+}
+
+void ConvolutionReverb::UniformConvolver::doItem() {
+    const size_t item = mNextItem++;
+    mDoneCost += itemCost(item);
+    if (item == 0) {
+        pffft_transform(mSetup, mInput.get(), &mInputSpectra[mNewest * mFftSize], mWork.get(),
+                        PFFFT_FORWARD);
+        memcpy(mInput.get(), &mInput[mBlockSize], mBlockSize * sizeof(float));
+        return;
+    }
+    const size_t channel = (item - 1) / (mPartitionCount + 1);
+    const size_t partition = (item - 1) % (mPartitionCount + 1);
+    if (partition == mPartitionCount) {
+        pffft_transform(mSetup, mAccumulator.get(), &mOutput[channel * mFftSize], mWork.get(),
+                        PFFFT_BACKWARD);
+        return;
+    }
+    if (partition == 0) {
+        memset(mAccumulator.get(), 0, mFftSize * sizeof(float));
+    }
+    // partition p filters the input block from p blocks ago
+    const size_t input = (mNewest + mPartitionCount - partition) % mPartitionCount;
+    pffft_zconvolve_accumulate(mSetup, &mInputSpectra[input * mFftSize],
+                               &mFilterSpectra[(channel * mPartitionCount + partition) * mFftSize],
+                               mAccumulator.get(), 1.f /* scaling */);
+}
+
+}  // namespace android
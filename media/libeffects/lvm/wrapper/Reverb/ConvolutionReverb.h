@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_CONVOLUTIONREVERB_H_
+#define ANDROID_CONVOLUTIONREVERB_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+
+#include <pffft.h>
+
+namespace android {
+
+/*
+ * Impulse response reverb, used by the preset reverb in place of the LVM reverb when an
+ * impulse response is available for the preset.
+ *
+ * The input is summed to mono and convolved with a mono or stereo impulse response, giving a
+ * stereo output. The convolution is uniformly partitioned in two levels, both running
+ * overlap-save with a frequency domain delay line:
+ *  - the head, the first kTailOffset taps, uses kHeadBlockSize partitions, which sets the
+ *    latency of the reverb to kHeadBlockSize frames.
+ *  - the tail, the remaining taps, uses kTailBlockSize partitions. A tail block only
+ *    contributes kTailBlockSize frames after its input block is complete, so its larger
+ *    partitions add no latency, and it can be computed during the next tail block: its work
+ *    is spread over the head blocks of that tail block, so that no process() call does the
+ *    whole tail at once.
+ * The cost per frame grows with the log of the block sizes plus the number of partitions,
+ * instead of with the impulse response length as a time domain filter would.
+ */
+class ConvolutionReverb {
+  public:
+    static constexpr size_t kHeadBlockSize = 128;
+    static constexpr size_t kTailBlockSize = 2048;  // must be a multiple of kHeadBlockSize
+    static constexpr size_t kTailOffset = 2 * kTailBlockSize;  // first tap of the tail
+    static constexpr size_t kMaxImpulseSeconds = 10;
+
+    /*
+     * Memory maps a WAV file holding a mono or stereo, 16 bit or float, impulse response.
+     * Returns nullptr if the file cannot be read or its sample rate is not sampleRate.
+     */
+    static std::unique_ptr<ConvolutionReverb> createFromFile(const char* path,
+                                                             uint32_t sampleRate);
+
+    /* impulse holds frameCount frames of channelCount (1 or 2) interleaved samples */
+    static std::unique_ptr<ConvolutionReverb> create(const float* impulse, size_t channelCount,
+                                                     size_t frameCount);
+
+    ~ConvolutionReverb();
+
+    /*
+     * Reverberates frameCount frames of inChannels (1 or 2) interleaved input samples into
+     * frameCount stereo frames. pIn and pOut must not overlap.
+     */
+    void process(const float* pIn, size_t inChannels, float* pOut, size_t frameCount);
+
+    /* Clears the history */
+    void reset();
+
+    /* Number of frames output after the input stops, before the reverb is silent */
+    size_t getTailFrames() const { return mImpulseFrames + kHeadBlockSize; }
+
+  private:
+    static constexpr size_t kOutChannels = 2;
+
+    struct AlignedDeleter {
+        void operator()(float* p) const { pffft_aligned_free(p); }
+    };
+    using AlignedBuffer = std::unique_ptr<float[], AlignedDeleter>;
+    static AlignedBuffer makeAlignedBuffer(size_t count);
+
+    /*
+     * Uniformly partitioned overlap-save convolution of a mono input with kOutChannels
+     * filters, in blocks of blockSize frames. The partitions share the input spectra.
+     */
+    class UniformConvolver {
+      public:
+        /* filters[channel] holds frameCount taps */
+        UniformConvolver(size_t blockSize, const float* const* filters, size_t frameCount);
+        ~UniformConvolver();
+
+        /* Consumes blockSize input frames and produces blockSize frames per channel */
+        void process(const float* pIn, float* const* pOut);
+
+        /*
+         * Consumes blockSize input frames, which are then processed by stepCount calls of
+         * step(), before the next call of push().
+         */
+        void push(const float* pIn);
+        /*
+         * Does the next of stepCount parts of similar cost of the processing of the pushed
+         * block. The last one produces blockSize frames per channel.
+         */
+        void step(size_t stepCount, float* const* pOut);
+
+        void reset();
+
+      private:
+        /* Does work item mNextItem; see step() */
+        void doItem();
+        size_t itemCost(size_t item) const;
+
+        const size_t mBlockSize;
+        const size_t mFftSize;
+        size_t mPartitionCount;
+        PFFFT_Setup* mSetup;
+        AlignedBuffer mFilterSpectra;  // [channel][partition][mFftSize]
+        AlignedBuffer mInputSpectra;   // [partition][mFftSize], a ring starting at mNewest
+        size_t mNewest = 0;
+        AlignedBuffer mInput;          // previous and current input blocks
+        AlignedBuffer mAccumulator;
+        AlignedBuffer mOutput;         // [channel][mFftSize]
+        AlignedBuffer mWork;
+
+        /* cost of an FFT, in spectrum multiply-accumulates */
+        const size_t mTransformCost;
+        const size_t mItemCount;
+        const size_t mBlockCost;
+        /* progress of the block in progress */
+        size_t mStep = 0;
+        size_t mNextItem = 0;
+        size_t mDoneCost = 0;
+    };
+
+    explicit ConvolutionReverb(size_t impulseFrames);
+
+    const size_t mImpulseFrames;
+    std::unique_ptr<UniformConvolver> mHead;
+    std::unique_ptr<UniformConvolver> mTail;  // nullptr for short impulse responses
+    bool mTailPending = false;  // a tail block was pushed since reset()
+
+    /* mono input of the block in progress, mHeadPos frames in */
+    float mHeadIn[kHeadBlockSize];
+    size_t mHeadPos = 0;
+    /* output of the last complete head block, delayed by kHeadBlockSize frames */
+    float mHeadOut[kOutChannels][kHeadBlockSize];
+
+    AlignedBuffer mTailIn;
+    size_t mTailPos = 0;
+    /* tail output ring of two blocks: one being output while the other one is computed */
+    AlignedBuffer mTailOut[kOutChannels];
+    size_t mTailReadPos;
+    size_t mTailWriteBlock;
+};
+
+}  // namespace android
+
+#endif /*ANDROID_CONVOLUTIONREVERB_H_*/
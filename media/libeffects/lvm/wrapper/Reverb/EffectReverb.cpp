@@ -23,13 +23,21 @@ typedef float LVM_FLOAT;
 
 #include <assert.h>
 #include <inttypes.h>
+#include <limits.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <new>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include <audio_utils/primitives.h>
+#include <cutils/properties.h>
 #include <log/log.h>
 
+#include "ConvolutionReverb.h"
 #include "EffectReverb.h"
 // from Reverb/lib
 #include "LVREV.h"
@@ -84,6 +92,15 @@ const static t_reverb_settings sReverbPresets[] = {
         {-400, -200, 1300, 900, 0, 2, 0, 10, 1000, 750},
 };
 
+// Impulse response file names of the presets, in the directory set by
+// REVERB_IMPULSE_RESPONSE_DIR_PROPERTY. A preset with a file uses the convolution reverb.
+const static char* const sPresetImpulseResponses[] = {
+        nullptr,  // REVERB_PRESET_NONE
+        "smallroom.wav", "mediumroom.wav", "largeroom.wav",
+        "mediumhall.wav", "largehall.wav", "plate.wav",
+};
+static_assert(ARRAY_SIZE(sPresetImpulseResponses) == ARRAY_SIZE(sReverbPresets));
+
 // NXP SW auxiliary environmental reverb
 const effect_descriptor_t gAuxEnvReverbDescriptor = {
         {0xc2e5d5f0, 0x94bd, 0x4763, 0x9cac, {0x4e, 0x23, 0x4d, 0x06, 0x83, 0x9e}},
@@ -166,6 +183,22 @@ struct ReverbContext {
     LVM_INT16 prevLeftVolume;
     LVM_INT16 prevRightVolume;
     int volumeMode;
+    // replaces LVREV for the current preset when an impulse response is available;
+    // only accessed by the audio thread
+    std::unique_ptr<ConvolutionReverb> convolution;
+    // getTailFrames() of convolution, or 0, for the command thread
+    std::atomic<int> convolutionTailFrames{0};
+    // set by the command thread to have the audio thread reset convolution
+    std::atomic<bool> convolutionResetPending{false};
+    // Hand-off of the impulse response engines between the command thread, which builds them,
+    // and the audio thread. The audio thread only ever try_lock()s convolutionLock, and engines
+    // are only allocated and freed by the command thread.
+    std::mutex convolutionLock;
+    // nextConvolution is the engine for nextPreset, or nullptr if it uses LVREV
+    bool hasNextConvolution = false;
+    std::unique_ptr<ConvolutionReverb> nextConvolution;
+    // replaced by Reverb_LoadPreset(), to be freed by the command thread
+    std::unique_ptr<ConvolutionReverb> retiredConvolution;
 };
 
 enum {
@@ -187,6 +220,7 @@ void Reverb_getConfig(ReverbContext* pContext, effect_config_t* pConfig);
 int Reverb_setParameter(ReverbContext* pContext, void* pParam, void* pValue, int vsize);
 int Reverb_getParameter(ReverbContext* pContext, void* pParam, uint32_t* pValueSize, void* pValue);
 int Reverb_LoadPreset(ReverbContext* pContext);
+void Reverb_LoadImpulseResponse(ReverbContext* pContext, uint16_t preset);
 int Reverb_paramValueSize(int32_t param);
 
 /* Effect Library Interface Implementation */
@@ -395,11 +429,21 @@ int process(effect_buffer_t* pIn, effect_buffer_t* pOut, int frameCount, ReverbC
             ALOGV("\tZeroing %d samples per frame at the end of call", channels);
         }
 
-        /* Process the samples, producing a stereo output */
-        LvmStatus = LVREV_Process(pContext->hInstance, /* Instance handle */
-                                  pContext->InFrames,  /* Input buffer */
-                                  pContext->OutFrames, /* Output buffer */
-                                  frameCount);         /* Number of samples to read */
+        if (pContext->convolution != nullptr) {
+            if (pContext->convolutionResetPending.exchange(false)) {
+                pContext->convolution->reset();
+            }
+            // the auxiliary input is mono, the insert input was converted to stereo above
+            pContext->convolution->process(pContext->InFrames,
+                                           pContext->auxiliary ? FCC_1 : FCC_2,
+                                           pContext->OutFrames, frameCount);
+        } else {
+            /* Process the samples, producing a stereo output */
+            LvmStatus = LVREV_Process(pContext->hInstance, /* Instance handle */
+                                      pContext->InFrames,  /* Input buffer */
+                                      pContext->OutFrames, /* Output buffer */
+                                      frameCount);         /* Number of samples to read */
+        }
     }
 
     LVM_ERROR_CHECK(LvmStatus, "LVREV_Process", "process")
@@ -581,6 +625,12 @@ int Reverb_setConfig(ReverbContext* pContext, effect_config_t* pConfig) {
         if (LvmStatus != LVREV_SUCCESS) return -EINVAL;
         // ALOGV("\tReverb_setConfig Successfully called LVREV_SetControlParameters\n");
         pContext->SampleRate = SampleRate;
+
+        // the impulse responses are recorded at a given sample rate, reload the preset
+        if (pContext->preset) {
+            Reverb_LoadImpulseResponse(pContext, pContext->nextPreset);
+            pContext->curPreset = REVERB_PRESET_LAST + 1;
+        }
     } else {
         // ALOGV("\tReverb_setConfig keep sampling rate at %d", SampleRate);
     }
@@ -1345,6 +1395,13 @@ int32_t ReverbGetDensity(ReverbContext* pContext) {
 //
 //----------------------------------------------------------------------------
 int Reverb_LoadPreset(ReverbContext* pContext) {
+    // The command thread may be publishing the impulse response of the preset;
+    // never wait for it on the audio thread, try again with the next buffer instead.
+    std::unique_lock<std::mutex> lock(pContext->convolutionLock, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return 0;
+    }
+
     // TODO: add reflections delay, level and reverb delay when early reflections are
     // implemented
     pContext->curPreset = pContext->nextPreset;
@@ -1363,9 +1420,62 @@ int Reverb_LoadPreset(ReverbContext* pContext) {
         ReverbSetDensity(pContext, preset->density);
     }
 
+    if (pContext->hasNextConvolution) {
+        // Each publication frees the previously retired engine, so the slot is empty here
+        // and the old engine is freed by the command thread, not by this thread.
+        ALOG_ASSERT(pContext->retiredConvolution == nullptr);
+        pContext->retiredConvolution = std::move(pContext->convolution);
+        pContext->convolution = std::move(pContext->nextConvolution);
+        pContext->hasNextConvolution = false;
+        pContext->convolutionResetPending = false;  // the new engine starts out silent
+        const int tailFrames =
+                pContext->convolution != nullptr ? pContext->convolution->getTailFrames() : 0;
+        pContext->convolutionTailFrames = tailFrames;
+        pContext->SamplesToExitCount = std::max(pContext->SamplesToExitCount, tailFrames);
+    }
+
     return 0;
 }
 
+//----------------------------------------------------------------------------
+// Reverb_LoadImpulseResponse()
+//----------------------------------------------------------------------------
+// Purpose:
+// Load the impulse response of a preset, if the device provides one, and publish
+// it in nextConvolution for Reverb_LoadPreset(). Called from the command thread,
+// as the file is memory mapped and transformed into the frequency domain.
+//
+// Inputs:
+//  pContext   - handle to instance data
+//  preset     - preset to load
+//
+//----------------------------------------------------------------------------
+
+void Reverb_LoadImpulseResponse(ReverbContext* pContext, uint16_t preset) {
+    std::unique_ptr<ConvolutionReverb> convolution;
+    char dir[PROPERTY_VALUE_MAX];
+    if (preset <= REVERB_PRESET_LAST && sPresetImpulseResponses[preset] != nullptr &&
+        property_get(REVERB_IMPULSE_RESPONSE_DIR_PROPERTY, dir, "") > 0) {
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "%s/%s", dir, sPresetImpulseResponses[preset]);
+        convolution = ConvolutionReverb::createFromFile(path,
+                                                        pContext->config.inputCfg.samplingRate);
+        ALOGV("Reverb_LoadImpulseResponse preset %d %s", preset,
+              convolution != nullptr ? path : "uses LVREV");
+    }
+
+    // swap under the lock, but free the engines replaced here and by the audio thread after it
+    std::unique_ptr<ConvolutionReverb> unpublished;
+    std::unique_ptr<ConvolutionReverb> retired;
+    {
+        std::lock_guard<std::mutex> lock(pContext->convolutionLock);
+        unpublished = std::move(pContext->nextConvolution);
+        retired = std::move(pContext->retiredConvolution);
+        pContext->nextConvolution = std::move(convolution);
+        pContext->hasNextConvolution = true;
+    }
+}
+
 //----------------------------------------------------------------------------
 // Reverb_getParameter()
 //----------------------------------------------------------------------------
@@ -1624,6 +1734,9 @@ int Reverb_setParameter(ReverbContext* pContext, void* pParam, void* pValue, int
         if (preset > REVERB_PRESET_LAST) {
             return -EINVAL;
         }
+        if (preset != pContext->nextPreset) {
+            Reverb_LoadImpulseResponse(pContext, preset);
+        }
         pContext->nextPreset = preset;
         return 0;
     }
@@ -1819,6 +1932,8 @@ int Reverb_command(effect_handle_t self, uint32_t cmdCode, uint32_t cmdSize, voi
             // ALOGV("\tReverb_command cmdCode Case: "
             //        "EFFECT_CMD_RESET start");
             Reverb_setConfig(pContext, &pContext->config);
+            // the convolution engine belongs to the audio thread
+            pContext->convolutionResetPending = true;
             break;
 
         case EFFECT_CMD_GET_PARAM: {
@@ -1914,6 +2029,8 @@ int Reverb_command(effect_handle_t self, uint32_t cmdCode, uint32_t cmdSize, voi
             LVM_ERROR_CHECK(LvmStatus, "LVREV_GetControlParameters", "EFFECT_CMD_ENABLE")
             pContext->SamplesToExitCount =
                     (ActiveParams.T60 * pContext->config.inputCfg.samplingRate) / 1000;
+            pContext->SamplesToExitCount = std::max<int>(pContext->SamplesToExitCount,
+                                                         pContext->convolutionTailFrames);
             // force no volume ramp for first buffer processed after enabling the effect
             pContext->volumeMode = android::REVERB_VOLUME_FLAT;
             // ALOGV("\tEFFECT_CMD_ENABLE SamplesToExitCount = %d", pContext->SamplesToExitCount);
@@ -28,6 +28,9 @@
 #define LVREV_CUP_LOAD_ARM9E 470                            // Expressed in 0.1 MIPS
 #define LVREV_MEM_USAGE (71 + (LVREV_MAX_FRAME_SIZE >> 7))  // Expressed in kB
 
+// Directory of the preset impulse responses, named after the presets ("smallroom.wav"...)
+#define REVERB_IMPULSE_RESPONSE_DIR_PROPERTY "ro.audio.reverb.impulse_response_dir"
+
 typedef struct _LPFPair_t {
     int16_t Room_HF;
     int16_t LPF;
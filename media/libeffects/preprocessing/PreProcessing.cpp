@@ -16,6 +16,8 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
+#include <vector>
 #define LOG_TAG "PreProcessing"
 //#define LOG_NDEBUG 0
 #include <audio_effects/effect_aec.h>
@@ -125,8 +127,61 @@ struct preproc_session_s {
     uint32_t revProcessedMsk;  // bit field containing IDs of pre processors with reverse
                                // channel already processed in current round
     webrtc::StreamConfig revConfig;     // reverse stream configuration.
+    audio_format_t format;     // AUDIO_FORMAT_PCM_16_BIT or AUDIO_FORMAT_PCM_FLOAT
+    audio_format_t revFormat;  // format of the reverse stream
+    // With AUDIO_FORMAT_PCM_FLOAT, the enabled pre processors run together on one
+    // deinterleaved float frame, processed in place by the APM, which avoids converting to
+    // and from int16 around the APM and around each effect in the framework.
+    std::vector<float> frame;             // frameCount samples per channel
+    std::vector<float*> frameChannels;    // channel pointers into frame
+    std::vector<float> revFrame;          // same for the reverse stream
+    std::vector<float*> revFrameChannels;
 };
 
+// Deinterleaves frameCount frames into the channel buffers
+static void Deinterleave(const float* in, float* const* channels, size_t channelCount,
+                         size_t frameCount) {
+    if (channelCount == 1) {
+        memcpy(channels[0], in, frameCount * sizeof(float));
+        return;
+    }
+    for (size_t c = 0; c < channelCount; c++) {
+        float* const channel = channels[c];
+        for (size_t i = 0; i < frameCount; i++) {
+            channel[i] = in[i * channelCount + c];
+        }
+    }
+}
+
+// Interleaves frameCount frames from the channel buffers
+static void Interleave(const float* const* channels, float* out, size_t channelCount,
+                       size_t frameCount) {
+    if (channelCount == 1) {
+        memcpy(out, channels[0], frameCount * sizeof(float));
+        return;
+    }
+    for (size_t c = 0; c < channelCount; c++) {
+        const float* const channel = channels[c];
+        for (size_t i = 0; i < frameCount; i++) {
+            out[i * channelCount + c] = channel[i];
+        }
+    }
+}
+
+// Sizes a deinterleaved frame of channelCount channels of frameCount samples
+static void AllocateFrame(std::vector<float>* frame, std::vector<float*>* channels,
+                          size_t channelCount, size_t frameCount) {
+    frame->assign(channelCount * frameCount, 0.f);
+    channels->resize(channelCount);
+    for (size_t c = 0; c < channelCount; c++) {
+        (*channels)[c] = frame->data() + c * frameCount;
+    }
+}
+
+static bool IsSupportedFormat(audio_format_t format) {
+    return format == AUDIO_FORMAT_PCM_16_BIT || format == AUDIO_FORMAT_PCM_FLOAT;
+}
+
 #ifdef DUAL_MIC_TEST
 enum {
     PREPROC_CMD_DUAL_MIC_ENABLE = EFFECT_CMD_FIRST_PROPRIETARY,  // enable dual mic mode
@@ -862,6 +917,8 @@ extern "C" int Session_CreateEffect(preproc_session_t* session, int32_t procId,
         session->processedMsk = 0;
         session->revEnabledMsk = 0;
         session->revProcessedMsk = 0;
+        session->format = AUDIO_FORMAT_PCM_16_BIT;
+        session->revFormat = AUDIO_FORMAT_PCM_16_BIT;
     }
     status = Effect_Create(&session->effects[procId], session, interface);
     if (status < 0) {
@@ -886,6 +943,10 @@ int Session_ReleaseEffect(preproc_session_t* session, preproc_effect_t* fx) {
         // Scoped_refptr will handle reference counting here
         session->apm = nullptr;
         session->id = 0;
+        session->frame.clear();
+        session->frameChannels.clear();
+        session->revFrame.clear();
+        session->revFrameChannels.clear();
     }
 
     return 0;
@@ -897,12 +958,12 @@ int Session_SetConfig(preproc_session_t* session, effect_config_t* config) {
 
     if (config->inputCfg.samplingRate != config->outputCfg.samplingRate ||
         config->inputCfg.format != config->outputCfg.format ||
-        config->inputCfg.format != AUDIO_FORMAT_PCM_16_BIT) {
+        !IsSupportedFormat((audio_format_t)config->inputCfg.format)) {
         return -EINVAL;
     }
 
-    ALOGV("Session_SetConfig sr %d cnl %08x", config->inputCfg.samplingRate,
-          config->inputCfg.channels);
+    ALOGV("Session_SetConfig sr %d cnl %08x format %#x", config->inputCfg.samplingRate,
+          config->inputCfg.channels, config->inputCfg.format);
 
     session->samplingRate = config->inputCfg.samplingRate;
     session->frameCount = session->samplingRate / 100;
@@ -917,6 +978,16 @@ int Session_SetConfig(preproc_session_t* session, effect_config_t* config) {
     session->revConfig.set_sample_rate_hz(session->samplingRate);
     session->revConfig.set_num_channels(inCnl);
 
+    session->format = (audio_format_t)config->inputCfg.format;
+    if (session->format == AUDIO_FORMAT_PCM_FLOAT) {
+        AllocateFrame(&session->frame, &session->frameChannels,
+                      std::max(inCnl, outCnl), session->frameCount);
+    }
+    if (session->revFormat == AUDIO_FORMAT_PCM_FLOAT) {
+        AllocateFrame(&session->revFrame, &session->revFrameChannels,
+                      session->revConfig.num_channels(), session->frameCount);
+    }
+
     session->state = PREPROC_SESSION_STATE_CONFIG;
     return 0;
 }
@@ -924,7 +995,7 @@ int Session_SetConfig(preproc_session_t* session, effect_config_t* config) {
 void Session_GetConfig(preproc_session_t* session, effect_config_t* config) {
     memset(config, 0, sizeof(effect_config_t));
     config->inputCfg.samplingRate = config->outputCfg.samplingRate = session->samplingRate;
-    config->inputCfg.format = config->outputCfg.format = AUDIO_FORMAT_PCM_16_BIT;
+    config->inputCfg.format = config->outputCfg.format = session->format;
     config->inputCfg.channels = audio_channel_in_mask_from_count(session->inChannelCount);
     // "out" doesn't mean output device, so this is the correct API to convert channel count to mask
     config->outputCfg.channels = audio_channel_in_mask_from_count(session->outChannelCount);
@@ -935,22 +1006,26 @@ void Session_GetConfig(preproc_session_t* session, effect_config_t* config) {
 int Session_SetReverseConfig(preproc_session_t* session, effect_config_t* config) {
     if (config->inputCfg.samplingRate != config->outputCfg.samplingRate ||
         config->inputCfg.format != config->outputCfg.format ||
-        config->inputCfg.format != AUDIO_FORMAT_PCM_16_BIT) {
+        !IsSupportedFormat((audio_format_t)config->inputCfg.format)) {
         return -EINVAL;
     }
 
-    ALOGV("Session_SetReverseConfig sr %d cnl %08x", config->inputCfg.samplingRate,
-          config->inputCfg.channels);
+    ALOGV("Session_SetReverseConfig sr %d cnl %08x format %#x", config->inputCfg.samplingRate,
+          config->inputCfg.channels, config->inputCfg.format);
 
     if (session->state < PREPROC_SESSION_STATE_CONFIG) {
         return -ENOSYS;
     }
-    if (config->inputCfg.samplingRate != session->samplingRate ||
-        config->inputCfg.format != AUDIO_FORMAT_PCM_16_BIT) {
+    if (config->inputCfg.samplingRate != session->samplingRate) {
         return -EINVAL;
     }
     uint32_t inCnl = audio_channel_count_from_out_mask(config->inputCfg.channels);
     session->revChannelCount = inCnl;
+    session->revFormat = (audio_format_t)config->inputCfg.format;
+    if (session->revFormat == AUDIO_FORMAT_PCM_FLOAT) {
+        AllocateFrame(&session->revFrame, &session->revFrameChannels,
+                      session->revConfig.num_channels(), session->frameCount);
+    }
 
     return 0;
 }
@@ -958,7 +1033,7 @@ int Session_SetReverseConfig(preproc_session_t* session, effect_config_t* config
 void Session_GetReverseConfig(preproc_session_t* session, effect_config_t* config) {
     memset(config, 0, sizeof(effect_config_t));
     config->inputCfg.samplingRate = config->outputCfg.samplingRate = session->samplingRate;
-    config->inputCfg.format = config->outputCfg.format = AUDIO_FORMAT_PCM_16_BIT;
+    config->inputCfg.format = config->outputCfg.format = session->revFormat;
     config->inputCfg.channels = config->outputCfg.channels =
             audio_channel_in_mask_from_count(session->revChannelCount);
     config->inputCfg.mask = config->outputCfg.mask =
@@ -1075,6 +1150,20 @@ int PreProcessingFx_Process(effect_handle_t self, audio_buffer_t* inBuffer,
     //         inBuffer->frameCount, session->enabledMsk, session->processedMsk);
     if ((session->processedMsk & session->enabledMsk) == session->enabledMsk) {
         effect->session->processedMsk = 0;
+        if (session->format == AUDIO_FORMAT_PCM_FLOAT) {
+            Deinterleave(inBuffer->f32, session->frameChannels.data(),
+                         session->inputConfig.num_channels(), session->frameCount);
+            if (int status = session->apm->ProcessStream(
+                        session->frameChannels.data(), session->inputConfig,
+                        session->outputConfig, session->frameChannels.data());
+                status != 0) {
+                ALOGE("Process Stream failed with error %d\n", status);
+                return status;
+            }
+            Interleave(session->frameChannels.data(), outBuffer->f32,
+                       session->outputConfig.num_channels(), session->frameCount);
+            return 0;
+        }
         if (int status = effect->session->apm->ProcessStream(
                     (const int16_t* const)inBuffer->s16,
                     (const webrtc::StreamConfig)effect->session->inputConfig,
@@ -1478,6 +1567,20 @@ int PreProcessingFx_ProcessReverse(effect_handle_t self, audio_buffer_t* inBuffe
 
     if ((session->revProcessedMsk & session->revEnabledMsk) == session->revEnabledMsk) {
         effect->session->revProcessedMsk = 0;
+        if (session->revFormat == AUDIO_FORMAT_PCM_FLOAT) {
+            Deinterleave(inBuffer->f32, session->revFrameChannels.data(),
+                         session->revConfig.num_channels(), session->frameCount);
+            if (int status = session->apm->ProcessReverseStream(
+                        session->revFrameChannels.data(), session->revConfig,
+                        session->revConfig, session->revFrameChannels.data());
+                status != 0) {
+                ALOGE("Process Reverse Stream failed with error %d\n", status);
+                return status;
+            }
+            Interleave(session->revFrameChannels.data(), outBuffer->f32,
+                       session->revConfig.num_channels(), session->frameCount);
+            return 0;
+        }
         if (int status = effect->session->apm->ProcessReverseStream(
                     (const int16_t* const)inBuffer->s16,
                     (const webrtc::StreamConfig)effect->session->revConfig,
@@ -129,6 +129,7 @@
 #include <climits>
 #include <cstdlib>
 #include <random>
+#include <type_traits>
 #include <vector>
 #include <audio_effects/effect_agc2.h>
 #include <audio_effects/effect_ns.h>
@@ -319,4 +320,127 @@ static void preprocessingArgs(benchmark::internal::Benchmark* b) {
 
 BENCHMARK(BM_PREPROCESSING)->Apply(preprocessingArgs);
 
+// Noise Suppressor, Automatic Gain Control 2 and Acoustic Echo Canceler on one session, which
+// run together on the session's audio processing module once all of them have been processed.
+// The AEC is created last, so that its reverse config is applied to a configured session.
+constexpr PreProcId kChainEffects[] = {PREPROC_NS, PREPROC_AGC2, PREPROC_AEC};
+
+template <typename T>
+static void fillChainBuffer(std::vector<T>* buffer, std::minstd_rand* gen) {
+    std::uniform_real_distribution<> dis(-1.0f, 1.0f);
+    for (auto& i : *buffer) {
+        if constexpr (std::is_same_v<T, float>) {
+            i = dis(*gen);
+        } else {
+            i = preProcGetShortVal(dis(*gen));
+        }
+    }
+}
+
+/*
+ * The first parameter indicates the channel mask index.
+ * The second parameter indicates the sample format, 0: int16, 1: float.
+ * With float, the chain is processed on deinterleaved float frames without converting to int16.
+ */
+template <typename T>
+static void runPreprocessingChain(benchmark::State& state) {
+    const size_t chMask = kChMasks[state.range(0) - 1];
+    const size_t channelCount = audio_channel_count_from_in_mask(chMask);
+
+    int32_t sessionId = 1;
+    int32_t ioId = 1;
+    effect_config_t config{};
+    config.inputCfg.samplingRate = config.outputCfg.samplingRate = kSampleRate;
+    config.inputCfg.channels = config.outputCfg.channels = chMask;
+    config.inputCfg.format = config.outputCfg.format =
+            std::is_same_v<T, float> ? AUDIO_FORMAT_PCM_FLOAT : AUDIO_FORMAT_PCM_16_BIT;
+
+    std::vector<effect_handle_t> effectHandles;
+    for (PreProcId effectType : kChainEffects) {
+        effect_handle_t effectHandle = nullptr;
+        if (int status = preProcCreateEffect(&effectHandle, effectType, &config, sessionId, ioId);
+            status != 0) {
+            ALOGE("Create effect call returned error %i", status);
+            return;
+        }
+        effectHandles.push_back(effectHandle);
+        int reply = 0;
+        uint32_t replySize = sizeof(reply);
+        if (int status = (*effectHandle)
+                                 ->command(effectHandle, EFFECT_CMD_ENABLE, 0, nullptr,
+                                           &replySize, &reply);
+            status != 0) {
+            ALOGE("Command enable call returned error %d\n", reply);
+            return;
+        }
+    }
+    effect_handle_t aecHandle = effectHandles.back();
+
+    const int frameLength = (int)(kSampleRate * kTenMilliSecVal);
+    std::minstd_rand gen(chMask);
+    std::vector<T> in(frameLength * channelCount);
+    fillChainBuffer(&in, &gen);
+    std::vector<T> farIn(frameLength * channelCount);
+    fillChainBuffer(&farIn, &gen);
+    std::vector<T> out(frameLength * channelCount);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(in.data());
+        benchmark::DoNotOptimize(out.data());
+        benchmark::DoNotOptimize(farIn.data());
+
+        audio_buffer_t inBuffer = {.frameCount = (size_t)frameLength, .raw = in.data()};
+        audio_buffer_t outBuffer = {.frameCount = (size_t)frameLength, .raw = out.data()};
+        audio_buffer_t farInBuffer = {.frameCount = (size_t)frameLength, .raw = farIn.data()};
+
+        if (int status = preProcSetConfigParam(aecHandle, AEC_PARAM_ECHO_DELAY, kStreamDelayMs);
+            status != 0) {
+            ALOGE("preProcSetConfigParam returned Error %d\n", status);
+            return;
+        }
+        // all but the last effect of the round return -ENODATA
+        for (effect_handle_t effectHandle : effectHandles) {
+            if (int status = (*effectHandle)->process(effectHandle, &inBuffer, &outBuffer);
+                status != 0 && status != -ENODATA) {
+                ALOGE("\nError: Process returned with error %d\n", status);
+                return;
+            }
+        }
+        if (int status = (*aecHandle)->process_reverse(aecHandle, &farInBuffer, &outBuffer);
+            status != 0) {
+            ALOGE("\nError: Process reverse returned with error %d\n", status);
+            return;
+        }
+    }
+    benchmark::ClobberMemory();
+
+    state.SetComplexityN(state.range(0));
+
+    for (effect_handle_t effectHandle : effectHandles) {
+        if (int status = AUDIO_EFFECT_LIBRARY_INFO_SYM.release_effect(effectHandle);
+            status != 0) {
+            ALOGE("release_effect returned an error = %d\n", status);
+            return;
+        }
+    }
+}
+
+static void BM_PREPROCESSING_CHAIN(benchmark::State& state) {
+    if (state.range(1) == 0) {
+        runPreprocessingChain<short>(state);
+    } else {
+        runPreprocessingChain<float>(state);
+    }
+}
+
+static void preprocessingChainArgs(benchmark::internal::Benchmark* b) {
+    for (int i = 1; i <= (int)kNumChMasks; i++) {
+        for (int j = 0; j <= 1; ++j) {
+            b->Args({i, j});
+        }
+    }
+}
+
+BENCHMARK(BM_PREPROCESSING_CHAIN)->Apply(preprocessingChainArgs);
+
 BENCHMARK_MAIN();
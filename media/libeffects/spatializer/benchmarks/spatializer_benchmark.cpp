@@ -64,6 +64,45 @@ constexpr effect_uuid_t kEffectUuid = {
 constexpr float kMinAmplitude = -1.0f;
 constexpr float kMaxAmplitude = 1.0f;
 
+/*
+ * Creates, configures and enables a spatializer rendering kInputChMask to stereo.
+ * Returns nullptr on error.
+ */
+static effect_handle_t createEffect(size_t sampleRate) {
+    effect_handle_t effectHandle = nullptr;
+    if (int status = AUDIO_EFFECT_LIBRARY_INFO_SYM.create_effect(&kEffectUuid, 1 /* sessionId */,
+                                                                 1 /* ioId */, &effectHandle);
+        status != 0) {
+        ALOGE("create_effect returned an error = %d\n", status);
+        return nullptr;
+    }
+
+    effect_config_t config{};
+    config.inputCfg.samplingRate = config.outputCfg.samplingRate = sampleRate;
+    config.inputCfg.channels = kInputChMask;
+    config.outputCfg.channels = AUDIO_CHANNEL_OUT_STEREO;
+    config.inputCfg.format = config.outputCfg.format = AUDIO_FORMAT_PCM_FLOAT;
+
+    int reply = 0;
+    uint32_t replySize = sizeof(reply);
+    if (int status = (*effectHandle)
+                             ->command(effectHandle, EFFECT_CMD_SET_CONFIG, sizeof(effect_config_t),
+                                       &config, &replySize, &reply);
+        status != 0) {
+        ALOGE("command returned an error = %d\n", status);
+        return nullptr;
+    }
+
+    if (int status = (*effectHandle)
+                             ->command(effectHandle, EFFECT_CMD_ENABLE, sizeof(effect_config_t),
+                                       &config, &replySize, &reply);
+        status != 0) {
+        ALOGE("command returned an error = %d\n", status);
+        return nullptr;
+    }
+    return effectHandle;
+}
+
 /*******************************************************************
  * A test result running on Pixel 5 for comparison.
  * The first parameter indicates the sample rate.
@@ -99,35 +138,8 @@ static void BM_SPATIALIZER(benchmark::State& state) {
         in = dis(gen);
     }
 
-    effect_handle_t effectHandle = nullptr;
-    if (int status = AUDIO_EFFECT_LIBRARY_INFO_SYM.create_effect(&kEffectUuid, 1 /* sessionId */,
-                                                                 1 /* ioId */, &effectHandle);
-        status != 0) {
-        ALOGE("create_effect returned an error = %d\n", status);
-        return;
-    }
-
-    effect_config_t config{};
-    config.inputCfg.samplingRate = config.outputCfg.samplingRate = sampleRate;
-    config.inputCfg.channels = kInputChMask;
-    config.outputCfg.channels = AUDIO_CHANNEL_OUT_STEREO;
-    config.inputCfg.format = config.outputCfg.format = AUDIO_FORMAT_PCM_FLOAT;
-
-    int reply = 0;
-    uint32_t replySize = sizeof(reply);
-    if (int status = (*effectHandle)
-                             ->command(effectHandle, EFFECT_CMD_SET_CONFIG, sizeof(effect_config_t),
-                                       &config, &replySize, &reply);
-        status != 0) {
-        ALOGE("command returned an error = %d\n", status);
-        return;
-    }
-
-    if (int status = (*effectHandle)
-                             ->command(effectHandle, EFFECT_CMD_ENABLE, sizeof(effect_config_t),
-                                       &config, &replySize, &reply);
-        status != 0) {
-        ALOGE("command returned an error = %d\n", status);
+    effect_handle_t effectHandle = createEffect(sampleRate);
+    if (effectHandle == nullptr) {
         return;
     }
 
@@ -162,4 +174,103 @@ static void SPATIALIZERArgs(benchmark::internal::Benchmark* b) {
 
 BENCHMARK(BM_SPATIALIZER)->Apply(SPATIALIZERArgs);
 
+/*
+ * Renders several streams of the same channel layout for the same head pose, as media and game
+ * playback do when both are spatialized.
+ * The first parameter is the number of streams.
+ * The second parameter selects the rendering:
+ * 0: one spatializer per stream, the binaural outputs are summed afterwards.
+ * 1: mixed, the streams are summed into one bed rendered by a single spatializer, as the
+ *    SpatializerThread mixes its tracks before its output stage effect. The HRTF filters and the
+ *    pose interpolation then run once for all the streams.
+ * This compares the framework mixing to separate effect instances. It does not measure a
+ * batched rendering entry point: the effect interface processes one input buffer per call,
+ * and the renderer behind it is not part of this tree.
+ */
+static void BM_SPATIALIZER_STREAMS(benchmark::State& state) {
+    const size_t streamCount = state.range(0);
+    const bool mixed = state.range(1) != 0;
+    constexpr size_t sampleRate = 48000;
+    constexpr size_t frameCount = 10 /* durationMs */ * sampleRate / 1000;
+    const size_t inputChannelCount = audio_channel_count_from_out_mask(kInputChMask);
+    const size_t outputChannelCount = audio_channel_count_from_out_mask(AUDIO_CHANNEL_OUT_STEREO);
+
+    std::minstd_rand gen(kInputChMask);
+    std::uniform_real_distribution<> dis(kMinAmplitude, kMaxAmplitude);
+    std::vector<std::vector<float>> inputs(streamCount);
+    for (auto& input : inputs) {
+        input.resize(frameCount * inputChannelCount);
+        for (auto& in : input) {
+            in = dis(gen);
+        }
+    }
+
+    std::vector<effect_handle_t> effectHandles;
+    for (size_t i = 0; i < (mixed ? 1 : streamCount); ++i) {
+        effect_handle_t effectHandle = createEffect(sampleRate);
+        if (effectHandle == nullptr) {
+            for (auto handle : effectHandles) {
+                AUDIO_EFFECT_LIBRARY_INFO_SYM.release_effect(handle);
+            }
+            return;
+        }
+        effectHandles.push_back(effectHandle);
+    }
+
+    std::vector<float> bed(frameCount * inputChannelCount);
+    std::vector<float> streamOutput(frameCount * outputChannelCount);
+    std::vector<float> output(frameCount * outputChannelCount);
+    for (auto _ : state) {
+        for (const auto& input : inputs) {
+            benchmark::DoNotOptimize(input.data());
+        }
+        benchmark::DoNotOptimize(output.data());
+
+        if (mixed) {
+            bed = inputs[0];
+            for (size_t i = 1; i < streamCount; ++i) {
+                for (size_t j = 0; j < bed.size(); ++j) {
+                    bed[j] += inputs[i][j];
+                }
+            }
+            audio_buffer_t inBuffer = {.frameCount = frameCount, .f32 = bed.data()};
+            audio_buffer_t outBuffer = {.frameCount = frameCount, .f32 = output.data()};
+            (*effectHandles[0])->process(effectHandles[0], &inBuffer, &outBuffer);
+        } else {
+            for (size_t i = 0; i < streamCount; ++i) {
+                audio_buffer_t inBuffer = {.frameCount = frameCount, .f32 = inputs[i].data()};
+                audio_buffer_t outBuffer = {.frameCount = frameCount,
+                                            .f32 = i == 0 ? output.data() : streamOutput.data()};
+                (*effectHandles[i])->process(effectHandles[i], &inBuffer, &outBuffer);
+                if (i > 0) {
+                    for (size_t j = 0; j < output.size(); ++j) {
+                        output[j] += streamOutput[j];
+                    }
+                }
+            }
+        }
+
+        benchmark::ClobberMemory();
+    }
+
+    state.SetComplexityN(streamCount);
+    state.SetLabel(mixed ? "mixed" : "per stream");
+
+    for (auto handle : effectHandles) {
+        if (int status = AUDIO_EFFECT_LIBRARY_INFO_SYM.release_effect(handle); status != 0) {
+            ALOGE("release_effect returned an error = %d\n", status);
+        }
+    }
+}
+
+static void SPATIALIZERStreamsArgs(benchmark::internal::Benchmark* b) {
+    for (int streams = 1; streams <= 4; ++streams) {
+        for (int mixed = 0; mixed <= 1; ++mixed) {
+            b->Args({streams, mixed});
+        }
+    }
+}
+
+BENCHMARK(BM_SPATIALIZER_STREAMS)->Apply(SPATIALIZERStreamsArgs);
+
 BENCHMARK_MAIN();
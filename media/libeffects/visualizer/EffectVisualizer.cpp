@@ -20,17 +20,28 @@
 #include <assert.h>
 #include <inttypes.h>
 #include <math.h>
+#include <pthread.h>
+#include <sched.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/resource.h>
 #include <time.h>
+#include <unistd.h>
 
 #include <algorithm> // max
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <new>
+#include <thread>
 
 #include <log/log.h>
+#include <pffft.h>
 
 #include <audio_effects/effect_visualizer.h>
 #include <audio_utils/primitives.h>
+#include <media/VisualizerSpectrum.h>
 
 #ifdef BUILD_FLOAT
 
@@ -78,6 +89,19 @@ enum visualizer_state_e {
 // maximum number of buffers for which we keep track of the measurements
 #define MEASUREMENT_WINDOW_MAX_SIZE_IN_BUFFERS 25 // note: buffer index is stored in uint8_t
 
+// the spectrum worker exits after this long without VISUALIZER_CMD_FFT
+#define SPECTRUM_IDLE_TIME_MS MAX_STALL_TIME_MS
+
+// bounds of the period at which the spectrum worker refreshes the spectrum
+#define SPECTRUM_MIN_PERIOD_MS 10
+#define SPECTRUM_MAX_PERIOD_MS 100
+
+#define SPECTRUM_THREAD_NICE 10 // ANDROID_PRIORITY_BACKGROUND
+
+// number of times the spectrum worker reads a capture which the audio thread overwrote while
+// it was read, before it skips a refresh
+#define SPECTRUM_READ_RETRIES 3
+
 
 struct BufferStats {
     bool mIsValid;
@@ -85,10 +109,19 @@ struct BufferStats {
     float mRmsSquared; // the average square of the samples in a buffer
 };
 
+// What the spectrum worker is asked to compute, updated by each VISUALIZER_CMD_FFT
+struct SpectrumRequest {
+    uint32_t mCaptureSize;
+    uint32_t mLatency;
+    uint32_t mSamplingRate;
+};
+
 struct VisualizerContext {
     const struct effect_interface_s *mItfe;
     effect_config_t mConfig;
-    uint32_t mCaptureIdx;
+    std::atomic<uint32_t> mCaptureIdx; // written by the audio thread only
+    // odd while the audio thread writes mCaptureBuf, see Visualizer_readCaptureConsistent()
+    std::atomic<uint32_t> mCaptureSeq{0};
     uint32_t mCaptureSize;
     uint32_t mScalingMode;
     uint8_t mState;
@@ -102,6 +135,16 @@ struct VisualizerContext {
     uint8_t mMeasurementWindowSizeInBuffers;
     uint8_t mMeasurementBufferIdx;
     BufferStats mPastMeasurements[MEASUREMENT_WINDOW_MAX_SIZE_IN_BUFFERS];
+    // for native spectrum capture, see Visualizer_spectrumThread()
+    std::mutex mSpectrumLock;
+    std::condition_variable mSpectrumCv;
+    std::thread mSpectrumThread;
+    bool mSpectrumRunning = false;  // following fields are guarded by mSpectrumLock
+    bool mSpectrumExit = false;
+    int64_t mSpectrumRequestNs = 0;
+    SpectrumRequest mSpectrumRequest{};
+    uint32_t mSpectrumSize = 0;     // 0 until a spectrum is available
+    uint8_t mSpectrum[VISUALIZER_CAPTURE_SIZE_MAX];
 };
 
 //
@@ -124,9 +167,226 @@ uint32_t Visualizer_getDeltaTimeMsFromUpdatedTime(VisualizerContext* pContext) {
     return deltaMs;
 }
 
+static int64_t Visualizer_nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+//----------------------------------------------------------------------------
+// Visualizer_readCapture()
+//----------------------------------------------------------------------------
+// Purpose: Copy the last captureSize samples of the capture buffer, latencyMs before
+//  captureIdx.
+//
+//----------------------------------------------------------------------------
+
+static void Visualizer_readCapture(const VisualizerContext *pContext, uint8_t *pDst,
+        uint32_t captureSize, uint32_t captureIdx, int32_t latencyMs, uint32_t samplingRate)
+{
+    if (latencyMs < 0) {
+        latencyMs = 0;
+    }
+    uint32_t deltaSmpl = captureSize + samplingRate * latencyMs / 1000;
+
+    // large sample rate, latency, or capture size, could cause overflow.
+    // do not offset more than the size of buffer.
+    if (deltaSmpl > CAPTURE_BUF_SIZE) {
+        android_errorWriteLog(0x534e4554, "31781965");
+        deltaSmpl = CAPTURE_BUF_SIZE;
+    }
+
+    int32_t capturePoint;
+    //capturePoint = (int32_t)captureIdx - deltaSmpl;
+    __builtin_sub_overflow((int32_t)captureIdx, deltaSmpl, &capturePoint);
+    // a negative capturePoint means we wrap the buffer.
+    if (capturePoint < 0) {
+        uint32_t size = -capturePoint;
+        if (size > captureSize) {
+            size = captureSize;
+        }
+        memcpy(pDst, pContext->mCaptureBuf + CAPTURE_BUF_SIZE + capturePoint, size);
+        pDst += size;
+        captureSize -= size;
+        capturePoint = 0;
+    }
+    memcpy(pDst, pContext->mCaptureBuf + capturePoint, captureSize);
+}
+
+//----------------------------------------------------------------------------
+// Visualizer_readCaptureConsistent()
+//----------------------------------------------------------------------------
+// Purpose: Read a capture like Visualizer_readCapture() from a thread other than the
+//  audio thread. mCaptureSeq makes mCaptureBuf a seqlock: the read is retried if the audio
+//  thread wrote the buffer meanwhile, up to SPECTRUM_READ_RETRIES times.
+//  Returns false if no consistent capture could be read.
+//
+//----------------------------------------------------------------------------
+
+static bool Visualizer_readCaptureConsistent(const VisualizerContext *pContext, uint8_t *pDst,
+        uint32_t captureSize, int32_t latencyMs, uint32_t samplingRate)
+{
+    for (int i = 0; i <= SPECTRUM_READ_RETRIES; ++i) {
+        const uint32_t seq = pContext->mCaptureSeq.load(std::memory_order_acquire);
+        if ((seq & 1) == 0) {
+            const uint32_t captureIdx = pContext->mCaptureIdx.load(std::memory_order_acquire);
+            Visualizer_readCapture(pContext, pDst, captureSize, captureIdx, latencyMs,
+                    samplingRate);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (pContext->mCaptureSeq.load(std::memory_order_relaxed) == seq) {
+                return true;
+            }
+        }
+        sched_yield(); // the audio thread only writes a buffer's worth of samples
+    }
+    return false;
+}
+
+//----------------------------------------------------------------------------
+// Visualizer_computeSpectrum()
+//----------------------------------------------------------------------------
+// Purpose: Compute the getFft() spectrum of a capture, see Visualizer_packSpectrum().
+//
+//----------------------------------------------------------------------------
+
+static void Visualizer_computeSpectrum(PFFFT_Setup *setup, const uint8_t *capture,
+        uint32_t captureSize, float *data, float *work, uint8_t *pSpectrum)
+{
+    android::Visualizer_unpackCapture(capture, captureSize, data);
+    pffft_transform_ordered(setup, data, data, work, PFFFT_FORWARD);
+    android::Visualizer_packSpectrum(data, captureSize, pSpectrum);
+}
+
+//----------------------------------------------------------------------------
+// Visualizer_spectrumThread()
+//----------------------------------------------------------------------------
+// Purpose: Refresh the spectrum returned by VISUALIZER_CMD_FFT from the capture buffer,
+//  at the rate of the capture. The audio thread only fills the capture buffer.
+//  The thread exits when no spectrum was requested for SPECTRUM_IDLE_TIME_MS.
+//
+//----------------------------------------------------------------------------
+
+static void Visualizer_spectrumThread(VisualizerContext *pContext)
+{
+    pthread_setname_np(pthread_self(), "VisualizerFft");
+    setpriority(PRIO_PROCESS, gettid(), SPECTRUM_THREAD_NICE);
+
+    float *data = (float *)pffft_aligned_malloc(VISUALIZER_CAPTURE_SIZE_MAX * sizeof(float));
+    float *work = (float *)pffft_aligned_malloc(VISUALIZER_CAPTURE_SIZE_MAX * sizeof(float));
+    PFFFT_Setup *setup = NULL;
+    uint32_t setupSize = 0;
+    uint8_t capture[VISUALIZER_CAPTURE_SIZE_MAX];
+    uint8_t spectrum[VISUALIZER_CAPTURE_SIZE_MAX];
+    uint32_t lastCaptureIdx = pContext->mCaptureIdx.load(std::memory_order_acquire);
+    int64_t lastCaptureNs = Visualizer_nowNs();
+
+    std::unique_lock lock(pContext->mSpectrumLock);
+    while (!pContext->mSpectrumExit) {
+        const int64_t nowNs = Visualizer_nowNs();
+        if (nowNs - pContext->mSpectrumRequestNs > SPECTRUM_IDLE_TIME_MS * 1000000LL) {
+            ALOGV("spectrum worker going to idle");
+            break;
+        }
+        const SpectrumRequest request = pContext->mSpectrumRequest;
+        lock.unlock();
+
+        if (request.mCaptureSize != setupSize) {
+            if (setup != NULL) {
+                pffft_destroy_setup(setup);
+            }
+            setup = pffft_new_setup(request.mCaptureSize, PFFFT_REAL);
+            setupSize = request.mCaptureSize;
+        }
+        const uint32_t captureIdx = pContext->mCaptureIdx.load(std::memory_order_acquire);
+        if (captureIdx != lastCaptureIdx) {
+            lastCaptureIdx = captureIdx;
+            lastCaptureNs = nowNs;
+        }
+        const int32_t deltaMs = (nowNs - lastCaptureNs) / 1000000;
+        bool refreshed = true;
+        if (deltaMs > MAX_STALL_TIME_MS) {
+            // the framework has stopped playing audio
+            memset(spectrum, 0, request.mCaptureSize);
+        } else if (Visualizer_readCaptureConsistent(pContext, capture, request.mCaptureSize,
+                (int32_t)request.mLatency - deltaMs, request.mSamplingRate)) {
+            Visualizer_computeSpectrum(setup, capture, request.mCaptureSize, data, work,
+                    spectrum);
+        } else {
+            ALOGV("spectrum worker keeps the previous spectrum");
+            refreshed = false;
+        }
+
+        lock.lock();
+        if (refreshed) {
+            memcpy(pContext->mSpectrum, spectrum, request.mCaptureSize);
+            pContext->mSpectrumSize = request.mCaptureSize;
+        }
+        const uint32_t periodMs = std::clamp<uint32_t>(
+                request.mCaptureSize * 1000 / std::max(request.mSamplingRate, 1u),
+                SPECTRUM_MIN_PERIOD_MS, SPECTRUM_MAX_PERIOD_MS);
+        pContext->mSpectrumCv.wait_for(lock, std::chrono::milliseconds(periodMs));
+    }
+    pContext->mSpectrumRunning = false;
+    lock.unlock();
+
+    if (setup != NULL) {
+        pffft_destroy_setup(setup);
+    }
+    pffft_aligned_free(work);
+    pffft_aligned_free(data);
+}
+
+//----------------------------------------------------------------------------
+// Visualizer_getSpectrum()
+//----------------------------------------------------------------------------
+// Purpose: Return the latest spectrum, and start the spectrum worker if needed.
+//  Until the worker has produced a spectrum of captureSize, the spectrum is silent.
+//
+//----------------------------------------------------------------------------
+
+static void Visualizer_getSpectrum(VisualizerContext *pContext, uint8_t *pSpectrum,
+        uint32_t captureSize)
+{
+    std::lock_guard lock(pContext->mSpectrumLock);
+    pContext->mSpectrumRequestNs = Visualizer_nowNs();
+    pContext->mSpectrumRequest = {
+        .mCaptureSize = captureSize,
+        .mLatency = pContext->mLatency,
+        .mSamplingRate = pContext->mConfig.inputCfg.samplingRate,
+    };
+    if (!pContext->mSpectrumRunning) {
+        if (pContext->mSpectrumThread.joinable()) {
+            pContext->mSpectrumThread.join(); // the worker went idle and has exited
+        }
+        pContext->mSpectrumSize = 0;
+        pContext->mSpectrumExit = false;
+        pContext->mSpectrumRunning = true;
+        pContext->mSpectrumThread = std::thread(Visualizer_spectrumThread, pContext);
+    }
+    if (pContext->mSpectrumSize == captureSize) {
+        memcpy(pSpectrum, pContext->mSpectrum, captureSize);
+    } else {
+        memset(pSpectrum, 0, captureSize);
+    }
+}
+
+static void Visualizer_stopSpectrum(VisualizerContext *pContext)
+{
+    {
+        std::lock_guard lock(pContext->mSpectrumLock);
+        pContext->mSpectrumExit = true;
+    }
+    pContext->mSpectrumCv.notify_one();
+    if (pContext->mSpectrumThread.joinable()) {
+        pContext->mSpectrumThread.join();
+    }
+}
+
 
 void Visualizer_reset(VisualizerContext *pContext)
 {
+    // the spectrum worker only expects the audio thread to write the capture buffer
+    Visualizer_stopSpectrum(pContext);
     pContext->mCaptureIdx = 0;
     pContext->mLastCaptureIdx = 0;
     pContext->mBufferUpdateTime.tv_sec = 0;
@@ -292,6 +552,7 @@ int VisualizerLib_Release(effect_handle_t handle) {
         return -EINVAL;
     }
     pContext->mState = VISUALIZER_STATE_UNINITIALIZED;
+    Visualizer_stopSpectrum(pContext);
     delete pContext;
 
     return 0;
@@ -341,11 +602,8 @@ int Visualizer_process(
         float rmsSqAcc = 0;
 
 #ifdef BUILD_FLOAT
-        float maxSample = 0.f;
-        for (size_t inIdx = 0; inIdx < sampleLen; ++inIdx) {
-            maxSample = fmax(maxSample, fabs(inBuffer->f32[inIdx]));
-            rmsSqAcc += inBuffer->f32[inIdx] * inBuffer->f32[inIdx];
-        }
+        float maxSample;
+        android::Visualizer_peakRms(inBuffer->f32, sampleLen, &maxSample, &rmsSqAcc);
         maxSample *= 1 << 15; // scale to int16_t, with exactly 1 << 15 representing positive num.
         rmsSqAcc *= 1 << 30; // scale to int16_t * 2
 #else
@@ -429,7 +687,11 @@ int Visualizer_process(
     uint32_t captIdx;
     uint32_t inIdx;
     uint8_t *buf = pContext->mCaptureBuf;
-    for (inIdx = 0, captIdx = pContext->mCaptureIdx;
+    // readers on other threads retry while the sequence is odd or has changed
+    const uint32_t captureSeq = pContext->mCaptureSeq.load(std::memory_order_relaxed);
+    pContext->mCaptureSeq.store(captureSeq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (inIdx = 0, captIdx = pContext->mCaptureIdx.load(std::memory_order_relaxed);
          inIdx < sampleLen;
          captIdx++) {
         if (captIdx >= CAPTURE_BUF_SIZE) captIdx = 0; // wrap
@@ -447,9 +709,11 @@ int Visualizer_process(
 #endif // BUILD_FLOAT
     }
 
-    // XXX the following two should really be atomic, though it probably doesn't
-    // matter much for visualization purposes
-    pContext->mCaptureIdx = captIdx;
+    // publish the samples to the spectrum worker
+    pContext->mCaptureIdx.store(captIdx, std::memory_order_release);
+    pContext->mCaptureSeq.store(captureSeq + 2, std::memory_order_release);
+    // XXX the time stamp should really be updated atomically with the index, though it probably
+    // doesn't matter much for visualization purposes
     // update last buffer update time stamp
     if (clock_gettime(CLOCK_MONOTONIC, &pContext->mBufferUpdateTime) < 0) {
         pContext->mBufferUpdateTime.tv_sec = 0;
@@ -535,6 +799,7 @@ int Visualizer_command(effect_handle_t self, uint32_t cmdCode, uint32_t cmdSize,
             return -ENOSYS;
         }
         pContext->mState = VISUALIZER_STATE_INITIALIZED;
+        Visualizer_stopSpectrum(pContext);
         ALOGV("EFFECT_CMD_DISABLE() OK");
         *(int *)pReplyData = 0;
         break;
@@ -645,40 +910,9 @@ int Visualizer_command(effect_handle_t self, uint32_t cmdCode, uint32_t cmdSize,
                     pContext->mBufferUpdateTime.tv_sec = 0;
                     memset(pReplyData, 0x80, captureSize);
             } else {
-                int32_t latencyMs = pContext->mLatency;
-                latencyMs -= deltaMs;
-                if (latencyMs < 0) {
-                    latencyMs = 0;
-                }
-                uint32_t deltaSmpl = captureSize
-                        + pContext->mConfig.inputCfg.samplingRate * latencyMs / 1000;
-
-                // large sample rate, latency, or capture size, could cause overflow.
-                // do not offset more than the size of buffer.
-                if (deltaSmpl > CAPTURE_BUF_SIZE) {
-                    android_errorWriteLog(0x534e4554, "31781965");
-                    deltaSmpl = CAPTURE_BUF_SIZE;
-                }
-
-                int32_t capturePoint;
-                //capturePoint = (int32_t)pContext->mCaptureIdx - deltaSmpl;
-                __builtin_sub_overflow((int32_t)pContext->mCaptureIdx, deltaSmpl, &capturePoint);
-                // a negative capturePoint means we wrap the buffer.
-                if (capturePoint < 0) {
-                    uint32_t size = -capturePoint;
-                    if (size > captureSize) {
-                        size = captureSize;
-                    }
-                    memcpy(pReplyData,
-                           pContext->mCaptureBuf + CAPTURE_BUF_SIZE + capturePoint,
-                           size);
-                    pReplyData = (char *)pReplyData + size;
-                    captureSize -= size;
-                    capturePoint = 0;
-                }
-                memcpy(pReplyData,
-                       pContext->mCaptureBuf + capturePoint,
-                       captureSize);
+                Visualizer_readCapture(pContext, (uint8_t *)pReplyData, captureSize,
+                        pContext->mCaptureIdx, (int32_t)pContext->mLatency - (int32_t)deltaMs,
+                        pContext->mConfig.inputCfg.samplingRate);
             }
 
             pContext->mLastCaptureIdx = pContext->mCaptureIdx;
@@ -688,6 +922,25 @@ int Visualizer_command(effect_handle_t self, uint32_t cmdCode, uint32_t cmdSize,
 
         } break;
 
+    case VISUALIZER_CMD_FFT: {
+        const uint32_t captureSize = pContext->mCaptureSize;
+        if (pReplyData == NULL || replySize == NULL || *replySize != captureSize) {
+            ALOGV("VISUALIZER_CMD_FFT() error *replySize %" PRIu32 " captureSize %" PRIu32,
+                    replySize == NULL ? 0 : *replySize, captureSize);
+            return -EINVAL;
+        }
+        // pffft real transforms need a multiple of 32 points
+        if (captureSize < VISUALIZER_CAPTURE_SIZE_MIN || captureSize % 32 != 0) {
+            ALOGV("VISUALIZER_CMD_FFT() unsupported captureSize %" PRIu32, captureSize);
+            return -EINVAL;
+        }
+        if (pContext->mState == VISUALIZER_STATE_ACTIVE) {
+            Visualizer_getSpectrum(pContext, (uint8_t *)pReplyData, captureSize);
+        } else {
+            memset(pReplyData, 0, captureSize);
+        }
+        } break;
+
     case VISUALIZER_CMD_MEASURE: {
         if (pReplyData == NULL || replySize == NULL ||
                 *replySize < (sizeof(int32_t) * MEASUREMENT_COUNT)) {
@@ -22,6 +22,7 @@
 
 #include <android/binder_status.h>
 #include <audio_utils/primitives.h>
+#include <media/VisualizerSpectrum.h>
 #include <system/audio.h>
 #include <Utils.h>
 
@@ -254,12 +255,9 @@ IEffect::Status VisualizerContext::process(float* in, float* out, int samples) {
     // perform measurements if needed
     if (mMeasurementMode == Visualizer::MeasurementMode::PEAK_RMS) {
         // find the peak and RMS squared for the new buffer
-        float rmsSqAcc = 0;
-        float maxSample = 0.f;
-        for (size_t inIdx = 0; inIdx < (unsigned) samples; ++inIdx) {
-            maxSample = fmax(maxSample, fabs(in[inIdx]));
-            rmsSqAcc += in[inIdx] * in[inIdx];
-        }
+        float rmsSqAcc;
+        float maxSample;
+        ::android::Visualizer_peakRms(in, samples, &maxSample, &rmsSqAcc);
         maxSample *= 1 << 15; // scale to int16_t, with exactly 1 << 15 representing positive num.
         rmsSqAcc *= 1 << 30; // scale to int16_t * 2
         mPastMeasurements[mMeasurementBufferIdx] = {.mIsValid = true,
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <system/audio_effects/effect_visualizer.h>
+
+/*
+ * Native spectrum capture, an extension of the visualizer commands of effect_visualizer.h.
+ *
+ * Command and response:
+ *  - cmdCode: VISUALIZER_CMD_FFT
+ *  - cmdSize: 0
+ *  - psize: VISUALIZER_CMD_CAPTURE capture size
+ *  - data: the spectrum of the latest capture, as returned by the framework Visualizer
+ *      getFft(): {Rf0, Rf(n/2), Rf1, If1, Rf2, If2, ...} as signed 8 bit values, scaled as
+ *      described in Visualizer_packSpectrum(). The spectrum is all zeroes while the
+ *      visualizer is not active.
+ * The spectrum is computed off the audio thread: by a worker of the effect for the legacy
+ * effect HAL, and by the conversion layer of the framework for the AIDL effect HAL.
+ */
+#define VISUALIZER_CMD_FFT (VISUALIZER_CMD_MEASURE + 1)
+
+namespace android {
+
+/*
+ * Finds the peak absolute value and the sum of squares of sampleCount samples, four at a time.
+ */
+inline void Visualizer_peakRms(const float* in, size_t sampleCount, float* pPeak,
+                               float* pSumSq) {
+    typedef float float_x4 __attribute__((vector_size(4 * sizeof(float))));
+    typedef int32_t int32_x4 __attribute__((vector_size(4 * sizeof(int32_t))));
+
+    float_x4 peak{};
+    float_x4 sumSq{};
+    size_t i = 0;
+    for (; i + 4 <= sampleCount; i += 4) {
+        float_x4 x;
+        memcpy(&x, in + i, sizeof(x));  // input is not aligned on a vector boundary
+        const float_x4 absX = (float_x4)((int32_x4)x & 0x7fffffff);
+        const int32_x4 greater = absX > peak;
+        peak = (float_x4)(((int32_x4)absX & greater) | ((int32_x4)peak & ~greater));
+        sumSq += x * x;
+    }
+    float maxSample = fmax(fmax(peak[0], peak[1]), fmax(peak[2], peak[3]));
+    float sumSqAcc = (sumSq[0] + sumSq[1]) + (sumSq[2] + sumSq[3]);
+    for (; i < sampleCount; ++i) {
+        maxSample = fmax(maxSample, fabs(in[i]));
+        sumSqAcc += in[i] * in[i];
+    }
+    *pPeak = maxSample;
+    *pSumSq = sumSqAcc;
+}
+
+/*
+ * Converts a capture of 8 bit unsigned samples to the input of a real FFT.
+ */
+inline void Visualizer_unpackCapture(const uint8_t* capture, uint32_t captureSize, float* pData) {
+    for (uint32_t i = 0; i < captureSize; ++i) {
+        pData[i] = (int8_t)(capture[i] ^ 0x80);
+    }
+}
+
+/*
+ * Converts the ordered, unscaled, real forward FFT of Visualizer_unpackCapture() to the
+ * 8 bit spectrum of VISUALIZER_CMD_FFT: fft holds {Rf0, Rf(n/2), Rf1, If1, ...}, as returned by
+ * pffft_transform_ordered().
+ *
+ * This matches the scaling of the framework getFft(): it runs the audio_utils fixed_fft_real()
+ * on the samples shifted left by 8 bits, where every radix 2 stage halves so that the result
+ * is scaled by 1 / captureSize, and keeps bits 5 to 12 of each 16 bit result: the spectrum is
+ * 8 / captureSize times the FFT, rounded down. Values out of the 8 bit range are halved until
+ * they fit, instead of being clamped, which keeps the relative level of the strongest bins.
+ */
+inline void Visualizer_packSpectrum(const float* fft, uint32_t captureSize, uint8_t* pSpectrum) {
+    const float scale = 8.f / captureSize;
+    for (uint32_t i = 0; i < captureSize; ++i) {
+        int32_t value = (int32_t)floorf(fft[i] * scale);
+        while (value > 127 || value < -128) {
+            value >>= 1;
+        }
+        pSpectrum[i] = (uint8_t)(int8_t)value;
+    }
+}
+
+}  // namespace android
@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <math.h>
+
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <media/VisualizerSpectrum.h>
+
+using namespace android;
+
+namespace {
+
+constexpr uint32_t kCaptureSize = 1024;
+
+// the ordered real forward FFT, as returned by pffft_transform_ordered()
+std::vector<float> orderedFft(const std::vector<uint8_t>& capture) {
+    const size_t n = capture.size();
+    std::vector<float> samples(n);
+    Visualizer_unpackCapture(capture.data(), n, samples.data());
+    std::vector<float> fft(n);
+    for (size_t k = 0; k <= n / 2; ++k) {
+        double re = 0;
+        double im = 0;
+        for (size_t i = 0; i < n; ++i) {
+            const double phase = -2 * M_PI * ((k * i) % n) / n;
+            re += samples[i] * cos(phase);
+            im += samples[i] * sin(phase);
+        }
+        if (k == 0) {
+            fft[0] = re;
+        } else if (k == n / 2) {
+            fft[1] = re;
+        } else {
+            fft[2 * k] = re;
+            fft[2 * k + 1] = im;
+        }
+    }
+    return fft;
+}
+
+std::vector<int8_t> spectrumOf(const std::vector<uint8_t>& capture) {
+    const std::vector<float> fft = orderedFft(capture);
+    std::vector<uint8_t> spectrum(capture.size());
+    Visualizer_packSpectrum(fft.data(), capture.size(), spectrum.data());
+    return std::vector<int8_t>(spectrum.begin(), spectrum.end());
+}
+
+// a capture of 8 bit unsigned samples
+uint8_t sample(int value) {
+    return (uint8_t)((int8_t)value ^ 0x80);
+}
+
+}  // namespace
+
+TEST(VisualizerSpectrumTest, PeakRmsMatchesScalar) {
+    std::minstd_rand gen(42);
+    std::uniform_real_distribution<float> dist(-1.f, 1.f);
+    for (size_t count : {0, 1, 3, 4, 7, 480, 481}) {
+        std::vector<float> in(count);
+        for (float& value : in) value = dist(gen);
+        float peak = 0;
+        float sumSq = 0;
+        for (float value : in) {
+            peak = fmax(peak, fabs(value));
+            sumSq += value * value;
+        }
+        float vectorPeak;
+        float vectorSumSq;
+        Visualizer_peakRms(in.data(), count, &vectorPeak, &vectorSumSq);
+        EXPECT_EQ(peak, vectorPeak) << count;
+        EXPECT_NEAR(sumSq, vectorSumSq, 1e-4f * count) << count;
+    }
+}
+
+TEST(VisualizerSpectrumTest, SilenceIsZero) {
+    const std::vector<uint8_t> capture(kCaptureSize, 0x80);
+    for (int8_t value : spectrumOf(capture)) {
+        EXPECT_EQ(0, value);
+    }
+}
+
+// The framework scales the FFT by 8 / captureSize: a cosine of amplitude a at bin k has a real
+// part of a * captureSize / 2 there, so it reads 4 * a.
+TEST(VisualizerSpectrumTest, CosineScaling) {
+    constexpr int kAmplitude = 16;
+    constexpr size_t kBin = 32;
+    std::vector<uint8_t> capture(kCaptureSize);
+    for (size_t i = 0; i < kCaptureSize; ++i) {
+        capture[i] = sample(lrint(kAmplitude * cos(2 * M_PI * kBin * i / kCaptureSize)));
+    }
+    const std::vector<int8_t> spectrum = spectrumOf(capture);
+    EXPECT_EQ(4 * kAmplitude, spectrum[2 * kBin]);
+    EXPECT_LE(abs(spectrum[2 * kBin + 1]), 1);
+    for (size_t k = 1; k < kCaptureSize / 2; ++k) {
+        if (k == kBin) continue;
+        EXPECT_LE(abs(spectrum[2 * k]), 1) << k;
+        EXPECT_LE(abs(spectrum[2 * k + 1]), 1) << k;
+    }
+}
+
+// The Nyquist bin is the second value.
+TEST(VisualizerSpectrumTest, NyquistLayout) {
+    constexpr int kAmplitude = 8;
+    std::vector<uint8_t> capture(kCaptureSize);
+    for (size_t i = 0; i < kCaptureSize; ++i) {
+        capture[i] = sample(i % 2 == 0 ? kAmplitude : -kAmplitude);
+    }
+    const std::vector<int8_t> spectrum = spectrumOf(capture);
+    EXPECT_EQ(0, spectrum[0]);
+    EXPECT_EQ(8 * kAmplitude, spectrum[1]);
+}
+
+// Values out of range are halved until they fit, as the framework does, and not clamped.
+TEST(VisualizerSpectrumTest, OutOfRangeIsHalved) {
+    std::vector<uint8_t> capture(kCaptureSize, sample(127));
+    // 8 * 127 = 1016, halved three times
+    EXPECT_EQ(127, spectrumOf(capture)[0]);
+    capture.assign(kCaptureSize, sample(-128));
+    // 8 * -128 = -1024, halved three times
+    EXPECT_EQ(-128, spectrumOf(capture)[0]);
+    capture.assign(kCaptureSize, sample(20));
+    // 8 * 20 = 160, halved once
+    EXPECT_EQ(80, spectrumOf(capture)[0]);
+}
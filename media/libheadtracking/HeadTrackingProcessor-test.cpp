@@ -106,6 +106,33 @@ TEST(HeadTrackingProcessor, Prediction) {
     EXPECT_EQ(processor->getHeadToStagePose(), Pose3f());
 }
 
+TEST(HeadTrackingProcessor, PredictionToPresentationTime) {
+    const Pose3f worldToHead{{1, 2, 3}, Quaternionf::UnitRandom()};
+    const Twist3f headTwist{{4, 5, 6}, quaternionToRotationVector(Quaternionf::UnitRandom()) / 10};
+
+    std::unique_ptr<HeadTrackingProcessor> processor = createHeadTrackingProcessor(
+            Options{.predictionDuration = 2.f}, HeadTrackingMode::WORLD_RELATIVE);
+
+    processor->setPosePredictorType(PosePredictorType::TWIST);
+
+    // Establish a baseline for the drift compensators.
+    processor->setWorldToHeadPose(0, Pose3f(), Twist3f());
+    processor->setWorldToScreenPose(0, Pose3f());
+
+    // The sample is 1 tick old and will be heard 3 ticks from now.
+    processor->setPresentationTimestamp(4);
+    processor->setWorldToHeadPose(0, worldToHead, headTwist);
+    processor->calculate(1);
+    ASSERT_EQ(processor->getActualMode(), HeadTrackingMode::WORLD_RELATIVE);
+    EXPECT_EQ(processor->getHeadToStagePose(), (worldToHead * integrate(headTwist, 4.f)).inverse());
+
+    // Back to the fixed prediction duration.
+    processor->setPresentationTimestamp(std::nullopt);
+    processor->setWorldToHeadPose(0, worldToHead, headTwist);
+    processor->calculate(1);
+    EXPECT_EQ(processor->getHeadToStagePose(), (worldToHead * integrate(headTwist, 2.f)).inverse());
+}
+
 TEST(HeadTrackingProcessor, SmoothModeSwitch) {
     const Pose3f targetHeadToWorld = Pose3f({4, 0, 0}, rotateZ(M_PI / 2));
 
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 #include <inttypes.h>
+#include <algorithm>
 
 #include <android-base/stringprintf.h>
 #include <audio_utils/SimpleLog.h>
@@ -60,8 +61,11 @@ class HeadTrackingProcessorImpl : public HeadTrackingProcessor {
 
     void setWorldToHeadPose(int64_t timestamp, const Pose3f& worldToHead,
                             const Twist3f& headTwist) override {
+        const float predictionDuration = mPresentationTimestamp.has_value()
+                ? std::max<int64_t>(0, mPresentationTimestamp.value() - timestamp)
+                : mOptions.predictionDuration;
         const Pose3f predictedWorldToHead = mPosePredictor.predict(
-                timestamp, worldToHead, headTwist, mOptions.predictionDuration);
+                timestamp, worldToHead, headTwist, predictionDuration);
         mHeadPoseBias.setInput(predictedWorldToHead);
         mHeadStillnessDetector.setInput(timestamp, predictedWorldToHead);
         mWorldToHeadTimestamp = timestamp;
@@ -88,6 +92,10 @@ class HeadTrackingProcessorImpl : public HeadTrackingProcessor {
         mPendingPhysicalToLogicalAngle = physicalToLogicalAngle;
     }
 
+    void setPresentationTimestamp(std::optional<int64_t> timestamp) override {
+        mPresentationTimestamp = timestamp;
+    }
+
     void calculate(int64_t timestamp) override {
         bool screenStable = true;
 
@@ -205,6 +213,7 @@ class HeadTrackingProcessorImpl : public HeadTrackingProcessor {
     float mPendingPhysicalToLogicalAngle = 0;
     std::optional<int64_t> mWorldToHeadTimestamp;
     std::optional<int64_t> mWorldToScreenTimestamp;
+    std::optional<int64_t> mPresentationTimestamp;
     Pose3f mHeadToStagePose;
     PoseBias mHeadPoseBias;
     PoseBias mScreenPoseBias;
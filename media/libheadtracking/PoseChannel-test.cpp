@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "media/PoseChannel.h"
+
+#include "media/QuaternionUtil.h"
+#include "TestUtil.h"
+
+namespace android {
+namespace media {
+namespace {
+
+using Eigen::Quaternionf;
+using Eigen::Vector3f;
+
+TEST(PoseChannel, Initial) {
+    PoseChannel channel;
+    EXPECT_FALSE(channel.read().has_value());
+    EXPECT_EQ(channel.getWriteCount(), 0u);
+}
+
+TEST(PoseChannel, WriteRead) {
+    PoseChannel channel;
+    const PoseSample sample{
+            .timestamp = -1234567890123,
+            .pose = Pose3f({1, 2, 3}, Quaternionf::UnitRandom()),
+            .twist = Twist3f({4, 5, 6}, {7, 8, 9}),
+    };
+    channel.write(sample);
+    EXPECT_EQ(channel.getWriteCount(), 1u);
+
+    const std::optional<PoseSample> result = channel.read();
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result->timestamp, sample.timestamp);
+    EXPECT_EQ(result->pose, sample.pose);
+    EXPECT_EQ(result->twist, sample.twist);
+
+    channel.write(PoseSample{.timestamp = 5});
+    EXPECT_EQ(channel.getWriteCount(), 2u);
+    EXPECT_EQ(channel.read()->timestamp, 5);
+    EXPECT_EQ(channel.read()->pose, Pose3f());
+}
+
+TEST(PoseChannel, Extrapolate) {
+    const PoseSample sample{
+            .timestamp = 10,
+            .pose = Pose3f({1, 2, 3}, Quaternionf::UnitRandom()),
+            .twist = Twist3f({1, 0, 0}, {0, 0, M_PI_4}),
+    };
+    EXPECT_EQ(sample.extrapolate(10), sample.pose);
+    EXPECT_EQ(sample.extrapolate(12), sample.pose * Pose3f(Vector3f{2, 0, 0}, rotateZ(M_PI_2)));
+}
+
+// A reader never observes a mix of two samples.
+TEST(PoseChannel, Concurrent) {
+    PoseChannel channel;
+    constexpr int64_t kWrites = 100000;
+    std::thread writer([&channel] {
+        for (int64_t i = 1; i <= kWrites; ++i) {
+            const float f = i;
+            channel.write(PoseSample{
+                    .timestamp = i,
+                    .pose = Pose3f(Vector3f{f, f, f}),
+                    .twist = Twist3f({f, f, f}, {f, f, f}),
+            });
+        }
+    });
+
+    int64_t last = 0;
+    while (last < kWrites) {
+        const std::optional<PoseSample> sample = channel.read();
+        if (!sample.has_value()) continue;
+        ASSERT_GE(sample->timestamp, last);
+        last = sample->timestamp;
+        const float f = last;
+        ASSERT_EQ(sample->pose.translation(), (Vector3f{f, f, f}));
+        ASSERT_EQ(sample->twist.translationalVelocity(), (Vector3f{f, f, f}));
+        ASSERT_EQ(sample->twist.rotationalVelocity(), (Vector3f{f, f, f}));
+    }
+    writer.join();
+}
+
+}  // namespace
+}  // namespace media
+}  // namespace android
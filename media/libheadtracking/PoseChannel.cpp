@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "media/PoseChannel.h"
+
+#include <sched.h>
+#include <string.h>
+
+namespace android {
+namespace media {
+namespace {
+
+uint32_t toWord(float value) {
+    uint32_t word;
+    memcpy(&word, &value, sizeof(word));
+    return word;
+}
+
+float toFloat(uint32_t word) {
+    float value;
+    memcpy(&value, &word, sizeof(value));
+    return value;
+}
+
+// Tells the CPU that this is a spin-wait loop.
+inline void cpuRelax() {
+#if defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield" ::: "memory");
+#elif defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#endif
+}
+
+}  // namespace
+
+void PoseChannel::write(const PoseSample& sample) {
+    std::array<uint32_t, kWords> words;
+    const uint64_t timestamp = sample.timestamp;
+    words[0] = static_cast<uint32_t>(timestamp);
+    words[1] = static_cast<uint32_t>(timestamp >> 32);
+    size_t i = kTimestampWords;
+    const Eigen::Vector3f translation = sample.pose.translation();
+    const Eigen::Quaternionf rotation = sample.pose.rotation();
+    const Eigen::Vector3f translationalVelocity = sample.twist.translationalVelocity();
+    const Eigen::Vector3f rotationalVelocity = sample.twist.rotationalVelocity();
+    for (float value : {translation.x(), translation.y(), translation.z(),
+                        rotation.w(), rotation.x(), rotation.y(), rotation.z(),
+                        translationalVelocity.x(), translationalVelocity.y(),
+                        translationalVelocity.z(),
+                        rotationalVelocity.x(), rotationalVelocity.y(), rotationalVelocity.z()}) {
+        words[i++] = toWord(value);
+    }
+
+    // single writer, so the sequence is only modified here
+    const uint32_t sequence = mSequence.load(std::memory_order_relaxed);
+    mSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t j = 0; j < kWords; ++j) {
+        mWords[j].store(words[j], std::memory_order_relaxed);
+    }
+    mSequence.store(sequence + 2, std::memory_order_release);
+}
+
+std::optional<PoseSample> PoseChannel::read() const {
+    std::array<uint32_t, kWords> words;
+    bool consistent = false;
+    for (int attempt = 0; attempt < kMaxReadAttempts && !consistent; ++attempt) {
+        if (attempt >= kSpinReadAttempts) {
+            // the writer may have been preempted in the middle of a write
+            sched_yield();
+        } else if (attempt > 0) {
+            cpuRelax();
+        }
+        const uint32_t sequence = mSequence.load(std::memory_order_acquire);
+        if (sequence == 0) {
+            return std::nullopt;
+        }
+        if (sequence & 1) {
+            continue;  // write in progress
+        }
+        for (size_t j = 0; j < kWords; ++j) {
+            words[j] = mWords[j].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        consistent = mSequence.load(std::memory_order_relaxed) == sequence;
+    }
+    if (!consistent) {
+        return std::nullopt;
+    }
+
+    PoseSample sample;
+    sample.timestamp = static_cast<int64_t>(words[0] | (static_cast<uint64_t>(words[1]) << 32));
+    float v[kWords - kTimestampWords];
+    for (size_t j = 0; j < std::size(v); ++j) {
+        v[j] = toFloat(words[kTimestampWords + j]);
+    }
+    sample.pose = Pose3f(Eigen::Vector3f(v[0], v[1], v[2]),
+                         Eigen::Quaternionf(v[3], v[4], v[5], v[6]));
+    sample.twist = Twist3f(Eigen::Vector3f(v[7], v[8], v[9]), Eigen::Vector3f(v[10], v[11], v[12]));
+    return sample;
+}
+
+}  // namespace media
+}  // namespace android
@@ -16,6 +16,7 @@
 #pragma once
 
 #include <limits>
+#include <optional>
 
 #include "HeadTrackingMode.h"
 #include "Pose.h"
@@ -77,6 +78,13 @@ class HeadTrackingProcessor {
      */
     virtual void setDisplayOrientation(float physicalToLogicalAngle) = 0;
 
+    /**
+     * Sets the time at which the audio rendered from the next outputs will be presented.
+     * The following world-to-head poses are then predicted up to that time, instead of by
+     * Options::predictionDuration. nullopt reverts to Options::predictionDuration.
+     */
+    virtual void setPresentationTimestamp(std::optional<int64_t> timestamp) = 0;
+
     /**
      * Process all the previous inputs and update the outputs.
      */
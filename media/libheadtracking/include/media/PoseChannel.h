@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <optional>
+
+#include "Pose.h"
+#include "Twist.h"
+
+namespace android {
+namespace media {
+
+/**
+ * A pose sample, as produced by a pose sensor.
+ */
+struct PoseSample {
+    int64_t timestamp = 0;
+    Pose3f pose;
+    /** Velocity, in the same time units as timestamp. */
+    Twist3f twist;
+
+    /**
+     * Extrapolates the pose to the given time, assuming a constant twist.
+     */
+    Pose3f extrapolate(int64_t atTimestamp) const {
+        return pose * integrate(twist, atTimestamp - timestamp);
+    }
+};
+
+/**
+ * Delivers the latest PoseSample from a writer thread to reader threads, without locks.
+ *
+ * This is a sequence lock: write() never blocks nor waits, and read() only retries when it raced
+ * with a write, which is a few dozen stores long. The sample is held in relaxed atomic words, so
+ * a torn read is detected by the sequence check rather than being a data race.
+ *
+ * read() backs off between retries, first with a CPU relax hint and then by yielding, so that a
+ * writer preempted in the middle of a write gets to finish it. It gives up after
+ * kMaxReadAttempts, in which case the reader keeps using the last sample it read.
+ *
+ * write() must not be called concurrently from several threads. read() is thread-safe.
+ */
+class PoseChannel {
+  public:
+    /** Publishes a sample, replacing the previous one. */
+    void write(const PoseSample& sample);
+
+    /**
+     * Returns the latest sample, or nullopt if none was written, or if no consistent sample
+     * could be read within kMaxReadAttempts because of concurrent writes.
+     */
+    std::optional<PoseSample> read() const;
+
+    /**
+     * Number of samples written so far. A reader can compare it to a previous value to tell
+     * whether a new sample is available.
+     */
+    uint32_t getWriteCount() const { return mSequence.load(std::memory_order_acquire) / 2; }
+
+    /** Number of read attempts before read() gives up. */
+    static constexpr int kMaxReadAttempts = 64;
+
+  private:
+    // read attempts that only spin before read() starts yielding
+    static constexpr int kSpinReadAttempts = 8;
+
+    // timestamp, translation, rotation (w, x, y, z), translational and rotational velocities
+    static constexpr size_t kTimestampWords = 2;
+    static constexpr size_t kWords = kTimestampWords + 3 + 4 + 3 + 3;
+
+    // odd while a write is in progress
+    std::atomic<uint32_t> mSequence{0};
+    std::array<std::atomic<uint32_t>, kWords> mWords{};
+};
+
+}  // namespace media
+}  // namespace android
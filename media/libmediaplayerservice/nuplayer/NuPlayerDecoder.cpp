@@ -112,6 +112,12 @@ sp<AMessage> NuPlayer::Decoder::getStats() {
     mStats->setInt64("frames-dropped-input", mNumInputFramesDropped);
     mStats->setInt64("frames-dropped-output", mNumOutputFramesDropped);
     mStats->setFloat("frame-rate-total", mFrameRateTotal);
+    sp<MediaCodec> codec = mStatsCodec.promote();
+    AString lockStats;
+    if (codec != NULL && codec->getBufferChannelLockStats(&lockStats) == OK
+            && !lockStats.empty()) {
+        mStats->setString("lock-stats", lockStats.c_str());
+    }
 
     // make our own copy, so we aren't victim to any later changes.
     sp<AMessage> copiedStats = mStats->dup();
@@ -378,6 +384,7 @@ void NuPlayer::Decoder::onConfigure(const sp<AMessage> &format) {
         Mutex::Autolock autolock(mStatsLock);
         mStats->setString("mime", mime.c_str());
         mStats->setString("component-name", mComponentName.c_str());
+        mStatsCodec = mCodec;
     }
 
     if (!mIsAudio) {
@@ -1016,6 +1016,16 @@ status_t NuPlayerDriver::dump(
                             ? 0.0 : (double)(numFramesDropped * 100) / numFramesTotal);
             logString.append(buf);
         }
+
+        AString lockStats;
+        if (stats->findString("lock-stats", &lockStats)) {
+            // one line per lock of the codec
+            size_t start = 0;
+            for (ssize_t end; (end = lockStats.find("\n", start)) >= 0; start = end + 1) {
+                logString.append("    lock ");
+                logString.append(lockStats.c_str() + start, end - start + 1);
+            }
+        }
     }
 
     ALOGI("%s", logString.c_str());
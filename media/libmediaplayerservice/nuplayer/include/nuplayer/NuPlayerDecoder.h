@@ -76,6 +76,7 @@ private:
     sp<AMessage> mInputFormat;
     sp<AMessage> mOutputFormat;
     sp<MediaCodec> mCodec;
+    wp<MediaCodec> mStatsCodec;  // guarded by mStatsLock, for getStats()
     sp<ALooper> mCodecLooper;
 
     List<sp<AMessage> > mPendingInputMessages;
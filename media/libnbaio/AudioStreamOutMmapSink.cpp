@@ -0,0 +1,294 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "AudioStreamOutMmapSink"
+//#define LOG_NDEBUG 0
+
+#include <algorithm>
+#include <atomic>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <utils/Log.h>
+#include <utils/Timers.h>
+#include <audio_utils/clock.h>
+#include <media/audiohal/StreamHalInterface.h>
+#include <media/nbaio/AudioStreamOutMmapSink.h>
+
+namespace android {
+
+// static
+sp<AudioStreamOutMmapSink> AudioStreamOutMmapSink::create(
+        const sp<StreamOutHalInterface>& stream, int32_t minSizeFrames)
+{
+    size_t frameSize;
+    status_t status = stream->getFrameSize(&frameSize);
+    if (status != OK || frameSize == 0) {
+        return nullptr;
+    }
+    struct audio_mmap_buffer_info info{};
+    status = stream->createMmapBuffer(minSizeFrames, &info);
+    if (status != OK || info.buffer_size_frames < minSizeFrames) {
+        ALOGV("%s: no MMAP buffer, status %d, %d frames", __func__, status,
+                info.buffer_size_frames);
+        return nullptr;
+    }
+    void *buffer = info.shared_memory_address;
+    size_t mappedBytes = 0;
+    if (buffer == nullptr) {
+        // the HAL only shares a file descriptor, so map the buffer here
+        const size_t bytes = info.buffer_size_frames * frameSize;
+        buffer = info.shared_memory_fd >= 0 ? mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                MAP_SHARED, info.shared_memory_fd, 0 /* offset */) : MAP_FAILED;
+        if (buffer == MAP_FAILED) {
+            ALOGW("%s: cannot map MMAP buffer of %zu bytes: %s", __func__, bytes,
+                    strerror(errno));
+            return nullptr;
+        }
+        mappedBytes = bytes;
+    }
+    ALOGD("%s: MMAP buffer of %d frames, burst %d frames", __func__,
+            info.buffer_size_frames, info.burst_size_frames);
+    return sp<AudioStreamOutMmapSink>(new AudioStreamOutMmapSink(stream, buffer,
+            info.buffer_size_frames, mappedBytes));
+}
+
+AudioStreamOutMmapSink::AudioStreamOutMmapSink(const sp<StreamOutHalInterface>& stream,
+        void *buffer, size_t bufferFrames, size_t mappedBytes) :
+        AudioStreamOutSink(stream),
+        mBuffer(buffer),
+        mBufferFrames(bufferFrames),
+        mMappedBytes(mappedBytes)
+{
+}
+
+AudioStreamOutMmapSink::~AudioStreamOutMmapSink()
+{
+    if (mStarted) {
+        (void) mStream->stop();
+    }
+    if (mMappedBytes != 0) {
+        munmap(mBuffer, mMappedBytes);
+    }
+}
+
+status_t AudioStreamOutMmapSink::start()
+{
+    if (mStarted) {
+        return OK;
+    }
+    memset(mBuffer, 0, mBufferFrames * mFrameSize);
+    status_t status = mStream->start();
+    if (status == OK) {
+        status = updateFramesRead(true /* reset */);
+    }
+    if (status != OK) {
+        ALOGE("%s: cannot start MMAP stream: %d", __func__, status);
+        return status;
+    }
+    mWritePosition = mFramesRead;
+    mStarted = true;
+    return OK;
+}
+
+status_t AudioStreamOutMmapSink::stop()
+{
+    if (!mStarted) {
+        return OK;
+    }
+    mStarted = false;
+    mAcquired = nullptr;
+    return mStream->stop();
+}
+
+status_t AudioStreamOutMmapSink::updateFramesRead(bool reset)
+{
+    struct audio_mmap_position position{};
+    const status_t status = mStream->getMmapPosition(&position);
+    if (status != OK) {
+        return status;
+    }
+    if (reset) {
+        // The position may restart from zero, so only track it relative to here.
+        // Frames written before stop() which the HAL did not read never will be,
+        // so count them as consumed.
+        if (mFramesRead < mWritePosition) {
+            mFramesRead = mWritePosition;
+        } else {
+            mSkippedFrames += mFramesRead - mWritePosition;
+        }
+    } else {
+        // position_frames is 32 bits and may wrap
+        const int32_t consumed =
+                (int32_t) ((uint32_t) position.position_frames - (uint32_t) mLastPosition);
+        if (consumed > 0) {
+            // The HAL will read these frames again after it wraps around,
+            // so leave silence there in case nothing is written before then.
+            silence(mFramesRead, (size_t) consumed);
+        }
+        mFramesRead += consumed;
+    }
+    mLastPosition = position.position_frames;
+    mReadTimeNs = position.time_nanoseconds;
+    return OK;
+}
+
+void AudioStreamOutMmapSink::silence(int64_t position, size_t count)
+{
+    count = std::min(count, mBufferFrames);
+    const size_t offset = position % mBufferFrames;
+    const size_t part1 = std::min(count, mBufferFrames - offset);
+    memset((char *) mBuffer + offset * mFrameSize, 0, part1 * mFrameSize);
+    if (part1 < count) {
+        memset(mBuffer, 0, (count - part1) * mFrameSize);
+    }
+}
+
+status_t AudioStreamOutMmapSink::waitForSpace(size_t count)
+{
+    const int64_t timeoutNs = (int64_t) mBufferFrames * 2 * NANOS_PER_SECOND
+            / Format_sampleRate(mFormat);
+    const nsecs_t deadlineNs = systemTime(SYSTEM_TIME_MONOTONIC) + timeoutNs;
+    for (;;) {
+        const status_t status = updateFramesRead();
+        if (status != OK) {
+            return status;
+        }
+        if (mFramesRead > mWritePosition) {
+            // the HAL has read past what we wrote; never write behind its read position
+            mSkippedFrames += mFramesRead - mWritePosition;
+            mWritePosition = mFramesRead;
+        }
+        const size_t available = mBufferFrames - (size_t) (mWritePosition - mFramesRead);
+        if (available >= count) {
+            return OK;
+        }
+        const nsecs_t nowNs = systemTime(SYSTEM_TIME_MONOTONIC);
+        if (nowNs >= deadlineNs) {
+            ALOGW("%s: timed out waiting for %zu frames, %zu available", __func__, count,
+                    available);
+            return WOULD_BLOCK;
+        }
+        // sleep for about as long as the HAL needs to read the shortfall
+        const int64_t sleepNs = std::min<int64_t>(deadlineNs - nowNs,
+                (int64_t) (count - available) * NANOS_PER_SECOND / Format_sampleRate(mFormat));
+        const struct timespec req = {
+            (time_t) (sleepNs / NANOS_PER_SECOND), (long) (sleepNs % NANOS_PER_SECOND)
+        };
+        nanosleep(&req, nullptr);
+    }
+}
+
+ssize_t AudioStreamOutMmapSink::availableToWrite()
+{
+    if (!mNegotiated) {
+        return NEGOTIATE;
+    }
+    if (!mStarted) {
+        return mBufferFrames;
+    }
+    const status_t status = updateFramesRead();
+    if (status != OK) {
+        return status;
+    }
+    return mBufferFrames - std::min(mBufferFrames,
+            (size_t) std::max<int64_t>(0, mWritePosition - mFramesRead));
+}
+
+void* AudioStreamOutMmapSink::acquire(size_t count)
+{
+    if (!mNegotiated || count > mBufferFrames || start() != OK || waitForSpace(count) != OK) {
+        return nullptr;
+    }
+    const size_t offset = mWritePosition % mBufferFrames;
+    if (offset + count > mBufferFrames) {
+        return nullptr;
+    }
+    void *buffer = (char *) mBuffer + offset * mFrameSize;
+    mAcquired = buffer;
+    mAcquiredFrames = count;
+    return buffer;
+}
+
+void AudioStreamOutMmapSink::release()
+{
+    if (mAcquired != nullptr) {
+        // acquire() returned frames at mWritePosition, which has not moved since
+        silence(mWritePosition, mAcquiredFrames);
+        mAcquired = nullptr;
+    }
+}
+
+status_t AudioStreamOutMmapSink::silenceConsumed()
+{
+    return mStarted ? updateFramesRead() : OK;
+}
+
+ssize_t AudioStreamOutMmapSink::write(const void *buffer, size_t count)
+{
+    if (!mNegotiated) {
+        return NEGOTIATE;
+    }
+    ALOG_ASSERT(Format_isValid(mFormat));
+    status_t status = start();
+    if (status != OK) {
+        return status;
+    }
+    if (count > mBufferFrames) {
+        count = mBufferFrames;
+    }
+    const size_t offset = mWritePosition % mBufferFrames;
+    if (buffer == mAcquired && offset + count <= mBufferFrames) {
+        // rendered in place after acquire(), which already waited for space
+        mAcquired = nullptr;
+        processMel(buffer, count * mFrameSize);
+    } else {
+        mAcquired = nullptr;
+        status = waitForSpace(count);
+        if (status != OK) {
+            return status;
+        }
+        const size_t part1 = std::min(count, mBufferFrames - offset);
+        memcpy((char *) mBuffer + offset * mFrameSize, buffer, part1 * mFrameSize);
+        if (part1 < count) {
+            memcpy(mBuffer, (const char *) buffer + part1 * mFrameSize,
+                    (count - part1) * mFrameSize);
+        }
+        processMel(buffer, count * mFrameSize);
+    }
+    // make the frames visible to the HAL before it reaches them
+    std::atomic_thread_fence(std::memory_order_release);
+    mWritePosition += count;
+    mFramesWritten += count;
+    return count;
+}
+
+status_t AudioStreamOutMmapSink::getTimestamp(ExtendedTimestamp &timestamp)
+{
+    if (!mStarted || updateFramesRead() != OK) {
+        return INVALID_OPERATION;
+    }
+    // report the position in terms of frames written, excluding what the HAL read without us
+    const int64_t position = std::min(mFramesRead, mWritePosition) - mSkippedFrames;
+    if (position < 0) {
+        return INVALID_OPERATION;
+    }
+    timestamp.mPosition[ExtendedTimestamp::LOCATION_KERNEL] = position;
+    timestamp.mTimeNs[ExtendedTimestamp::LOCATION_KERNEL] = mReadTimeNs;
+    return OK;
+}
+
+}   // namespace android
@@ -71,11 +71,7 @@ ssize_t AudioStreamOutSink::write(const void *buffer, size_t count)
     size_t written;
     status_t ret = mStream->write(buffer, count * mFrameSize, &written);
     if (ret == OK && written > 0) {
-        // Send to MelProcessor for sound dose measurement.
-        auto processor = mMelProcessor.load();
-        if (processor) {
-            processor->process(buffer, written);
-        }
+        processMel(buffer, written);
 
         written /= mFrameSize;
         mFramesWritten += written;
@@ -88,6 +84,15 @@ ssize_t AudioStreamOutSink::write(const void *buffer, size_t count)
     }
 }
 
+void AudioStreamOutSink::processMel(const void *buffer, size_t bytes)
+{
+    // Send to MelProcessor for sound dose measurement.
+    auto processor = mMelProcessor.load();
+    if (processor) {
+        processor->process(buffer, bytes);
+    }
+}
+
 status_t AudioStreamOutSink::getTimestamp(ExtendedTimestamp &timestamp)
 {
     uint64_t position64;
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_AUDIO_STREAM_OUT_MMAP_SINK_H
+#define ANDROID_AUDIO_STREAM_OUT_MMAP_SINK_H
+
+#include <media/nbaio/AudioStreamOutSink.h>
+
+namespace android {
+
+// An AudioStreamOutSink for a HAL output stream which exposes an MMAP buffer.
+// Rather than calling StreamOutHalInterface::write(), it writes into the buffer shared with the
+// HAL, and like a blocking HAL write() it waits for room based on the HAL's read position.
+// A caller can also render in place: acquire() returns a pointer into the shared buffer,
+// and passing that pointer to write() then publishes the frames without copying them.
+// The HAL reads the buffer continuously, so the frames it has consumed are replaced by silence
+// whenever its read position is updated; if writes stop, it then plays silence rather than
+// replaying old frames.
+// not multi-thread safe
+class AudioStreamOutMmapSink : public AudioStreamOutSink {
+
+public:
+    // Returns nullptr if the stream cannot provide an MMAP buffer of at least minSizeFrames
+    // which can be accessed from this process.
+    static sp<AudioStreamOutMmapSink> create(const sp<StreamOutHalInterface>& stream,
+            int32_t minSizeFrames);
+    virtual ~AudioStreamOutMmapSink();
+
+    // NBAIO_Sink interface
+
+    virtual ssize_t availableToWrite();
+    virtual ssize_t write(const void *buffer, size_t count);
+    virtual status_t getTimestamp(ExtendedTimestamp &timestamp);
+
+    // NBAIO_Sink end
+
+    // Wait until count frames are free, and return the location of those frames in the shared
+    // buffer, or nullptr if they are not contiguous or there was a timeout or error.
+    // The frames are only counted as written when the pointer is passed to write(), but the HAL
+    // may read them earlier if it underruns, so only acquire frames which will be written.
+    void*   acquire(size_t count);
+
+    // Replace the frames returned by acquire() by silence, if they were not written.
+    void    release();
+
+    // Update the HAL read position, and so silence the frames it consumed since the last update.
+    // Call about once per period while not writing, so that the HAL does not replay old frames.
+    status_t silenceConsumed();
+
+    // Stop the HAL stream, e.g. for standby.  The next write() or acquire() restarts it.
+    status_t stop();
+
+private:
+    AudioStreamOutMmapSink(const sp<StreamOutHalInterface>& stream, void *buffer,
+            size_t bufferFrames, size_t mappedBytes);
+
+    // start the HAL stream if needed, with an empty buffer
+    status_t start();
+    // update mFramesRead from the HAL read position, rebasing the position if reset is true
+    status_t updateFramesRead(bool reset = false);
+    // wait until count frames are free, with a timeout of twice the buffer duration
+    status_t waitForSpace(size_t count);
+    // fill count frames of the shared buffer with silence, starting at position
+    void silence(int64_t position, size_t count);
+
+    void * const        mBuffer;            // shared with the HAL
+    const size_t        mBufferFrames;
+    const size_t        mMappedBytes;       // non-zero if mBuffer was mapped by us
+    bool                mStarted = false;
+    int64_t             mFramesRead = 0;    // HAL read position, extended to 64 bits
+    int64_t             mReadTimeNs = 0;    // time of mFramesRead
+    int32_t             mLastPosition = 0;  // last audio_mmap_position::position_frames
+    int64_t             mWritePosition = 0; // next frame to write, in mFramesRead units
+    int64_t             mSkippedFrames = 0; // frames the HAL read before they were written
+    const void*         mAcquired = nullptr;   // returned by acquire() and not yet written
+    size_t              mAcquiredFrames = 0;   // frame count of mAcquired
+};
+
+}   // namespace android
+
+#endif  // ANDROID_AUDIO_STREAM_OUT_MMAP_SINK_H
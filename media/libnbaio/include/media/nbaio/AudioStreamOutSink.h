@@ -58,8 +58,13 @@ public:
     sp<StreamOutHalInterface> stream() const { return mStream; }
 #endif
 
-private:
+protected:
+    // Send data written to the HAL to the MelProcessor, if any, for sound dose measurement.
+    void processMel(const void *buffer, size_t bytes);
+
     sp<StreamOutHalInterface> mStream;
+
+private:
     size_t              mStreamBufferSizeBytes; // as reported by get_buffer_size()
     mediautils::atomic_sp<audio_utils::MelProcessor> mMelProcessor;
 };
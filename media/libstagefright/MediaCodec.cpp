@@ -3554,6 +3554,15 @@ status_t MediaCodec::getCodecInfo(sp<MediaCodecInfo> *codecInfo) const {
     return OK;
 }
 
+status_t MediaCodec::getBufferChannelLockStats(AString *stats) const {
+    // mBufferChannel is only assigned in init(), before the codec is handed out.
+    if (mBufferChannel == nullptr) {
+        return NO_INIT;
+    }
+    mBufferChannel->dumpLockStats(stats);
+    return OK;
+}
+
 // this is the user-callable entry point
 status_t MediaCodec::getMetrics(mediametrics_handle_t &reply) {
 
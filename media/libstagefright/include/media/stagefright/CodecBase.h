@@ -534,6 +534,11 @@ public:
      * Clear and fill array with output buffers.
      */
     virtual void getOutputBufferArray(Vector<sp<MediaCodecBuffer>> *array) = 0;
+    /**
+     * Append the contention statistics of the internal locks to |out|, one line per lock.
+     * Must be safe to call from any thread.
+     */
+    virtual void dumpLockStats(AString * /* out */) const {}
 
     /**
      * Convert binder IMemory to drm SharedBuffer
@@ -285,6 +285,10 @@ struct MediaCodec : public AHandler {
 
     status_t getCodecInfo(sp<MediaCodecInfo> *codecInfo) const;
 
+    // Appends the lock contention statistics of the buffer channel to |stats|. Unlike the
+    // other getters, this does not go through the looper, so that it can be used for dumps.
+    status_t getBufferChannelLockStats(AString *stats) const;
+
     status_t getMetrics(mediametrics_handle_t &reply);
 
     status_t setParameters(const sp<AMessage> &params);
@@ -18,12 +18,14 @@
 #define LOG_TAG "CodecServiceRegistrant"
 
 #include <android/api-level.h>
+#include <android-base/file.h>
 #include <android-base/logging.h>
 #include <android-base/properties.h>
 #include <android-base/stringprintf.h>
 
 #include <C2Component.h>
 #include <C2PlatformSupport.h>
+#include <ComponentExecutor.h>
 
 #include <android/hidl/manager/1.2/IServiceManager.h>
 #include <codec2/hidl/1.0/ComponentStore.h>
@@ -44,6 +46,7 @@
 
 namespace /* unnamed */ {
 
+using ::android::hardware::hidl_handle;
 using ::android::hardware::hidl_vec;
 using ::android::hardware::hidl_string;
 using ::android::hardware::Return;
@@ -710,6 +713,40 @@ public:
     }
 };
 
+// Appends the stats of the executor the software components run on, if they share one.
+void dumpComponentExecutor(int fd) {
+    std::shared_ptr<::android::ComponentExecutor> executor =
+            ::android::ComponentExecutor::Shared();
+    if (executor && !::android::base::WriteStringToFd(executor->dump(), fd)) {
+        PLOG(WARNING) << "debug -- dumping the component executor failed -- write()";
+    }
+}
+
+// Component stores that also dump the executor of the software components.
+struct SoftwareAidlComponentStore : public c2_aidl::utils::ComponentStore {
+    using c2_aidl::utils::ComponentStore::ComponentStore;
+
+    virtual binder_status_t dump(int fd, const char** args, uint32_t numArgs) override {
+        binder_status_t status = c2_aidl::utils::ComponentStore::dump(fd, args, numArgs);
+        dumpComponentExecutor(fd);
+        return status;
+    }
+};
+
+struct SoftwareHidlComponentStore : public c2_hidl::utils::ComponentStore {
+    using c2_hidl::utils::ComponentStore::ComponentStore;
+
+    virtual Return<void> debug(
+            const hidl_handle& handle, const hidl_vec<hidl_string>& args) override {
+        Return<void> ret = c2_hidl::utils::ComponentStore::debug(handle, args);
+        const native_handle_t *h = handle.getNativeHandle();
+        if (h && h->numFds == 1) {
+            dumpComponentExecutor(h->data[0]);
+        }
+        return ret;
+    }
+};
+
 bool ionPropertiesDefined() {
     using namespace ::android::base;
     std::string heapMask =
@@ -763,9 +800,9 @@ extern "C" void RegisterCodecServices() {
     std::shared_ptr<c2_aidl::IComponentStore> aidlStore;
     const char *hidlVer = "(unknown)";
     if (aidlSelected) {
-        aidlStore = ::ndk::SharedRefBase::make<c2_aidl::utils::ComponentStore>(store);
+        aidlStore = ::ndk::SharedRefBase::make<SoftwareAidlComponentStore>(store);
     } else if (platformVersion >= __ANDROID_API_S__) {
-        hidlStore = ::android::sp<V1_2::utils::ComponentStore>::make(store);
+        hidlStore = ::android::sp<SoftwareHidlComponentStore>::make(store);
         hidlVer = "1.2";
     } else if (platformVersion == __ANDROID_API_R__) {
         hidlStore = ::android::sp<V1_1::utils::ComponentStore>::make(store);
@@ -824,7 +861,7 @@ extern "C" void RegisterCodecServices() {
     if (__builtin_available(android __ANDROID_API_S__, *)) {
         if (AServiceManager_isDeclared(aidlServiceName.c_str())) {
             if (!aidlStore) {
-                aidlStore = ::ndk::SharedRefBase::make<c2_aidl::utils::ComponentStore>(
+                aidlStore = ::ndk::SharedRefBase::make<SoftwareAidlComponentStore>(
                         std::make_shared<H2C2ComponentStore>(nullptr));
             }
             binder_exception_t ex = AServiceManager_addService(
@@ -845,7 +882,7 @@ extern "C" void RegisterCodecServices() {
                     V1_2::utils::ComponentStore::descriptor, "software");
     if (transport == IServiceManager::Transport::HWBINDER) {
         if (!hidlStore) {
-            hidlStore = ::android::sp<V1_2::utils::ComponentStore>::make(
+            hidlStore = ::android::sp<SoftwareHidlComponentStore>::make(
                     std::make_shared<H2C2ComponentStore>(nullptr));
             hidlVer = "1.2";
         }
@@ -17,11 +17,71 @@
 #ifndef STAGEFRIGHT_FOUNDATION_MUTEXED_H_
 #define STAGEFRIGHT_FOUNDATION_MUTEXED_H_
 
+#include <atomic>
+
 #include <utils/Mutex.h>
 #include <utils/Condition.h>
+#include <utils/Timers.h>
 
 namespace android {
 
+/*
+ * Contention statistics of a lock, which can be hooked to a Mutexed<> using setContention().
+ *
+ * Uncontended acquisitions only cost a relaxed atomic increment; the wait time is measured
+ * only when the lock is held by another thread.
+ */
+class LockContention {
+public:
+    struct Stats {
+        uint64_t acquisitions = 0;
+        uint64_t contentions = 0;   // acquisitions that had to wait
+        nsecs_t totalWaitNs = 0;
+        nsecs_t maxWaitNs = 0;
+    };
+
+    LockContention() = default;
+
+    // Locks |lock|, and records whether and how long it had to wait.
+    inline void lock(Mutex &lock) {
+        mAcquisitions.fetch_add(1, std::memory_order_relaxed);
+        if (lock.tryLock() == NO_ERROR) {
+            return;
+        }
+        nsecs_t startNs = systemTime();
+        lock.lock();
+        record(systemTime() - startNs);
+    }
+
+    inline Stats stats() const {
+        Stats stats;
+        stats.acquisitions = mAcquisitions.load(std::memory_order_relaxed);
+        stats.contentions = mContentions.load(std::memory_order_relaxed);
+        stats.totalWaitNs = mTotalWaitNs.load(std::memory_order_relaxed);
+        stats.maxWaitNs = mMaxWaitNs.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+private:
+    inline void record(nsecs_t waitNs) {
+        mContentions.fetch_add(1, std::memory_order_relaxed);
+        mTotalWaitNs.fetch_add(waitNs, std::memory_order_relaxed);
+        nsecs_t maxWaitNs = mMaxWaitNs.load(std::memory_order_relaxed);
+        while (waitNs > maxWaitNs
+                && !mMaxWaitNs.compare_exchange_weak(
+                        maxWaitNs, waitNs, std::memory_order_relaxed)) {
+        }
+    }
+
+    std::atomic<uint64_t> mAcquisitions{0};
+    std::atomic<uint64_t> mContentions{0};
+    std::atomic<nsecs_t> mTotalWaitNs{0};
+    std::atomic<nsecs_t> mMaxWaitNs{0};
+
+    LockContention(const LockContention&) = delete;
+    void operator=(const LockContention&) = delete;
+};
+
 /*
  * Wrapper class to programmatically protect a structure using a mutex.
  *
@@ -79,6 +139,12 @@ namespace android {
  *   data->mVar1 = 3;
  * }
  *
+ * To profile the contention of the mutex, hook a LockContention to it before the Mutexed<> is
+ * shared between threads:
+ *
+ * LockContention mProtectedDataContention;
+ * mProtectedData.setContention(&mProtectedDataContention);
+ *
  */
 
 template<typename T>
@@ -106,6 +172,7 @@ public:
         inline Locked(Locked &&from) noexcept :
             mLock(from.mLock),
             mTreasure(from.mTreasure),
+            mContention(from.mContention),
             mLocked(from.mLocked) {}
         inline ~Locked();
 
@@ -134,8 +201,18 @@ public:
         inline void lock();
 
     private:
+        // locks mLock, through mContention if the Mutexed<> is profiled
+        inline void lockMutex() {
+            if (mContention) {
+                mContention->lock(mLock);
+            } else {
+                mLock.lock();
+            }
+        }
+
         Mutex &mLock;
         T &mTreasure;
+        LockContention *mContention;
         bool mLocked;
 
         // disable copy constructors
@@ -157,10 +234,17 @@ public:
         return Locked(*this);
     }
 
+    // Records the contention of the mutex into |contention|, which must outlive this object.
+    // This is not thread-safe, so it must be called before the mutex is used by several threads.
+    inline void setContention(LockContention *contention) {
+        mContention = contention;
+    }
+
 private:
     friend class Locked;
     Mutex mLock;
     T mTreasure;
+    LockContention *mContention = nullptr;
 
     // disable copy constructors
     Mutexed(const Mutexed<T>&) = delete;
@@ -171,8 +255,9 @@ template<typename T>
 inline Mutexed<T>::Locked::Locked(Mutexed<T> &mParent)
     : mLock(mParent.mLock),
       mTreasure(mParent.mTreasure),
+      mContention(mParent.mContention),
       mLocked(true) {
-    mLock.lock();
+    lockMutex();
 }
 
 template<typename T>
@@ -193,7 +278,7 @@ inline void Mutexed<T>::Locked::unlock() {
 template<typename T>
 inline void Mutexed<T>::Locked::lock() {
     if (!mLocked) {
-        mLock.lock();
+        lockMutex();
         mLocked = true;
     }
 }
@@ -0,0 +1,115 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <media/stagefright/foundation/Mutexed.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace android {
+
+TEST(MutexedTest, GuardsValue) {
+    Mutexed<int> value(1);
+    {
+        Mutexed<int>::Locked locked(value);
+        EXPECT_EQ(1, *locked);
+        *locked = 2;
+        locked.unlock();
+        EXPECT_EQ(nullptr, locked.operator->());
+        locked.lock();
+        EXPECT_EQ(2, *locked);
+    }
+    EXPECT_EQ(2, *value.lock());
+}
+
+TEST(MutexedTest, ProfilesAcquisitions) {
+    LockContention contention;
+    Mutexed<int> value(1);
+    value.setContention(&contention);
+    {
+        Mutexed<int>::Locked locked(value);
+        locked.unlock();
+        locked.lock();
+    }
+    EXPECT_EQ(1, *value.lock());
+
+    LockContention::Stats stats = contention.stats();
+    EXPECT_EQ(3u, stats.acquisitions);
+    EXPECT_EQ(0u, stats.contentions);
+    EXPECT_EQ(0, stats.totalWaitNs);
+    EXPECT_EQ(0, stats.maxWaitNs);
+}
+
+TEST(MutexedTest, RecordsWaitTime) {
+    using namespace std::chrono_literals;
+    LockContention contention;
+    Mutexed<int> value(0);
+    value.setContention(&contention);
+    std::atomic_bool started(false);
+    std::thread waiter;
+    {
+        Mutexed<int>::Locked locked(value);
+        waiter = std::thread([&value, &started] {
+            started = true;
+            ++*value.lock();
+        });
+        while (!started) {
+            std::this_thread::yield();
+        }
+        // the waiter cannot finish while the lock is held
+        std::this_thread::sleep_for(20ms);
+        EXPECT_EQ(0, *locked);
+    }
+    waiter.join();
+    EXPECT_EQ(1, *value.lock());
+
+    LockContention::Stats stats = contention.stats();
+    EXPECT_EQ(3u, stats.acquisitions);
+    EXPECT_EQ(1u, stats.contentions);
+    EXPECT_GT(stats.maxWaitNs, 0);
+    EXPECT_EQ(stats.totalWaitNs, stats.maxWaitNs);
+}
+
+TEST(MutexedTest, CountsEveryAcquisition) {
+    constexpr int kThreads = 4;
+    constexpr int kIncrements = 10000;
+    LockContention contention;
+    Mutexed<int> value(0);
+    value.setContention(&contention);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kThreads; ++i) {
+        threads.emplace_back([&value] {
+            for (int j = 0; j < kIncrements; ++j) {
+                ++*value.lock();
+            }
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(kThreads * kIncrements, *value.lock());
+
+    LockContention::Stats stats = contention.stats();
+    EXPECT_EQ(uint64_t(kThreads * kIncrements + 1), stats.acquisitions);
+    EXPECT_LE(stats.contentions, stats.acquisitions);
+    EXPECT_LE(stats.maxWaitNs, stats.totalWaitNs);
+}
+
+} // namespace android
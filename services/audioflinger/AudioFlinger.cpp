@@ -42,6 +42,7 @@
 #include <com_android_media_audioserver.h>
 #include <media/AidlConversion.h>
 #include <media/AudioParameter.h>
+#include <media/AudioResampler.h>
 #include <media/AudioValidator.h>
 #include <media/IMediaLogService.h>
 #include <media/MediaMetricsItem.h>
@@ -716,6 +717,13 @@ void AudioFlinger::dumpInternals_l(int fd, const Vector<String16>& args __unused
     }
     dprintf(fd, "Bluetooth latency modes are %senabled\n",
             mBluetoothLatencyModesEnabled ? "" : "not ");
+
+    const AudioResampler::FilterCacheStats filterCacheStats =
+            AudioResampler::getFilterCacheStats();
+    dprintf(fd, "Resampler filter cache: %zu filters (%zu bytes), %llu hits, %llu misses\n",
+            filterCacheStats.filters, filterCacheStats.bytes,
+            (unsigned long long)filterCacheStats.hits,
+            (unsigned long long)filterCacheStats.misses);
 }
 
 void AudioFlinger::dumpPermissionDenial(int fd, const Vector<String16>& args __unused)
@@ -2944,7 +2952,13 @@ sp<IAfThreadBase> AudioFlinger::openOutput_l(audio_module_handle_t module,
     mHardwareStatus = AUDIO_HW_IDLE;
 
     if (status == NO_ERROR) {
-        if (flags & AUDIO_OUTPUT_FLAG_MMAP_NOIRQ) {
+        // When enabled, a mix port declared by the audio policy with AUDIO_OUTPUT_FLAG_MMAP_NOIRQ
+        // but not AUDIO_OUTPUT_FLAG_DIRECT is mixed by a MixerThread which renders into the
+        // HAL MMAP buffer, see AudioStreamOutMmapSink.
+        const bool mmapMixer = (flags & AUDIO_OUTPUT_FLAG_MMAP_NOIRQ)
+                && !(flags & AUDIO_OUTPUT_FLAG_DIRECT)
+                && property_get_bool("ro.audio.mixer_mmap_sink", false /* default_value */);
+        if ((flags & AUDIO_OUTPUT_FLAG_MMAP_NOIRQ) && !mmapMixer) {
             const sp<IAfMmapPlaybackThread> thread = IAfMmapPlaybackThread::create(
                     this, *output, outHwDev, outputStream, mSystemReady);
             mMmapThreads.add(*output, thread);
@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "AudioFlinger::EffectChainWorkers"
+//#define LOG_NDEBUG 0
+
+#define ATRACE_TAG ATRACE_TAG_AUDIO
+
+#include "EffectChainWorkers.h"
+
+#include <algorithm>
+
+#include <android-base/stringprintf.h>
+#include <cutils/properties.h>
+#include <system/thread_defs.h>
+#include <utils/Log.h>
+#include <utils/Timers.h>
+#include <utils/Trace.h>
+
+namespace android {
+
+/* static */
+size_t EffectChainWorkers::getWorkerCountProperty()
+{
+    const int32_t workers = property_get_int32("ro.audio.effect_chain_workers",
+            0 /* default_value */);
+    return std::clamp(workers, 0, static_cast<int32_t>(kMaxWorkers));
+}
+
+EffectChainWorkers::EffectChainWorkers(const std::string& threadName, size_t workerCount)
+{
+    for (size_t i = 0; i < std::min(workerCount, kMaxWorkers); ++i) {
+        sp<Worker> worker = sp<Worker>::make(*this);
+        const std::string name = threadName + "_fx" + std::to_string(i);
+        // same priority as the playback thread which waits for the workers
+        const status_t status = worker->run(name.c_str(), ANDROID_PRIORITY_URGENT_AUDIO);
+        if (status != NO_ERROR) {
+            ALOGW("%s: unable to start %s: %d", __func__, name.c_str(), status);
+            break;
+        }
+        mWorkers.push_back(std::move(worker));
+    }
+}
+
+EffectChainWorkers::~EffectChainWorkers()
+{
+    {
+        audio_utils::lock_guard _l(mutex());
+        mExiting = true;
+    }
+    mBatchCv.notify_all();
+    for (const auto& worker : mWorkers) {
+        worker->requestExitAndWait();
+    }
+}
+
+std::vector<pid_t> EffectChainWorkers::getTids() const
+{
+    std::vector<pid_t> tids;
+    for (const auto& worker : mWorkers) {
+        const pid_t tid = worker->getTid();
+        if (tid != -1) {
+            tids.push_back(tid);
+        }
+    }
+    return tids;
+}
+
+void EffectChainWorkers::process(const std::vector<sp<IAfEffectChain>>& chains)
+{
+    if (chains.empty()) {
+        return;
+    }
+    ATRACE_NAME("effect chain workers");
+    {
+        audio_utils::lock_guard _l(mutex());
+        mChains = &chains;
+        mNextChain = 0;
+        mPendingChains = chains.size();
+        mProcessNs.assign(chains.size(), 0);
+        ++mBatch;
+    }
+    // a single chain is processed by the calling thread only
+    if (chains.size() > 1) {
+        mBatchCv.notify_all();
+    }
+    processChains();
+
+    std::vector<int64_t> processNs;
+    {
+        audio_utils::unique_lock _l(mutex());
+        mDoneCv.wait(_l, [this]() REQUIRES(mutex()) { return mPendingChains == 0; });
+        mChains = nullptr;
+        processNs.swap(mProcessNs);
+    }
+
+    audio_utils::lock_guard _l(statsMutex());
+    for (size_t i = 0; i < chains.size(); ++i) {
+        ChainStats& stats = mStats[chains[i]->sessionId()];
+        ++stats.count;
+        stats.lastNs = processNs[i];
+        stats.maxNs = std::max(stats.maxNs, processNs[i]);
+        stats.totalNs += processNs[i];
+    }
+}
+
+// The playback thread holds the mutex of every chain in the batch, and waits in process()
+// until the batch is done, so the chains are not modified while the workers process them.
+void EffectChainWorkers::processChains() NO_THREAD_SAFETY_ANALYSIS
+{
+    for (;;) {
+        sp<IAfEffectChain> chain;
+        size_t index;
+        {
+            audio_utils::lock_guard _l(mutex());
+            if (mChains == nullptr || mNextChain >= mChains->size()) {
+                return;
+            }
+            index = mNextChain++;
+            chain = (*mChains)[index];
+        }
+        const nsecs_t startNs = systemTime(SYSTEM_TIME_MONOTONIC);
+        chain->processEffects_l();
+        const int64_t processNs = systemTime(SYSTEM_TIME_MONOTONIC) - startNs;
+        {
+            audio_utils::lock_guard _l(mutex());
+            mProcessNs[index] = processNs;
+            if (--mPendingChains == 0) {
+                mDoneCv.notify_one();
+            }
+        }
+    }
+}
+
+void EffectChainWorkers::removeSession(audio_session_t session)
+{
+    audio_utils::lock_guard _l(statsMutex());
+    mStats.erase(session);
+}
+
+std::string EffectChainWorkers::toString() const
+{
+    std::string result = base::StringPrintf("%zu worker(s)\n", mWorkers.size());
+    audio_utils::lock_guard _l(statsMutex());
+    if (!mStats.empty()) {
+        result.append("    Session   Count  Last(us)  Mean(us)   Max(us)\n");
+    }
+    for (const auto& [session, stats] : mStats) {
+        result.append(base::StringPrintf("    %7d %7lld %9.1f %9.1f %9.1f\n",
+                session, (long long)stats.count, stats.lastNs * 1e-3,
+                stats.count > 0 ? stats.totalNs * 1e-3 / stats.count : 0.,
+                stats.maxNs * 1e-3));
+    }
+    return result;
+}
+
+bool EffectChainWorkers::Worker::threadLoop()
+{
+    {
+        audio_utils::unique_lock _l(mOwner.mutex());
+        mOwner.mBatchCv.wait(_l, [this]() REQUIRES(mOwner.mutex()) {
+            return mOwner.mExiting || mOwner.mBatch != mBatch;
+        });
+        if (mOwner.mExiting) {
+            return false;
+        }
+        mBatch = mOwner.mBatch;
+    }
+    mOwner.processChains();
+    return true;
+}
+
+}  // namespace android
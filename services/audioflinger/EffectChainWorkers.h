@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "IAfEffect.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <android-base/thread_annotations.h>
+#include <audio_utils/mutex.h>
+#include <utils/Thread.h>
+
+namespace android {
+
+// EffectChainWorkers processes the effect chains of independent audio sessions in parallel on
+// behalf of a PlaybackThread.
+// The thread gives each such chain a private output buffer, hands the chains to process(),
+// which returns once every chain has been processed, and then accumulates the private
+// buffers into the mix. The OUTPUT_MIX, OUTPUT_STAGE and DEVICE chains are processed
+// afterwards on the thread itself, as they read the mix.
+class EffectChainWorkers {
+public:
+    static constexpr size_t kMaxWorkers = 4;
+
+    // Returns the number of workers requested by ro.audio.effect_chain_workers,
+    // at most kMaxWorkers. 0 means that effect chains are processed serially.
+    static size_t getWorkerCountProperty();
+
+    // threadName is used to name the worker threads.
+    EffectChainWorkers(const std::string& threadName, size_t workerCount);
+    ~EffectChainWorkers();
+
+    size_t workerCount() const { return mWorkers.size(); }
+    std::vector<pid_t> getTids() const;
+
+    // Calls processEffects_l() on each chain, spread over the workers and the calling thread.
+    // The caller must hold the mutex of every chain. Records each chain's processing time.
+    void process(const std::vector<sp<IAfEffectChain>>& chains) EXCLUDES(mutex());
+
+    // Forgets the processing times of a session whose chain was removed from the thread.
+    void removeSession(audio_session_t session) EXCLUDES(statsMutex());
+
+    std::string toString() const EXCLUDES(statsMutex());
+
+private:
+    class Worker : public Thread {
+    public:
+        explicit Worker(EffectChainWorkers& owner)
+            : Thread(false /*canCallJava*/), mOwner(owner) {}
+    private:
+        bool threadLoop() override;
+
+        EffectChainWorkers& mOwner;
+        uint64_t mBatch = 0;            // last batch seen, only used by the worker
+    };
+
+    // Processes chains of the current batch until none is left.
+    void processChains() EXCLUDES(mutex());
+
+    audio_utils::mutex& mutex() const RETURN_CAPABILITY(mMutex) { return mMutex; }
+    audio_utils::mutex& statsMutex() const RETURN_CAPABILITY(mStatsMutex) {
+        return mStatsMutex;
+    }
+
+    struct ChainStats {
+        int64_t count = 0;
+        int64_t lastNs = 0;
+        int64_t maxNs = 0;
+        int64_t totalNs = 0;
+    };
+
+    std::vector<sp<Worker>> mWorkers;
+
+    // Taken by the playback thread with the mutex of every chain in the batch held.
+    mutable audio_utils::mutex mMutex{audio_utils::MutexOrder::kOtherMutex};
+    audio_utils::condition_variable mBatchCv;  // signaled by process() when a batch is available
+    audio_utils::condition_variable mDoneCv;   // signaled when the last chain of a batch is done
+    bool mExiting GUARDED_BY(mutex()) = false;
+    uint64_t mBatch GUARDED_BY(mutex()) = 0;
+    const std::vector<sp<IAfEffectChain>>* mChains GUARDED_BY(mutex()) = nullptr;
+    size_t mNextChain GUARDED_BY(mutex()) = 0;
+    size_t mPendingChains GUARDED_BY(mutex()) = 0;
+    std::vector<int64_t> mProcessNs GUARDED_BY(mutex());   // indexed like *mChains
+
+    mutable audio_utils::mutex mStatsMutex{audio_utils::MutexOrder::kOtherMutex};
+    std::map<audio_session_t, ChainStats> mStats GUARDED_BY(statsMutex());
+};
+
+}  // namespace android
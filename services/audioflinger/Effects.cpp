@@ -2241,6 +2241,11 @@ void EffectChain::clearInputBuffer_l()
 
 // Must be called with EffectChain::mutex() locked
 void EffectChain::process_l() {
+    processEffects_l();
+    updateEffectsState_l();
+}
+
+void EffectChain::processEffects_l() {
     // never process effects when:
     // - on an OFFLOAD thread
     // - no more tracks are on the session and the effect tail has been rendered
@@ -2281,6 +2286,10 @@ void EffectChain::process_l() {
             mOutBuffer->commit();
         }
     }
+}
+
+void EffectChain::updateEffectsState_l() {
+    const size_t size = mEffects.size();
     bool doResetVolume = false;
     for (size_t i = 0; i < size; i++) {
         doResetVolume = mEffects[i]->updateState_l() || doResetVolume;
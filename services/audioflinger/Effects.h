@@ -413,6 +413,8 @@ public:
     EffectChain(const sp<IAfThreadBase>& thread, audio_session_t sessionId);
 
     void process_l() final REQUIRES(audio_utils::EffectChain_Mutex);
+    void processEffects_l() final REQUIRES(audio_utils::EffectChain_Mutex);
+    void updateEffectsState_l() final REQUIRES(audio_utils::EffectChain_Mutex);
 
     audio_utils::mutex& mutex() const final RETURN_CAPABILITY(audio_utils::EffectChain_Mutex) {
         return mMutex;
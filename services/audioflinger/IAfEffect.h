@@ -229,8 +229,17 @@ public:
     // a session is stopped or removed to allow effect tail to be rendered
     static constexpr int kProcessTailDurationMs = 1000;
 
+    // process_l() is processEffects_l() followed by updateEffectsState_l().
     virtual void process_l() REQUIRES(audio_utils::EffectChain_Mutex) = 0;
 
+    // Renders one buffer of audio through the chain. This does not change the state of the
+    // effects nor call back into the thread, so that it can run on an effect chain worker
+    // while the thread holds the chain mutex.
+    virtual void processEffects_l() REQUIRES(audio_utils::EffectChain_Mutex) = 0;
+
+    // Applies the effect state transitions following processEffects_l().
+    virtual void updateEffectsState_l() REQUIRES(audio_utils::EffectChain_Mutex) = 0;
+
     virtual audio_utils::mutex& mutex() const RETURN_CAPABILITY(audio_utils::EffectChain_Mutex) = 0;
 
     virtual status_t createEffect_l(sp<IAfEffectModule>& effect, effect_descriptor_t* desc, int id,
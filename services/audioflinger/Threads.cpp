@@ -66,6 +66,7 @@
 #include <media/audiohal/EffectsFactoryHalInterface.h>
 #include <media/audiohal/StreamHalInterface.h>
 #include <media/nbaio/AudioStreamInSource.h>
+#include <media/nbaio/AudioStreamOutMmapSink.h>
 #include <media/nbaio/AudioStreamOutSink.h>
 #include <media/nbaio/MonoPipe.h>
 #include <media/nbaio/MonoPipeReader.h>
@@ -86,6 +87,7 @@
 #include <utils/Log.h>
 #include <utils/Trace.h>
 
+#include <algorithm>
 #include <fcntl.h>
 #include <linux/futex.h>
 #include <math.h>
@@ -220,6 +222,10 @@ static const enum {
     FastCapture_Static, // initialize if needed, then use all the time if initialized
 } kUseFastCapture = FastCapture_Static;
 
+// Whether the normal mixer tells the fast mixer which fast tracks changed in each pushed state,
+// so the fast mixer only reconfigures those slots instead of checking all of them.
+static const bool kUseFastTrackDeltas = true;
+
 // Priorities for requestPriority
 static const int kPriorityAudioApp = 2;
 static const int kPriorityFastMixer = 3;
@@ -2187,6 +2193,14 @@ PlaybackThread::PlaybackThread(const sp<IAfThreadCallback>& afThreadCallback,
         mMixerChannelMask = mixerConfig->channel_mask;
     }
 
+    if (type == MIXER || type == SPATIALIZER) {
+        const size_t effectChainWorkers = EffectChainWorkers::getWorkerCountProperty();
+        if (effectChainWorkers > 0) {
+            mEffectChainWorkers = std::make_unique<EffectChainWorkers>(
+                    mThreadName, effectChainWorkers);
+        }
+    }
+
     readOutputParameters_l();
 
     if (mType != SPATIALIZER
@@ -2353,6 +2367,10 @@ void PlaybackThread::dumpInternals_l(int fd, const Vector<String16>& args)
     if (mPipeSink.get() != nullptr) {
         dprintf(fd, "  PipeSink frames written: %lld\n", (long long)mPipeSink->framesWritten());
     }
+    if (mEffectChainWorkers != nullptr) {
+        dprintf(fd, "  Effect chain workers: %s",
+                mEffectChainWorkers->toString().c_str());
+    }
     if (output != nullptr) {
         dprintf(fd, "  Hal stream dump:\n");
         (void)output->stream->dump(fd, args);
@@ -3580,14 +3598,17 @@ ssize_t PlaybackThread::threadLoop_write()
                         (pipe->maxFrames() * 7) / 8 : mNormalFrameCount * 2);
             }
         }
-        ssize_t framesWritten = mNormalSink->write((char *)mSinkBuffer + offset, count);
+        // the sink data is in mSinkWriteBuffer if it was rendered in place
+        char * const sinkBuffer =
+                (char *)(mSinkWriteBuffer != nullptr ? mSinkWriteBuffer : mSinkBuffer);
+        ssize_t framesWritten = mNormalSink->write(sinkBuffer + offset, count);
         ATRACE_END();
 
         if (framesWritten > 0) {
             bytesWritten = framesWritten * mFrameSize;
 
 #ifdef TEE_SINK
-            mTee.write((char *)mSinkBuffer + offset, framesWritten);
+            mTee.write(sinkBuffer + offset, framesWritten);
 #endif
         } else {
             bytesWritten = framesWritten;
@@ -3803,6 +3824,13 @@ status_t PlaybackThread::addEffectChain_l(const sp<IAfEffectChain>& chain)
                     &halOutBuffer);
             if (result != OK) return result;
 
+            if (mEffectChainWorkers != nullptr) {
+                useParallelEffectChainOutput_l(chain, halOutBuffer,
+                        static_cast<float*>(
+                                isSessionSpatialized ? mEffectBuffer : mPostSpatializerBuffer),
+                        mNormalFrameCount * audio_channel_count_from_out_mask(channelMask));
+            }
+
             buffer = halInBuffer ? halInBuffer->audioBuffer()->f32 : buffer;
 
             ALOGV("addEffectChain_l() creating new input buffer %p session %d",
@@ -3849,6 +3877,13 @@ status_t PlaybackThread::addEffectChain_l(const sp<IAfEffectChain>& chain)
                 buffer = halInBuffer ? halInBuffer->audioBuffer()->f32 : buffer;
                 ALOGV("addEffectChain_l() creating new input buffer %p session %d",
                         buffer, session);
+
+                if (mEffectChainWorkers != nullptr && mEffectBufferEnabled) {
+                    useParallelEffectChainOutput_l(chain, halOutBuffer,
+                            static_cast<float*>(mEffectBuffer),
+                            mNormalFrameCount
+                                    * audio_channel_count_from_out_mask(mMixerChannelMask));
+                }
             }
         }
     }
@@ -3908,12 +3943,37 @@ status_t PlaybackThread::addEffectChain_l(const sp<IAfEffectChain>& chain)
     return NO_ERROR;
 }
 
+// Replaces the output buffer of a session chain by a private buffer of the same size, so that
+// the chain can be processed by mEffectChainWorkers concurrently with the other session chains.
+// On failure the chain keeps outputting to halOutBuffer and is processed serially.
+void PlaybackThread::useParallelEffectChainOutput_l(const sp<IAfEffectChain>& chain,
+        sp<EffectBufferHalInterface>& halOutBuffer, float* target, size_t sampleCount)
+{
+    sp<EffectBufferHalInterface> output;
+    if (mAfThreadCallback->getEffectsFactoryHal()->allocateBuffer(
+            halOutBuffer->getSize(), &output) != OK || output == nullptr) {
+        ALOGW("%s: cannot allocate output buffer for session %d, processing it serially",
+                __func__, chain->sessionId());
+        return;
+    }
+    ALOGV("%s: session %d outputs to %p", __func__, chain->sessionId(),
+            output->audioBuffer()->f32);
+    mParallelEffectChains[chain->sessionId()] = {chain, output, target, sampleCount};
+    halOutBuffer = output;
+}
+
 size_t PlaybackThread::removeEffectChain_l(const sp<IAfEffectChain>& chain)
 {
     audio_session_t session = chain->sessionId();
 
     ALOGV("removeEffectChain_l() %p from thread %p for session %d", chain.get(), this, session);
 
+    if (auto it = mParallelEffectChains.find(session);
+            it != mParallelEffectChains.end() && it->second.chain == chain) {
+        mParallelEffectChains.erase(it);
+        mEffectChainWorkers->removeSession(session);
+    }
+
     for (size_t i = 0; i < mEffectChains.size(); i++) {
         if (chain == mEffectChains[i]) {
             mEffectChains.removeAt(i);
@@ -3994,6 +4054,12 @@ NO_THREAD_SAFETY_ANALYSIS  // manual locking of AudioFlinger
             if (priorityBoost > 0) {
                 stream()->setHalThreadPriority(priorityBoost);
             }
+            // the thread waits for its effect chain workers every cycle
+            if (mEffectChainWorkers != nullptr) {
+                for (const pid_t workerTid : mEffectChainWorkers->getTids()) {
+                    (void)requestSpatializerPriority(getpid(), workerTid);
+                }
+            }
         }
     } else if (property_get_bool("ro.boot.container", false /* default_value */)) {
         // In ARC experiments (b/73091832), the latency under using CFS scheduler with any priority
@@ -4256,6 +4322,11 @@ NO_THREAD_SAFETY_ANALYSIS  // manual locking of AudioFlinger
             // or modified if an effect is created or deleted
             lockEffectChains_l(effectChains);
 
+            mCycleParallelEffectChains.clear();
+            for (const auto& [_, parallelChain] : mParallelEffectChains) {
+                mCycleParallelEffectChains.push_back(parallelChain);
+            }
+
             // Determine which session to pick up haptic data.
             // This must be done under the same lock as prepareTracks_l().
             // The haptic data from the effect is at a higher priority than the one from track.
@@ -4282,6 +4353,7 @@ NO_THREAD_SAFETY_ANALYSIS  // manual locking of AudioFlinger
 
         if (mBytesRemaining == 0) {
             mCurrentWriteLength = 0;
+            releaseSinkWriteBuffer();
             if (mMixerStatus == MIXER_TRACKS_READY) {
                 // threadLoop_mix() sets mCurrentWriteLength
                 threadLoop_mix();
@@ -4322,7 +4394,7 @@ NO_THREAD_SAFETY_ANALYSIS  // manual locking of AudioFlinger
             uint32_t mixerChannelCount = mEffectBufferValid ?
                         audio_channel_count_from_out_mask(mMixerChannelMask) : mChannelCount;
             if (mMixerBufferValid && (mEffectBufferValid || !mHasDataCopiedToSinkBuffer)) {
-                void *buffer = mEffectBufferValid ? mEffectBuffer : mSinkBuffer;
+                void *buffer = mEffectBufferValid ? mEffectBuffer : acquireSinkWriteBuffer();
                 audio_format_t format = mEffectBufferValid ? mEffectBufferFormat : mFormat;
 
                 // Apply mono blending and balancing if the effect buffer is not valid. Otherwise,
@@ -4372,29 +4444,61 @@ NO_THREAD_SAFETY_ANALYSIS  // manual locking of AudioFlinger
 
             // only process effects if we're going to write
             if (mSleepTimeUs == 0 && mType != OFFLOAD) {
-                for (size_t i = 0; i < effectChains.size(); i ++) {
-                    effectChains[i]->process_l();
-                    // TODO: Write haptic data directly to sink buffer when mixing.
-                    if (activeHapticSessionId != AUDIO_SESSION_NONE
-                            && activeHapticSessionId == effectChains[i]->sessionId()) {
-                        // Haptic data is active in this case, copy it directly from
-                        // in buffer to out buffer.
-                        uint32_t hapticSessionChannelCount = mEffectBufferValid ?
-                                            audio_channel_count_from_out_mask(mMixerChannelMask) :
-                                            mChannelCount;
-                        if (mType == SPATIALIZER && !isHapticSessionSpatialized) {
-                            hapticSessionChannelCount = mChannelCount;
-                        }
+                // TODO: Write haptic data directly to sink buffer when mixing.
+                const auto copyHapticData = [&](const sp<IAfEffectChain>& chain,
+                                                void* outBuffer) {
+                    if (activeHapticSessionId == AUDIO_SESSION_NONE
+                            || activeHapticSessionId != chain->sessionId()) {
+                        return;
+                    }
+                    // Haptic data is active in this case, copy it directly from
+                    // in buffer to out buffer.
+                    uint32_t hapticSessionChannelCount = mEffectBufferValid ?
+                                        audio_channel_count_from_out_mask(mMixerChannelMask) :
+                                        mChannelCount;
+                    if (mType == SPATIALIZER && !isHapticSessionSpatialized) {
+                        hapticSessionChannelCount = mChannelCount;
+                    }
 
-                        const size_t audioBufferSize = mNormalFrameCount
-                            * audio_bytes_per_frame(hapticSessionChannelCount,
-                                                    AUDIO_FORMAT_PCM_FLOAT);
-                        memcpy_by_audio_format(
-                                (uint8_t*)effectChains[i]->outBuffer() + audioBufferSize,
-                                AUDIO_FORMAT_PCM_FLOAT,
-                                (const uint8_t*)effectChains[i]->inBuffer() + audioBufferSize,
-                                AUDIO_FORMAT_PCM_FLOAT, mNormalFrameCount * mHapticChannelCount);
+                    const size_t audioBufferSize = mNormalFrameCount
+                        * audio_bytes_per_frame(hapticSessionChannelCount,
+                                                AUDIO_FORMAT_PCM_FLOAT);
+                    memcpy_by_audio_format(
+                            (uint8_t*)outBuffer + audioBufferSize,
+                            AUDIO_FORMAT_PCM_FLOAT,
+                            (const uint8_t*)chain->inBuffer() + audioBufferSize,
+                            AUDIO_FORMAT_PCM_FLOAT, mNormalFrameCount * mHapticChannelCount);
+                };
+
+                // Session chains with a private output buffer are processed in parallel,
+                // then accumulated into the buffer they would otherwise output to,
+                // before the output mix, output stage and device chains are processed.
+                if (!mCycleParallelEffectChains.empty()) {
+                    mCycleParallelChains.clear();
+                    for (const auto& parallelChain : mCycleParallelEffectChains) {
+                        memset(parallelChain.output->audioBuffer()->f32, 0,
+                                parallelChain.output->getSize());
+                        mCycleParallelChains.push_back(parallelChain.chain);
+                    }
+                    mEffectChainWorkers->process(mCycleParallelChains);
+                    for (const auto& parallelChain : mCycleParallelEffectChains) {
+                        parallelChain.chain->updateEffectsState_l();
+                        accumulate_float(parallelChain.target,
+                                parallelChain.output->audioBuffer()->f32,
+                                parallelChain.sampleCount);
+                        copyHapticData(parallelChain.chain, parallelChain.target);
+                    }
+                }
+                for (size_t i = 0; i < effectChains.size(); i ++) {
+                    if (std::any_of(mCycleParallelEffectChains.begin(),
+                            mCycleParallelEffectChains.end(),
+                            [&](const auto& parallelChain) {
+                                return parallelChain.chain == effectChains[i];
+                            })) {
+                        continue;
                     }
+                    effectChains[i]->process_l();
+                    copyHapticData(effectChains[i], effectChains[i]->outBuffer());
                 }
             }
         }
@@ -4446,22 +4550,23 @@ NO_THREAD_SAFETY_ANALYSIS  // manual locking of AudioFlinger
                                        mNormalFrameCount * mHapticChannelCount);
             }
             const size_t framesToCopy = mNormalFrameCount * (mChannelCount + mHapticChannelCount);
+            void * const sinkBuffer = acquireSinkWriteBuffer();
             if (mFormat == AUDIO_FORMAT_PCM_FLOAT &&
                     mEffectBufferFormat == AUDIO_FORMAT_PCM_FLOAT) {
                 // Clamp PCM float values more than this distance from 0 to insulate
                 // a HAL which doesn't handle NaN correctly.
                 static constexpr float HAL_FLOAT_SAMPLE_LIMIT = 2.0f;
-                memcpy_to_float_from_float_with_clamping(static_cast<float*>(mSinkBuffer),
+                memcpy_to_float_from_float_with_clamping(static_cast<float*>(sinkBuffer),
                         static_cast<const float*>(effectBuffer),
                         framesToCopy, HAL_FLOAT_SAMPLE_LIMIT /* absMax */);
             } else {
-                memcpy_by_audio_format(mSinkBuffer, mFormat,
+                memcpy_by_audio_format(sinkBuffer, mFormat,
                         effectBuffer, mEffectBufferFormat, framesToCopy);
             }
             // The sample data is partially interleaved when haptic channels exist,
             // we need to adjust channels here.
             if (mHapticChannelCount > 0) {
-                adjust_channels_non_destructive(mSinkBuffer, mChannelCount, mSinkBuffer,
+                adjust_channels_non_destructive(sinkBuffer, mChannelCount, sinkBuffer,
                         mChannelCount + mHapticChannelCount,
                         audio_bytes_per_sample(mFormat),
                         audio_bytes_per_frame(mChannelCount, mFormat) * mNormalFrameCount);
@@ -4655,6 +4760,8 @@ NO_THREAD_SAFETY_ANALYSIS  // manual locking of AudioFlinger
 
         // Effect chains will be actually deleted here if they were removed from
         // mEffectChains list during mixing or effects processing
+        mCycleParallelEffectChains.clear();
+        mCycleParallelChains.clear();
         effectChains.clear();
 
         // FIXME Note that the above .clear() is no longer necessary since effectChains
@@ -5116,8 +5223,19 @@ MixerThread::MixerThread(const sp<IAfThreadCallback>& afThreadCallback, AudioStr
         // Do not create or use mFastMixer, mOutputSink, mPipeSink, or mNormalSink.
         return;
     }
-    // create an NBAIO sink for the HAL output stream, and negotiate
-    mOutputSink = new AudioStreamOutSink(output->stream);
+    // create an NBAIO sink for the HAL output stream, and negotiate.
+    // Write through the HAL MMAP buffer of an MMAP_NOIRQ output opened for mixing,
+    // see AudioFlinger::openOutput_l().
+    if (type == MIXER && (output->flags & AUDIO_OUTPUT_FLAG_MMAP_NOIRQ) != 0 &&
+            property_get_bool("ro.audio.mixer_mmap_sink", false /* default_value */)) {
+        mMmapSink = AudioStreamOutMmapSink::create(output->stream, 2 * mNormalFrameCount);
+        ALOGI_IF(mMmapSink != 0, "MixerThread() id=%d writes through the HAL MMAP buffer", id);
+    }
+    if (mMmapSink != 0) {
+        mOutputSink = mMmapSink;
+    } else {
+        mOutputSink = new AudioStreamOutSink(output->stream);
+    }
     size_t numCounterOffers = 0;
     const NBAIO_Format offers[1] = {Format_from_SR_C(
             mSampleRate, mChannelCount + mHapticChannelCount, mFormat)};
@@ -5198,6 +5316,7 @@ MixerThread::MixerThread(const sp<IAfThreadCallback>& afThreadCallback, AudioStr
 #ifdef STATE_QUEUE_DUMP
         sq->setObserverDump(&mStateQueueObserverDump);
         sq->setMutatorDump(&mStateQueueMutatorDump);
+        mFastMixer->dq()->setMutatorDump(&mStateQueueMutatorDump);
 #endif
         FastMixerState *state = sq->begin();
         FastTrack *fastTrack = &state->mFastTracks[0];
@@ -5213,6 +5332,7 @@ MixerThread::MixerThread(const sp<IAfThreadCallback>& afThreadCallback, AudioStr
         fastTrack->mHapticMaxAmplitude = NAN;
         fastTrack->mGeneration++;
         state->mFastTracksGen++;
+        mFastTrackDeltaGen = state->mFastTracksGen; // fast mixer checks all slots the first time
         state->mTrackMask = 1;
         // fast mixer will use the HAL output sink
         state->mOutputSink = mOutputSink.get();
@@ -5239,10 +5359,14 @@ MixerThread::MixerThread(const sp<IAfThreadCallback>& afThreadCallback, AudioStr
         info.type = NBLog::FASTMIXER;
         mFastMixerNBLogWriter->log<NBLog::EVENT_THREAD_INFO>(info);
 
-        // start the fast mixer
+        // start the fast mixer, and its helpers first if it has any
+        const std::vector<pid_t> helperTids = mFastMixer->runHelpers();
         mFastMixer->run("FastMixer", PRIORITY_URGENT_AUDIO);
         pid_t tid = mFastMixer->getTid();
         sendPrioConfigEvent(getpid(), tid, kPriorityFastMixer, false /*forApp*/);
+        for (const pid_t helperTid : helperTids) {
+            sendPrioConfigEvent(getpid(), helperTid, kPriorityFastMixer, false /*forApp*/);
+        }
         stream()->setHalThreadPriority(kPriorityFastMixer);
 
 #ifdef AUDIO_WATCHDOG
@@ -5415,9 +5539,40 @@ void MixerThread::threadLoop_standby()
             sq->end(false /*didModify*/);
         }
     }
+    if (mMmapSink != 0) {
+        mMmapSink->stop();
+    }
     PlaybackThread::threadLoop_standby();
 }
 
+void* MixerThread::acquireSinkWriteBuffer()
+{
+    // Render in place only if the normal mix goes straight to the HAL.
+    // With a fast mixer, the sink buffer is written to the MonoPipe instead.
+    // The HAL may read the shared buffer at any time, so also only if this cycle will be written:
+    // not when suspended (the write is simulated) nor when sleeping instead of writing.
+    if (mMmapSink != 0 && mNormalSink == mOutputSink && !isSuspended() && mSleepTimeUs == 0) {
+        mSinkWriteBuffer = mMmapSink->acquire(mNormalFrameCount);
+        if (mSinkWriteBuffer != nullptr) {
+            return mSinkWriteBuffer;
+        }
+    }
+    return mSinkBuffer;
+}
+
+void MixerThread::releaseSinkWriteBuffer()
+{
+    // the sink is not thread safe, so leave it alone while a fast mixer writes to it
+    if (mMmapSink != 0 && mNormalSink == mOutputSink) {
+        // Silence what was rendered in place but not written, e.g. if the write failed
+        // or the output got suspended meanwhile.  While not writing, this is also where the
+        // frames the HAL has consumed get silenced, as the loop runs at least once per period.
+        mMmapSink->release();
+        (void) mMmapSink->silenceConsumed();
+    }
+    PlaybackThread::releaseSinkWriteBuffer();
+}
+
 bool PlaybackThread::waitingAsyncCallback_l()
 {
     return false;
@@ -5579,6 +5734,7 @@ PlaybackThread::mixer_state MixerThread::prepareTracks_l(
     bool didModify = false;
     FastMixerStateQueue::block_t block = FastMixerStateQueue::BLOCK_UNTIL_PUSHED;
     bool coldIdle = false;
+    unsigned modifiedFastTracks = 0;    // bit i is set if state->mFastTracks[i] was modified
     if (mFastMixer != 0) {
         sq = mFastMixer->sq();
         state = sq->begin();
@@ -5771,6 +5927,7 @@ PlaybackThread::mixer_state MixerThread::prepareTracks_l(
                     fastTrack->mHapticMaxAmplitude = track->getHapticMaxAmplitude();
                     fastTrack->mGeneration++;
                     state->mTrackMask |= 1 << j;
+                    modifiedFastTracks |= 1 << j;
                     didModify = true;
                     // no acknowledgement required for newly active tracks
                 }
@@ -5815,6 +5972,7 @@ PlaybackThread::mixer_state MixerThread::prepareTracks_l(
                     fastTrack->mBufferProvider = NULL;
                     fastTrack->mGeneration++;
                     state->mTrackMask &= ~(1 << j);
+                    modifiedFastTracks |= 1 << j;
                     didModify = true;
                     // If any fast tracks were removed, we must wait for acknowledgement
                     // because we're about to decrement the last sp<> on those tracks.
@@ -5837,6 +5995,7 @@ PlaybackThread::mixer_state MixerThread::prepareTracks_l(
             }
             if (fastTrack->mHapticPlaybackEnabled != track->getHapticPlaybackEnabled()) {
                 fastTrack->mHapticPlaybackEnabled = track->getHapticPlaybackEnabled();
+                modifiedFastTracks |= 1 << j;
                 didModify = true;
             }
             continue;
@@ -6225,6 +6384,7 @@ PlaybackThread::mixer_state MixerThread::prepareTracks_l(
         FastTrack *fastTrack = &state->mFastTracks[0];
         if (fastTrack->mHapticPlaybackEnabled != noFastHapticTrack) {
             fastTrack->mHapticPlaybackEnabled = noFastHapticTrack;
+            modifiedFastTracks |= 1;
             didModify = true;
         }
     }
@@ -6233,6 +6393,17 @@ PlaybackThread::mixer_state MixerThread::prepareTracks_l(
     [[maybe_unused]] bool pauseAudioWatchdog = false;
     if (didModify) {
         state->mFastTracksGen++;
+        if (kUseFastTrackDeltas) {
+            // If there is no room for the delta, then merge it into the next one;
+            // the fast mixer will check all slots when it finds the gap.
+            mFastTrackDeltaMask |= modifiedFastTracks;
+            const FastTrackDelta delta{mFastTrackDeltaGen, state->mFastTracksGen,
+                    mFastTrackDeltaMask};
+            if (mFastMixer->dq()->push(delta)) {
+                mFastTrackDeltaGen = state->mFastTracksGen;
+                mFastTrackDeltaMask = 0;
+            }
+        }
         // if the fast mixer was active, but now there are no fast tracks, then put it in cold idle
         if (kUseFastMixer == FastMixer_Dynamic &&
                 state->mCommand == FastMixerState::MIX_WRITE && state->mTrackMask <= 1) {
@@ -6250,7 +6421,8 @@ PlaybackThread::mixer_state MixerThread::prepareTracks_l(
         }
     }
     if (sq != NULL) {
-        sq->end(didModify);
+        // only the modified fast tracks need to be copied into the next state
+        sq->end(didModify, modifiedFastTracks);
         // No need to block if the FastMixer is in COLD_IDLE as the FastThread
         // is not active. (We BLOCK_UNTIL_ACKED when entering COLD_IDLE
         // when bringing the output sink into standby.)
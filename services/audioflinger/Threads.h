@@ -19,6 +19,7 @@
 
 // ADD_BATTERY_DATA AUDIO_WATCHDOG FAST_THREAD_STATISTICS STATE_QUEUE_DUMP TEE_SINK
 #include "Configuration.h"
+#include "EffectChainWorkers.h"
 #include "IAfThread.h"
 #include "IAfTrack.h"
 
@@ -39,6 +40,7 @@
 namespace android {
 
 class AsyncCallbackThread;
+class AudioStreamOutMmapSink;
 
 class ThreadBase : public virtual IAfThreadBase, public Thread {
 public:
@@ -939,6 +941,16 @@ protected:
     virtual void threadLoop_removeTracks(const Vector<sp<IAfTrack>>& tracksToRemove)
             REQUIRES(ThreadBase_ThreadLoop);
 
+    // Returns the buffer the final sink format data of the current cycle is rendered into.
+    // This is mSinkBuffer unless the output sink lends its own memory for the cycle,
+    // in which case threadLoop_write() writes from that memory instead.
+    virtual void* acquireSinkWriteBuffer() REQUIRES(ThreadBase_ThreadLoop) { return mSinkBuffer; }
+    // Called at the start of each cycle to end the use of the memory acquired by the previous one,
+    // whether or not it was written.
+    virtual void releaseSinkWriteBuffer() REQUIRES(ThreadBase_ThreadLoop) {
+        mSinkWriteBuffer = nullptr;
+    }
+
                 // prepareTracks_l reads and writes mActiveTracks, and returns
                 // the pending set of tracks to remove via Vector 'tracksToRemove'.  The caller
                 // is responsible for clearing or destroying this Vector later on, when it
@@ -1222,6 +1234,10 @@ protected:
 
     void*                           mSinkBuffer;         // frame size aligned sink buffer
 
+    // Sink memory acquired by acquireSinkWriteBuffer() for the current cycle, or nullptr
+    // if the cycle is rendered into mSinkBuffer.
+    void* mSinkWriteBuffer GUARDED_BY(ThreadBase_ThreadLoop) = nullptr;
+
     // TODO:
     // Rearrange the buffer info into a struct/class with
     // clear, copy, construction, destruction methods.
@@ -1295,6 +1311,29 @@ protected:
     // Size of mPostSpatializerBuffer in bytes
     size_t mPostSpatializerBufferSize GUARDED_BY(mutex());
 
+    // Processes the session effect chains in parallel on MIXER and SPATIALIZER threads,
+    // if enabled by ro.audio.effect_chain_workers.
+    std::unique_ptr<EffectChainWorkers> mEffectChainWorkers;
+
+    // A session effect chain processed by mEffectChainWorkers outputs to a private buffer,
+    // which the thread accumulates into the buffer the chain would otherwise output to.
+    struct ParallelEffectChain {
+        sp<IAfEffectChain> chain;
+        sp<EffectBufferHalInterface> output;    // private output buffer of the chain
+        float* target = nullptr;                // mEffectBuffer or mPostSpatializerBuffer
+        size_t sampleCount = 0;                 // audio samples per buffer, without haptics
+    };
+    std::map<audio_session_t, ParallelEffectChain> mParallelEffectChains GUARDED_BY(mutex());
+
+    void useParallelEffectChainOutput_l(const sp<IAfEffectChain>& chain,
+            sp<EffectBufferHalInterface>& halOutBuffer, float* target, size_t sampleCount)
+            REQUIRES(mutex());
+
+    // Copy of mParallelEffectChains taken with the effect chains for the current cycle.
+    std::vector<ParallelEffectChain> mCycleParallelEffectChains
+            GUARDED_BY(ThreadBase_ThreadLoop);
+    std::vector<sp<IAfEffectChain>> mCycleParallelChains GUARDED_BY(ThreadBase_ThreadLoop);
+
     // suspend count, > 0 means suspended.  While suspended, the thread continues to pull from
     // tracks and mix, but doesn't write to HAL.  A2DP and SCO HAL implementations can't handle
     // concurrent use of both of them, so Audio Policy Service suspends one of the threads to
@@ -1629,6 +1668,8 @@ protected:
     void threadLoop_standby() override REQUIRES(ThreadBase_ThreadLoop);
     void threadLoop_mix() override REQUIRES(ThreadBase_ThreadLoop);
     void threadLoop_sleepTime() override REQUIRES(ThreadBase_ThreadLoop);
+    void* acquireSinkWriteBuffer() override REQUIRES(ThreadBase_ThreadLoop);
+    void releaseSinkWriteBuffer() override REQUIRES(ThreadBase_ThreadLoop);
     uint32_t correctLatency_l(uint32_t latency) const final REQUIRES(mutex());
 
     status_t createAudioPatch_l(
@@ -1652,6 +1693,8 @@ private:
                 // one-time initialization, no locks required
                 sp<FastMixer>     mFastMixer;     // non-0 if there is also a fast mixer
                 sp<AudioWatchdog> mAudioWatchdog; // non-0 if there is an audio watchdog thread
+                // non-0 if mOutputSink writes through the HAL MMAP buffer
+                sp<AudioStreamOutMmapSink> mMmapSink;
 
                 // contents are not guaranteed to be consistent, no locks required
                 FastMixerDumpState mFastMixerDumpState;
@@ -1663,7 +1706,10 @@ private:
 
                 // accessible only within the threadLoop(), no locks required
                 //          mFastMixer->sq()    // for mutating and pushing state
+                //          mFastMixer->dq()    // for pushing fast track deltas
     int32_t mFastMixerFutex GUARDED_BY(ThreadBase_ThreadLoop);  // for cold idle
+    int mFastTrackDeltaGen GUARDED_BY(ThreadBase_ThreadLoop) = 0;  // mToGen of last pushed delta
+    unsigned mFastTrackDeltaMask GUARDED_BY(ThreadBase_ThreadLoop) = 0;  // not yet in a delta
 
                 std::atomic_bool mMasterMono;
 public:
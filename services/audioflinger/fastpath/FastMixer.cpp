@@ -26,7 +26,9 @@
 #define ATRACE_TAG ATRACE_TAG_AUDIO
 
 #include "Configuration.h"
+#include <algorithm>
 #include <time.h>
+#include <unistd.h>
 #include <utils/Log.h>
 #include <utils/Trace.h>
 #include <system/audio.h>
@@ -39,7 +41,9 @@
 #include <audio_utils/channels.h>
 #include <audio_utils/format.h>
 #include <audio_utils/mono_blend.h>
+#include <audio_utils/primitives.h>
 #include <cutils/bitops.h>
+#include <cutils/properties.h>
 #include <media/AudioMixer.h>
 #include "FastMixer.h"
 #include <afutils/TypedLogger.h>
@@ -74,6 +78,16 @@ FastMixer::FastMixer(audio_io_handle_t parentIoHandle)
     mSinkChannelMask = getChannelMaskFromCount(mSinkChannelCount);
     mBalance.setChannelMask(mSinkChannelMask);
 
+    // Optionally mix partitions of the fast tracks on helper threads, each pinned to its own core.
+    // Start from the highest numbered core, as those are usually the most capable.
+    const long cpus = sysconf(_SC_NPROCESSORS_CONF);
+    const long helpers = property_get_int32("ro.audio.fast_mixer_helpers", 0 /* default_value */);
+    mHelperCount = (size_t) std::clamp(std::min(helpers, cpus - 1),
+            0L, (long) FastMixerState::kMaxHelperThreads);
+    for (size_t i = 0; i < mHelperCount; ++i) {
+        mHelpers[i] = new FastMixerHelper((int) (cpus - 1 - i));
+    }
+
 #ifdef FAST_THREAD_STATISTICS
     mOldLoad.tv_sec = 0;
     mOldLoad.tv_nsec = 0;
@@ -85,6 +99,31 @@ FastMixerStateQueue* FastMixer::sq()
     return &mSQ;
 }
 
+FastMixerDeltaQueue* FastMixer::dq()
+{
+    return &mDQ;
+}
+
+std::vector<pid_t> FastMixer::runHelpers()
+{
+    std::vector<pid_t> tids;
+    for (size_t i = 0; i < mHelperCount; ++i) {
+        const status_t status = mHelpers[i]->run("FastMixerHelper", PRIORITY_URGENT_AUDIO);
+        if (status != NO_ERROR) {
+            ALOGE("%s: unable to run helper %zu, status %d", __func__, i, status);
+            // the FastMixer mixes the partitions of the missing helpers itself,
+            // so release the helpers that were not started; only started ones are stopped
+            for (size_t j = i; j < mHelperCount; ++j) {
+                mHelpers[j].clear();
+            }
+            mHelperCount = i;
+            break;
+        }
+        tids.push_back(mHelpers[i]->getTid());
+    }
+    return tids;
+}
+
 const FastThreadState *FastMixer::poll()
 {
     return mSQ.poll();
@@ -102,11 +141,83 @@ void FastMixer::onIdle()
 
 void FastMixer::onExit()
 {
+    for (size_t i = 0; i < mHelperCount; ++i) {
+        mHelpers[i]->stop();
+        delete mHelperMixers[i];
+        free(mHelperBuffers[i]);
+    }
     delete mMixer;
     free(mMixerBuffer);
     free(mSinkBuffer);
 }
 
+void FastMixer::waitLateHelpers(int64_t timeoutNs)
+{
+    unsigned lateHelpers = mLateHelpers;
+    while (lateHelpers != 0) {
+        const int j = __builtin_ctz(lateHelpers);
+        lateHelpers &= ~(1 << j);
+        if (mHelpers[j]->wait(timeoutNs) < 0) {
+            continue;
+        }
+        mLateHelpers &= ~(1 << j);
+        mReclaimedTracks[j] = 0;
+        if (mStaleHelpers & (1 << j)) {
+            mStaleHelpers &= ~(1 << j);
+            releaseHelperMixer(j);
+        } else {
+            mLateMixes |= 1 << j;
+        }
+    }
+}
+
+void FastMixer::disableHelpers()
+{
+    const FastMixerState * const current = (const FastMixerState *) mCurrent;
+    const FastMixerState * const previous = (const FastMixerState *) mPrevious;
+    mHelpersDisabled = true;
+
+    // the tracks of the helpers are those of the previous state
+    unsigned helperTracks = mMixer != nullptr ? previous->mTrackMask : 0;
+    while (helperTracks != 0) {
+        const int i = __builtin_ctz(helperTracks);
+        helperTracks &= ~(1 << i);
+        const int partition = mTrackPartitions[i];
+        if (partition <= 0) {
+            continue;
+        }
+        --mPartitionTracks[partition];
+        if (!(current->mTrackMask & (1 << i))) {
+            // the track is being removed, so it need not be created again
+            mTrackPartitions[i] = -1;
+            continue;
+        }
+        // now that the helpers are disabled, this creates the track in our own partition
+        updateMixerTrack(i, REASON_ADD);
+        if (mLateHelpers & (1 << (partition - 1))) {
+            // the late helper may still use the buffer provider
+            mMixer->disable(i);
+            mReclaimedTracks[partition - 1] |= 1 << i;
+        }
+    }
+    // the late mixes and the mixers of the helpers which are still mixing are released once
+    // they complete
+    for (size_t j = 0; j < mHelperCount; ++j) {
+        if (!(mLateHelpers & (1 << j)) && !(mLateMixes & (1 << j))) {
+            releaseHelperMixer(j);
+        }
+    }
+}
+
+void FastMixer::releaseHelperMixer(int helper)
+{
+    // FIXME to avoid priority inversion, don't delete here
+    delete mHelperMixers[helper];
+    mHelperMixers[helper] = nullptr;
+    free(mHelperBuffers[helper]);
+    mHelperBuffers[helper] = nullptr;
+}
+
 bool FastMixer::isSubClassCommand(FastThreadState::Command command)
 {
     switch ((FastMixerState::Command) command) {
@@ -136,10 +247,23 @@ void FastMixer::updateMixerTrack(int index, Reason reason) {
 
     switch (reason) {
     case REASON_REMOVE:
-        mMixer->destroy(index);
+        if (mTrackPartitions[index] >= 0) {
+            partitionMixer(mTrackPartitions[index])->destroy(index);
+            --mPartitionTracks[mTrackPartitions[index]];
+        }
         break;
     case REASON_ADD: {
-        const status_t status = mMixer->create(
+        // assign the new track to the partition with the fewest tracks, preferring our own
+        // on a tie, so that a lone track does not need a hand-off to a helper
+        int partition = 0;
+        for (int p = 1; p <= (int) mHelperCount && !mHelpersDisabled; ++p) {
+            if (mPartitionTracks[p] < mPartitionTracks[partition]) {
+                partition = p;
+            }
+        }
+        mTrackPartitions[index] = partition;
+        ++mPartitionTracks[partition];
+        const status_t status = partitionMixer(partition)->create(
                 index, fastTrack->mChannelMask, fastTrack->mFormat, AUDIO_SESSION_OUTPUT_MIX);
         LOG_ALWAYS_FATAL_IF(status != NO_ERROR,
                 "%s: cannot create fast track index"
@@ -147,8 +271,10 @@ void FastMixer::updateMixerTrack(int index, Reason reason) {
                 __func__, index, fastTrack->mChannelMask, fastTrack->mFormat);
     }
         [[fallthrough]];  // now fallthrough to update the newly created track.
-    case REASON_MODIFY:
-        mMixer->setBufferProvider(index, fastTrack->mBufferProvider);
+    case REASON_MODIFY: {
+        const int partition = mTrackPartitions[index];
+        AudioMixer * const mixer = partitionMixer(partition);
+        mixer->setBufferProvider(index, fastTrack->mBufferProvider);
 
         float vlf, vrf;
         if (fastTrack->mVolumeProvider != nullptr) {
@@ -162,34 +288,53 @@ void FastMixer::updateMixerTrack(int index, Reason reason) {
         // set volume to avoid ramp whenever the track is updated (or created).
         // Note: this does not distinguish from starting fresh or
         // resuming from a paused state.
-        mMixer->setParameter(index, AudioMixer::VOLUME, AudioMixer::VOLUME0, &vlf);
-        mMixer->setParameter(index, AudioMixer::VOLUME, AudioMixer::VOLUME1, &vrf);
+        mixer->setParameter(index, AudioMixer::VOLUME, AudioMixer::VOLUME0, &vlf);
+        mixer->setParameter(index, AudioMixer::VOLUME, AudioMixer::VOLUME1, &vrf);
 
-        mMixer->setParameter(index, AudioMixer::RESAMPLE, AudioMixer::REMOVE, nullptr);
-        mMixer->setParameter(index, AudioMixer::TRACK, AudioMixer::MAIN_BUFFER,
-                (void *)mMixerBuffer);
-        mMixer->setParameter(index, AudioMixer::TRACK, AudioMixer::MIXER_FORMAT,
+        mixer->setParameter(index, AudioMixer::RESAMPLE, AudioMixer::REMOVE, nullptr);
+        mixer->setParameter(index, AudioMixer::TRACK, AudioMixer::MAIN_BUFFER,
+                partitionBuffer(partition));
+        mixer->setParameter(index, AudioMixer::TRACK, AudioMixer::MIXER_FORMAT,
                 (void *)(uintptr_t)mMixerBufferFormat);
-        mMixer->setParameter(index, AudioMixer::TRACK, AudioMixer::FORMAT,
+        mixer->setParameter(index, AudioMixer::TRACK, AudioMixer::FORMAT,
                 (void *)(uintptr_t)fastTrack->mFormat);
-        mMixer->setParameter(index, AudioMixer::TRACK, AudioMixer::CHANNEL_MASK,
+        mixer->setParameter(index, AudioMixer::TRACK, AudioMixer::CHANNEL_MASK,
                 (void *)(uintptr_t)fastTrack->mChannelMask);
-        mMixer->setParameter(index, AudioMixer::TRACK, AudioMixer::MIXER_CHANNEL_MASK,
+        mixer->setParameter(index, AudioMixer::TRACK, AudioMixer::MIXER_CHANNEL_MASK,
                 (void *)(uintptr_t)mSinkChannelMask);
-        mMixer->setParameter(index, AudioMixer::TRACK, AudioMixer::HAPTIC_ENABLED,
+        mixer->setParameter(index, AudioMixer::TRACK, AudioMixer::HAPTIC_ENABLED,
                 (void *)(uintptr_t)fastTrack->mHapticPlaybackEnabled);
-        mMixer->setParameter(index, AudioMixer::TRACK, AudioMixer::HAPTIC_SCALE,
+        mixer->setParameter(index, AudioMixer::TRACK, AudioMixer::HAPTIC_SCALE,
                 (void *)(&(fastTrack->mHapticScale)));
-        mMixer->setParameter(index, AudioMixer::TRACK, AudioMixer::HAPTIC_MAX_AMPLITUDE,
+        mixer->setParameter(index, AudioMixer::TRACK, AudioMixer::HAPTIC_MAX_AMPLITUDE,
                 (void *)(&(fastTrack->mHapticMaxAmplitude)));
 
-        mMixer->enable(index);
-        break;
+        mixer->enable(index);
+    } break;
     default:
         LOG_ALWAYS_FATAL("%s: invalid update reason %d", __func__, reason);
     }
 }
 
+unsigned FastMixer::pollTrackDeltas(int fastTracksGen)
+{
+    unsigned modified = 0;
+    int gen = mFastTracksGen;
+    bool complete = true;
+    const FastTrackDelta *delta;
+    // deltas for states newer than the current one may already be queued, so leave those
+    while ((delta = mDQ.front()) != nullptr &&
+            (int) ((unsigned) delta->mToGen - (unsigned) fastTracksGen) <= 0) {
+        if (delta->mFromGen != gen) {
+            complete = false;   // a delta is missing, or the chain started before a reconfigure
+        }
+        modified |= delta->mTrackMask;
+        gen = delta->mToGen;
+        mDQ.pop();
+    }
+    return complete && gen == fastTracksGen ? modified : ~0u;
+}
+
 void FastMixer::onStateChange()
 {
     const FastMixerState * const current = (const FastMixerState *) mCurrent;
@@ -201,6 +346,14 @@ void FastMixer::onStateChange()
     mTimestamp.mTimebaseOffset[ExtendedTimestamp::TIMEBASE_BOOTTIME] =
             mBoottimeOffset.load();
 
+    // The helper mixers may be reconfigured or deleted below, so any late mix must complete
+    // first.  A helper is a normal priority thread, so don't wait for it more than a mix period:
+    // mix all the tracks ourselves instead.
+    waitLateHelpers(mPeriodNs);
+    if (mLateHelpers != 0 && !mHelpersDisabled) {
+        disableHelpers();
+    }
+
     // handle state change here, but since we want to diff the state,
     // we're prepared for previous == &sInitial the first time through
     unsigned previousTrackMask;
@@ -241,6 +394,16 @@ void FastMixer::onStateChange()
         mMixerBuffer = nullptr;
         free(mSinkBuffer);
         mSinkBuffer = nullptr;
+        // the late mixes are for the previous format, and so are discarded
+        mLateMixes = 0;
+        for (size_t i = 0; i < mHelperCount; ++i) {
+            if (mLateHelpers & (1 << i)) {
+                // still mixing, so it is released once it completes
+                mStaleHelpers |= 1 << i;
+                continue;
+            }
+            releaseHelperMixer(i);
+        }
         if (frameCount > 0 && mSampleRate > 0) {
             // FIXME new may block for unbounded time at internal mutex of the heap
             //       implementation; it would be better to have normal mixer allocate for us
@@ -255,6 +418,10 @@ void FastMixer::onStateChange()
                     * audio_bytes_per_sample(mMixerBufferFormat);
             mMixerBufferSize = mixerFrameSize * frameCount;
             (void)posix_memalign(&mMixerBuffer, 32, mMixerBufferSize);
+            for (size_t i = 0; i < mHelperCount && !mHelpersDisabled; ++i) {
+                mHelperMixers[i] = new AudioMixer(frameCount, mSampleRate);
+                (void)posix_memalign(&mHelperBuffers[i], 32, mMixerBufferSize);
+            }
             const size_t sinkFrameSize = mSinkChannelCount
                     * audio_bytes_per_sample(mFormat.mFormat);
             if (sinkFrameSize > mixerFrameSize) { // need a sink buffer
@@ -278,6 +445,7 @@ void FastMixer::onStateChange()
         mMixerBufferState = UNDEFINED;
         // we need to reconfigure all active tracks
         previousTrackMask = 0;
+        std::fill(std::begin(mPartitionTracks), std::end(mPartitionTracks), 0);
         mFastTracksGen = current->mFastTracksGen - 1;
         dumpState->mFrameCount = frameCount;
 #ifdef TEE_SINK
@@ -312,8 +480,10 @@ void FastMixer::onStateChange()
         }
 
         // finally process (potentially) modified tracks; these use the same slot
-        // but may have a different buffer provider or volume provider
-        unsigned modifiedTracks = currentTrackMask & previousTrackMask;
+        // but may have a different buffer provider or volume provider.
+        // If the normal mixer told us which slots it modified, then only check those.
+        unsigned modifiedTracks = currentTrackMask & previousTrackMask
+                & pollTrackDeltas(current->mFastTracksGen);
         while (modifiedTracks != 0) {
             const int i = __builtin_ctz(modifiedTracks);
             modifiedTracks &= ~(1 << i);
@@ -322,6 +492,12 @@ void FastMixer::onStateChange()
 
         mFastTracksGen = current->mFastTracksGen;
     }
+
+    dumpState->mNumHelpers = mHelperCount;
+    dumpState->mHelpersDisabled = mHelpersDisabled;
+    for (size_t i = 0; i < mHelperCount; ++i) {
+        dumpState->mHelpers[i].mNumTracks = mPartitionTracks[i + 1];
+    }
 }
 
 void FastMixer::onWork()
@@ -353,9 +529,24 @@ void FastMixer::onWork()
     if ((command & FastMixerState::MIX) && (mMixer != nullptr) && mIsWarm) {
         ALOG_ASSERT(mMixerBuffer != nullptr);
 
+        // A helper that is still busy with a late mix cannot mix its partition this cycle, and
+        // the buffer providers of its tracks must be left alone until it completes.  A helper
+        // that has completed a late mix since the last cycle outputs it in place of mixing its
+        // partition this cycle: its tracks then play one cycle late, like after an underrun,
+        // rather than losing the frames that the late mix consumed.
+        waitLateHelpers(0 /* timeoutNs */);
+        const unsigned skippedPartitions = (mLateHelpers | mLateMixes) << 1;
+        unsigned skippedTracks = 0;
+        for (unsigned lateHelpers = mLateHelpers; lateHelpers != 0; ) {
+            const int j = __builtin_ctz(lateHelpers);
+            lateHelpers &= ~(1 << j);
+            skippedTracks |= mReclaimedTracks[j];
+        }
+
         // AudioMixer::mState.enabledTracks is undefined if mState.hook == process__validate,
-        // so we keep a side copy of enabledTracks
-        bool anyEnabledTracks = false;
+        // so we keep a side copy of enabledTracks, per partition: bit p is set if partition p
+        // has any enabled tracks
+        unsigned enabledPartitions = 0;
 
         // for each track, update volume and check for underrun
         unsigned currentTrackMask = current->mTrackMask;
@@ -364,6 +555,15 @@ void FastMixer::onWork()
             currentTrackMask &= ~(1 << i);
             const FastTrack* fastTrack = &current->mFastTracks[i];
 
+            const int partition = mTrackPartitions[i];
+            if ((skippedPartitions & (1 << partition)) || (skippedTracks & (1 << i))) {
+                if (partition == 0) {
+                    // reclaimed from a late helper, which may still use the buffer provider
+                    mMixer->disable(i);
+                }
+                continue;
+            }
+
             const int64_t trackFramesWrittenButNotPresented =
                 mNativeFramesWrittenButNotPresented;
             const int64_t trackFramesWritten = fastTrack->mBufferProvider->framesReleased();
@@ -383,13 +583,14 @@ void FastMixer::onWork()
             fastTrack->mBufferProvider->onTimestamp(perTrackTimestamp);
 
             const int name = i;
+            AudioMixer * const mixer = partitionMixer(partition);
             if (fastTrack->mVolumeProvider != nullptr) {
                 const gain_minifloat_packed_t vlr = fastTrack->mVolumeProvider->getVolumeLR();
                 float vlf = float_from_gain(gain_minifloat_unpack_left(vlr));
                 float vrf = float_from_gain(gain_minifloat_unpack_right(vlr));
 
-                mMixer->setParameter(name, AudioMixer::RAMP_VOLUME, AudioMixer::VOLUME0, &vlf);
-                mMixer->setParameter(name, AudioMixer::RAMP_VOLUME, AudioMixer::VOLUME1, &vrf);
+                mixer->setParameter(name, AudioMixer::RAMP_VOLUME, AudioMixer::VOLUME0, &vlf);
+                mixer->setParameter(name, AudioMixer::RAMP_VOLUME, AudioMixer::VOLUME1, &vrf);
             }
             // FIXME The current implementation of framesReady() for fast tracks
             // takes a tryLock, which can block
@@ -410,28 +611,74 @@ void FastMixer::onWork()
                 if (framesReady == 0) {
                     underruns.mBitFields.mEmpty++;
                     underruns.mBitFields.mMostRecent = UNDERRUN_EMPTY;
-                    mMixer->disable(name);
+                    mixer->disable(name);
                 } else {
                     // allow mixing partial buffer
                     underruns.mBitFields.mPartial++;
                     underruns.mBitFields.mMostRecent = UNDERRUN_PARTIAL;
-                    mMixer->enable(name);
-                    anyEnabledTracks = true;
+                    mixer->enable(name);
+                    enabledPartitions |= 1 << mTrackPartitions[i];
                 }
             } else {
                 underruns.mBitFields.mFull++;
                 underruns.mBitFields.mMostRecent = UNDERRUN_FULL;
-                mMixer->enable(name);
-                anyEnabledTracks = true;
+                mixer->enable(name);
+                enabledPartitions |= 1 << mTrackPartitions[i];
             }
             ftDump->mUnderruns = underruns;
             ftDump->mFramesReady = framesReady;
             ftDump->mFramesWritten = trackFramesWritten;
         }
 
-        if (anyEnabledTracks) {
+        if (enabledPartitions != 0 || mLateMixes != 0) {
+            // start the helpers first, so that they mix in parallel with our own partition
+            for (size_t j = 0; j < mHelperCount; ++j) {
+                if (enabledPartitions & (1 << (j + 1))) {
+                    mHelpers[j]->mix(mHelperMixers[j]);
+                }
+            }
             // process() is CPU-bound
-            mMixer->process();
+            if (enabledPartitions & 1) {
+                mMixer->process();
+            } else {
+                memset(mMixerBuffer, 0, mMixerBufferSize);
+            }
+            // then sum the sub-buses of the helpers, but don't let a helper that was preempted
+            // or throttled make the whole cycle late: output its mix in the next cycle instead
+            const nsecs_t waitDeadlineNs = systemTime(SYSTEM_TIME_MONOTONIC) + mOverrunNs;
+            for (size_t j = 0; j < mHelperCount; ++j) {
+                if (!(enabledPartitions & (1 << (j + 1)))) {
+                    continue;
+                }
+                FastMixerHelperDump *helperDump = &dumpState->mHelpers[j];
+                const nsecs_t waitStartNs = systemTime(SYSTEM_TIME_MONOTONIC);
+                const int64_t mixNs = mHelpers[j]->wait(std::max(waitDeadlineNs - waitStartNs,
+                        (nsecs_t) 0));
+                const nsecs_t waitNs = systemTime(SYSTEM_TIME_MONOTONIC) - waitStartNs;
+                if (mixNs < 0) {
+                    mLateHelpers |= 1 << j;
+                    helperDump->mLateMixes++;
+                    helperDump->mMaxWaitNs = std::max(helperDump->mMaxWaitNs, (uint32_t) waitNs);
+                    continue;
+                }
+                accumulate_float((float *)mMixerBuffer, (const float *)mHelperBuffers[j],
+                        mMixerBufferSize / sizeof(float));
+                helperDump->mMixes++;
+                helperDump->mLastMixNs = (uint32_t) mixNs;
+                helperDump->mMaxMixNs = std::max(helperDump->mMaxMixNs, (uint32_t) mixNs);
+                helperDump->mTotalMixNs += mixNs;
+                helperDump->mMaxWaitNs = std::max(helperDump->mMaxWaitNs, (uint32_t) waitNs);
+            }
+            // finally add the late mixes completed since the last cycle
+            while (mLateMixes != 0) {
+                const int j = __builtin_ctz(mLateMixes);
+                mLateMixes &= ~(1 << j);
+                accumulate_float((float *)mMixerBuffer, (const float *)mHelperBuffers[j],
+                        mMixerBufferSize / sizeof(float));
+                if (mHelpersDisabled) {
+                    releaseHelperMixer(j);
+                }
+            }
             mMixerBufferState = MIXED;
         } else if (mMixerBufferState != ZEROED) {
             mMixerBufferState = UNDEFINED;
@@ -17,8 +17,10 @@
 #pragma once
 
 #include <atomic>
+#include <vector>
 #include <audio_utils/Balance.h>
 #include "FastThread.h"
+#include "FastMixerHelper.h"
 #include "StateQueue.h"
 #include "FastMixerState.h"
 #include "FastMixerDumpState.h"
@@ -29,6 +31,7 @@ namespace android {
 class AudioMixer;
 
 using FastMixerStateQueue = StateQueue<FastMixerState>;
+using FastMixerDeltaQueue = StateDeltaQueue<FastTrackDelta>;
 
 class FastMixer : public FastThread {
 
@@ -38,6 +41,13 @@ public:
     explicit FastMixer(audio_io_handle_t threadIoHandle);
 
             FastMixerStateQueue* sq();
+            // optional, for the normal mixer to tell which fast tracks changed in each state
+            FastMixerDeltaQueue* dq();
+
+            // Start the helper threads, if this FastMixer is configured to use any.
+            // Must be called before run().  Returns the tids of the started helpers,
+            // so that the caller can raise their priority to match the FastMixer's.
+            std::vector<pid_t> runHelpers();
 
     virtual void setMasterMono(bool mono) { mMasterMono.store(mono); /* memory_order_seq_cst */ }
     virtual void setMasterBalance(float balance) { mMasterBalance.store(balance); }
@@ -47,6 +57,7 @@ public:
     }
 private:
             FastMixerStateQueue mSQ;
+            FastMixerDeltaQueue mDQ;
 
     // callouts
     const FastThreadState *poll() override;
@@ -65,6 +76,24 @@ private:
     // called when a fast track of index has been removed, added, or modified
     void updateMixerTrack(int index, Reason reason);
 
+    // consume the track deltas up to fastTracksGen, and return the mask of fast tracks which
+    // may have been modified since mFastTracksGen; all bits are set if the deltas are incomplete
+    unsigned pollTrackDeltas(int fastTracksGen);
+
+    // wait at most timeoutNs for each helper in mLateHelpers to complete its late mix, and move
+    // its bit to mLateMixes if it did; a negative timeoutNs waits indefinitely
+    void waitLateHelpers(int64_t timeoutNs);
+
+    // stop mixing on the helpers, and move their tracks to the FastMixer's own partition
+    void disableHelpers();
+
+    // delete the AudioMixer and sub-bus of a helper which is disabled and not mixing
+    void releaseHelperMixer(int helper);
+
+    // the AudioMixer and mix buffer of partition p; see mHelpers
+    AudioMixer* partitionMixer(int p) const { return p == 0 ? mMixer : mHelperMixers[p - 1]; }
+    void* partitionBuffer(int p) const { return p == 0 ? mMixerBuffer : mHelperBuffers[p - 1]; }
+
     // FIXME these former local variables need comments
     static const FastMixerState sInitial;
 
@@ -85,6 +114,29 @@ private:
     size_t          mMixerBufferSize = 0;
     static constexpr audio_format_t mMixerBufferFormat = AUDIO_FORMAT_PCM_FLOAT;
 
+    // The fast tracks may be partitioned between the FastMixer itself (partition 0) and its
+    // helper threads (partition i + 1 for helper i), so that the partitions are mixed in parallel.
+    // Each helper has its own AudioMixer and sub-bus, which is added into mMixerBuffer.
+    size_t          mHelperCount = 0;
+    sp<FastMixerHelper> mHelpers[FastMixerState::kMaxHelperThreads];
+    AudioMixer*     mHelperMixers[FastMixerState::kMaxHelperThreads]{};
+    void*           mHelperBuffers[FastMixerState::kMaxHelperThreads]{};   // mMixerBufferSize
+    int             mTrackPartitions[FastMixerState::kMaxFastTracks]{}; // partition of each track,
+                                        // or -1 if in no AudioMixer
+    unsigned        mLateHelpers = 0;   // bit i is set if helper i has not completed a mix in
+                                        // time; its AudioMixer and the buffer providers of its
+                                        // tracks must not be touched until it does
+    unsigned        mLateMixes = 0;     // bit i is set if helper i completed a late mix, which is
+                                        // output by the next cycle in place of its partition
+    unsigned        mStaleHelpers = 0;  // bit i is set if the late mix of helper i is for an
+                                        // earlier output format, and so must be discarded
+    bool            mHelpersDisabled = false;  // a helper was late at a state change, so all
+                                               // tracks are mixed by the FastMixer itself
+    unsigned        mReclaimedTracks[FastMixerState::kMaxHelperThreads]{}; // tracks moved off
+                                        // late helper i, not mixed until it completes
+    unsigned        mPartitionTracks[FastMixerState::kMaxHelperThreads + 1]{}; // tracks per
+                                                                               // partition
+
     // audio channel count, excludes haptic channels.  Set in onStateChange().
     uint32_t        mAudioChannelCount = 0;
 
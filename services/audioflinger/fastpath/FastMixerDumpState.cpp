@@ -61,6 +61,16 @@ void FastMixerDumpState::dump(int fd) const
                 mSampleRate, mFrameCount, measuredWarmupMs, mWarmupCycles,
                 mixPeriodSec * 1e3, mLatencyMs);
     dprintf(fd, "  FastMixer Timestamp stats: %s\n", mTimestampVerifier.toString().c_str());
+    for (uint32_t i = 0; i < mNumHelpers && i < FastMixerState::kMaxHelperThreads; ++i) {
+        const FastMixerHelperDump& helper = mHelpers[i];
+        const double meanMixMs = helper.mMixes > 0 ?
+                helper.mTotalMixNs * 1e-6 / helper.mMixes : 0.;
+        dprintf(fd, "  FastMixer helper %u: numTracks=%u mixes=%u mix last=%.3f mean=%.3f"
+                " max=%.3f ms, maxWait=%.3f ms, late=%u%s\n",
+                i, helper.mNumTracks, helper.mMixes, helper.mLastMixNs * 1e-6, meanMixMs,
+                helper.mMaxMixNs * 1e-6, helper.mMaxWaitNs * 1e-6, helper.mLateMixes,
+                mHelpersDisabled ? " (disabled)" : "");
+    }
 #ifdef FAST_THREAD_STATISTICS
     // find the interval of valid samples
     const uint32_t bounds = mBounds;
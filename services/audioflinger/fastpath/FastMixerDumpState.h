@@ -62,6 +62,20 @@ struct FastTrackDump {
 // No virtuals.
 static_assert(!std::is_polymorphic_v<FastTrackDump>);
 
+// Represents the dump state of a FastMixerHelper, as seen by the FastMixer
+struct FastMixerHelperDump {
+    uint32_t mNumTracks = 0;    // number of active fast tracks mixed by this helper
+    uint32_t mMixes = 0;        // total number of mixes
+    uint32_t mLastMixNs = 0;    // duration of most recent mix
+    uint32_t mMaxMixNs = 0;     // duration of longest mix
+    uint64_t mTotalMixNs = 0;   // total duration of all mixes
+    uint32_t mMaxWaitNs = 0;    // longest time the FastMixer waited for a mix to complete
+    uint32_t mLateMixes = 0;    // number of mixes not completed in time, so output a cycle late
+};
+
+// No virtuals.
+static_assert(!std::is_polymorphic_v<FastMixerHelperDump>);
+
 struct FastMixerDumpState : FastThreadDumpState {
     void dump(int fd) const;    // should only be called on a stable copy, not the original
 
@@ -74,6 +88,9 @@ struct FastMixerDumpState : FastThreadDumpState {
     size_t   mFrameCount = 0;
     uint32_t mTrackMask = 0;      // mask of active tracks
     FastTrackDump   mTracks[FastMixerState::kMaxFastTracks];
+    uint32_t mNumHelpers = 0;     // number of helper threads
+    bool     mHelpersDisabled = false; // helpers were disabled after a late mix at a state change
+    FastMixerHelperDump mHelpers[FastMixerState::kMaxHelperThreads];
 
     // For timestamp statistics.
     TimestampVerifier<int64_t /* frame count */, int64_t /* time ns */> mTimestampVerifier;
@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// <IMPORTANT_WARNING>
+// Design rules for threadLoop() are given in the comments at section "Fast mixer thread" of
+// StateQueue.h.  In particular, avoid library and system calls except at well-known points.
+// </IMPORTANT_WARNING>
+
+#define LOG_TAG "FastMixerHelper"
+//#define LOG_NDEBUG 0
+
+#define ATRACE_TAG ATRACE_TAG_AUDIO
+
+#include "Configuration.h"
+#include <linux/futex.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <cutils/atomic.h>
+#include <media/AudioMixer.h>
+#include <utils/Log.h>
+#include <utils/Timers.h>
+#include <utils/Trace.h>
+#include "FastMixerHelper.h"
+
+namespace android {
+
+FastMixerHelper::FastMixerHelper(int cpu) : Thread(false /*canCallJava*/), mCpu(cpu)
+{
+}
+
+void FastMixerHelper::mix(AudioMixer* mixer)
+{
+    mMixer = mixer;
+    // android_atomic_inc() is a full barrier, so the helper will observe mMixer
+    android_atomic_inc(&mRequest);
+    (void) syscall(__NR_futex, &mRequest, FUTEX_WAKE_PRIVATE, 1);
+}
+
+int64_t FastMixerHelper::wait(int64_t timeoutNs)
+{
+    // mRequest is only modified by this thread, so no barrier is needed to read it
+    const int32_t request = mRequest;
+    const nsecs_t deadlineNs = timeoutNs >= 0 ?
+            systemTime(SYSTEM_TIME_MONOTONIC) + timeoutNs : 0;
+    for (;;) {
+        const int32_t done = android_atomic_acquire_load(&mDone);
+        if (done == request) {
+            return mMixNs;
+        }
+        if (timeoutNs < 0) {
+            (void) syscall(__NR_futex, &mDone, FUTEX_WAIT_PRIVATE, done, nullptr);
+            continue;
+        }
+        // the helper may have been preempted or throttled, so don't wait past the deadline
+        const nsecs_t remainingNs = deadlineNs - systemTime(SYSTEM_TIME_MONOTONIC);
+        if (remainingNs <= 0) {
+            return -1;
+        }
+        const struct timespec ts = {
+            .tv_sec = (time_t) (remainingNs / 1000000000),
+            .tv_nsec = (long) (remainingNs % 1000000000),
+        };
+        (void) syscall(__NR_futex, &mDone, FUTEX_WAIT_PRIVATE, done, &ts);
+    }
+}
+
+void FastMixerHelper::stop()
+{
+    requestExit();
+    android_atomic_inc(&mRequest);
+    (void) syscall(__NR_futex, &mRequest, FUTEX_WAKE_PRIVATE, 1);
+    join();
+}
+
+status_t FastMixerHelper::readyToRun()
+{
+    if (mCpu >= 0) {
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        CPU_SET(mCpu, &cpuSet);
+        if (sched_setaffinity(0 /*pid*/, sizeof(cpuSet), &cpuSet) != 0) {
+            ALOGW("%s: unable to pin to cpu %d: %s", __func__, mCpu, strerror(errno));
+        }
+    }
+    return NO_ERROR;
+}
+
+bool FastMixerHelper::threadLoop()
+{
+    // wait for the next request
+    for (;;) {
+        const int32_t request = android_atomic_acquire_load(&mRequest);
+        if (request != mLastRequest) {
+            mLastRequest = request;
+            break;
+        }
+        (void) syscall(__NR_futex, &mRequest, FUTEX_WAIT_PRIVATE, request, nullptr);
+    }
+    if (exitPending()) {
+        return false;
+    }
+
+    const nsecs_t startNs = systemTime(SYSTEM_TIME_MONOTONIC);
+    {
+        ATRACE_NAME("helper mix");
+        // process() is CPU-bound
+        mMixer->process();
+    }
+    mMixNs = systemTime(SYSTEM_TIME_MONOTONIC) - startNs;
+
+    android_atomic_release_store(mLastRequest, &mDone);
+    (void) syscall(__NR_futex, &mDone, FUTEX_WAKE_PRIVATE, 1);
+    return true;
+}
+
+}   // namespace android
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <utils/Thread.h>
+
+namespace android {
+
+class AudioMixer;
+
+// A FastMixerHelper runs AudioMixer::process() on behalf of a FastMixer, for the partition of
+// fast tracks assigned to it, so that the partitions are mixed in parallel on separate cores.
+// Each partition has its own AudioMixer which mixes into a private sub-bus,
+// and the FastMixer sums the sub-buses into its own mix buffer.
+// The FastMixer owns and configures the AudioMixer, and may only do so between wait() and the
+// next mix().  Because the FastMixer waits for the helper every cycle, the design rules of
+// FastMixer::threadLoop() in StateQueue.h also apply to the helper's threadLoop().
+class FastMixerHelper : public Thread {
+
+public:
+    // cpu is the index of the core to pin the thread to, or -1 to leave the affinity unchanged
+    explicit FastMixerHelper(int cpu);
+
+    // FastMixer APIs
+
+    // Start mixing asynchronously, by calling mixer->process().
+    void    mix(AudioMixer* mixer);
+
+    // Wait at most timeoutNs for the mix started by mix() to complete, and return how long the
+    // helper spent in process(), in nanoseconds, or -1 if the mix has not completed in time.
+    // The mix then remains outstanding: the FastMixer must not touch the AudioMixer nor call
+    // mix() again until a later wait() succeeds.  A negative timeoutNs waits indefinitely.
+    int64_t wait(int64_t timeoutNs = -1);
+
+    // Ask the thread to exit, and wait for it to do so.  Must not be called during a mix.
+    void    stop();
+
+private:
+    // implement Thread APIs
+    status_t readyToRun() override;
+    bool threadLoop() override;
+
+    const int       mCpu;
+    AudioMixer*     mMixer = nullptr;       // written by FastMixer before incrementing mRequest
+    int64_t         mMixNs = 0;             // written by helper before releasing mDone
+
+    // futex words; both are sequence numbers of mix requests
+    int32_t         mRequest = 0;           // incremented by FastMixer to request a mix
+    int32_t         mDone = 0;              // set by helper to mRequest on completion
+    int32_t         mLastRequest = 0;       // only used by helper
+};  // class FastMixerHelper
+
+}   // namespace android
@@ -65,4 +65,27 @@ void FastMixerState::sMaxFastTracksInit()
     ALOGI("sMaxFastTracks = %u", sMaxFastTracks);
 }
 
+// static
+void StateQueueCopier<FastMixerState>::copy(
+        FastMixerState *dst, const FastMixerState& src, uint32_t parts)
+{
+    static_assert(FastMixerState::kMaxFastTracks <= sizeof(parts) * 8);
+    *static_cast<FastThreadState *>(dst) = src;
+    while (parts != 0) {
+        const int i = __builtin_ctz(parts);
+        parts &= ~(1u << i);
+        if (i >= (int) FastMixerState::kMaxFastTracks) {
+            // kAllParts: there are no more fast tracks
+            break;
+        }
+        dst->mFastTracks[i] = src.mFastTracks[i];
+    }
+    dst->mFastTracksGen = src.mFastTracksGen;
+    dst->mTrackMask = src.mTrackMask;
+    dst->mOutputSink = src.mOutputSink;
+    dst->mOutputSinkGen = src.mOutputSinkGen;
+    dst->mFrameCount = src.mFrameCount;
+    dst->mSinkChannelMask = src.mSinkChannelMask;
+}
+
 }   // namespace android
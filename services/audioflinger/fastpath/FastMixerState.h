@@ -27,6 +27,7 @@
 #include <media/nblog/NBLog.h>
 #include <vibrator/ExternalVibrationUtils.h>
 #include "FastThreadState.h"
+#include "StateQueue.h"
 
 namespace android {
 
@@ -61,6 +62,16 @@ struct FastTrack {
 // No virtuals.
 static_assert(!std::is_polymorphic_v<FastTrack>);
 
+// Identifies the fast track slots modified between two values of FastMixerState::mFastTracksGen.
+// Passed from normal mixer to fast mixer via a StateDeltaQueue, so that the fast mixer can skip
+// the slots that have not changed.  Consecutive deltas form a chain, where each mFromGen is the
+// previous mToGen; a missing link means the fast mixer must check all slots.
+struct FastTrackDelta {
+    int         mFromGen = 0;   // mFastTracksGen before the modifications
+    int         mToGen = 0;     // mFastTracksGen of the first state with all the modifications
+    unsigned    mTrackMask = 0; // bit i is set if mFastTracks[i] may have been modified
+};
+
 // Represents a single state of the fast mixer
 struct FastMixerState : FastThreadState {
     FastMixerState();
@@ -70,10 +81,14 @@ struct FastMixerState : FastThreadState {
     static constexpr unsigned kMaxFastTracks = 32;
     static constexpr unsigned kDefaultFastTracks = 8;
 
+    // Maximum number of helper threads which a FastMixer may use to mix fast tracks in parallel
+    static constexpr unsigned kMaxHelperThreads = 3;
+
     static unsigned sMaxFastTracks;             // Configured maximum number of fast tracks
     static pthread_once_t sMaxFastTracksOnce;   // Protects initializer for sMaxFastTracks
 
     // all pointer fields use raw pointers; objects are owned and ref-counted by the normal mixer
+    // Fields added below must also be copied by StateQueueCopier<FastMixerState>::copy().
     FastTrack   mFastTracks[kMaxFastTracks];
     int         mFastTracksGen = 0; // increment when any
                                     // mFastTracks[i].mGeneration is incremented
@@ -103,4 +118,10 @@ struct FastMixerState : FastThreadState {
 // No virtuals.
 static_assert(!std::is_polymorphic_v<FastMixerState>);
 
+// Most pushes modify few fast tracks, if any, so only copy the fast tracks that changed:
+// bit i of parts selects mFastTracks[i].
+template<> struct StateQueueCopier<FastMixerState> {
+    static void copy(FastMixerState *dst, const FastMixerState& src, uint32_t parts);
+};
+
 }   // namespace android
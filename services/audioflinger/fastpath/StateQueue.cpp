@@ -33,8 +33,8 @@ void StateQueueObserverDump::dump(int fd)
 
 void StateQueueMutatorDump::dump(int fd)
 {
-    dprintf(fd, "State queue mutator: pushDirty=%u pushAck=%u blockedSequence=%u\n",
-            mPushDirty, mPushAck, mBlockedSequence);
+    dprintf(fd, "State queue mutator: pushDirty=%u pushAck=%u blockedSequence=%u"
+            " deltaFull=%u\n", mPushDirty, mPushAck, mBlockedSequence, mDeltaFull);
 }
 #endif
 
@@ -63,13 +63,14 @@ template<typename T> T* StateQueue<T>::begin()
     return mMutating;
 }
 
-template<typename T> void StateQueue<T>::end(bool didModify)
+template<typename T> void StateQueue<T>::end(bool didModify, uint32_t modifiedParts)
 {
     ALOG_ASSERT(mInMutation, "end() called when not in a mutation");
     ALOG_ASSERT(mIsInitialized || didModify, "first end() must modify for initialization");
     if (didModify) {
         mIsDirty = true;
         mIsInitialized = true;
+        mMutatingParts |= modifiedParts;
     }
     mInMutation = false;
 }
@@ -128,11 +129,22 @@ template<typename T> bool StateQueue<T>::push(StateQueue<T>::block_t block)
         atomic_store_explicit(&mNext, (uintptr_t)mMutating, memory_order_release);
         mExpecting = mMutating;
 
+        mPushedParts[mExpecting - mStates] = mMutatingParts;
+        mMutatingParts = 0;
+
         // copy with circular wraparound
         if (++mMutating >= &mStates[kN]) {
             mMutating = &mStates[0];
         }
-        *mMutating = *mExpecting;
+        // The next slot already holds the state pushed from it kN pushes ago,
+        // so it only lacks the parts modified by the kN - 1 pushes since then.
+        uint32_t parts = 0;
+        for (unsigned i = 0; i < kN; ++i) {
+            if (&mStates[i] != mMutating) {
+                parts |= mPushedParts[i];
+            }
+        }
+        StateQueueCopier<T>::copy(mMutating, *mExpecting, parts);
         mIsDirty = false;
 
     }
@@ -168,6 +180,42 @@ template<typename T> bool StateQueue<T>::push(StateQueue<T>::block_t block)
     return true;
 }
 
+// Observer APIs
+
+template<typename D> const D* StateDeltaQueue<D>::front()
+{
+    const uint_fast32_t front = atomic_load_explicit(&mFront, memory_order_relaxed);
+    const uint_fast32_t rear = atomic_load_explicit(&mRear, memory_order_acquire);
+    return front != rear ? &mDeltas[front & (kN - 1)] : nullptr;
+}
+
+template<typename D> void StateDeltaQueue<D>::pop()
+{
+    const uint_fast32_t front = atomic_load_explicit(&mFront, memory_order_relaxed);
+    ALOG_ASSERT(front != atomic_load_explicit(&mRear, memory_order_relaxed),
+            "pop() called when empty");
+    // release so that the mutator does not overwrite the delta while we may still read it
+    atomic_store_explicit(&mFront, front + 1, memory_order_release);
+}
+
+// Mutator APIs
+
+template<typename D> bool StateDeltaQueue<D>::push(const D& delta)
+{
+    const uint_fast32_t rear = atomic_load_explicit(&mRear, memory_order_relaxed);
+    const uint_fast32_t front = atomic_load_explicit(&mFront, memory_order_acquire);
+    if (rear - front >= kN) {
+#ifdef STATE_QUEUE_DUMP
+        mMutatorDump->mDeltaFull++;
+#endif
+        return false;
+    }
+    mDeltas[rear & (kN - 1)] = delta;
+    // publish
+    atomic_store_explicit(&mRear, rear + 1, memory_order_release);
+    return true;
+}
+
 }   // namespace android
 
 // Instantiate StateQueue template for the types we need.
@@ -180,4 +228,5 @@ template<typename T> bool StateQueue<T>::push(StateQueue<T>::block_t block)
 namespace android {
 template class StateQueue<FastCaptureState>;
 template class StateQueue<FastMixerState>;
+template class StateDeltaQueue<FastTrackDelta>;
 }   // namespace android
@@ -17,6 +17,7 @@
 #pragma once
 
 #include <stdatomic.h>
+#include <stdint.h>
 
 // The state queue template class was originally driven by this use case / requirements:
 //  There are two threads: a fast mixer, and a normal mixer, and they share state.
@@ -111,22 +112,38 @@ struct StateQueueObserverDump {
 };
 
 struct StateQueueMutatorDump {
-    StateQueueMutatorDump() : mPushDirty(0), mPushAck(0), mBlockedSequence(0) { }
+    StateQueueMutatorDump() : mPushDirty(0), mPushAck(0), mBlockedSequence(0), mDeltaFull(0) { }
     /*virtual*/ ~StateQueueMutatorDump() { }
     unsigned    mPushDirty;       // incremented each time push() is called with a dirty state
     unsigned    mPushAck;         // incremented each time push(BLOCK_UNTIL_ACKED) is called
     unsigned    mBlockedSequence; // incremented before and after each time that push()
                                   // blocks for more than one PUSH_BLOCK_ACK_NS;
                                   // if odd, then mutator is currently blocked inside push()
+    unsigned    mDeltaFull;       // incremented each time StateDeltaQueue::push() finds no room
     void        dump(int fd);
 };
 #endif
 
+// Copies the most recently pushed state into the next slot to be mutated.
+// The mutator may tell StateQueue::end() which parts of the state it modified; |parts| is then
+// the union of the parts modified since |dst| was last pushed, and only those need to be copied.
+// The meaning of each bit is up to T, and anything not covered by a bit must always be copied.
+// The default copies the entire state; specialize for states that are expensive to copy.
+template<typename T> struct StateQueueCopier {
+    static void copy(T *dst, const T& src, uint32_t /*parts*/) { *dst = src; }
+};
+
 // manages a FIFO queue of states
 // marking as final to avoid derived classes as there are no virtuals.
 template<typename T> class StateQueue final {
 
 public:
+    StateQueue() {
+        for (uint32_t& parts : mPushedParts) {
+            parts = kAllParts;  // slots that were never pushed to need a full copy
+        }
+    }
+
     // Observer APIs
 
     // Poll for a state change.  Returns a pointer to a read-only state,
@@ -150,7 +167,10 @@ public:
     // If didModify is true, then the state is marked dirty (in need of pushing).
     // There is no rollback option because modifications are done in place.
     // Does not automatically push the new state onto the state queue.
-    void    end(bool didModify = true);
+    // If didModify is true, modifiedParts tells which parts of the state were modified,
+    // as interpreted by StateQueueCopier<T>; by default the entire state is assumed modified.
+    static constexpr uint32_t kAllParts = ~0u;
+    void    end(bool didModify = true, uint32_t modifiedParts = kAllParts);
 
     // Push a new state, if any, out to the observer via the state queue.
     // For BLOCK_NEVER, returns:
@@ -198,6 +218,8 @@ private:
     bool        mInMutation = false;    // whether we're currently in the middle of a mutation
     bool        mIsDirty = false;       // whether mutating state has been modified since last push
     bool        mIsInitialized = false; // whether mutating state has been initialized yet
+    uint32_t    mMutatingParts = 0;     // parts of mutating state modified since last push
+    uint32_t    mPushedParts[kN];       // parts modified by the last push from each slot
 
 #ifdef STATE_QUEUE_DUMP
     StateQueueObserverDump  mObserverDummyDump; // default area for observer dump if not set
@@ -210,4 +232,50 @@ private:
 
 };  // class StateQueue
 
+// A bounded FIFO of state deltas, for use alongside a StateQueue when the observer would rather
+// apply only the part of a state that changed than compare the entire state against the previous.
+// It has the same single observer and single mutator as the StateQueue, and is lock-free:
+// neither side ever blocks, and the mutator is told when the FIFO is full.
+// The mutator may push a delta before the state it describes, so each delta should identify the
+// state(s) it applies to, and the observer must not consume a delta newer than its current state.
+// Deltas should contain only POD, as they are copied by assignment and never destroyed.
+template<typename D> class StateDeltaQueue final {
+
+public:
+    // Observer APIs
+
+    // Returns a pointer to the oldest delta, or nullptr if there are none.
+    // The delta remains valid and unchanged until it is removed by pop().
+    const D* front();
+
+    // Remove the oldest delta; there must be one.
+    void    pop();
+
+    // Mutator APIs
+
+    // Append a delta.  Returns true if appended, or false if the FIFO is full.
+    // On failure, the mutator should merge this delta into its next push.
+    bool    push(const D& delta);
+
+#ifdef STATE_QUEUE_DUMP
+    // Register location of mutator dump area
+    void    setMutatorDump(StateQueueMutatorDump *dump)
+            { mMutatorDump = dump != NULL ? dump : &mMutatorDummyDump; }
+#endif
+
+private:
+    static const unsigned kN = 16;      // must be a power of 2
+    D                 mDeltas[kN];      // written by mutator, read by observer
+
+    atomic_uint_fast32_t mRear{};       // written by mutator, read by observer
+    atomic_uint_fast32_t mFront{};      // written by observer, read by mutator
+
+#ifdef STATE_QUEUE_DUMP
+    StateQueueMutatorDump   mMutatorDummyDump;  // default area for mutator dump if not set
+    // pointer to active mutator dump, always non-nullptr
+    StateQueueMutatorDump*  mMutatorDump{&mMutatorDummyDump};
+#endif
+
+};  // class StateDeltaQueue
+
 }   // namespace android
@@ -0,0 +1,90 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "statequeue_tests"
+
+#include "fastpath/FastMixerState.h"
+#include "fastpath/StateQueue.h"
+
+#include <gtest/gtest.h>
+
+using namespace android;
+
+namespace {
+
+// More pushes than StateQueue has slots, so that every slot is reused.
+constexpr unsigned kPushes = 9;
+
+// Pushes the state being mutated, and acknowledges it as the fast mixer would.
+const FastMixerState* pushAndPoll(StateQueue<FastMixerState>& sq) {
+    EXPECT_TRUE(sq.push(StateQueue<FastMixerState>::BLOCK_NEVER));
+    return sq.poll();
+}
+
+// Track i has generation i + 1 once push i has been made, and 0 before.
+void expectTracksPushed(const FastMixerState& state, unsigned pushes) {
+    for (unsigned i = 0; i < kPushes; ++i) {
+        EXPECT_EQ(i < pushes ? int(i + 1) : 0, state.mFastTracks[i].mGeneration)
+                << "track " << i << " after " << pushes << " pushes";
+    }
+    EXPECT_EQ(int(pushes), state.mFastTracksGen);
+}
+
+}  // namespace
+
+// Each push modifies a different fast track. The slots are copied with only the parts
+// pushed since they were last used, and must still hold every modification.
+TEST(StateQueueTest, DisjointPartsReachEverySlot) {
+    StateQueue<FastMixerState> sq;
+    for (unsigned i = 0; i < kPushes; ++i) {
+        FastMixerState* state = sq.begin();
+        expectTracksPushed(*state, i);
+        state->mFastTracks[i].mGeneration = i + 1;
+        state->mFastTracksGen = i + 1;
+        // the first push must copy all the parts to initialize the other slots
+        sq.end(true /* didModify */,
+                i == 0 ? StateQueue<FastMixerState>::kAllParts : 1u << i);
+        const FastMixerState* pushed = pushAndPoll(sq);
+        ASSERT_NE(nullptr, pushed);
+        expectTracksPushed(*pushed, i + 1);
+    }
+    expectTracksPushed(*sq.begin(), kPushes);
+    sq.end(false /* didModify */);
+}
+
+// A mutation without modification does not push, and the parts of the mutations that
+// follow it still reach every slot.
+TEST(StateQueueTest, UnmodifiedMutationsKeepParts) {
+    StateQueue<FastMixerState> sq;
+    for (unsigned i = 0; i < kPushes; ++i) {
+        FastMixerState* state = sq.begin();
+        state->mFastTracks[i].mGeneration = i + 1;
+        state->mFastTracksGen = i + 1;
+        sq.end(true /* didModify */,
+                i == 0 ? StateQueue<FastMixerState>::kAllParts : 1u << i);
+
+        // a mutation that changes nothing
+        expectTracksPushed(*sq.begin(), i + 1);
+        sq.end(false /* didModify */);
+
+        ASSERT_NE(nullptr, pushAndPoll(sq));
+        // nothing is dirty, so this does not push again
+        EXPECT_TRUE(sq.push(StateQueue<FastMixerState>::BLOCK_NEVER));
+        expectTracksPushed(*sq.poll(), i + 1);
+    }
+    expectTracksPushed(*sq.begin(), kPushes);
+    sq.end(false /* didModify */);
+}
@@ -2027,9 +2027,11 @@ audio_io_handle_t AudioPolicyManager::selectOutput(const SortedVector<audio_io_h
         }
     }
 
-    // Flags disqualifying an output: the match must happen before calling selectOutput()
+    // Flags disqualifying an output: the match must happen before calling selectOutput().
+    // A mix port with AUDIO_OUTPUT_FLAG_MMAP_NOIRQ but not AUDIO_OUTPUT_FLAG_DIRECT is not
+    // disqualified: it opts in to a mixer output rendering into the HAL MMAP buffer.
     static const audio_output_flags_t kExcludedFlags = (audio_output_flags_t)
-        (AUDIO_OUTPUT_FLAG_HW_AV_SYNC | AUDIO_OUTPUT_FLAG_MMAP_NOIRQ | AUDIO_OUTPUT_FLAG_DIRECT);
+        (AUDIO_OUTPUT_FLAG_HW_AV_SYNC | AUDIO_OUTPUT_FLAG_DIRECT);
 
     // Flags expressing a functional request: must be honored in priority over
     // other criteria
@@ -40,6 +40,7 @@
 #include <media/ShmemCompat.h>
 #include <mediautils/SchedulingPolicyService.h>
 #include <mediautils/ServiceUtilities.h>
+#include <utils/SystemClock.h>
 #include <utils/Thread.h>
 
 #include "Spatializer.h"
@@ -977,6 +978,7 @@ status_t Spatializer::attachOutput(audio_io_handle_t output, size_t numActiveTra
             mSupportedLatencyModes = latencyModes;
             sortSupportedLatencyModes_l();
         }
+        updateOutputLatency_l();
 
         checkEngineState_l();
         if (mSupportsHeadTracking) {
@@ -1018,6 +1020,7 @@ audio_io_handle_t Spatializer::detachOutput() {
         AudioSystem::removeSupportedLatencyModesCallback(this);
         output = mOutput;
         mOutput = AUDIO_IO_HANDLE_NONE;
+        mOutputLatencyMs = 0;
         mPoseController.reset();
         callback = mSpatializerCallback;
     }
@@ -1142,6 +1145,14 @@ void Spatializer::checkSensorsState_l() {
                 AudioSystem::setRequestedLatencyMode(mOutput, requestedLatencyMode);
         ALOGD("%s: setRequestedLatencyMode for output thread(%d) to %s returned %d", __func__,
               mOutput, toString(requestedLatencyMode).c_str(), status);
+        updateOutputLatency_l();
+    }
+}
+
+void Spatializer::updateOutputLatency_l() {
+    if (mOutput == AUDIO_IO_HANDLE_NONE
+            || AudioSystem::getLatency(mOutput, &mOutputLatencyMs) != OK) {
+        mOutputLatencyMs = 0;
     }
 }
 
@@ -1183,7 +1194,13 @@ void Spatializer::calculateHeadPose() {
     ALOGV("%s", __func__);
     audio_utils::lock_guard lock(mMutex);
     if (mPoseController != nullptr) {
-        mPoseController->calculateAsync();
+        // The engine renders the next buffer with the pose calculated now, and that buffer
+        // reaches the listener after the output latency.
+        std::optional<int64_t> presentationTimestamp;
+        if (mOutputLatencyMs > 0) {
+            presentationTimestamp = elapsedRealtimeNano() + mOutputLatencyMs * 1'000'000LL;
+        }
+        mPoseController->calculateAsync(presentationTimestamp);
     }
 }
 
@@ -409,6 +409,12 @@ private:
      */
     void sortSupportedLatencyModes_l() REQUIRES(mMutex);
 
+    /**
+     * Reads the latency of mOutput into mOutputLatencyMs, used to predict the head pose up to
+     * the time the audio is heard.
+     */
+    void updateOutputLatency_l() REQUIRES(mMutex);
+
     /**
      * Called after enabling head tracking in the spatializer engine to indicate which
      * connection mode should be used among those supported. The selection depends on
@@ -442,6 +448,8 @@ private:
     sp<AudioEffect> mEngine GUARDED_BY(mMutex);
     /** Output stream the spatializer mixer thread is attached to */
     audio_io_handle_t mOutput GUARDED_BY(mMutex) = AUDIO_IO_HANDLE_NONE;
+    /** Latency of mOutput, 0 if unknown */
+    uint32_t mOutputLatencyMs GUARDED_BY(mMutex) = 0;
 
     /** Callback interface to the client (AudioService) controlling this`Spatializer */
     sp<media::INativeSpatializerCallback> mSpatializerCallback GUARDED_BY(mMutex);
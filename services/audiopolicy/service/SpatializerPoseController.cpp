@@ -35,6 +35,7 @@ using media::createHeadTrackingProcessor;
 using media::HeadTrackingMode;
 using media::HeadTrackingProcessor;
 using media::Pose3f;
+using media::PoseSample;
 using media::SensorPoseProvider;
 using media::Twist3f;
 
@@ -102,19 +103,15 @@ SpatializerPoseController::SpatializerPoseController(Listener* listener,
                                         std::optional<std::chrono::microseconds> maxUpdatePeriod)
     : mListener(listener),
       mSensorPeriod(sensorPeriod),
+      mPredictionDurationPropertyMs(
+              property_get_int32("audio.spatializer.prediction_duration_ms", -1)),
       mProcessor(createHeadTrackingProcessor(HeadTrackingProcessor::Options{
               .maxTranslationalVelocity = kMaxTranslationalVelocity / kTicksPerSecond,
               .maxRotationalVelocity = kMaxRotationalVelocity / kTicksPerSecond,
               .freshnessTimeout = Ticks(kFreshnessTimeout).count(),
-              .predictionDuration = []() -> float {
-                  const int duration_ms =
-                          property_get_int32("audio.spatializer.prediction_duration_ms", -1);
-                  if (duration_ms >= 0) {
-                      return duration_ms * 1'000'000LL;
-                  } else {
-                      return Ticks(kPredictionDuration).count();
-                  }
-              }(),
+              .predictionDuration = static_cast<float>(mPredictionDurationPropertyMs >= 0
+                      ? mPredictionDurationPropertyMs * 1'000'000LL
+                      : Ticks(kPredictionDuration).count()),
               .autoRecenterWindowDuration = Ticks(kAutoRecenterWindowDuration).count(),
               .autoRecenterTranslationalThreshold = kAutoRecenterTranslationThreshold,
               .autoRecenterRotationalThreshold = kAutoRecenterRotationThreshold,
@@ -184,7 +181,7 @@ void SpatializerPoseController::setHeadSensor(int32_t sensor) {
     std::lock_guard lock(mMutex);
     if (sensor == mHeadSensor) return;
     ALOGV("%s: new sensor:%d  mHeadSensor:%d  mScreenSensor:%d",
-            __func__, sensor, mHeadSensor, mScreenSensor);
+            __func__, sensor, mHeadSensor.load(), mScreenSensor.load());
 
     // Stop current sensor, if valid and different from the other sensor.
     if (mHeadSensor != INVALID_SENSOR && mHeadSensor != mScreenSensor) {
@@ -210,7 +207,7 @@ void SpatializerPoseController::setHeadSensor(int32_t sensor) {
             }
         } else {
             // Sensor is already enabled.
-            mHeadSensor = mScreenSensor;
+            mHeadSensor = mScreenSensor.load();
         }
     } else {
         mHeadSensor = INVALID_SENSOR;
@@ -223,7 +220,7 @@ void SpatializerPoseController::setScreenSensor(int32_t sensor) {
     std::lock_guard lock(mMutex);
     if (sensor == mScreenSensor) return;
     ALOGV("%s: new sensor:%d  mHeadSensor:%d  mScreenSensor:%d",
-            __func__, sensor, mHeadSensor, mScreenSensor);
+            __func__, sensor, mHeadSensor.load(), mScreenSensor.load());
 
     // Stop current sensor, if valid and different from the other sensor.
     if (mScreenSensor != INVALID_SENSOR && mScreenSensor != mHeadSensor) {
@@ -247,7 +244,7 @@ void SpatializerPoseController::setScreenSensor(int32_t sensor) {
                 .record();
         } else {
             // Sensor is already enabled.
-            mScreenSensor = mHeadSensor;
+            mScreenSensor = mHeadSensor.load();
         }
     } else {
         mScreenSensor = INVALID_SENSOR;
@@ -271,8 +268,9 @@ void SpatializerPoseController::setDisplayOrientation(float physicalToLogicalAng
     mProcessor->setDisplayOrientation(physicalToLogicalAngle);
 }
 
-void SpatializerPoseController::calculateAsync() {
+void SpatializerPoseController::calculateAsync(std::optional<int64_t> presentationTimestamp) {
     std::lock_guard lock(mMutex);
+    mPresentationTimestamp = presentationTimestamp;
     mShouldCalculate = true;
     mCondVar.notify_all();
 }
@@ -288,6 +286,26 @@ SpatializerPoseController::calculate_l() {
     HeadTrackingMode mode;
     std::optional<media::HeadTrackingMode> modeIfChanged;
 
+    if (mPredictionDurationPropertyMs < 0) {
+        mProcessor->setPresentationTimestamp(mPresentationTimestamp);
+    }
+    // Take the recenter request before reading the channel: onPose() raises it after writing
+    // the new reference pose, so that pose, or a later one, is read below.
+    const bool recenterHead = mHeadRecenterPending.exchange(false);
+    // Only the latest head pose matters, poses received since the last calculation and
+    // overwritten in the channel are skipped. The processor, and its head stillness detector,
+    // thus see one pose per calculation rather than every sensor event. If the channel could
+    // not be read, the processor keeps the last pose and the read is retried next time.
+    if (const uint32_t count = mHeadPoseChannel.getWriteCount(); count != mHeadPoseCount) {
+        if (const std::optional<PoseSample> sample = mHeadPoseChannel.read()) {
+            mHeadPoseCount = count;
+            mProcessor->setWorldToHeadPose(sample->timestamp, sample->pose, sample->twist);
+        }
+    }
+    if (recenterHead) {
+        mProcessor->recenter(true /* recenterHead */, false /* recenterScreen */, "onPose");
+    }
+
     mProcessor->calculate(elapsedRealtimeNano());
     headToStage = mProcessor->getHeadToStagePose();
     mode = mProcessor->getActualMode();
@@ -305,7 +323,6 @@ void SpatializerPoseController::recenter() {
 
 void SpatializerPoseController::onPose(int64_t timestamp, int32_t sensor, const Pose3f& pose,
                                        const std::optional<Twist3f>& twist, bool isNewReference) {
-    std::lock_guard lock(mMutex);
     constexpr float NANOS_TO_MILLIS = 1e-6;
     constexpr float RAD_TO_DEGREE = 180.f / M_PI;
 
@@ -336,13 +353,19 @@ void SpatializerPoseController::onPose(int64_t timestamp, int32_t sensor, const
         mHeadSensorRecorder.record(pryprydt);
         mHeadSensorDurableRecorder.record(pryprydt);
 
-        mProcessor->setWorldToHeadPose(timestamp, pose,
-                                       twist.value_or(Twist3f()) / kTicksPerSecond);
+        // The recenter flag is raised after the write. calculate_l() takes the flag before it
+        // reads the channel, so when it recenters it has read this pose or a later one.
+        mHeadPoseChannel.write(PoseSample{
+                .timestamp = timestamp,
+                .pose = pose,
+                .twist = twist.value_or(Twist3f()) / kTicksPerSecond,
+        });
         if (isNewReference) {
-            mProcessor->recenter(true, false, __func__);
+            mHeadRecenterPending = true;
         }
     }
     if (sensor == mScreenSensor) {
+        std::lock_guard lock(mMutex);
         std::vector<float> pryt{ 0.f, 0.f, 0.f, delayMs}; // pitch, roll, yaw, timestamp_delay
         media::quaternionToAngles(pose.rotation(), &pryt[0], &pryt[1], &pryt[2]);
         for (size_t i = 0; i < 3; ++i) {
@@ -378,7 +401,7 @@ std::string SpatializerPoseController::toString(unsigned level) const {
         base::StringAppendF(&ss, "HeadSensor: 0x%08x "
             "(active world-to-head : head-relative velocity) "
             "[ pitch, roll, yaw : d_pitch, d_roll, d_yaw : disc : delay ] "
-            "(degrees, degrees/s, bool, ms)\n", mHeadSensor);
+            "(degrees, degrees/s, bool, ms)\n", mHeadSensor.load());
         ss.append(prefixSpace)
             .append(" PerMinuteHistory:\n")
             .append(mHeadSensorDurableRecorder.toString(level + 3))
@@ -393,7 +416,7 @@ std::string SpatializerPoseController::toString(unsigned level) const {
     } else {
         base::StringAppendF(&ss, "ScreenSensor: 0x%08x (active world-to-screen) "
             "[ pitch, roll, yaw : delay ] "
-            "(degrees, ms)\n", mScreenSensor);
+            "(degrees, ms)\n", mScreenSensor.load());
         ss.append(prefixSpace)
             .append(" PerMinuteHistory:\n")
             .append(mScreenSensorDurableRecorder.toString(level + 3))
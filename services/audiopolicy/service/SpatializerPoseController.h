@@ -15,6 +15,7 @@
  */
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <limits>
@@ -23,6 +24,7 @@
 #include <thread>
 
 #include <media/HeadTrackingProcessor.h>
+#include <media/PoseChannel.h>
 #include <media/SensorPoseProvider.h>
 #include <media/VectorRecorder.h>
 
@@ -34,6 +36,8 @@ namespace android {
  * necessary processing, etc.
  *
  * Calculations happen on a dedicated thread and published to the client via the Listener interface.
+ * Head poses are handed from the sensor thread to the calculation thread through a lock-free
+ * PoseChannel, so the sensor thread never waits for a calculation, a sensor change or a dump.
  * A calculation may be triggered in one of two ways:
  * - By calling calculateAsync() - calculation will be kicked off in the background.
  * - By setting a timeout in the ctor, a calculation will be triggered after the timeout elapsed
@@ -105,8 +109,11 @@ class SpatializerPoseController : private media::SensorPoseProvider::Listener {
     /**
      * This call triggers the recalculation of the output and the invocation of the relevant
      * callbacks. This call is async and the callbacks will be triggered shortly after.
+     * presentationTimestamp is when the audio rendered with the result will be heard, in the
+     * elapsedRealtimeNano() time base. The head pose is predicted up to that time, or by a fixed
+     * duration if it is nullopt or if a duration is forced by property.
      */
-    void calculateAsync();
+    void calculateAsync(std::optional<int64_t> presentationTimestamp = std::nullopt);
 
     /**
      * Blocks until calculation and invocation of the respective callbacks has happened at least
@@ -121,9 +128,18 @@ class SpatializerPoseController : private media::SensorPoseProvider::Listener {
     mutable std::timed_mutex mMutex;
     Listener* const mListener;
     const std::chrono::microseconds mSensorPeriod;
+    // audio.spatializer.prediction_duration_ms, negative if not set
+    const int32_t mPredictionDurationPropertyMs;
     std::unique_ptr<media::HeadTrackingProcessor> mProcessor;
-    int32_t mHeadSensor = media::SensorPoseProvider::INVALID_HANDLE;
-    int32_t mScreenSensor = media::SensorPoseProvider::INVALID_HANDLE;
+    // written with mMutex held, read without it by the sensor thread
+    std::atomic<int32_t> mHeadSensor = media::SensorPoseProvider::INVALID_HANDLE;
+    std::atomic<int32_t> mScreenSensor = media::SensorPoseProvider::INVALID_HANDLE;
+    // latest head pose, written by the sensor thread
+    media::PoseChannel mHeadPoseChannel;
+    std::atomic<bool> mHeadRecenterPending = false;
+    // mHeadPoseChannel write count at the last calculation
+    uint32_t mHeadPoseCount = 0;
+    std::optional<int64_t> mPresentationTimestamp;
     std::optional<media::HeadTrackingMode> mActualMode;
     std::condition_variable_any mCondVar;
     bool mShouldCalculate = true;
@@ -3268,6 +3268,60 @@ TEST_F(AudioPolicyManagerTVTest, MatchOutputDirectMMapNoIrq) {
             "low latency");
 }
 
+class AudioPolicyManagerMmapMixerTest : public AudioPolicyManagerTestWithConfigurationFile {
+protected:
+    std::string getConfigFile() override { return sMmapMixerConfig; }
+    void testPortSelection(audio_output_flags_t flags, const char* expectedMixPortName);
+
+    static const std::string sMmapMixerConfig;
+};
+
+const std::string AudioPolicyManagerMmapMixerTest::sMmapMixerConfig =
+        AudioPolicyManagerMmapMixerTest::sExecutableDir + "test_mmap_mixer_configuration.xml";
+
+// SwAudioOutputDescriptor doesn't populate flags so check against the port name.
+void AudioPolicyManagerMmapMixerTest::testPortSelection(
+        audio_output_flags_t flags, const char* expectedMixPortName) {
+    audio_port_handle_t selectedDeviceId = AUDIO_PORT_HANDLE_NONE;
+    audio_io_handle_t output = AUDIO_IO_HANDLE_NONE;
+    audio_port_handle_t portId;
+    getOutputForAttr(&selectedDeviceId, AUDIO_FORMAT_PCM_16_BIT, AUDIO_CHANNEL_OUT_STEREO,
+            k48000SamplingRate, flags, &output, &portId);
+    sp<SwAudioOutputDescriptor> outDesc = mManager->getOutputs().valueFor(output);
+    ASSERT_NE(nullptr, outDesc.get());
+    audio_port_v7 port = {};
+    outDesc->toAudioPort(&port);
+    mManager->releaseOutput(portId);
+    ASSERT_EQ(AUDIO_PORT_TYPE_MIX, port.type);
+    ASSERT_EQ(AUDIO_PORT_ROLE_SOURCE, port.role);
+    ASSERT_STREQ(expectedMixPortName, port.name);
+}
+
+TEST_F(AudioPolicyManagerMmapMixerTest, InitSuccess) {
+    // SetUp must finish with no assertions.
+}
+
+TEST_F(AudioPolicyManagerMmapMixerTest, MixedOutputIsOpened) {
+    // the MMAP port without DIRECT is opened at init, like other mixed outputs
+    bool found = false;
+    for (size_t i = 0; i < mManager->getOutputs().size(); ++i) {
+        audio_port_v7 port = {};
+        mManager->getOutputs().valueAt(i)->toAudioPort(&port);
+        found = found || strcmp("mmap mixer", port.name) == 0;
+    }
+    ASSERT_TRUE(found);
+}
+
+TEST_F(AudioPolicyManagerMmapMixerTest, FastTrackSelectsMmapMixer) {
+    testPortSelection(AUDIO_OUTPUT_FLAG_FAST, "mmap mixer");
+}
+
+TEST_F(AudioPolicyManagerMmapMixerTest, MmapRequestSelectsDirect) {
+    testPortSelection(static_cast<audio_output_flags_t>(
+                    AUDIO_OUTPUT_FLAG_DIRECT|AUDIO_OUTPUT_FLAG_MMAP_NOIRQ),
+            "mmap direct");
+}
+
 class AudioPolicyManagerDynamicHwModulesTest : public AudioPolicyManagerTestWithConfigurationFile {
 protected:
     void SetUpManagerConfig() override;